@@ -0,0 +1,120 @@
+// Compares the per value FFI serializer (`Serialized`) against the bulk
+// native codec (`Codec`) on whole columns. Prints rows/sec for both.
+//
+//   ./codec-bench [rows]
+
+#include <chrono>
+#include <cstdlib>
+#include <fmt/core.h>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "../src/lib/codec.hpp"
+#include "../src/lib/serializer.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+template <typename F> double rows_per_sec(std::size_t rows, F &&run) {
+  auto start = Clock::now();
+  run();
+  std::chrono::duration<double> elapsed = Clock::now() - start;
+  return static_cast<double>(rows) / elapsed.count();
+}
+
+void report(const std::string &what, double before, double after) {
+  fmt::print("{:<14} {:>16.0f} {:>16.0f} {:>9.1f}x\n", what, before, after,
+             after / before);
+}
+
+template <typename T>
+void bench_fixed(const std::string &name, std::size_t rows,
+                 T (*decoder)(uint8_t *, uint64_t)) {
+  std::vector<T> values(rows);
+  std::iota(values.begin(), values.end(), T{});
+
+  std::vector<std::uint8_t> file;
+  double encode_before = rows_per_sec(rows, [&] {
+    file.clear();
+    for (auto value : values) {
+      Serialized serialized = Serialized::serialize(value);
+      file.insert(file.end(), serialized.data(),
+                  serialized.data() + serialized.len());
+    }
+  });
+
+  std::vector<std::uint8_t> bulk(rows * sizeof(T));
+  double encode_after = rows_per_sec(rows, [&] {
+    Codec::encode(std::span<const T>(values), bulk.data());
+  });
+
+  std::vector<T> decoded;
+  double decode_before = rows_per_sec(rows, [&] {
+    decoded.clear();
+    for (std::size_t i = 0; i < file.size(); i += sizeof(T))
+      decoded.push_back(decoder(&file[i], sizeof(T)));
+  });
+
+  std::vector<T> decoded_bulk(rows);
+  double decode_after = rows_per_sec(
+      rows, [&] { Codec::decode(bulk.data(), rows, decoded_bulk.data()); });
+
+  if (file != bulk || decoded != decoded_bulk)
+    fmt::print("!! {} encodings differ\n", name);
+
+  report(name + " encode", encode_before, encode_after);
+  report(name + " decode", decode_before, decode_after);
+}
+
+void bench_str(std::size_t rows, std::uint64_t size) {
+  std::vector<std::string> values;
+  values.reserve(rows);
+  for (std::size_t i = 0; i < rows; i++)
+    values.push_back(fmt::format("value-{}", i));
+
+  std::vector<std::uint8_t> file;
+  double encode_before = rows_per_sec(rows, [&] {
+    file.clear();
+    for (auto &value : values) {
+      Serialized serialized = Serialized::serialize(value, size);
+      file.insert(file.end(), serialized.data(),
+                  serialized.data() + serialized.len());
+    }
+  });
+
+  std::vector<std::uint8_t> bulk(rows * (size + 8));
+  double encode_after = rows_per_sec(rows, [&] {
+    Codec::encode(std::span<const std::string>(values), size, bulk.data());
+  });
+
+  std::vector<std::string> decoded;
+  double decode_before = rows_per_sec(rows, [&] {
+    decoded.clear();
+    for (std::size_t i = 0; i < file.size(); i += size + 8)
+      decoded.push_back(Serialized::dstr(&file[i], size + 8).to_string());
+  });
+
+  std::vector<std::string> decoded_bulk(rows);
+  double decode_after = rows_per_sec(rows, [&] {
+    Codec::decode(bulk.data(), rows, size, decoded_bulk.data());
+  });
+
+  if (file != bulk || decoded != decoded_bulk)
+    fmt::print("!! str encodings differ\n");
+
+  report("str encode", encode_before, encode_after);
+  report("str decode", decode_before, decode_after);
+}
+
+int main(int argc, char **argv) {
+  std::size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+  fmt::print("{} rows per column\n", rows);
+  fmt::print("{:<14} {:>16} {:>16} {:>10}\n", "", "Serialized r/s", "Codec r/s",
+             "speedup");
+
+  bench_fixed<std::uint64_t>("u64", rows, Serialized::du64);
+  bench_fixed<std::int32_t>("i32", rows, Serialized::di32);
+  bench_fixed<double>("f64", rows, Serialized::df64);
+  bench_str(rows, 32);
+}
@@ -0,0 +1,128 @@
+// Compresses generated u64 columns page by page with PageCodec, the way
+// ColumnFile seals them. Prints the compression ratio, the codec most pages
+// got, and how fast the pages decode next to a plain memcpy.
+//
+//   ./page-codec-bench [rows]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fmt/core.h>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../src/lib/columnFile.hpp"
+#include "../src/lib/pageCodec.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t PAGE_ROWS = ColumnFile::PAGE_ROWS;
+constexpr int ROUNDS = 5;
+
+struct Page {
+  PageCodec::Kind kind;
+  std::size_t from;
+  std::size_t size;
+};
+
+// Best of `ROUNDS` runs, in GB/s of decoded values
+template <typename F> double gb_per_sec(std::size_t bytes, F &&run) {
+  double best = 0;
+  for (int round = 0; round < ROUNDS; round++) {
+    auto start = Clock::now();
+    run();
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    best = std::max(best, static_cast<double>(bytes) / elapsed.count() / 1e9);
+  }
+  return best;
+}
+
+void bench(const std::string &name, const std::vector<std::uint64_t> &values) {
+  std::vector<std::uint8_t> encoded;
+  std::vector<Page> pages;
+  std::map<PageCodec::Kind, std::size_t> kinds;
+  for (std::size_t from = 0; from < values.size(); from += PAGE_ROWS) {
+    std::size_t at = encoded.size();
+    auto kind = PageCodec::encode(values.data() + from, PAGE_ROWS, encoded);
+    pages.push_back({kind, at, encoded.size() - at});
+    kinds[kind]++;
+  }
+
+  std::vector<std::uint64_t> decoded(values.size());
+  bool valid = true;
+  double decode = gb_per_sec(values.size() * sizeof(std::uint64_t), [&] {
+    for (std::size_t page = 0; page < pages.size(); page++)
+      valid &= PageCodec::decode(pages[page].kind,
+                                 encoded.data() + pages[page].from,
+                                 pages[page].size, PAGE_ROWS,
+                                 decoded.data() + page * PAGE_ROWS);
+  });
+
+  if (!valid || decoded != values)
+    fmt::print("!! {} does not round trip\n", name);
+
+  auto most = std::max_element(
+      kinds.begin(), kinds.end(),
+      [](auto &a, auto &b) { return a.second < b.second; });
+  double ratio = static_cast<double>(values.size() * sizeof(std::uint64_t)) /
+                 static_cast<double>(encoded.size());
+  fmt::print("{:<12} {:>9.1f}x {:>8} {:>10.1f}\n", name, ratio,
+             PageCodec::to_string(most->first), decode);
+}
+
+int main(int argc, char **argv) {
+  std::size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 8 << 20;
+  rows = std::max(rows / PAGE_ROWS, std::size_t{1}) * PAGE_ROWS;
+
+  std::mt19937_64 random(7);
+  std::vector<std::uint64_t> timestamps, counters, runs, uniform;
+  timestamps.reserve(rows);
+  counters.reserve(rows);
+  runs.reserve(rows);
+  uniform.reserve(rows);
+
+  // Milliseconds about a second apart, with jitter
+  std::uint64_t now = 1700000000000;
+  // Growing by random increments in 0..1023
+  std::uint64_t counter = 0;
+  // Status codes repeated in runs of 1..1000 rows
+  const std::uint64_t codes[] = {200, 201, 301, 404, 500};
+  std::uint64_t code = codes[0];
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < rows; i++) {
+    now += 1000 + random() % 16;
+    timestamps.push_back(now);
+
+    counter += random() % 1024;
+    counters.push_back(counter);
+
+    if (run == 0) {
+      code = codes[random() % std::size(codes)];
+      run = 1 + random() % 1000;
+    }
+    runs.push_back(code);
+    run--;
+
+    uniform.push_back(random() % 65536);
+  }
+
+  fmt::print("{} rows, {} pages of {} rows\n", rows, rows / PAGE_ROWS,
+             PAGE_ROWS);
+  fmt::print("{:<12} {:>10} {:>8} {:>10}\n", "", "ratio", "codec",
+             "GB/s");
+
+  bench("timestamps", timestamps);
+  bench("counters", counters);
+  bench("runs", runs);
+  bench("uniform", uniform);
+
+  std::vector<std::uint64_t> copy(rows);
+  double memcpy_speed = gb_per_sec(rows * sizeof(std::uint64_t), [&] {
+    std::memcpy(copy.data(), uniform.data(), rows * sizeof(std::uint64_t));
+  });
+  fmt::print("{:<12} {:>10} {:>8} {:>10.1f}\n", "memcpy", "", "",
+             memcpy_speed);
+}
@@ -24,6 +24,8 @@ pub enum ColumnType {
     f64 = 8,
     str = 9,
     rbool = 12,
+    dstr = 13,
+    vstr = 14,
 }
 
 #[repr(C)]
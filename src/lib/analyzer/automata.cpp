@@ -4,6 +4,90 @@
 #include "../logger.hpp"
 #include "parser.hpp"
 
+#include <algorithm>
+
+namespace {
+
+// Builds the WHERE tree out of the tokens after `WHERE`, AND binds tighter
+// than OR. Leaves take the restrictions in the order they are written. The
+// tokens around each parenthesis were already checked by the automata.
+struct WhereBuilder {
+  const std::vector<Parser::Token> &in;
+  std::size_t at;
+  std::size_t leaves = 0;
+
+  bool at_operator(Parser::OperatorE op) const {
+    return at < in.size() &&
+           Parser::same_variant_and_value(in[at],
+                                          Parser::Token{Parser::Operator{op}});
+  }
+
+  bool at_symbol(Parser::SymbolE symbol) const {
+    return at < in.size() &&
+           Parser::same_variant_and_value(
+               in[at], Parser::Token{Parser::Symbol{symbol}});
+  }
+
+  // `a op (b op c)` is kept as a single node `op` of a, b and c
+  static void add(Automata::Predicate &node, Automata::Predicate child) {
+    if (!child.restriction && child.op == node.op) {
+      for (auto &grandchild : child.children)
+        node.children.push_back(std::move(grandchild));
+    } else {
+      node.children.push_back(std::move(child));
+    }
+  }
+
+  cpp::result<Automata::Predicate, std::string>
+  chain(Parser::OperatorE op,
+        cpp::result<Automata::Predicate, std::string> (WhereBuilder::*term)()) {
+    auto first = (this->*term)();
+    if (first.has_error() || !at_operator(op))
+      return first;
+
+    Automata::Predicate node{op, std::nullopt, {}};
+    add(node, std::move(first.value()));
+    while (at_operator(op)) {
+      at++;
+      auto next = (this->*term)();
+      if (next.has_error())
+        return next;
+      add(node, std::move(next.value()));
+    }
+    return node;
+  }
+
+  cpp::result<Automata::Predicate, std::string> any_of() {
+    return chain(Parser::OperatorE::OR, &WhereBuilder::all_of);
+  }
+
+  cpp::result<Automata::Predicate, std::string> all_of() {
+    return chain(Parser::OperatorE::AND, &WhereBuilder::operand);
+  }
+
+  cpp::result<Automata::Predicate, std::string> operand() {
+    if (at_symbol(Parser::SymbolE::OPENING_PAR)) {
+      at++;
+      auto inner = any_of();
+      if (inner.has_error())
+        return inner;
+      if (!at_symbol(Parser::SymbolE::CLOSING_PAR))
+        return cpp::fail("Expected `)` to close a `(` in `WHERE`");
+      at++;
+      return inner;
+    }
+
+    // table.column, operator and value
+    if (at + 2 >= in.size() ||
+        !std::holds_alternative<Parser::Identifier>(in[at]))
+      return cpp::fail("Expected `table.column` in `WHERE`");
+    at += 3;
+    return Automata::Predicate{Parser::OperatorE::AND, leaves++, {}};
+  }
+};
+
+} // namespace
+
 cpp::result<Automata::Action, std::string>
 Automata::get_action_struct(std::vector<Parser::Token> in,
                             std::string original) {
@@ -18,6 +102,23 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
   std::optional<Token> prev = std::nullopt;
   std::optional<Token> prevm1 = std::nullopt;
 
+  auto is_aggregate = [](const std::optional<Token> &token) {
+    if (!token.has_value() || !std::holds_alternative<Keyword>(*token))
+      return false;
+    auto keyword = std::get<Keyword>(*token).variant;
+    return keyword == KeywordE::COUNT || keyword == KeywordE::SUM ||
+           keyword == KeywordE::MIN || keyword == KeywordE::MAX ||
+           keyword == KeywordE::AVG;
+  };
+
+  // Keywords starting the clauses that may follow the columns and WHERE of
+  // a SELECT
+  auto starts_clause = [](const Token &token) {
+    return same_variant_and_value(token, Token{Keyword{KeywordE::GROUP}}) ||
+           same_variant_and_value(token, Token{Keyword{KeywordE::ORDER}}) ||
+           same_variant_and_value(token, Token{Keyword{KeywordE::LIMIT}});
+  };
+
   auto visitor = overload{
       [&](const Bool &rbool) -> cpp::result<void, std::string> {
         if (ctx == Context::InsertE) {
@@ -41,7 +142,7 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         } else if (ctx == Context::WhereE) {
           if (!next.has_value()) {
             return cpp::fail(
-                fmt::format("Expected `;`, `AND` or `OR` but got nothing.\nAfter token "
+                fmt::format("Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got nothing.\nAfter token "
                             "{} (Pos: {}) in query:\n    \"{}\"",
                             to_string(*curr), token_number, original));
           } else if (!same_variant_and_value(
@@ -49,9 +150,12 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                      !same_variant_and_value(*next,
                                              Token{Operator{OperatorE::AND}}) &&
                      !same_variant_and_value(*next,
-                                             Token{Operator{OperatorE::OR}})) {
+                                             Token{Operator{OperatorE::OR}}) &&
+                     !same_variant_and_value(
+                         *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                     !starts_clause(*next)) {
             return cpp::fail(fmt::format(
-                "Expected `;`, `AND` or `OR`  but got `{}`.\nAfter token {} (Pos: {}) "
+                "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got `{}`.\nAfter token {} (Pos: {}) "
                 "in query:\n    \"{}\"",
                 to_string(*next), to_string(*curr), token_number, original));
           }
@@ -64,6 +168,84 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
 
         return {};
       },
+      [&](const Null &null) -> cpp::result<void, std::string> {
+        if (ctx == Context::InsertE) {
+          if (!next.has_value()) {
+            return cpp::fail(
+                fmt::format("Expected `)` or `,` but got nothing.\nAfter token "
+                            "{} (Pos: {}) in query:\n    \"{}\"",
+                            to_string(*curr), token_number, original));
+          } else if (!same_variant_and_value(
+                         *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                     !same_variant_and_value(*next,
+                                             Token{Symbol{SymbolE::COMA}})) {
+            return cpp::fail(fmt::format(
+                "Expected `)` or `,` but got `{}`.\nAfter token {} (Pos: {}) "
+                "in query:\n    \"{}\"",
+                to_string(*next), to_string(*curr), token_number, original));
+          }
+
+          auto &var = std::get<Automata::Insert>(variant.value());
+          var.values.push_back({null});
+        } else if (ctx == Context::CreateTableE) {
+          // `type name NULL` declares a column that may hold no value
+          if (!prev.has_value() || !same_variant(*prev, Token{Identifier{Name{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected column name before `NULL` in `CREATE TABLE` context."
+                "\nAt token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(
+                          *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                      !same_variant_and_value(*next,
+                                              Token{Symbol{SymbolE::COMA}}) &&
+                      !same_variant_and_value(*next,
+                                              Token{Keyword{KeywordE::UN}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `)`, `,` or `UN` after `NULL` in `CREATE TABLE` context."
+                "\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+
+          auto &var = std::get<Automata::CreateTable>(variant.value());
+          Layout *layout =
+              var.columns.get(std::get<Name>(std::get<Identifier>(*prev)).value);
+          if (layout == nullptr) {
+            return cpp::fail(fmt::format(
+                "Something went wrong while extracting types.\nIn token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          layout->optional = true;
+        } else if (ctx == Context::WhereE) {
+          if (!next.has_value()) {
+            return cpp::fail(
+                fmt::format("Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got nothing.\nAfter token "
+                            "{} (Pos: {}) in query:\n    \"{}\"",
+                            to_string(*curr), token_number, original));
+          } else if (!same_variant_and_value(
+              *next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                     !same_variant_and_value(*next,
+                                             Token{Operator{OperatorE::AND}}) &&
+                     !same_variant_and_value(*next,
+                                             Token{Operator{OperatorE::OR}}) &&
+                     !same_variant_and_value(
+                         *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                     !starts_clause(*next)) {
+            return cpp::fail(fmt::format(
+                "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got `{}`.\nAfter token {} (Pos: {}) "
+                "in query:\n    \"{}\"",
+                to_string(*next), to_string(*curr), token_number, original));
+          }
+
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          auto operador = std::get<Operator>(*prev);
+          auto name_sub = std::get<Parser::NameAndSub>(std::get<Parser::Identifier>(*prevm1));
+          var.restrictions.emplace_back(name_sub, operador.variant, null);
+        }
+
+        return {};
+      },
       [&](const Keyword &keyword) -> cpp::result<void, std::string> {
         switch (keyword.variant) {
 
@@ -77,15 +259,17 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
 
           if (!next.has_value()) {
             return cpp::fail(fmt::format(
-                "Expected `DATABASE` or `TABLE` after `CREATE` but got "
+                "Expected `DATABASE`, `TABLE` or `INDEX` after `CREATE` but got "
                 "nothing.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
                 to_string(*curr), token_number, original));
           } else if (!same_variant_and_value(
                          next.value(), Token{Keyword{KeywordE::DATABASE}}) &&
                      !same_variant_and_value(next.value(),
-                                             Token{Keyword{KeywordE::TABLE}})) {
+                                             Token{Keyword{KeywordE::TABLE}}) &&
+                     !same_variant_and_value(next.value(),
+                                             Token{Keyword{KeywordE::INDEX}})) {
             return cpp::fail(fmt::format(
-                "Expected `DATABASE` or `TABLE` after `CREATE` but got "
+                "Expected `DATABASE`, `TABLE` or `INDEX` after `CREATE` but got "
                 "`{}`.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
                 to_string(*next), token_number, to_string(*curr), original));
           }
@@ -94,6 +278,9 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
             if (same_variant_and_value(next.value(),
                                        Token{Keyword{KeywordE::DATABASE}})) {
               ctx = Context::CreateDatabaseE;
+            } else if (same_variant_and_value(
+                           next.value(), Token{Keyword{KeywordE::INDEX}})) {
+              ctx = Context::CreateIndexE;
             } else {
               ctx = Context::CreateTableE;
             }
@@ -137,11 +324,12 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                   "Expected `table.row` table.row but got nothing.\nAfter token {} "
                   "(Pos: {}) in query:\n    \"{}\"",
                   to_string(*curr), token_number, original));
-            }else if (!same_variant(next.value(),Token{Identifier{NameAndSub{}}})){
+            }else if (!same_variant(next.value(),Token{Identifier{NameAndSub{}}}) &&
+                      !is_aggregate(next)){
               return cpp::fail(fmt::format(
-                  "Expected `table.row` table.row but got nothing.\nAfter token {} "
+                  "Expected `table.row` or an aggregate but got `{}`.\nAfter token {} "
                   "(Pos: {}) in query:\n    \"{}\"",
-                  to_string(*curr), token_number, original));
+                  to_string(*next), to_string(*curr), token_number, original));
             }
             else{
               ctx = Context::SelectE;
@@ -150,24 +338,252 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         }
         break;
 
-        case KeywordE::WHERE: {
-          if (ctx == Context::WhereE){
-            if(!same_variant(next.value(),Token{Identifier{NameAndSub{}}})){
+        case KeywordE::COUNT:
+        case KeywordE::SUM:
+        case KeywordE::MIN:
+        case KeywordE::MAX:
+        case KeywordE::AVG: {
+          if (ctx != Context::SelectE) {
+            return cpp::fail(fmt::format(
+                "Found `{}` outside of a `SELECT`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant_and_value(*next,
+                                             Token{Symbol{SymbolE::OPENING_PAR}})) {
+            return cpp::fail(fmt::format(
+                "Expected `(` after `{}`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*curr), token_number, original));
+          }
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          var.aggregates.push_back({keyword.variant, std::nullopt, std::nullopt});
+        } break;
+
+        case KeywordE::GROUP: {
+          if (ctx != Context::SelectE && ctx != Context::WhereE) {
+            return cpp::fail(fmt::format(
+                "Found `GROUP` outside of a `SELECT` or after `ORDER BY`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant_and_value(*next, Token{Keyword{KeywordE::BY}})) {
+            return cpp::fail(fmt::format(
+                "Expected `BY` after `GROUP`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          ctx = Context::GroupE;
+        } break;
+
+        case KeywordE::JOIN: {
+          if (ctx != Context::SelectE ||
+              !same_variant(*prev, Token{Identifier{NameAndSub{}}})) {
+            return cpp::fail(fmt::format(
+                "Found `JOIN` not after the columns of a `SELECT`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant(*next, Token{Identifier{Name{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected a table after `JOIN`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          ctx = Context::JoinE;
+        } break;
+
+        case KeywordE::INDEX: {
+          if (ctx != Context::CreateIndexE || token_number != 1) {
+            return cpp::fail(fmt::format(
+                "Found `INDEX` not after `CREATE`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant_and_value(*next,
+                                             Token{Keyword{KeywordE::ON}})) {
+            return cpp::fail(fmt::format(
+                "Expected `ON` after `CREATE INDEX`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+        } break;
+
+        case KeywordE::PK: {
+          // `type name PK` makes the column the primary key of the table
+          if (ctx != Context::CreateTableE || !variant.has_value() ||
+              !prev.has_value() ||
+              !same_variant(*prev, Token{Identifier{Name{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected column name before `PK` in `CREATE TABLE` context."
+                "\nAt token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(
+                          *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                      !same_variant_and_value(*next,
+                                              Token{Symbol{SymbolE::COMA}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `)` or `,` after `PK` in `CREATE TABLE` context."
+                "\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+
+          auto &var = std::get<Automata::CreateTable>(variant.value());
+          if (var.primary_key) {
+            return cpp::fail(fmt::format(
+                "A table has one primary key but `{}` is the second.\nAt "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                std::get<Name>(std::get<Identifier>(*prev)).value,
+                to_string(*curr), token_number, original));
+          }
+          var.primary_key = std::get<Name>(std::get<Identifier>(*prev)).value;
+        } break;
+
+        case KeywordE::UN: {
+          // `type name [NULL] UN` keeps two rows from holding the same
+          // value in the column, NULLs aside
+          bool after_null = prev.has_value() && same_variant(*prev, Token{Null{}});
+          const std::optional<Token> &named = after_null ? prevm1 : prev;
+          if (ctx != Context::CreateTableE || !variant.has_value() ||
+              !named.has_value() ||
+              !same_variant(*named, Token{Identifier{Name{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected column name before `UN` in `CREATE TABLE` context."
+                "\nAt token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(
+                          *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                      !same_variant_and_value(*next,
+                                              Token{Symbol{SymbolE::COMA}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `)` or `,` after `UN` in `CREATE TABLE` context."
+                "\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+
+          auto &var = std::get<Automata::CreateTable>(variant.value());
+          var.unique.push_back(std::get<Name>(std::get<Identifier>(*named)).value);
+        } break;
+
+        case KeywordE::ON: {
+          if (ctx == Context::CreateIndexE) {
+            if (!next.has_value() ||
+                !same_variant(*next, Token{Identifier{NameAndSub{}}})) {
               return cpp::fail(fmt::format(
-                  "Expected `table.row` table.row but got nothing.\nAfter token {} "
-                  "(Pos: {}) in query:\n    \"{}\"",
+                  "Expected `DATABASE.TABLE` identifier after `CREATE INDEX "
+                  "ON`.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
                   to_string(*curr), token_number, original));
             }
+            break;
+          }
+          if (ctx != Context::JoinE ||
+              !same_variant(*prev, Token{Identifier{Name{}}})) {
+            return cpp::fail(fmt::format(
+                "Found `ON` not after `JOIN table`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant(*next, Token{Identifier{NameAndSub{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` after `ON`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+        } break;
+
+        case KeywordE::ORDER: {
+          if (ctx != Context::SelectE && ctx != Context::WhereE &&
+              ctx != Context::GroupE && ctx != Context::JoinE) {
+            return cpp::fail(fmt::format(
+                "Found `ORDER` outside of a `SELECT` or after `LIMIT`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant_and_value(*next, Token{Keyword{KeywordE::BY}})) {
+            return cpp::fail(fmt::format(
+                "Expected `BY` after `ORDER`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          ctx = Context::OrderE;
+        } break;
+
+        case KeywordE::BY: {
+          if (!(ctx == Context::GroupE &&
+                same_variant_and_value(*prev, Token{Keyword{KeywordE::GROUP}})) &&
+              !(ctx == Context::OrderE &&
+                same_variant_and_value(*prev, Token{Keyword{KeywordE::ORDER}}))) {
+            return cpp::fail(fmt::format(
+                "Found `BY` not after `GROUP` or `ORDER`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant(*next, Token{Identifier{NameAndSub{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` after `{} BY`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*prev), to_string(*curr), token_number, original));
+          }
+        } break;
+
+        case KeywordE::ASC:
+        case KeywordE::DESC: {
+          if (ctx != Context::OrderE ||
+              !same_variant(*prev, Token{Identifier{NameAndSub{}}})) {
+            return cpp::fail(fmt::format(
+                "Found `{}` not after an `ORDER BY` column.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(*next, Token{Symbol{SymbolE::COMA}}) &&
+                      !same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                      !same_variant_and_value(*next, Token{Keyword{KeywordE::LIMIT}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `,`, `LIMIT` or `;` after `{}`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*curr), token_number, original));
+          }
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          var.order_by.back().descending = keyword.variant == KeywordE::DESC;
+        } break;
+
+        case KeywordE::LIMIT: {
+          if (ctx != Context::SelectE && ctx != Context::WhereE &&
+              ctx != Context::GroupE && ctx != Context::OrderE &&
+              ctx != Context::JoinE) {
+            return cpp::fail(fmt::format(
+                "Found `LIMIT` outside of a `SELECT`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant(*next, Token{Numbers{UInt{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected a row count after `LIMIT`.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          ctx = Context::LimitE;
+        } break;
+
+        case KeywordE::WHERE: {
+          if (ctx == Context::WhereE){
             if (!next.has_value())
             {
               return cpp::fail(fmt::format(
-                  "Expected `== or > or >= or <= 0r > or < or !=` Operator but got nothing.\nAfter token {} "
+                  "Expected `table.row` or `(` but got nothing.\nAfter token {} "
                   "(Pos: {}) in query:\n    \"{}\"",
                   to_string(*curr), token_number, original));
 
             }
-
-
+            if(!same_variant(next.value(),Token{Identifier{NameAndSub{}}}) &&
+               !same_variant_and_value(next.value(), Token{Symbol{SymbolE::OPENING_PAR}})){
+              return cpp::fail(fmt::format(
+                  "Expected `table.row` or `(` but got `{}`.\nAfter token {} "
+                  "(Pos: {}) in query:\n    \"{}\"",
+                  to_string(*next), to_string(*curr), token_number, original));
+            }
           }
 
         }
@@ -479,6 +895,13 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
           }
         }
         } break;
+        case KeywordE::EXPLAIN:
+        case KeywordE::ANALYZE:
+          return cpp::fail(fmt::format(
+              "`EXPLAIN` and `EXPLAIN ANALYZE` only go in front of a query.\n"
+              "After token {} (Pos: {}) in query:\n    \"{}\"",
+              to_string(*curr), token_number, original));
+
         default:
           break;
         }
@@ -487,7 +910,8 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
       },
       [&](const Type &type) -> cpp::result<void, std::string> {
         if (ctx == Context::CreateTableE ) {
-          if (type.variant == TypeE::STR) {
+          if (type.variant == TypeE::STR || type.variant == TypeE::DSTR ||
+              type.variant == TypeE::VSTR) {
             if (!nextp1.has_value()) {
               return cpp::fail(fmt::format(
                   "Expected name after type str{} in `CREATE TABLE` context "
@@ -530,6 +954,69 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                 "token `;` (Pos: {}) in query:\n    \"{}\"",
                 to_string(*next), token_number, original));
           }
+        } else if (symbol.variant == SymbolE::OPENING_PAR &&
+                   ctx == Context::SelectE) {
+          if (!is_aggregate(prev)) {
+            return cpp::fail(fmt::format(
+                "Found `(` not after an aggregate in `SELECT`\nAfter token `(` "
+                "(Pos: {}) in query:\n    \"{}\"",
+                token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant(*next, Token{Identifier{NameAndSub{}}}) &&
+                      !same_variant(*next, Token{Identifier{Name{}}}) &&
+                      !same_variant_and_value(*next, Token{Symbol{SymbolE::ALL}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row`, `table` or `*` after `(` in `SELECT`\n"
+                "After token `(` (Pos: {}) in query:\n    \"{}\"",
+                token_number, original));
+          }
+        } else if (symbol.variant == SymbolE::ALL && ctx == Context::SelectE) {
+          if (!same_variant_and_value(*prev, Token{Symbol{SymbolE::OPENING_PAR}}) ||
+              !same_variant_and_value(*prevm1, Token{Keyword{KeywordE::COUNT}})) {
+            return cpp::fail(fmt::format(
+                "Only `COUNT` takes `*`\nAfter token `*` (Pos: {}) in "
+                "query:\n    \"{}\"",
+                token_number, original));
+          } else if (!next.has_value() ||
+                     !same_variant_and_value(*next, Token{Symbol{SymbolE::CLOSING_PAR}})) {
+            return cpp::fail(fmt::format(
+                "Expected `)` after `*`\nAfter token `*` (Pos: {}) in "
+                "query:\n    \"{}\"",
+                token_number, original));
+          }
+        } else if (symbol.variant == SymbolE::CLOSING_PAR &&
+                   ctx == Context::SelectE) {
+          if (!next.has_value() ||
+              (!same_variant_and_value(*next, Token{Symbol{SymbolE::COMA}}) &&
+               !same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+               !same_variant_and_value(*next, Token{Keyword{KeywordE::WHERE}}) &&
+               !starts_clause(*next))) {
+            return cpp::fail(fmt::format(
+                "Expected `,`, `WHERE`, `GROUP BY`, `ORDER BY`, `LIMIT` or `;` after an aggregate\nAfter token "
+                "`)` (Pos: {}) in query:\n    \"{}\"",
+                token_number, original));
+          }
+          if (same_variant_and_value(*next, Token{Keyword{KeywordE::WHERE}}))
+            ctx = Context::WhereE;
+        } else if (symbol.variant == SymbolE::COMA &&
+                   (ctx == Context::GroupE || ctx == Context::OrderE)) {
+          if (!next.has_value() ||
+              !same_variant(*next, Token{Identifier{NameAndSub{}}})) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` after `,` in `{} BY`\nAfter token "
+                "`,` (Pos: {}) in query:\n    \"{}\"",
+                ctx == Context::GroupE ? "GROUP" : "ORDER", token_number,
+                original));
+          }
+        } else if (symbol.variant == SymbolE::COMA && ctx == Context::SelectE) {
+          if (!next.has_value() ||
+              (!same_variant(*next, Token{Identifier{NameAndSub{}}}) &&
+               !is_aggregate(next))) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` or an aggregate after `,`\nAfter token "
+                "`,` (Pos: {}) in query:\n    \"{}\"",
+                token_number, original));
+          }
         } else if (symbol.variant == SymbolE::OPENING_PAR) {
           if (ctx == Context::CreateTableE) {
             if (!next.has_value()) {
@@ -545,10 +1032,26 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                               "token `;` (Pos: {}) in query:\n    \"{}\"",
                               to_string(*next), token_number, original));
             }
+          } else if (ctx == Context::WhereE) {
+            if (!next.has_value()) {
+              return cpp::fail(fmt::format(
+                  "Expected `table.row` or `(` after opening parenthesis in "
+                  "`WHERE` context but got nothing\nAfter token `(` (Pos: {}) "
+                  "in query:\n    \"{}\"",
+                  token_number, original));
+            } else if (!same_variant(*next, Token{Identifier{NameAndSub{}}}) &&
+                       !same_variant_and_value(
+                           *next, Token{Symbol{SymbolE::OPENING_PAR}})) {
+              return cpp::fail(fmt::format(
+                  "Expected `table.row` or `(` after opening parenthesis in "
+                  "`WHERE` context but got `{}`\nAfter token `(` (Pos: {}) "
+                  "in query:\n    \"{}\"",
+                  to_string(*next), token_number, original));
+            }
           } else if (ctx == Context::InsertE) {
             if (!next.has_value()) {
               return cpp::fail(fmt::format(
-                  "Expected str, uint, int, bool or double literal after "
+                  "Expected str, uint, int, bool, double literal or NULL after "
                   "opening parenthesis in `INSERT INTO` context but got "
                   "nothing\nAfter token `;` (Pos: {}) in query:\n    \"{}\"",
                   token_number, original));
@@ -556,9 +1059,10 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                        !same_variant(*next, Token{Numbers{Int{}}}) &&
                        !same_variant(*next, Token{Numbers{UInt{}}}) &&
                        !same_variant(*next, Token{Numbers{Double{}}}) &&
-                       !same_variant(*next, Token{Bool{}})) {
+                       !same_variant(*next, Token{Bool{}}) &&
+                       !same_variant(*next, Token{Null{}})) {
               return cpp::fail(fmt::format(
-                  "Expected str, uint, int, bool or double literal after "
+                  "Expected str, uint, int, bool, double literal or NULL after "
                   "opening parenthesis in `INSERT INTO` context but got "
                   "`{}`\nAfter token `;` (Pos: {}) in query:\n    \"{}\"",
                   to_string(*next), token_number, original));
@@ -591,7 +1095,8 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                        !same_variant(*next, Token{Numbers{Int{}}}) &&
                        !same_variant(*next, Token{Numbers{UInt{}}}) &&
                        !same_variant(*next, Token{Numbers{Double{}}}) &&
-                       !same_variant(*next, Token{Bool{}})) {
+                       !same_variant(*next, Token{Bool{}}) &&
+                       !same_variant(*next, Token{Null{}})) {
               return cpp::fail(fmt::format(
                   "Expected value or `)` in `INSERT INTO` context but got "
                   "`{}`\nAfter token `,` (Pos: {}) in query:\n    \"{}\"",
@@ -612,6 +1117,26 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                   "token `)` (Pos: {}) in query:\n    \"{}\"",
                   to_string(*next), token_number, original));
             }
+          } else if (ctx == Context::WhereE) {
+            if (!next.has_value()) {
+              return cpp::fail(fmt::format(
+                  "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` in `WHERE` context but got "
+                  "nothing\nAfter token `)` (Pos: {}) in query:\n    \"{}\"",
+                  token_number, original));
+            } else if (!same_variant_and_value(
+                           *next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                       !same_variant_and_value(
+                           *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                       !same_variant_and_value(
+                           *next, Token{Operator{OperatorE::AND}}) &&
+                       !same_variant_and_value(
+                           *next, Token{Operator{OperatorE::OR}}) &&
+                     !starts_clause(*next)) {
+              return cpp::fail(fmt::format(
+                  "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` in `WHERE` context but got "
+                  "`{}`\nAfter token `)` (Pos: {}) in query:\n    \"{}\"",
+                  to_string(*next), token_number, original));
+            }
           } else if (ctx == Context::InsertE) {
             if (!next.has_value()) {
               return cpp::fail(fmt::format(
@@ -651,7 +1176,7 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         } else if (ctx == Context::WhereE) {
           if (!next.has_value()) {
             return cpp::fail(
-                fmt::format("Expected `;`, `AND` or `OR` but got nothing.\nAfter token "
+                fmt::format("Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got nothing.\nAfter token "
                             "{} (Pos: {}) in query:\n    \"{}\"",
                             to_string(*curr), token_number, original));
           } else if (!same_variant_and_value(
@@ -659,9 +1184,12 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                      !same_variant_and_value(*next,
                                              Token{Operator{OperatorE::AND}}) &&
                      !same_variant_and_value(*next,
-                                             Token{Operator{OperatorE::OR}})) {
+                                             Token{Operator{OperatorE::OR}}) &&
+                     !same_variant_and_value(
+                         *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                     !starts_clause(*next)) {
             return cpp::fail(fmt::format(
-                "Expected `;`, `AND` or `OR`  but got `{}`.\nAfter token {} (Pos: {}) "
+                "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got `{}`.\nAfter token {} (Pos: {}) "
                 "in query:\n    \"{}\"",
                 to_string(*next), to_string(*curr), token_number, original));
           }
@@ -675,7 +1203,17 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         return {};
       },
       [&](const Numbers &numbers) -> cpp::result<void, std::string> {
-        if (ctx == Context::InsertE) {
+        if (ctx == Context::LimitE) {
+          if (!next.has_value() ||
+              !same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}})) {
+            return cpp::fail(fmt::format(
+                "Expected `;` after the `LIMIT` count.\nAfter token {} "
+                "(Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          var.limit = std::get<UInt>(numbers).value;
+        } else if (ctx == Context::InsertE) {
           if (!next.has_value()) {
             return cpp::fail(
                 fmt::format("Expected `)` or `,` but got nothing.\nAfter token "
@@ -705,7 +1243,7 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         } else if (ctx == Context::WhereE) {
           if (!next.has_value()) {
             return cpp::fail(
-                fmt::format("Expected `;`, `AND` or `OR` but got nothing.\nAfter token "
+                fmt::format("Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got nothing.\nAfter token "
                             "{} (Pos: {}) in query:\n    \"{}\"",
                             to_string(*curr), token_number, original));
           } else if (!same_variant_and_value(
@@ -713,9 +1251,12 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                      !same_variant_and_value(*next,
                                              Token{Operator{OperatorE::AND}}) &&
                      !same_variant_and_value(*next,
-                                              Token{Operator{OperatorE::OR}})) {
+                                              Token{Operator{OperatorE::OR}}) &&
+                     !same_variant_and_value(
+                         *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
+                     !starts_clause(*next)) {
             return cpp::fail(fmt::format(
-                "Expected `;`, `AND` or `OR`  but got `{}`.\nAfter token {} (Pos: {}) "
+                "Expected `;`, `AND`, `OR`, `)`, `GROUP BY`, `ORDER BY` or `LIMIT` but got `{}`.\nAfter token {} (Pos: {}) "
                 "in query:\n    \"{}\"",
                 to_string(*next), to_string(*curr), token_number, original));
           }
@@ -757,7 +1298,139 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                 to_string(*next), token_number, to_string(*curr), original));
         }
 
-        if (ctx == Context::SelectE){
+        if (ctx == Context::CreateIndexE) {
+          // `ON database.table ( column ) ;`
+          if (std::holds_alternative<NameAndSub>(identifier)) {
+            if (!next.has_value() ||
+                !same_variant_and_value(*next,
+                                        Token{Symbol{SymbolE::OPENING_PAR}})) {
+              return cpp::fail(fmt::format(
+                  "Expected `(` after the table of `CREATE INDEX`.\nAfter "
+                  "token {} (Pos: {}) in query:\n    \"{}\"",
+                  to_string(*curr), token_number, original));
+            }
+            auto data = std::get<NameAndSub>(identifier);
+            variant = {Automata::CreateIndex{data.name, data.sub, ""}};
+            return {};
+          }
+          if (!variant.has_value() || !prev.has_value() ||
+              !same_variant_and_value(*prev,
+                                      Token{Symbol{SymbolE::OPENING_PAR}}) ||
+              !next.has_value() ||
+              !same_variant_and_value(*next,
+                                      Token{Symbol{SymbolE::CLOSING_PAR}}) ||
+              (nextp1.has_value() &&
+               !same_variant_and_value(*nextp1,
+                                       Token{Symbol{SymbolE::SEMICOLON}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `CREATE INDEX ON database.table (column);`.\nAt "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          std::get<Automata::CreateIndex>(*variant).column =
+              std::get<Name>(identifier).value;
+          return {};
+        }
+
+        if (ctx == Context::JoinE) {
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          if (std::holds_alternative<Name>(identifier)) {
+            // The joined table, `JOIN` already checked it
+            if (!next.has_value() ||
+                !same_variant_and_value(*next, Token{Keyword{KeywordE::ON}})) {
+              return cpp::fail(fmt::format(
+                  "Expected `ON` after `JOIN {}`.\nAfter token {} "
+                  "(Pos: {}) in query:\n    \"{}\"",
+                  to_string(*curr), to_string(*curr), token_number, original));
+            }
+            var.join = Automata::Join{std::get<Name>(identifier).value, {}, {}};
+          } else if (same_variant_and_value(*prev, Token{Keyword{KeywordE::ON}})) {
+            if (!next.has_value() ||
+                !same_variant_and_value(*next, Token{Operator{OperatorE::EQUAL}}) ||
+                !nextp1.has_value() ||
+                !same_variant(*nextp1, Token{Identifier{NameAndSub{}}})) {
+              return cpp::fail(fmt::format(
+                  "Expected `== table.row` after `ON {}`.\nAfter token {} "
+                  "(Pos: {}) in query:\n    \"{}\"",
+                  to_string(*curr), to_string(*curr), token_number, original));
+            }
+            var.join->left = std::get<NameAndSub>(identifier);
+          } else {
+            if (!next.has_value() ||
+                (!same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                 !same_variant_and_value(*next, Token{Keyword{KeywordE::WHERE}}) &&
+                 !same_variant_and_value(*next, Token{Keyword{KeywordE::ORDER}}) &&
+                 !same_variant_and_value(*next, Token{Keyword{KeywordE::LIMIT}}))) {
+              return cpp::fail(fmt::format(
+                  "Expected `WHERE`, `ORDER BY`, `LIMIT` or `;` after the `JOIN` "
+                  "condition.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
+                  to_string(*curr), token_number, original));
+            }
+            var.join->right = std::get<NameAndSub>(identifier);
+            if (same_variant_and_value(*next, Token{Keyword{KeywordE::WHERE}}))
+              ctx = Context::WhereE;
+          }
+        } else if (ctx == Context::OrderE) {
+          if (!std::holds_alternative<NameAndSub>(identifier)) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` in `ORDER BY` but got `{}`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*prev), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(*next, Token{Symbol{SymbolE::COMA}}) &&
+                      !same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                      !same_variant_and_value(*next, Token{Keyword{KeywordE::ASC}}) &&
+                      !same_variant_and_value(*next, Token{Keyword{KeywordE::DESC}}) &&
+                      !same_variant_and_value(*next, Token{Keyword{KeywordE::LIMIT}}))) {
+            return cpp::fail(fmt::format(
+                "Expected `ASC`, `DESC`, `,`, `LIMIT` or `;` after an `ORDER BY` "
+                "column.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          var.order_by.push_back({std::get<NameAndSub>(identifier), false});
+        } else if (ctx == Context::GroupE) {
+          if (!std::holds_alternative<NameAndSub>(identifier)) {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` in `GROUP BY` but got `{}`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), to_string(*prev), token_number, original));
+          } else if (!next.has_value() ||
+                     (!same_variant_and_value(*next, Token{Symbol{SymbolE::COMA}}) &&
+                      !same_variant_and_value(*next, Token{Symbol{SymbolE::SEMICOLON}}) &&
+                      !starts_clause(*next))) {
+            return cpp::fail(fmt::format(
+                "Expected `,`, `ORDER BY`, `LIMIT` or `;` after a `GROUP BY` column.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(*curr), token_number, original));
+          }
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          var.group_by.push_back(std::get<NameAndSub>(identifier));
+        } else if (ctx == Context::SelectE &&
+            same_variant_and_value(prev.value(), Token{Symbol{SymbolE::OPENING_PAR}})) {
+          // The argument of an aggregate, only COUNT takes a table
+          auto &var = std::get<Automata::Show_Select>(variant.value());
+          auto &aggregate = var.aggregates.back();
+          if (std::holds_alternative<NameAndSub>(identifier)) {
+            aggregate.column = std::get<NameAndSub>(identifier);
+          } else if (aggregate.function == KeywordE::COUNT) {
+            aggregate.table = std::get<Name>(identifier).value;
+          } else {
+            return cpp::fail(fmt::format(
+                "Expected `table.row` in `{}` but got `{}`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(Keyword{aggregate.function}), to_string(*curr),
+                to_string(*prev), token_number, original));
+          }
+          if (!next.has_value() ||
+              !same_variant_and_value(*next, Token{Symbol{SymbolE::CLOSING_PAR}})) {
+            return cpp::fail(fmt::format(
+                "Expected `)` after the argument of `{}`.\nAfter "
+                "token {} (Pos: {}) in query:\n    \"{}\"",
+                to_string(Keyword{aggregate.function}), to_string(*curr),
+                token_number, original));
+          }
+        } else if (ctx == Context::SelectE){
           if ( std::holds_alternative<NameAndSub>(identifier) ) {
             if (!next.has_value()){
               return cpp::fail(fmt::format(
@@ -766,7 +1439,10 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                   token_number, to_string(*curr), original));
             }
             else if(same_variant_and_value(next.value(),Token{Symbol{SymbolE::COMA}}) ||
-                    same_variant_and_value(next.value(), Token{Keyword{KeywordE::WHERE}})){
+                    same_variant_and_value(next.value(), Token{Keyword{KeywordE::WHERE}}) ||
+                    starts_clause(*next) ||
+                    same_variant_and_value(next.value(), Token{Keyword{KeywordE::JOIN}}) ||
+                    same_variant_and_value(next.value(), Token{Symbol{SymbolE::SEMICOLON}})){
               auto &var = std::get<Automata::Show_Select>(variant.value());
               auto table_column = std::get<NameAndSub>(std::get<Parser::Identifier>(*curr));
               var.tables.push_back(table_column);
@@ -880,21 +1556,26 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
             }
 
             auto data = std::get<NameAndSub>(identifier);
-            variant = {Automata::CreateTable{data.name, data.sub, {}}};
+            variant = {Automata::CreateTable{data.name, data.sub, {}, {}, {}}};
           }
 
           if (std::holds_alternative<Name>(identifier)) {
             if (!next.has_value()) {
               return cpp::fail(
-                  fmt::format("Expected `)` or `,` but got nothing.\nAfter "
-                              "token {} (Pos: {}) in query:\n    \"{}\"",
+                  fmt::format("Expected `)`, `,`, `NULL`, `PK` or `UN` but got "
+                              "nothing.\nAfter token {} (Pos: {}) in query:\n    \"{}\"",
                               to_string(*curr), token_number, original));
             } else if (!same_variant_and_value(
                            *next, Token{Symbol{SymbolE::CLOSING_PAR}}) &&
                        !same_variant_and_value(*next,
-                                               Token{Symbol{SymbolE::COMA}})) {
+                                               Token{Symbol{SymbolE::COMA}}) &&
+                       !same_variant(*next, Token{Null{}}) &&
+                       !same_variant_and_value(*next,
+                                               Token{Keyword{KeywordE::PK}}) &&
+                       !same_variant_and_value(*next,
+                                               Token{Keyword{KeywordE::UN}})) {
               return cpp::fail(fmt::format(
-                  "Expected `)` or `,` but got `{}`.\nAfter token {} (Pos: {}) "
+                  "Expected `)`, `,`, `NULL`, `PK` or `UN` but got `{}`.\nAfter token {} (Pos: {}) "
                   "in query:\n    \"{}\"",
                   to_string(*next), to_string(*curr), token_number, original));
             }
@@ -905,13 +1586,18 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
               Parser::Type type = std::get<Parser::Type>(*prev);
               var.columns.insert(name, Layout::from_parser_type(type));
             } else if (same_variant_and_value(
-                           *prevm1, Token{Parser::Type{TypeE::STR}})) {
+                           *prevm1, Token{Parser::Type{TypeE::STR}}) ||
+                       same_variant_and_value(
+                           *prevm1, Token{Parser::Type{TypeE::DSTR}}) ||
+                       same_variant_and_value(
+                           *prevm1, Token{Parser::Type{TypeE::VSTR}})) {
               auto &var = std::get<Automata::CreateTable>(variant.value());
               std::string name = std::get<Name>(identifier).value;
               UInt size = std::get<UInt>(std::get<Numbers>(*prev));
-              var.columns.insert(name, Layout{.size = size.value,
-                                              .optional = false,
-                                              .type = ColumnType::str});
+              Layout layout = Layout::from_parser_type(
+                  std::get<Parser::Type>(*prevm1));
+              layout.size = size.value;
+              var.columns.insert(name, layout);
             } else {
               return cpp::fail(fmt::format(
                   "Something went wrong while extracting types.\nIn token {} "
@@ -965,22 +1651,27 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                        !same_variant(*prev, Token{Numbers{Int{}}}) &&
                        !same_variant(*prev, Token{Numbers{UInt{}}}) &&
                        !same_variant(*prev, Token{Numbers{Double{}}}) &&
-                       !same_variant(*prev, Token{Bool{}})) {
+                       !same_variant(*prev, Token{Bool{}}) &&
+                       !same_variant(*prev, Token{Null{}}) &&
+                       !same_variant_and_value(
+                           *prev, Token{Symbol{SymbolE::CLOSING_PAR}})) {
               return cpp::fail(fmt::format(
-                  "Expected value but got `{}`.\nBefore token {} (Pos: {}) "
+                  "Expected value or `)` but got `{}`.\nBefore token {} (Pos: {}) "
                   "in query:\n    \"{}\"",
                   to_string(*prev), to_string(*curr), token_number, original));
             }
 
             if (!next.has_value()) {
               return cpp::fail(
-                  fmt::format("Expected table.column identifier but got nothing.\nAfter token {} "
+                  fmt::format("Expected table.column identifier or `(` but got nothing.\nAfter token {} "
                               "(Pos: {}) in query:\n    \"{}\"",
                               token_number, to_string(*curr), original));
             } else if (!same_variant(
-                           *next, Token{Identifier{NameAndSub{}}})) {
+                           *next, Token{Identifier{NameAndSub{}}}) &&
+                       !same_variant_and_value(
+                           *next, Token{Symbol{SymbolE::OPENING_PAR}})) {
               return cpp::fail(fmt::format(
-                  "Expected table.column identifier but got `{}`.\nAfter token {} (Pos: {}) in "
+                  "Expected table.column identifier or `(` but got `{}`.\nAfter token {} (Pos: {}) in "
                   "query:\n    \"{}\"",
                   to_string(*next), token_number, to_string(*curr), original));
             }
@@ -999,9 +1690,10 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
                        !same_variant(*next, Token{Numbers{Int{}}}) &&
                        !same_variant(*next, Token{Numbers{UInt{}}}) &&
                        !same_variant(*next, Token{Numbers{Double{}}}) &&
-                       !same_variant(*next, Token{Bool{}})) {
+                       !same_variant(*next, Token{Bool{}}) &&
+                       !same_variant(*next, Token{Null{}})) {
               return cpp::fail(fmt::format(
-                  "Expected string, int, uint, bool or f64 value but got "
+                  "Expected string, int, uint, bool, f64 value or NULL but got "
                   "{}.\nBefore token {} (Pos: {}) in query:\n    \"{}\"",
                   to_string(*next), to_string(*curr), token_number, original));
             }
@@ -1019,6 +1711,19 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
         return cpp::fail(result);
       }};
 
+  // `EXPLAIN [ANALYZE]` wraps the query that follows it
+  Explain explain = Explain::None;
+  if (!in.empty() &&
+      same_variant_and_value(in.front(), Token{Keyword{KeywordE::EXPLAIN}})) {
+    explain = Explain::Plan;
+    in.erase(in.begin());
+    if (!in.empty() &&
+        same_variant_and_value(in.front(), Token{Keyword{KeywordE::ANALYZE}})) {
+      explain = Explain::Analyze;
+      in.erase(in.begin());
+    }
+  }
+
   for (token_number = 0; token_number < in.size(); token_number++) {
     curr = in[token_number];
 
@@ -1052,6 +1757,90 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
     }
   }
 
+  if (variant.has_value() &&
+      std::holds_alternative<Automata::Show_Select>(variant.value())) {
+    auto &var = std::get<Automata::Show_Select>(variant.value());
+    if (var.join) {
+      auto &join = *var.join;
+      if (join.left.name == join.right.name)
+        return cpp::fail(fmt::format(
+            "`JOIN` needs a column of each table in query:\n    \"{}\"",
+            original));
+      if (join.table != join.left.name && join.table != join.right.name)
+        return cpp::fail(fmt::format(
+            "`JOIN {}` is not one of the tables of its `ON` in query:\n    "
+            "\"{}\"",
+            join.table, original));
+      if (!var.aggregates.empty() || !var.group_by.empty())
+        return cpp::fail(fmt::format(
+            "Aggregates and `GROUP BY` do not take a `JOIN` in query:\n    "
+            "\"{}\"",
+            original));
+
+      // Every column has to come from one of the two tables
+      std::vector<NameAndSub> columns = var.tables;
+      for (auto &order : var.order_by)
+        columns.push_back(order.column);
+      for (auto &restriction : var.restrictions)
+        columns.push_back(std::get<0>(restriction));
+      for (auto &column : columns) {
+        if (column.name != join.left.name && column.name != join.right.name)
+          return cpp::fail(fmt::format(
+              "`{}.{}` is not from a joined table in query:\n    \"{}\"",
+              column.name, column.sub, original));
+      }
+    }
+
+    // Next to aggregates or a GROUP BY only the grouped columns make sense
+    if (!var.aggregates.empty() || !var.group_by.empty()) {
+      auto columns = var.tables;
+      for (auto &order : var.order_by)
+        columns.push_back(order.column);
+      for (auto &column : columns) {
+        bool grouped = std::any_of(
+            var.group_by.begin(), var.group_by.end(), [&](const auto &key) {
+              return key.name == column.name && key.sub == column.sub;
+            });
+        if (!grouped)
+          return cpp::fail(fmt::format(
+              "`{}.{}` is neither grouped by nor aggregated in query:\n    "
+              "\"{}\"",
+              column.name, column.sub, original));
+      }
+    }
+    auto where = std::find_if(in.begin(), in.end(), [](const Token &token) {
+      return same_variant_and_value(token, Token{Keyword{KeywordE::WHERE}});
+    });
+    if (where != in.end()) {
+      WhereBuilder builder{in, static_cast<std::size_t>(where - in.begin()) + 1};
+      auto tree = builder.any_of();
+      if (tree.has_error())
+        return cpp::fail(fmt::format("{} in query:\n    \"{}\"", tree.error(),
+                                     original));
+      if (builder.at < in.size() &&
+          !same_variant_and_value(in[builder.at],
+                                  Token{Symbol{SymbolE::SEMICOLON}}) &&
+          !starts_clause(in[builder.at]))
+        return cpp::fail(fmt::format(
+            "Unbalanced `)` in `WHERE` in query:\n    \"{}\"", original));
+      if (builder.leaves != var.restrictions.size())
+        return cpp::fail(fmt::format(
+            "Malformed `WHERE` in query:\n    \"{}\"", original));
+      var.where = std::move(tree.value());
+    }
+    var.explain = explain;
+  } else if (explain != Explain::None) {
+    return cpp::fail(fmt::format(
+        "Only a `SELECT` can be explained in query:\n    \"{}\"", original));
+  }
+
+  if (variant.has_value() &&
+      std::holds_alternative<Automata::CreateIndex>(variant.value()) &&
+      std::get<Automata::CreateIndex>(variant.value()).column.empty()) {
+    return cpp::fail(fmt::format(
+        "Expected the `(column)` to index in query:\n    \"{}\"", original));
+  }
+
   if (variant.has_value()) {
     return variant.value();
   } else {
@@ -1059,8 +1848,17 @@ Automata::get_action_struct(std::vector<Parser::Token> in,
   }
 }
 
+std::string Automata::to_string(const Aggregate &aggregate) {
+  std::string argument = "*";
+  if (aggregate.column)
+    argument = fmt::format("{}.{}", aggregate.column->name, aggregate.column->sub);
+  else if (aggregate.table)
+    argument = *aggregate.table;
+  return fmt::format("{}({})", Parser::to_string(aggregate.function), argument);
+}
+
 std::string Automata::val_to_string(
-    const std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double, Parser::Bool> &value) {
+    const std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double, Parser::Bool, Parser::Null> &value) {
   if (std::holds_alternative<Parser::UInt>(value)) {
     return std::to_string(std::get<Parser::UInt>(value).value);
   } else if (std::holds_alternative<Parser::Int>(value)) {
@@ -1071,6 +1869,8 @@ std::string Automata::val_to_string(
     return std::get<Parser::String>(value).value;
   } else if (std::holds_alternative<Parser::Bool>(value)) {
     return std::to_string(std::get<Parser::Bool>(value).value);
+  } else if (std::holds_alternative<Parser::Null>(value)) {
+    return "NULL";
   }
   return "Err";
 }
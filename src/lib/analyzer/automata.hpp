@@ -4,6 +4,7 @@
 #include "../table.hpp"
 #include "parser.hpp"
 #include <map>
+#include <optional>
 #include <result.hpp>
 #include <set>
 #include <string>
@@ -17,6 +18,17 @@ struct CreateTable {
   std::string db;
   std::string name;
   KeyValueList<std::string, Layout> columns;
+  // Column declared `PK`
+  std::optional<std::string> primary_key;
+  // Columns declared `UN`, in order
+  std::vector<std::string> unique;
+};
+
+// `CREATE INDEX ON database.table (column)`, a RangeIndex over the column
+struct CreateIndex {
+  std::string database;
+  std::string table;
+  std::string column;
 };
 
 struct CreateDatabase {
@@ -45,18 +57,73 @@ struct Insert {
   std::string database;
   std::string table;
   List<std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double,
-                    Parser::Bool>>
+                    Parser::Bool, Parser::Null>>
       values;
 };
+using Restriction =
+    std::tuple<Parser::NameAndSub, Parser::OperatorE,
+               std::variant<Parser::String, Parser::UInt, Parser::Int,
+                            Parser::Double, Parser::Bool, Parser::Null>>;
+
+// A WHERE clause as a tree. Leaves are an index into the restrictions,
+// other nodes AND or OR their children. An AND with no children holds for
+// every row.
+struct Predicate {
+  Parser::OperatorE op = Parser::OperatorE::AND;
+  std::optional<std::size_t> restriction;
+  std::vector<Predicate> children;
+};
+
+// COUNT, SUM, MIN, MAX or AVG of a column. COUNT(*) has no column and
+// counts the rows of the table the rest of the query is about, COUNT(table)
+// those of `table`.
+struct Aggregate {
+  Parser::KeywordE function;
+  std::optional<Parser::NameAndSub> column;
+  std::optional<std::string> table;
+};
+
+std::string to_string(const Aggregate &aggregate);
+
+// `JOIN table ON left == right`, `table` is the side named by one of them.
+// Rows of both tables pair up where the two columns hold the same value.
+struct Join {
+  std::string table;
+  Parser::NameAndSub left;
+  Parser::NameAndSub right;
+};
+
+// A sort key of ORDER BY, ascending unless DESC is written
+struct Order {
+  Parser::NameAndSub column;
+  bool descending = false;
+};
+
+// What a SELECT answers: its rows, its plan, or its plan once it ran
+enum class Explain : std::uint8_t { None, Plan, Analyze };
+
 struct Show_Select{
   std::string database;
   std::vector<Parser::NameAndSub> tables;
-  std::vector<std::tuple<Parser::NameAndSub, Parser::OperatorE, std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double,
-      Parser::Bool >>>restrictions;
+  // Computed over the selected rows, answered as a single row or one row
+  // per group
+  std::vector<Aggregate> aggregates;
+  // In the order they are written
+  std::vector<Restriction> restrictions;
+  Predicate where;
+  // Columns whose values split the selected rows into groups
+  std::vector<Parser::NameAndSub> group_by;
+  // Second table of the query, its rows pair with those of the first
+  std::optional<Join> join;
+  // Sort keys, the first one written decides first
+  std::vector<Order> order_by;
+  // Most rows answered
+  std::optional<std::uint64_t> limit;
+  Explain explain = Explain::None;
 };
 
 std::string val_to_string(const std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double,
-    Parser::Bool > & value);
+    Parser::Bool, Parser::Null > & value);
 
 
 struct ShowDatabases {};
@@ -74,6 +141,7 @@ struct ShowTableData{
 enum Context {
   CreateDatabaseE,
   CreateTableE,
+  CreateIndexE,
   WhereE,
   DeleteDatabaseE,
   DeleteTableE,
@@ -82,13 +150,18 @@ enum Context {
   ShowDatabasesE,
   InsertE,
   SelectE,
+  GroupE,
+  OrderE,
+  LimitE,
+  JoinE,
   ShowColumnValuesE,
   ShowTableDataE,
   Unknown [[maybe_unused]]
 };
 
 using Action = std::variant<
-    Automata::CreateDatabase, Automata::CreateTable, Automata::DeleteDatabase,
+    Automata::CreateDatabase, Automata::CreateTable, Automata::CreateIndex,
+    Automata::DeleteDatabase,
     Automata::DeleteTable, Automata::ShowDatabase, Automata::ShowTable,
     Automata::ShowDatabases, Automata::Insert, Automata::ShowColumnValues, Automata::ShowTableData, Automata::Show_Select>;
 
@@ -8,12 +8,16 @@ std::vector<Parser::Token> Parser::parse(const std::string &in) {
                                                         ","};
 
   const static std::vector<std::string> valid_operators = {
-      "==", ">", "<", "!", "<=", ">=", "&&", "||", "AND", "0R"};
+      "==", ">", "<", "!", "<=", ">=", "&&", "||", "AND", "OR", "0R"};
 
   const static std::vector<std::string> valid_keywords = {
       "CREATE", "DATABASE", "DATABASES", "TABLE", "INSERT", "INTO",
       "VALUES", "SELECT",   "FROM",      "WHERE", "UPDATE", "SET",
-      "DELETE", "DROP",     "PK",        "UN",    "SHOW",   "COLUMN","USING"};
+      "DELETE", "DROP",     "PK",        "UN",    "SHOW",   "COLUMN","USING",
+      "COUNT",  "SUM",      "MIN",       "MAX",   "AVG",
+      "GROUP",  "BY",       "ORDER",     "ASC",   "DESC",   "LIMIT",
+      "JOIN",   "ON",     "EXPLAIN", "ANALYZE",
+      "INDEX"};
 
   const static std::vector<std::string> valid_types = {
       "i8",  "i16", "i32", "i64", "u8",  "u16",
@@ -76,6 +80,22 @@ std::vector<Parser::Token> Parser::parse(const std::string &in) {
       KEYWORD(PK)
       KEYWORD(UN)
       KEYWORD(INTO)
+      KEYWORD(COUNT)
+      KEYWORD(SUM)
+      KEYWORD(MIN)
+      KEYWORD(MAX)
+      KEYWORD(AVG)
+      KEYWORD(GROUP)
+      KEYWORD(BY)
+      KEYWORD(ORDER)
+      KEYWORD(ASC)
+      KEYWORD(DESC)
+      KEYWORD(LIMIT)
+      KEYWORD(JOIN)
+      KEYWORD(ON)
+      KEYWORD(EXPLAIN)
+      KEYWORD(ANALYZE)
+      KEYWORD(INDEX)
 
 #undef KEYWORD
     }
@@ -95,7 +115,7 @@ std::vector<Parser::Token> Parser::parse(const std::string &in) {
         resultado.emplace_back(Operator{OperatorE::AND});
         continue;
       }
-      if (*it == "||" || *it == "0R") {
+      if (*it == "||" || *it == "OR" || *it == "0R") {
         resultado.emplace_back(Operator{OperatorE::OR});
         continue;
       }
@@ -162,12 +182,18 @@ std::vector<Parser::Token> Parser::parse(const std::string &in) {
       }
     }
 
-    if (std::regex_match(token, std::regex("str[0-9]+"))) {
-      resultado.emplace_back(Type{TypeE::STR});
+    if (std::regex_match(token, std::regex("[dv]?str[0-9]+"))) {
+      std::size_t prefix = token[0] == 's' ? 0 : 1;
+      if (token[0] == 'd')
+        resultado.emplace_back(Type{TypeE::DSTR});
+      else if (token[0] == 'v')
+        resultado.emplace_back(Type{TypeE::VSTR});
+      else
+        resultado.emplace_back(Type{TypeE::STR});
 
       std::stringstream number;
 
-      for (int i = 3; i < token.size(); i++)
+      for (int i = prefix + 3; i < token.size(); i++)
         number << token[i];
 
       std::uint64_t nvalue;
@@ -214,6 +240,11 @@ std::vector<Parser::Token> Parser::parse(const std::string &in) {
       continue;
     }
 
+    if (token == "NULL") {
+      resultado.emplace_back(Null{});
+      continue;
+    }
+
     // Check if token is a identifier
     if (std::regex_match(token, std::regex("([a-zA-Z_][a-zA-Z0-9_]*)"))) {
       resultado.emplace_back(Identifier{Name{token}});
@@ -294,6 +325,10 @@ bool Parser::same_variant(const Parser::Token &left,
       return true;
     }
   }
+  else if (std::holds_alternative<Null>(left) &&
+           std::holds_alternative<Null>(right)) {
+    return true;
+  }
   else if (std::holds_alternative<Numbers>(left) &&
            std::holds_alternative<Numbers>(right)) {
     if (std::holds_alternative<Int>(std::get<Numbers>(left)) &&
@@ -346,6 +381,10 @@ bool Parser::same_variant_and_value(const Token &left, const Token &right) {
                  std::get<NameAndSub>(std::get<Identifier>(right)).sub;
     }
   }
+  else if (std::holds_alternative<Null>(left) &&
+           std::holds_alternative<Null>(right)) {
+    return true;
+  }
   else if (std::holds_alternative<Numbers>(left) &&
            std::holds_alternative<Numbers>(right)) {
     if (std::holds_alternative<Int>(std::get<Numbers>(left)) &&
@@ -67,7 +67,23 @@ enum KeywordE {
   SHOW,
   DATABASES,
   COLUMN,
-  USING
+  USING,
+  COUNT,
+  SUM,
+  MIN,
+  MAX,
+  AVG,
+  GROUP,
+  BY,
+  ORDER,
+  ASC,
+  DESC,
+  LIMIT,
+  JOIN,
+  ON,
+  EXPLAIN,
+  ANALYZE,
+  INDEX
 };
 
 inline std::string to_string(const KeywordE &x) {
@@ -131,6 +147,54 @@ inline std::string to_string(const KeywordE &x) {
   case KeywordE::COLUMN:
     ss << "COLUMN";
     break;
+  case KeywordE::COUNT:
+    ss << "COUNT";
+    break;
+  case KeywordE::SUM:
+    ss << "SUM";
+    break;
+  case KeywordE::MIN:
+    ss << "MIN";
+    break;
+  case KeywordE::MAX:
+    ss << "MAX";
+    break;
+  case KeywordE::AVG:
+    ss << "AVG";
+    break;
+  case KeywordE::GROUP:
+    ss << "GROUP";
+    break;
+  case KeywordE::BY:
+    ss << "BY";
+    break;
+  case KeywordE::ORDER:
+    ss << "ORDER";
+    break;
+  case KeywordE::ASC:
+    ss << "ASC";
+    break;
+  case KeywordE::DESC:
+    ss << "DESC";
+    break;
+  case KeywordE::LIMIT:
+    ss << "LIMIT";
+    break;
+  case KeywordE::JOIN:
+    ss << "JOIN";
+    break;
+  case KeywordE::ON:
+    ss << "ON";
+    break;
+  case KeywordE::EXPLAIN:
+    ss << "EXPLAIN";
+    break;
+  case KeywordE::ANALYZE:
+    ss << "ANALYZE";
+    break;
+  case KeywordE::INDEX:
+    ss << "INDEX";
+    break;
   }
 
   return ss.str();
@@ -142,7 +206,7 @@ struct Keyword {
 
 inline std::string to_string(const Keyword &x) { return to_string(x.variant); }
 
-enum TypeE { I8, I16, I32, I64, U8, U16, U32, U64, F64, BOOL, STR };
+enum TypeE { I8, I16, I32, I64, U8, U16, U32, U64, F64, BOOL, STR, DSTR, VSTR };
 
 inline std::string to_string(const TypeE &x) {
   std::ostringstream ss;
@@ -181,6 +245,12 @@ inline std::string to_string(const TypeE &x) {
   case TypeE::STR:
     ss << "str";
     break;
+  case TypeE::DSTR:
+    ss << "dstr";
+    break;
+  case TypeE::VSTR:
+    ss << "vstr";
+    break;
   }
 
   return ss.str();
@@ -299,8 +369,13 @@ inline std::string to_string(const Numbers &x) {
   return std::visit([](auto &&arg) { return to_string(arg); }, x);
 }
 
+// A missing value, for columns declared with NULL
+struct Null {};
+
+inline std::string to_string(const Null &) { return "NULL"; }
+
 using Token = std::variant<Operator, Keyword, Type, Symbol, String, Numbers,
-                           Identifier, Unknown, Bool>;
+                           Identifier, Unknown, Bool, Null>;
 
 template <typename T> bool is_same_variant(const T &x, const T &y) {
   return x.index() == y.index();
@@ -70,12 +70,16 @@ Parser::validate(const std::string &in) {
   const static std::vector<std::string> valid_tokens = {"(", ")", ";", "*"};
 
   const static std::vector<std::string> valid_operators = {
-      "==", ">", "<", "!", "<=", ">=", ",", "&&", "||", "AND", "0R"};
+      "==", ">", "<", "!", "<=", ">=", ",", "&&", "||", "AND", "OR", "0R"};
 
   const static std::vector<std::string> valid_keywords = {
       "CREATE", "DATABASE", "DATABASES", "TABLE", "INSERT", "INTO",
       "VALUES", "SELECT",   "FROM",      "WHERE", "UPDATE", "SET",
-      "DELETE", "DROP",     "PK",        "UN",    "SHOW",   "COLUMN","USING"};
+      "DELETE", "DROP",     "PK",        "UN",    "SHOW",   "COLUMN","USING",
+      "COUNT",  "SUM",      "MIN",       "MAX",   "AVG",
+      "GROUP",  "BY",       "ORDER",     "ASC",   "DESC",   "LIMIT",
+      "JOIN",   "ON",     "EXPLAIN", "ANALYZE",
+      "INDEX"};
 
   const static std::vector<std::string> valid_types = {
       "i8",  "i16", "i32", "i64", "u8",  "u16",
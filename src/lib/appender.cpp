@@ -0,0 +1,257 @@
+#include "appender.hpp"
+
+#include <fmt/core.h>
+
+#include "fm.hpp"
+
+std::string to_string(AckMode mode) {
+  switch (mode) {
+  case AckMode::Buffered:
+    return "buffered";
+  case AckMode::Logged:
+    return "logged";
+  case AckMode::Flushed:
+    return "flushed";
+  }
+
+  throw std::runtime_error("Invalid ack mode");
+}
+
+std::optional<AckMode> ack_mode_from_string(const std::string &mode) {
+  if (mode == "buffered")
+    return AckMode::Buffered;
+  if (mode == "logged")
+    return AckMode::Logged;
+  if (mode == "flushed")
+    return AckMode::Flushed;
+  return std::nullopt;
+}
+
+AppendOptions &AppendOptions::global() {
+  static AppendOptions options;
+  return options;
+}
+
+TableAppender::TableAppender(const std::string &database,
+                             const std::string &table,
+                             const std::vector<std::pair<std::string, Layout>> &columns,
+                             std::uint64_t rows,
+                             std::shared_ptr<WriteAheadLog> log,
+                             AppendOptions options)
+    : options_(options), table_(table), log_(std::move(log)),
+      pending_(columns.size()), rows_(rows) {
+  auto table_path = FileManager::Path("data") / database / table;
+  for (auto &[column, layout] : columns)
+    writers_.emplace_back((table_path / (column + ".col")).path, layout);
+}
+
+TableAppender::~TableAppender() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    stop_ = true;
+  }
+  wake_.notify_all();
+  if (flusher_.joinable())
+    flusher_.join();
+
+  auto _ = flush();
+}
+
+cpp::result<std::uint64_t, std::string> TableAppender::append(Row &row) {
+  if (row.size() != writers_.size())
+    return cpp::fail(fmt::format("Expected {} values but got {}",
+                                 writers_.size(), row.size()));
+
+  std::unique_lock<std::mutex> lock(mtx_);
+
+  if (discarded_)
+    return cpp::fail("The table is being deleted");
+
+  if (!failure_.empty())
+    return cpp::fail(failure_);
+
+  if (queued_ == flushed_ && pending_bytes_ == 0)
+    oldest_ = Clock::now();
+
+  for (std::size_t i = 0; i < row.size(); i++) {
+    pending_[i].insert(pending_[i].end(), row[i].begin(), row[i].end());
+    pending_bytes_ += row[i].size();
+  }
+
+  std::uint64_t index = rows_++;
+  if (log_) {
+    logged_ = log_->log(table_, index, row);
+    sequences_.push_back(logged_);
+  }
+
+  std::uint64_t sequence = ++queued_;
+
+  if (ack() == AckMode::Flushed) {
+    auto flushed = flush_until(lock, sequence);
+    if (flushed.has_error())
+      return cpp::fail(flushed.error());
+    return index;
+  }
+
+  start_flusher();
+  if (pending_bytes_ >= options_.flush_bytes || sequence == flushed_ + 1)
+    wake_.notify_one();
+
+  if (ack() == AckMode::Logged) {
+    std::uint64_t logged = logged_;
+    lock.unlock();
+    auto synced = log_->sync(logged);
+    if (synced.has_error())
+      return cpp::fail(synced.error());
+  }
+
+  return index;
+}
+
+AckMode TableAppender::ack() const {
+  if (options_.ack == AckMode::Logged && !log_)
+    return AckMode::Flushed;
+  return options_.ack;
+}
+
+cpp::result<void, std::string> TableAppender::flush() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  return flush_until(lock, queued_);
+}
+
+std::uint64_t TableAppender::rows() {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return rows_;
+}
+
+void TableAppender::discard() {
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    discarded_ = true;
+    stop_ = true;
+    for (auto &column : pending_)
+      column.clear();
+    pending_bytes_ = 0;
+  }
+
+  if (log_) {
+    auto _ = log_->log_drop(table_);
+  }
+  wake_.notify_all();
+  if (flusher_.joinable() && flusher_.get_id() != std::this_thread::get_id())
+    flusher_.join();
+
+  // Wait for a flush that may already be writing
+  std::unique_lock<std::mutex> lock(mtx_);
+  flushed_cv_.wait(lock, [&] { return !flushing_; });
+  // The drop voids whatever of the table the log still holds
+  if (log_)
+    log_->applied(sequences_);
+  sequences_.clear();
+  flushed_ = queued_;
+}
+
+cpp::result<void, std::string>
+TableAppender::flush_until(std::unique_lock<std::mutex> &lock,
+                           std::uint64_t target) {
+  while (flushed_ < target && !discarded_ && failure_.empty()) {
+    if (flushing_) {
+      // Someone is already writing, our rows go in the next batch unless
+      // they were already part of this one
+      flushed_cv_.wait(lock);
+      continue;
+    }
+
+    // We lead this flush and take every row queued so far with us
+    flushing_ = true;
+    Row batch(pending_.size());
+    batch.swap(pending_);
+    pending_bytes_ = 0;
+    std::vector<std::uint64_t> batch_sequences;
+    batch_sequences.swap(sequences_);
+    std::uint64_t batch_to = queued_;
+    std::uint64_t batch_logged = logged_;
+
+    lock.unlock();
+    // Write ahead: the rows must be durable in the log before any column
+    // file sees them, so a crash never leaves a row in only some columns
+    cpp::result<void, std::string> result;
+    if (log_)
+      result = log_->sync(batch_logged);
+    if (!result.has_error())
+      result = write(batch);
+    // Rows that failed stay in the log and get replayed on the next start
+    if (log_ && !result.has_error())
+      log_->applied(batch_sequences);
+    lock.lock();
+
+    if (result.has_error()) {
+      // Some columns may hold the batch and others not, so any row written
+      // after it would land at a different index in each column. Nothing
+      // else is written until the table is loaded again and the log
+      // replayed; rows queued meanwhile are only in the log.
+      failure_ = fmt::format("Table {} stopped taking rows after a failed "
+                             "write: {}",
+                             table_, result.error());
+      for (auto &column : pending_)
+        column.clear();
+      pending_bytes_ = 0;
+      sequences_.insert(sequences_.begin(), batch_sequences.begin(),
+                        batch_sequences.end());
+    } else {
+      flushed_ = batch_to;
+    }
+
+    flushing_ = false;
+    oldest_ = Clock::now();
+    flushed_cv_.notify_all();
+  }
+
+  if (flushed_ < target && !failure_.empty())
+    return cpp::fail(failure_);
+
+  return {};
+}
+
+std::shared_lock<std::shared_mutex> TableAppender::read_lock() {
+  return std::shared_lock<std::shared_mutex>(files_mtx_);
+}
+
+cpp::result<void, std::string> TableAppender::write(const Row &batch) {
+  std::unique_lock<std::shared_mutex> writing(files_mtx_);
+  for (std::size_t i = 0; i < batch.size(); i++) {
+    if (batch[i].empty())
+      continue;
+
+    // With a log the columns must be durable before it can be truncated
+    auto result = writers_[i].append(batch[i].data(), batch[i].size(),
+                                     log_ != nullptr);
+    if (result.has_error())
+      return result;
+  }
+
+  return {};
+}
+
+void TableAppender::start_flusher() {
+  if (!flusher_.joinable() && !stop_)
+    flusher_ = std::thread([this] { run_flusher(); });
+}
+
+void TableAppender::run_flusher() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  while (!stop_) {
+    if (flushed_ == queued_ || !failure_.empty()) {
+      wake_.wait(lock);
+      continue;
+    }
+
+    auto deadline = oldest_ + options_.flush_interval;
+    if (pending_bytes_ < options_.flush_bytes && Clock::now() < deadline) {
+      wake_.wait_until(lock, deadline);
+      continue;
+    }
+
+    auto _ = flush_until(lock, queued_);
+  }
+}
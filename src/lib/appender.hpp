@@ -0,0 +1,137 @@
+#ifndef APPENDER_HPP
+#define APPENDER_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <result.hpp>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "columnFile.hpp"
+#include "wal.hpp"
+
+// When an INSERT is acknowledged
+enum class AckMode {
+  // As soon as the row is queued in memory. Rows reach the column files
+  // when the buffer grows past `flush_bytes` or `flush_interval` elapses.
+  Buffered,
+  // Once the row is durable in the database log. Column files are written
+  // in the background like in Buffered mode. Concurrent inserters share
+  // one fsync. Without a log this behaves as Flushed.
+  Logged,
+  // Once the row was written to the column files. Concurrent inserters
+  // share a single write (group commit).
+  Flushed,
+};
+
+std::string to_string(AckMode mode);
+
+std::optional<AckMode> ack_mode_from_string(const std::string &mode);
+
+struct AppendOptions {
+  AckMode ack = AckMode::Logged;
+  std::size_t flush_bytes = 1 << 20;
+  std::chrono::milliseconds flush_interval{50};
+
+  // Options used by every table, set once at startup
+  static AppendOptions &global();
+};
+
+// Encoded values waiting to be appended to the .col files of one table.
+// Column paths are resolved once and each flush opens every file a single
+// time no matter how many rows it carries.
+//
+// With a log every row is first recorded there under its row index, and a
+// batch only reaches the column files once its records are durable.
+struct TableAppender {
+  using Row = std::vector<std::vector<std::uint8_t>>;
+
+  // `rows` is how many rows the column files already hold
+  TableAppender(const std::string &database, const std::string &table,
+                const std::vector<std::pair<std::string, Layout>> &columns,
+                std::uint64_t rows = 0,
+                std::shared_ptr<WriteAheadLog> log = nullptr,
+                AppendOptions options = AppendOptions::global());
+
+  TableAppender(const TableAppender &) = delete;
+  TableAppender &operator=(const TableAppender &) = delete;
+
+  // Writes whatever is still queued
+  ~TableAppender();
+
+  // Queues one row, `row[i]` holding the encoded value for column i.
+  // Returns the index of the row, according to the ack mode. Once a write
+  // to the column files failed every append fails.
+  cpp::result<std::uint64_t, std::string> append(Row &row);
+
+  // Writes every row queued so far, used by readers before they scan
+  cpp::result<void, std::string> flush();
+
+  // Held by readers of the column files, a batch is not written while it
+  // is and readers never see one half written
+  [[nodiscard]] std::shared_lock<std::shared_mutex> read_lock();
+
+  // Rows the table has once every queued row is written
+  std::uint64_t rows();
+
+  // Drops queued rows and stops writing, for tables being deleted
+  void discard();
+
+  [[nodiscard]] const AppendOptions &options() const { return options_; }
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  cpp::result<void, std::string> flush_until(std::unique_lock<std::mutex> &lock,
+                                             std::uint64_t target);
+
+  cpp::result<void, std::string> write(const Row &batch);
+
+  [[nodiscard]] AckMode ack() const;
+
+  void start_flusher();
+
+  void run_flusher();
+
+  AppendOptions options_;
+  std::string table_;
+  std::vector<ColumnFile::Writer> writers_;
+  std::shared_ptr<WriteAheadLog> log_;
+
+  std::mutex mtx_;
+  std::condition_variable flushed_cv_;
+  std::condition_variable wake_;
+  // Taken alone while a batch is written
+  std::shared_mutex files_mtx_;
+
+  Row pending_;
+  std::size_t pending_bytes_ = 0;
+  Clock::time_point oldest_;
+  // Row index the next insert gets, and log sequence of the last one
+  std::uint64_t rows_;
+  std::uint64_t logged_ = 0;
+  // Log sequences of the rows not yet in the column files, but for the
+  // batch being written
+  std::vector<std::uint64_t> sequences_;
+
+  // Rows are numbered as they get queued. Everything up to `flushed_` is
+  // on disk.
+  std::uint64_t queued_ = 0;
+  std::uint64_t flushed_ = 0;
+  bool flushing_ = false;
+  bool discarded_ = false;
+
+  // Set by the first failed write, every later append and flush fails
+  std::string failure_;
+
+  std::thread flusher_;
+  bool stop_ = false;
+};
+
+#endif // APPENDER_HPP
@@ -0,0 +1,128 @@
+#ifndef BITMAP_HPP
+#define BITMAP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "codec.hpp"
+
+// Bits packed into 64 bit words, bit `i` is bit `i % 64` of word `i / 64`.
+// Words are stored little endian, the same way in memory and on disk, so a
+// mapped bool column is used as it is.
+namespace Bitmap {
+
+constexpr std::size_t WORD_BITS = 64;
+
+inline std::size_t words_for(std::size_t bits) {
+  return (bits + WORD_BITS - 1) / WORD_BITS;
+}
+
+// Word `w` of a packed buffer
+inline std::uint64_t word(const std::uint8_t *bits, std::size_t w) {
+  return Codec::load<std::uint64_t>(bits + w * sizeof(std::uint64_t));
+}
+
+inline bool get(const std::uint8_t *bits, std::size_t i) {
+  return (bits[i / 8] >> (i % 8)) & 1;
+}
+
+// Bits of the last word past `bits` rows, to be cleared
+inline std::uint64_t tail_mask(std::size_t bits) {
+  std::size_t used = bits % WORD_BITS;
+  return used == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << used) - 1;
+}
+
+inline void set(std::vector<std::uint64_t> &words, std::size_t i) {
+  words[i / WORD_BITS] |= std::uint64_t{1} << (i % WORD_BITS);
+}
+
+inline bool test(const std::vector<std::uint64_t> &words, std::size_t i) {
+  return (words[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+}
+
+// Keeps in `into` the bits also set in `other`, a word at a time
+inline void intersect(std::vector<std::uint64_t> &into,
+                      const std::vector<std::uint64_t> &other) {
+  std::size_t words = std::min(into.size(), other.size());
+  for (std::size_t w = 0; w < words; w++)
+    into[w] &= other[w];
+}
+
+// Adds to `into` the bits set in `other`
+inline void unite(std::vector<std::uint64_t> &into,
+                  const std::vector<std::uint64_t> &other) {
+  std::size_t words = std::min(into.size(), other.size());
+  for (std::size_t w = 0; w < words; w++)
+    into[w] |= other[w];
+}
+
+// Clears in `into` the bits set in `other`
+inline void subtract(std::vector<std::uint64_t> &into,
+                     const std::vector<std::uint64_t> &other) {
+  std::size_t words = std::min(into.size(), other.size());
+  for (std::size_t w = 0; w < words; w++)
+    into[w] &= ~other[w];
+}
+
+inline bool any(const std::vector<std::uint64_t> &words) {
+  return std::any_of(words.begin(), words.end(),
+                     [](std::uint64_t word) { return word != 0; });
+}
+
+// Calls `f(from, to)` for the runs of [begin, end) covered by words with
+// some bit set, so scans can skip the words where nothing is left
+template <typename F>
+void for_each_run(const std::vector<std::uint64_t> &words, std::size_t begin,
+                  std::size_t end, F &&f) {
+  std::size_t from = begin;
+  while (from < end) {
+    while (from < end && words[from / WORD_BITS] == 0)
+      from = (from / WORD_BITS + 1) * WORD_BITS;
+    std::size_t to = from;
+    while (to < end && words[to / WORD_BITS] != 0)
+      to = (to / WORD_BITS + 1) * WORD_BITS;
+    if (from < end)
+      f(from, std::min(to, end));
+    from = to;
+  }
+}
+
+// Packs one byte per value (zero or not) into words, starting at bit
+// `first` of `out`. Bits before it are kept.
+inline void pack(const std::uint8_t *values, std::size_t count,
+                 std::size_t first, std::uint8_t *out) {
+  for (std::size_t i = 0; i < count; i++) {
+    std::size_t bit = first + i;
+    std::uint8_t mask = static_cast<std::uint8_t>(1u << (bit % 8));
+    if (values[i] != 0)
+      out[bit / 8] |= mask;
+    else
+      out[bit / 8] &= static_cast<std::uint8_t>(~mask);
+  }
+}
+
+// Set bits among the first `bits` of the words
+inline std::size_t count(const std::uint8_t *words, std::size_t bits) {
+  std::size_t total = 0;
+  std::size_t full = bits / WORD_BITS;
+  for (std::size_t w = 0; w < full; w++)
+    total += std::popcount(word(words, w));
+  if (bits % WORD_BITS != 0)
+    total += std::popcount(word(words, full) & tail_mask(bits));
+  return total;
+}
+
+// Calls `f(i)` for every set bit, in order
+template <typename F>
+void for_each_set(const std::vector<std::uint64_t> &words, F &&f) {
+  for (std::size_t w = 0; w < words.size(); w++) {
+    for (std::uint64_t bits = words[w]; bits != 0; bits &= bits - 1)
+      f(w * WORD_BITS + std::countr_zero(bits));
+  }
+}
+
+} // namespace Bitmap
+
+#endif // BITMAP_HPP
@@ -0,0 +1,182 @@
+#ifndef CODEC_HPP
+#define CODEC_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "serializer.hpp"
+
+// Native encoder/decoder for whole column buffers. It writes exactly the
+// bytes bincode (default options) produces for each value, so files written
+// through `Serialized` and through `Codec` are interchangeable:
+//   - integers, f64: little endian, no padding
+//   - bool: a single 0x00/0x01 byte
+//   - str(n): u64 little endian length (always n) followed by n bytes, the
+//     value padded with zeros
+//   - dstr(n): u32 code of the value in the column dictionary
+//   - vstr(n): u64 end offset of the value in the column heap; rows and the
+//     log carry the value itself as a u32 length followed by its bytes
+namespace Codec {
+
+template <typename T>
+concept Fixed = std::is_arithmetic_v<T>;
+
+// Bytes one value of `layout` takes once encoded
+inline std::size_t value_size(const Layout &layout) {
+  switch (layout.type) {
+  case ColumnType::str:
+    return layout.size + 8;
+  case ColumnType::dstr:
+    return sizeof(std::uint32_t);
+  case ColumnType::vstr:
+    return sizeof(std::uint64_t);
+  default:
+    return layout.size;
+  }
+}
+
+template <Fixed T> inline T load(const std::uint8_t *in) {
+  T value;
+  if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+    std::memcpy(&value, in, sizeof(T));
+  } else {
+    std::uint8_t swapped[sizeof(T)];
+    for (std::size_t i = 0; i < sizeof(T); i++)
+      swapped[i] = in[sizeof(T) - 1 - i];
+    std::memcpy(&value, swapped, sizeof(T));
+  }
+  return value;
+}
+
+template <Fixed T> inline void store(T value, std::uint8_t *out) {
+  if constexpr (std::endian::native == std::endian::little || sizeof(T) == 1) {
+    std::memcpy(out, &value, sizeof(T));
+  } else {
+    std::uint8_t raw[sizeof(T)];
+    std::memcpy(raw, &value, sizeof(T));
+    for (std::size_t i = 0; i < sizeof(T); i++)
+      out[i] = raw[sizeof(T) - 1 - i];
+  }
+}
+
+// Encodes every value into `out`, which must hold values.size() * sizeof(T)
+// bytes. Returns the number of bytes written.
+template <Fixed T>
+std::size_t encode(std::span<const T> values, std::uint8_t *out) {
+  if constexpr (std::is_same_v<T, bool>) {
+    for (std::size_t i = 0; i < values.size(); i++)
+      out[i] = values[i] ? 1 : 0;
+  } else if constexpr (std::endian::native == std::endian::little) {
+    if (!values.empty())
+      std::memcpy(out, values.data(), values.size_bytes());
+  } else {
+    for (std::size_t i = 0; i < values.size(); i++)
+      store(values[i], out + i * sizeof(T));
+  }
+  return values.size() * sizeof(T);
+}
+
+// Decodes `rows` values from `in` into `out`
+template <Fixed T>
+void decode(const std::uint8_t *in, std::size_t rows, T *out) {
+  if constexpr (std::is_same_v<T, bool>) {
+    for (std::size_t i = 0; i < rows; i++)
+      out[i] = in[i] != 0;
+  } else if constexpr (std::endian::native == std::endian::little) {
+    if (rows > 0)
+      std::memcpy(out, in, rows * sizeof(T));
+  } else {
+    for (std::size_t i = 0; i < rows; i++)
+      out[i] = load<T>(in + i * sizeof(T));
+  }
+}
+
+// Encodes one str(size) value into `out`, which must hold size + 8 bytes.
+// Like the Rust encoder, the value ends at its first NUL and is cut to `size`.
+inline std::size_t encode_str(std::string_view value, std::uint64_t size,
+                              std::uint8_t *out) {
+  store<std::uint64_t>(size, out);
+  std::size_t length = std::min<std::size_t>(
+      std::min(value.find('\0'), value.size()), size);
+  std::memcpy(out + 8, value.data(), length);
+  std::memset(out + 8 + length, 0, size - length);
+  return size + 8;
+}
+
+template <typename S>
+std::size_t encode(std::span<const S> values, std::uint64_t size,
+                   std::uint8_t *out) {
+  for (std::size_t i = 0; i < values.size(); i++)
+    encode_str(values[i], size, out + i * (size + 8));
+  return values.size() * (size + 8);
+}
+
+// View of one encoded str value, without the zero padding
+inline std::string_view decode_str(const std::uint8_t *in,
+                                   std::uint64_t size) {
+  std::uint64_t length = std::min(load<std::uint64_t>(in), size);
+  const char *value = reinterpret_cast<const char *>(in + 8);
+  const void *end = std::memchr(value, 0, length);
+  return {value, end == nullptr ? length
+                                : static_cast<std::size_t>(
+                                      static_cast<const char *>(end) - value)};
+}
+
+inline void decode(const std::uint8_t *in, std::size_t rows,
+                   std::uint64_t size, std::string *out) {
+  for (std::size_t i = 0; i < rows; i++)
+    out[i] = decode_str(in + i * (size + 8), size);
+}
+
+// Appends the encoding of one value to `out`
+template <Fixed T> void push(std::vector<std::uint8_t> &out, T value) {
+  std::size_t at = out.size();
+  out.resize(at + sizeof(T));
+  encode(std::span<const T>(&value, 1), out.data() + at);
+}
+
+inline void push(std::vector<std::uint8_t> &out, std::string_view value,
+                 std::uint64_t size) {
+  std::size_t at = out.size();
+  out.resize(at + size + 8);
+  encode_str(value, size, out.data() + at);
+}
+
+// Appends a vstr value as rows carry it, before it is split into heap bytes
+// and an offset
+inline void push_varlen(std::vector<std::uint8_t> &out,
+                        std::string_view value) {
+  push(out, static_cast<std::uint32_t>(value.size()));
+  out.insert(out.end(), value.begin(), value.end());
+}
+
+// CRC-32 (IEEE), used to tell torn or corrupt records from valid ones
+inline std::uint32_t crc32(const std::uint8_t *data, std::size_t size) {
+  static const std::array<std::uint32_t, 256> table = [] {
+    std::array<std::uint32_t, 256> result{};
+    for (std::uint32_t i = 0; i < 256; i++) {
+      std::uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++)
+        value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+      result[i] = value;
+    }
+    return result;
+  }();
+
+  std::uint32_t crc = 0xFFFFFFFFu;
+  for (std::size_t i = 0; i < size; i++)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFu;
+}
+
+} // namespace Codec
+
+#endif // CODEC_HPP
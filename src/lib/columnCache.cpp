@@ -0,0 +1,229 @@
+#include "columnCache.hpp"
+
+#include <list>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace ColumnCache {
+
+namespace {
+
+// Bytes an entry is charged for
+std::size_t charge(const ColumnInstance &instance) {
+  return instance.bytes() +
+         instance.nulls.pages.size() * sizeof(ColumnFile::NullMap::Page);
+}
+
+// Held by the cache alone, no query uses the entry
+bool unused(const ColumnInstance &instance) {
+  return std::visit([](const auto &storage) { return storage.use_count() <= 1; },
+                    instance.storage);
+}
+
+// `cached` grown to the first `rows` rows of its file, reading only the
+// rows it does not hold yet. Nothing when it has to be loaded again whole.
+std::optional<ColumnInstance> extend(ColumnInstance cached, std::uint64_t rows) {
+  if (cached.layout.type == ColumnType::rbool)
+    return std::nullopt;
+
+  auto mapping = FileManager::MappedFile::open(cached.file);
+  if (mapping.has_error())
+    return std::nullopt;
+  auto contents = mapping.value();
+  auto header = ColumnFile::Header::parse(contents->data(), contents->size());
+  std::size_t offset = header.has_value() ? ColumnFile::HEADER_SIZE : 0;
+  std::size_t stride = cached.stride();
+  std::size_t from = cached.size;
+  if (contents->size() < offset)
+    return std::nullopt;
+
+  if (cached.is_mapped()) {
+    // The new rows are already in place behind a new mapping
+    if ((contents->size() - offset) / stride < rows)
+      return std::nullopt;
+    cached.storage = contents;
+    cached.data = contents->data() + offset;
+  } else if (header.has_value() &&
+             header->encoding == ColumnFile::Encoding::Paged) {
+    // Only the pages past the cached rows are decoded
+    auto added = ColumnFile::read_paged(contents->data(), contents->size(),
+                                        cached.file, cached.layout, from);
+    if (added.has_error() || added->size() / stride < rows - from)
+      return std::nullopt;
+
+    // Copied first when a query still reads the old values
+    auto &owned =
+        std::get<std::shared_ptr<std::vector<std::uint8_t>>>(cached.storage);
+    if (owned.use_count() > 1)
+      owned = std::make_shared<std::vector<std::uint8_t>>(*owned);
+    owned->insert(owned->end(), added->begin(),
+                  added->begin() + (rows - from) * stride);
+    cached.data = owned->data();
+  } else {
+    return std::nullopt;
+  }
+  cached.size = rows;
+
+  if (cached.layout.type == ColumnType::vstr) {
+    auto heap = FileManager::MappedFile::open(ColumnFile::heap_path(cached.file));
+    if (heap.has_error() ||
+        Codec::load<std::uint64_t>(cached.data + (rows - 1) * stride) >
+            heap.value()->size())
+      return std::nullopt;
+    cached.heap = heap.value();
+  }
+  if (cached.layout.type == ColumnType::dstr) {
+    // Codes the cached dictionary does not hold yet make it load again
+    auto codes = cached.values<std::uint32_t>();
+    for (std::size_t i = from; i < rows; i++) {
+      if (codes[i] >= cached.dictionary->size()) {
+        cached.dictionary =
+            Dictionary::load(Dictionary::path_for(cached.file));
+        break;
+      }
+    }
+  }
+  if (cached.layout.optional)
+    cached.nulls =
+        ColumnFile::NullMap::load(ColumnFile::nulls_path(cached.file), rows);
+  if (cached.zones && cached.zones->rows() == from) {
+    // Copied, queries holding the old instance still prune with it
+    auto zones = std::make_shared<ColumnFile::ZoneMap>(*cached.zones);
+    zones->extend(cached.data + from * stride, rows - from);
+    cached.zones = std::move(zones);
+  } else {
+    cached.load_zones();
+  }
+  return cached;
+}
+
+struct Entry {
+  ColumnInstance instance;
+  std::size_t bytes;
+  // Position in `recent`
+  std::list<std::string>::iterator used;
+};
+
+std::mutex mutex;
+std::unordered_map<std::string, Entry> entries;
+// Keys, the most recently used first
+std::list<std::string> recent;
+Stats counters;
+
+void erase(std::unordered_map<std::string, Entry>::iterator entry) {
+  counters.bytes -= entry->second.bytes;
+  recent.erase(entry->second.used);
+  entries.erase(entry);
+}
+
+// Drops unused entries from the least recently used on until the cache
+// fits its budget, called with `mutex` held
+void evict() {
+  auto budget = Options::global().bytes;
+  auto key = recent.end();
+  while (counters.bytes > budget && key != recent.begin()) {
+    --key;
+    auto entry = entries.find(*key);
+    if (!unused(entry->second.instance))
+      continue;
+    key = std::next(key);
+    erase(entry);
+    counters.evictions++;
+  }
+}
+
+// Adds `instance` under `key` unless it does not fit at all, called with
+// `mutex` held
+void keep(const std::string &key, const ColumnInstance &instance) {
+  std::size_t bytes = charge(instance);
+  if (bytes > Options::global().bytes || entries.contains(key))
+    return;
+  recent.push_front(key);
+  entries.emplace(key, Entry{instance, bytes, recent.begin()});
+  counters.bytes += bytes;
+  evict();
+}
+
+} // namespace
+
+Options &Options::global() {
+  static Options options;
+  return options;
+}
+
+cpp::result<ColumnInstance, std::string> load(const std::string &database,
+                                              const std::string &table,
+                                              const std::string &column,
+                                              DatabaseTable &descriptor) {
+  // Taken before flushing, every row under it is in the files after
+  auto watermark = descriptor.watermark(database);
+  auto flushed = descriptor.flush_appends();
+  if (flushed.has_error())
+    return cpp::fail(flushed.error());
+
+  auto key = fmt::format("{}.{}.{}", database, table, column);
+  std::optional<ColumnInstance> stale;
+  {
+    std::lock_guard lock(mutex);
+    auto entry = entries.find(key);
+    if (entry != entries.end()) {
+      if (entry->second.instance.size >= watermark) {
+        counters.hits++;
+        recent.splice(recent.begin(), recent, entry->second.used);
+        // Entries unpinned since the last load may be over the budget
+        ColumnInstance hit = entry->second.instance;
+        evict();
+        return hit;
+      }
+      // Taken out while it grows, no other query can get it meanwhile
+      stale = std::move(entry->second.instance);
+      erase(entry);
+    }
+  }
+
+  if (stale) {
+    std::optional<ColumnInstance> grown;
+    {
+      // Read like load_column does, with no batch half written
+      std::shared_lock<std::shared_mutex> lock(descriptor.mtx_);
+      auto reading = descriptor.lock_files();
+      grown = extend(std::move(*stale), watermark);
+    }
+    if (grown) {
+      std::lock_guard lock(mutex);
+      counters.extensions++;
+      keep(key, *grown);
+      return std::move(*grown);
+    }
+  }
+
+  auto loaded = ColumnInstance::load_column(database, table, column, descriptor);
+  if (loaded.has_error())
+    return loaded;
+  std::lock_guard lock(mutex);
+  counters.misses++;
+  keep(key, loaded.value());
+  return loaded;
+}
+
+void forget(const std::string &database, const std::string &table) {
+  auto prefix = table.empty() ? fmt::format("{}.", database)
+                              : fmt::format("{}.{}.", database, table);
+  std::lock_guard lock(mutex);
+  for (auto entry = entries.begin(); entry != entries.end();) {
+    auto next = std::next(entry);
+    if (entry->first.starts_with(prefix))
+      erase(entry);
+    entry = next;
+  }
+}
+
+Stats stats() {
+  std::lock_guard lock(mutex);
+  Stats current = counters;
+  current.entries = entries.size();
+  return current;
+}
+
+} // namespace ColumnCache
@@ -0,0 +1,56 @@
+#ifndef COLUMNCACHE_HPP
+#define COLUMNCACHE_HPP
+
+#include <cstdint>
+#include <result.hpp>
+#include <string>
+
+#include "columnInstance.hpp"
+#include "table.hpp"
+
+// Columns loaded by earlier queries, kept decoded so the next query that
+// reads them does not open, map or decode their files again. Only inserts
+// change a table, and only at its end: an entry holding fewer rows than
+// the table's watermark (see DatabaseTable::watermark) is extended with the
+// rows written since, mapping the file again or decoding just the new
+// pages, and its zone map folds them in, instead of being loaded again
+// whole.
+//
+// Up to `Options::bytes` are kept and the least recently used entries go
+// first, but never one a query still holds: a ColumnInstance shares the
+// storage of its entry, which stays pinned until the last copy is gone.
+namespace ColumnCache {
+
+struct Options {
+  // Most bytes of columns kept, 0 keeps none
+  std::size_t bytes = std::size_t{256} << 20;
+
+  // Options used by every query, set once at startup
+  static Options &global();
+};
+
+struct Stats {
+  std::size_t hits = 0;
+  std::size_t misses = 0;
+  // Entries grown by the rows inserted since they were loaded
+  std::size_t extensions = 0;
+  std::size_t evictions = 0;
+  std::size_t entries = 0;
+  std::size_t bytes = 0;
+};
+
+// `column` of `database.table` as ColumnInstance::load_column gives it,
+// from the cache, extended to the rows inserted since it was cached
+cpp::result<ColumnInstance, std::string> load(const std::string &database,
+                                              const std::string &table,
+                                              const std::string &column,
+                                              DatabaseTable &descriptor);
+
+// Drops the entries of `database`, only those of `table` when it is given
+void forget(const std::string &database, const std::string &table = "");
+
+Stats stats();
+
+} // namespace ColumnCache
+
+#endif // COLUMNCACHE_HPP
@@ -0,0 +1,1070 @@
+#include "columnFile.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fmt/core.h>
+#include <fstream>
+
+#include "bitmap.hpp"
+#include "fm.hpp"
+#include "pageCodec.hpp"
+
+namespace ColumnFile {
+
+static constexpr char MAGIC[6] = {'T', 'O', 'I', 'C', 'O', 'L'};
+static constexpr char ZONE_MAGIC[4] = {'T', 'O', 'I', 'Z'};
+static constexpr std::size_t ZONE_HEADER_SIZE = 16;
+static constexpr std::size_t ZONE_ENTRY_SIZE = 24;
+
+Header Header::for_layout(const Layout &layout) {
+  Header header;
+  header.type = layout.type;
+  header.stride = Codec::value_size(layout);
+  if (layout.type == ColumnType::rbool)
+    header.encoding = Encoding::Bits;
+  else if (is_paged(layout.type))
+    header.encoding = Encoding::Paged;
+  return header;
+}
+
+std::array<std::uint8_t, HEADER_SIZE> Header::encode() const {
+  std::array<std::uint8_t, HEADER_SIZE> out{};
+  std::memcpy(out.data(), MAGIC, sizeof(MAGIC));
+  Codec::store<std::uint16_t>(version, out.data() + 6);
+  Codec::store<std::uint32_t>(static_cast<std::uint32_t>(type),
+                              out.data() + 8);
+  out[12] = static_cast<std::uint8_t>(encoding);
+  Codec::store<std::uint32_t>(page_rows, out.data() + 16);
+  Codec::store<std::uint64_t>(stride, out.data() + 24);
+  Codec::store<std::uint64_t>(rows, out.data() + 32);
+  Codec::store<std::uint64_t>(bytes, out.data() + 40);
+  return out;
+}
+
+std::optional<Header> Header::parse(const std::uint8_t *data,
+                                    std::size_t size) {
+  if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0)
+    return std::nullopt;
+
+  Header header;
+  header.version = Codec::load<std::uint16_t>(data + 6);
+  header.type = static_cast<ColumnType>(Codec::load<std::uint32_t>(data + 8));
+  header.encoding = static_cast<Encoding>(data[12]);
+  header.page_rows = Codec::load<std::uint32_t>(data + 16);
+  header.stride = Codec::load<std::uint64_t>(data + 24);
+  header.rows = Codec::load<std::uint64_t>(data + 32);
+  header.bytes = Codec::load<std::uint64_t>(data + 40);
+  return header;
+}
+
+cpp::result<void, std::string> create(const std::string &path,
+                                      const Layout &layout) {
+  auto header = Header::for_layout(layout).encode();
+  std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(header.data()), header.size());
+  file.close();
+
+  if (file.fail())
+    return cpp::fail(fmt::format("Failed to create column file {}", path));
+
+  // Rows a previous column of the same name left waiting for a page
+  if (is_paged(layout.type))
+    std::remove(tail_path(path).c_str());
+  if (layout.optional)
+    std::remove(nulls_path(path).c_str());
+
+  if (layout.type == ColumnType::vstr) {
+    std::ofstream heap(heap_path(path),
+                       std::ios::out | std::ios::binary | std::ios::trunc);
+    heap.close();
+    if (heap.fail())
+      return cpp::fail(fmt::format("Failed to create heap file {}",
+                                   heap_path(path)));
+  }
+
+  return {};
+}
+
+static std::optional<Header> read_header(const std::string &path) {
+  std::uint8_t head[HEADER_SIZE];
+  std::ifstream file(path, std::ios::in | std::ios::binary);
+  file.read(reinterpret_cast<char *>(head), HEADER_SIZE);
+  auto read = static_cast<std::size_t>(file.gcount());
+  return Header::parse(head, read);
+}
+
+std::size_t data_offset(const std::string &path) {
+  return read_header(path).has_value() ? HEADER_SIZE : 0;
+}
+
+std::string tail_path(const std::string &column_path) {
+  auto dot = column_path.rfind(".col");
+  return (dot == std::string::npos ? column_path
+                                   : column_path.substr(0, dot)) +
+         ".tail";
+}
+
+std::string nulls_path(const std::string &column_path) {
+  auto dot = column_path.rfind(".col");
+  return (dot == std::string::npos ? column_path
+                                   : column_path.substr(0, dot)) +
+         ".nulls";
+}
+
+bool is_paged(ColumnType type) {
+  return type == ColumnType::u64 || type == ColumnType::i64;
+}
+
+static constexpr std::size_t PAGE_HEADER_SIZE = 12;
+static constexpr std::uint64_t SIGN_BIT = std::uint64_t{1} << 63;
+
+// Codecs see signed values with the sign bit flipped so they order as
+// unsigned ones
+static std::uint64_t order_key(ColumnType type, std::uint64_t value) {
+  return type == ColumnType::i64 ? value ^ SIGN_BIT : value;
+}
+
+// Index of the first tail row and the whole values after it
+static std::pair<std::uint64_t, std::vector<std::uint64_t>>
+read_tail(const std::string &path, std::uint64_t sealed) {
+  std::vector<std::uint64_t> values;
+  if (!FileManager::Path(path).exists())
+    return {sealed, values};
+
+  auto contents = FileManager::read_to_vec(path);
+  if (contents.size() < sizeof(std::uint64_t))
+    return {sealed, values};
+
+  std::uint64_t first = Codec::load<std::uint64_t>(contents.data());
+  std::size_t rows = (contents.size() - sizeof(std::uint64_t)) /
+                     sizeof(std::uint64_t);
+  values.resize(rows);
+  Codec::decode(contents.data() + sizeof(std::uint64_t), rows, values.data());
+  return {first, values};
+}
+
+static std::uint64_t paged_rows(const std::string &path,
+                                const Header &header) {
+  auto [first, values] = read_tail(tail_path(path), header.rows);
+  if (first > header.rows)
+    return header.rows;
+  return std::max(header.rows, first + values.size());
+}
+
+cpp::result<std::vector<std::uint8_t>, std::string>
+read_paged(const std::uint8_t *data, std::size_t size, const std::string &path,
+           const Layout &layout, std::uint64_t from) {
+  auto header = Header::parse(data, size);
+  if (!header.has_value() || header->encoding != Encoding::Paged)
+    return cpp::fail(fmt::format("{} is not a paged column", path));
+  if (size < HEADER_SIZE + header->bytes)
+    return cpp::fail(fmt::format("{} is shorter than its pages", path));
+
+  auto [first, tail] = read_tail(tail_path(path), header->rows);
+  if (first > header->rows)
+    return cpp::fail(fmt::format("The tail of {} skips rows", path));
+  std::uint64_t skip = header->rows - first;
+  std::uint64_t rows =
+      header->rows + (tail.size() > skip ? tail.size() - skip : 0);
+  from = std::min(from, rows);
+
+  std::vector<std::uint8_t> out((rows - from) * sizeof(std::uint64_t));
+  auto *values = reinterpret_cast<std::uint64_t *>(out.data());
+  // A page that starts before `from` is decoded aside and only its rows
+  // past `from` are kept
+  std::vector<std::uint64_t> straddling;
+
+  const std::uint8_t *in = data + HEADER_SIZE;
+  const std::uint8_t *end = in + header->bytes;
+  std::uint64_t decoded = 0;
+  while (in < end) {
+    if (end - in < static_cast<std::ptrdiff_t>(PAGE_HEADER_SIZE))
+      return cpp::fail(fmt::format("Torn page in {}", path));
+    std::uint32_t page_rows = Codec::load<std::uint32_t>(in);
+    std::uint32_t payload = Codec::load<std::uint32_t>(in + 4);
+    auto kind = static_cast<PageCodec::Kind>(in[8]);
+    in += PAGE_HEADER_SIZE;
+
+    if (end - in < static_cast<std::ptrdiff_t>(payload) ||
+        page_rows > header->rows - decoded)
+      return cpp::fail(fmt::format("Corrupt page in {}", path));
+    if (decoded + page_rows > from) {
+      std::uint64_t *page = values + (decoded - std::min(decoded, from));
+      if (decoded < from) {
+        straddling.resize(page_rows);
+        page = straddling.data();
+      }
+      if (!PageCodec::decode(kind, in, payload, page_rows, page))
+        return cpp::fail(fmt::format("Corrupt page in {}", path));
+      for (std::uint64_t i = 0; i < page_rows; i++)
+        page[i] = order_key(layout.type, page[i]);
+      if (decoded < from)
+        std::copy(page + (from - decoded), page + page_rows, values);
+    }
+    decoded += page_rows;
+    in += payload;
+  }
+
+  if (decoded != header->rows)
+    return cpp::fail(fmt::format("The pages of {} hold {} rows, not {}", path,
+                                 decoded, header->rows));
+
+  for (std::uint64_t i = skip; i < tail.size(); i++, decoded++) {
+    if (decoded >= from)
+      values[decoded - from] = tail[i];
+  }
+
+  return out;
+}
+
+std::uint64_t row_count(const std::string &path, const Layout &layout) {
+  FileManager::Path column(path);
+  if (!column.exists())
+    return 0;
+
+  auto header = read_header(path);
+  if (header.has_value() && header->encoding == Encoding::Bits)
+    return header->rows;
+  if (header.has_value() && header->encoding == Encoding::Paged)
+    return paged_rows(path, *header);
+
+  std::uint64_t size = column.get_file_size();
+  std::uint64_t offset = header.has_value() ? HEADER_SIZE : 0;
+  return size < offset ? 0 : (size - offset) / Codec::value_size(layout);
+}
+
+cpp::result<std::uint64_t, std::string> repair(const std::string &path,
+                                               const Layout &layout) {
+  FileManager::Path column(path);
+  if (!column.exists())
+    return 0;
+
+  // Words past the row count in the header are not part of the column,
+  // neither are pages past its bytes. Writers cut them.
+  auto header = read_header(path);
+  if (header.has_value() && header->encoding == Encoding::Bits)
+    return header->rows;
+  if (header.has_value() && header->encoding == Encoding::Paged)
+    return paged_rows(path, *header);
+
+  std::uint64_t stride = Codec::value_size(layout);
+  std::uint64_t offset = header.has_value() ? HEADER_SIZE : 0;
+  std::uint64_t bytes = column.get_file_size();
+  bytes = bytes < offset ? 0 : bytes - offset;
+  std::uint64_t rows = bytes / stride;
+
+  if (bytes % stride != 0 &&
+      !FileManager::resize_file(path, offset + rows * stride))
+    return cpp::fail(fmt::format("Failed to repair {}", path));
+
+  return rows;
+}
+
+std::string zone_map_path(const std::string &column_path) {
+  auto dot = column_path.rfind(".col");
+  return (dot == std::string::npos ? column_path
+                                   : column_path.substr(0, dot)) +
+         ".zm";
+}
+
+std::string heap_path(const std::string &column_path) {
+  auto dot = column_path.rfind(".col");
+  return (dot == std::string::npos ? column_path
+                                   : column_path.substr(0, dot)) +
+         ".heap";
+}
+
+// How min and max of a type are compared once widened
+enum class Widened { Unsigned, Signed, Float };
+
+static Widened widened(ColumnType type) {
+  switch (type) {
+  case ColumnType::i8:
+  case ColumnType::i16:
+  case ColumnType::i32:
+  case ColumnType::i64:
+    return Widened::Signed;
+  case ColumnType::f64:
+    return Widened::Float;
+  default:
+    return Widened::Unsigned;
+  }
+}
+
+template <typename T>
+static PageStats fold(const std::uint8_t *in, std::uint64_t rows) {
+  using W = std::conditional_t<
+      std::is_floating_point_v<T>, double,
+      std::conditional_t<is_unsigned_key<T>(), std::uint64_t, std::int64_t>>;
+
+  W min = std::numeric_limits<W>::max();
+  W max = std::numeric_limits<W>::lowest();
+  bool nan = false;
+
+  for (std::uint64_t i = 0; i < rows; i++) {
+    W value;
+    if constexpr (std::is_same_v<T, bool>)
+      value = in[i] != 0;
+    else
+      value = static_cast<W>(Codec::load<T>(in + i * sizeof(T)));
+
+    if constexpr (std::is_floating_point_v<W>) {
+      if (std::isnan(value)) {
+        nan = true;
+        continue;
+      }
+    }
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+
+  // A NaN matches no comparison but NOT_EQUAL, keep such pages in every scan
+  if constexpr (std::is_floating_point_v<W>) {
+    if (nan) {
+      min = -std::numeric_limits<double>::infinity();
+      max = std::numeric_limits<double>::infinity();
+    }
+  }
+
+  return {rows, std::bit_cast<std::uint64_t>(min),
+          std::bit_cast<std::uint64_t>(max)};
+}
+
+template <typename W>
+static void merge_as(PageStats &into, const PageStats &other) {
+  W min = std::min(std::bit_cast<W>(into.min), std::bit_cast<W>(other.min));
+  W max = std::max(std::bit_cast<W>(into.max), std::bit_cast<W>(other.max));
+  into.min = std::bit_cast<std::uint64_t>(min);
+  into.max = std::bit_cast<std::uint64_t>(max);
+  into.rows += other.rows;
+}
+
+bool ZoneMap::supports(ColumnType type) {
+  switch (type) {
+  case ColumnType::u8:
+  case ColumnType::u16:
+  case ColumnType::u32:
+  case ColumnType::u64:
+  case ColumnType::i8:
+  case ColumnType::i16:
+  case ColumnType::i32:
+  case ColumnType::i64:
+  case ColumnType::f64:
+  case ColumnType::dstr:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::size_t ZoneMap::value_size(ColumnType type) {
+  switch (type) {
+  case ColumnType::u16:
+  case ColumnType::i16:
+    return 2;
+  case ColumnType::u32:
+  case ColumnType::i32:
+  case ColumnType::dstr:
+    return 4;
+  case ColumnType::u64:
+  case ColumnType::i64:
+  case ColumnType::f64:
+    return 8;
+  default:
+    return 1;
+  }
+}
+
+std::uint64_t ZoneMap::rows() const {
+  std::uint64_t total = 0;
+  for (auto &page : pages)
+    total += page.rows;
+  return total;
+}
+
+PageStats ZoneMap::page_stats(const std::uint8_t *values,
+                              std::uint64_t rows) const {
+  switch (type) {
+  case ColumnType::u8:
+    return fold<std::uint8_t>(values, rows);
+  case ColumnType::u16:
+    return fold<std::uint16_t>(values, rows);
+  case ColumnType::u32:
+    return fold<std::uint32_t>(values, rows);
+  case ColumnType::u64:
+    return fold<std::uint64_t>(values, rows);
+  case ColumnType::i8:
+    return fold<std::int8_t>(values, rows);
+  case ColumnType::i16:
+    return fold<std::int16_t>(values, rows);
+  case ColumnType::i32:
+    return fold<std::int32_t>(values, rows);
+  case ColumnType::i64:
+    return fold<std::int64_t>(values, rows);
+  case ColumnType::f64:
+    return fold<double>(values, rows);
+  case ColumnType::rbool:
+    return fold<bool>(values, rows);
+  case ColumnType::dstr:
+    return fold<std::uint32_t>(values, rows);
+  default:
+    return {rows, 0, 0};
+  }
+}
+
+std::size_t ZoneMap::extend(const std::uint8_t *values, std::uint64_t rows) {
+  std::size_t stride = value_size(type);
+
+  std::size_t first_changed = pages.size();
+  if (!pages.empty() && pages.back().rows < page_rows)
+    first_changed--;
+
+  std::uint64_t consumed = 0;
+  while (consumed < rows) {
+    if (pages.empty() || pages.back().rows == page_rows)
+      pages.push_back({});
+
+    PageStats &page = pages.back();
+    std::uint64_t take = std::min<std::uint64_t>(page_rows - page.rows,
+                                                  rows - consumed);
+    PageStats added = page_stats(values + consumed * stride, take);
+
+    if (page.rows == 0) {
+      page = added;
+    } else {
+      switch (widened(type)) {
+      case Widened::Unsigned:
+        merge_as<std::uint64_t>(page, added);
+        break;
+      case Widened::Signed:
+        merge_as<std::int64_t>(page, added);
+        break;
+      case Widened::Float:
+        merge_as<double>(page, added);
+        break;
+      }
+    }
+    consumed += take;
+  }
+
+  return first_changed;
+}
+
+static std::array<std::uint8_t, ZONE_ENTRY_SIZE>
+encode_entry(const PageStats &stats) {
+  std::array<std::uint8_t, ZONE_ENTRY_SIZE> out{};
+  Codec::store<std::uint32_t>(static_cast<std::uint32_t>(stats.rows),
+                              out.data());
+  Codec::store<std::uint64_t>(stats.min, out.data() + 8);
+  Codec::store<std::uint64_t>(stats.max, out.data() + 16);
+  std::array<std::uint8_t, 20> covered{};
+  std::memcpy(covered.data(), out.data(), 4);
+  std::memcpy(covered.data() + 4, out.data() + 8, 16);
+  Codec::store<std::uint32_t>(Codec::crc32(covered.data(), covered.size()),
+                              out.data() + 4);
+  return out;
+}
+
+static std::optional<PageStats> decode_entry(const std::uint8_t *in) {
+  std::array<std::uint8_t, 20> covered{};
+  std::memcpy(covered.data(), in, 4);
+  std::memcpy(covered.data() + 4, in + 8, 16);
+  if (Codec::crc32(covered.data(), covered.size()) !=
+      Codec::load<std::uint32_t>(in + 4))
+    return std::nullopt;
+
+  return PageStats{Codec::load<std::uint32_t>(in),
+                   Codec::load<std::uint64_t>(in + 8),
+                   Codec::load<std::uint64_t>(in + 16)};
+}
+
+ZoneMap ZoneMap::load(const std::string &path, const Layout &layout,
+                      const std::uint8_t *values, std::uint64_t rows) {
+  ZoneMap zones{layout.type, PAGE_ROWS, {}};
+  if (!supports(layout.type) || rows == 0)
+    return zones;
+
+  std::vector<std::uint8_t> stored;
+  if (FileManager::Path(path).exists())
+    stored = FileManager::read_to_vec(path);
+
+  bool usable =
+      stored.size() >= ZONE_HEADER_SIZE &&
+      std::memcmp(stored.data(), ZONE_MAGIC, sizeof(ZONE_MAGIC)) == 0 &&
+      Codec::load<std::uint32_t>(stored.data() + 4) == zones.page_rows &&
+      Codec::load<std::uint32_t>(stored.data() + 8) ==
+          static_cast<std::uint32_t>(layout.type);
+  std::size_t entries =
+      usable ? (stored.size() - ZONE_HEADER_SIZE) / ZONE_ENTRY_SIZE : 0;
+
+  std::size_t stride = Codec::value_size(layout);
+  std::uint64_t page_count = (rows + zones.page_rows - 1) / zones.page_rows;
+  zones.pages.reserve(page_count);
+
+  for (std::uint64_t page = 0; page < page_count; page++) {
+    std::uint64_t first = page * zones.page_rows;
+    std::uint64_t expected =
+        std::min<std::uint64_t>(zones.page_rows, rows - first);
+
+    std::optional<PageStats> entry;
+    if (page < entries)
+      entry = decode_entry(stored.data() + ZONE_HEADER_SIZE +
+                           page * ZONE_ENTRY_SIZE);
+
+    if (entry.has_value() && entry->rows == expected)
+      zones.pages.push_back(*entry);
+    else
+      zones.pages.push_back(
+          zones.page_stats(values + first * stride, expected));
+  }
+
+  return zones;
+}
+
+cpp::result<void, std::string> ZoneMap::store(const std::string &path,
+                                              std::size_t from_page) const {
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  if (file == nullptr)
+    file = std::fopen(path.c_str(), "w+b");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open zone map {}", path));
+
+  std::array<std::uint8_t, ZONE_HEADER_SIZE> header{};
+  std::memcpy(header.data(), ZONE_MAGIC, sizeof(ZONE_MAGIC));
+  Codec::store<std::uint32_t>(page_rows, header.data() + 4);
+  Codec::store<std::uint32_t>(static_cast<std::uint32_t>(type),
+                              header.data() + 8);
+
+  bool ok = std::fwrite(header.data(), 1, header.size(), file) ==
+            header.size();
+
+  std::vector<std::uint8_t> entries;
+  entries.reserve((pages.size() - std::min(from_page, pages.size())) *
+                  ZONE_ENTRY_SIZE);
+  for (std::size_t page = from_page; page < pages.size(); page++) {
+    auto entry = encode_entry(pages[page]);
+    entries.insert(entries.end(), entry.begin(), entry.end());
+  }
+
+  ok = ok &&
+       std::fseek(file,
+                  static_cast<long>(ZONE_HEADER_SIZE +
+                                    from_page * ZONE_ENTRY_SIZE),
+                  SEEK_SET) == 0 &&
+       std::fwrite(entries.data(), 1, entries.size(), file) == entries.size();
+  ok = std::fclose(file) == 0 && ok;
+
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to write zone map {}", path));
+
+  return {};
+}
+
+NullMap NullMap::load(const std::string &path, std::uint64_t rows) {
+  NullMap map;
+  if (rows == 0 || !FileManager::Path(path).exists())
+    return map;
+
+  auto contents = FileManager::read_to_vec(path);
+  std::uint64_t row_pages = (rows + PAGE_ROWS - 1) / PAGE_ROWS;
+  for (std::size_t at = 0; at + ENTRY_SIZE <= contents.size();
+       at += ENTRY_SIZE) {
+    Page entry{Codec::load<std::uint64_t>(contents.data() + at)};
+    // Entries only go forward, anything else was torn
+    if (entry.page >= row_pages ||
+        (!map.pages.empty() && entry.page <= map.pages.back().page))
+      break;
+    for (std::size_t w = 0; w < PAGE_WORDS; w++)
+      entry.bits[w] = Codec::load<std::uint64_t>(
+          contents.data() + at + (w + 1) * sizeof(std::uint64_t));
+    map.pages.push_back(entry);
+  }
+
+  if (map.pages.empty())
+    return map;
+
+  // Bits of rows the column does not hold
+  Page &last = map.pages.back();
+  std::uint64_t used = rows - last.page * PAGE_ROWS;
+  bool any = false;
+  for (std::size_t w = 0; w < PAGE_WORDS; w++) {
+    std::uint64_t from = w * Bitmap::WORD_BITS;
+    if (from >= used)
+      last.bits[w] = 0;
+    else if (used - from < Bitmap::WORD_BITS)
+      last.bits[w] &= Bitmap::tail_mask(used - from);
+    any = any || last.bits[w] != 0;
+  }
+  if (!any)
+    map.pages.pop_back();
+
+  return map;
+}
+
+std::uint64_t NullMap::count() const {
+  std::uint64_t total = 0;
+  for (auto &entry : pages) {
+    for (auto bits : entry.bits)
+      total += std::popcount(bits);
+  }
+  return total;
+}
+
+std::size_t NullMap::set(std::uint64_t row) {
+  std::uint64_t page = row / PAGE_ROWS;
+  if (pages.empty() || pages.back().page != page)
+    pages.push_back(Page{page});
+
+  std::uint64_t bit = row % PAGE_ROWS;
+  pages.back().bits[bit / Bitmap::WORD_BITS] |= std::uint64_t{1}
+                                                << (bit % Bitmap::WORD_BITS);
+  return pages.size() - 1;
+}
+
+void NullMap::clear(std::vector<std::uint64_t> &selected) const {
+  for (auto &entry : pages) {
+    std::size_t first = entry.page * PAGE_WORDS;
+    if (first >= selected.size())
+      break;
+    std::size_t words = std::min(PAGE_WORDS, selected.size() - first);
+    for (std::size_t w = 0; w < words; w++)
+      selected[first + w] &= ~entry.bits[w];
+  }
+}
+
+cpp::result<void, std::string> Writer::append(const std::uint8_t *values,
+                                              std::size_t size, bool sync) {
+  if (layout.optional)
+    return append_optional(values, size, sync);
+  return append_values(values, size, sync);
+}
+
+cpp::result<void, std::string>
+Writer::append_optional(const std::uint8_t *values, std::size_t size,
+                        bool sync) {
+  auto nulls = nulls_path(path);
+
+  // Bits a crash left past the last row go before rows land on them
+  if (!next_row_.has_value()) {
+    std::uint64_t rows = row_count(path, layout);
+    nulls_ = NullMap::load(nulls, rows);
+    if (FileManager::Path(nulls).exists()) {
+      if (!FileManager::resize_file(nulls,
+                                    nulls_.pages.size() * NullMap::ENTRY_SIZE))
+        return cpp::fail(fmt::format("Failed to repair {}", nulls));
+      if (!nulls_.empty()) {
+        auto written = write_nulls({nulls_.pages.size() - 1}, sync);
+        if (written.has_error())
+          return written;
+      }
+    }
+    next_row_ = rows;
+  }
+
+  // The flags go to the null map, the values on to the column
+  std::vector<std::uint8_t> stripped;
+  std::vector<std::size_t> changed;
+  stripped.reserve(size);
+  std::uint64_t row = *next_row_;
+  std::size_t stride = Codec::value_size(layout);
+  for (std::size_t at = 0; at < size; row++) {
+    std::size_t length = stride;
+    if (layout.type == ColumnType::vstr && size - at >= 5)
+      length = 4 + Codec::load<std::uint32_t>(values + at + 1);
+    if (size - at < 1 + length) {
+      next_row_.reset();
+      return cpp::fail(fmt::format("Torn value appended to {}", path));
+    }
+
+    if (values[at] == 0) {
+      std::size_t entry = nulls_.set(row);
+      if (changed.empty() || changed.back() != entry)
+        changed.push_back(entry);
+    }
+    stripped.insert(stripped.end(), values + at + 1,
+                    values + at + 1 + length);
+    at += 1 + length;
+  }
+
+  // Null bits first, rows past the column ignore them
+  cpp::result<void, std::string> result;
+  if (!changed.empty())
+    result = write_nulls(changed, sync);
+  if (!result.has_error())
+    result = append_values(stripped.data(), stripped.size(), sync);
+
+  if (result.has_error()) {
+    next_row_.reset();
+    return result;
+  }
+  next_row_ = row;
+  return {};
+}
+
+cpp::result<void, std::string>
+Writer::write_nulls(const std::vector<std::size_t> &entries, bool sync) {
+  auto nulls = nulls_path(path);
+  std::FILE *file = std::fopen(nulls.c_str(), "r+b");
+  if (file == nullptr)
+    file = std::fopen(nulls.c_str(), "w+b");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open {}", nulls));
+
+  std::array<std::uint8_t, NullMap::ENTRY_SIZE> encoded{};
+  bool ok = true;
+  for (auto entry : entries) {
+    const NullMap::Page &page = nulls_.pages[entry];
+    Codec::store<std::uint64_t>(page.page, encoded.data());
+    for (std::size_t w = 0; w < NullMap::PAGE_WORDS; w++)
+      Codec::store<std::uint64_t>(page.bits[w], encoded.data() +
+                                                    (w + 1) *
+                                                        sizeof(std::uint64_t));
+    ok = ok &&
+         std::fseek(file, static_cast<long>(entry * NullMap::ENTRY_SIZE),
+                    SEEK_SET) == 0 &&
+         std::fwrite(encoded.data(), 1, encoded.size(), file) ==
+             encoded.size();
+  }
+  ok = ok && std::fflush(file) == 0;
+  if (ok && sync)
+    ok = FileManager::sync_file(file);
+  ok = std::fclose(file) == 0 && ok;
+
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to write {}", nulls));
+  return {};
+}
+
+cpp::result<void, std::string>
+Writer::append_values(const std::uint8_t *values, std::size_t size,
+                      bool sync) {
+  if (layout.type == ColumnType::vstr)
+    return append_varlen(values, size, sync);
+
+  if (!header_read_) {
+    header_ = read_header(path);
+    header_read_ = true;
+  }
+  if (header_.has_value() && header_->encoding == Encoding::Bits)
+    return append_bits(values, size, sync);
+
+  auto appended =
+      header_.has_value() && header_->encoding == Encoding::Paged
+          ? append_paged(values, size, sync)
+          : FileManager::append_bytes(path, values, size, sync);
+  if (appended.has_error())
+    return appended;
+
+  if (!ZoneMap::supports(layout.type))
+    return {};
+
+  // The zone map is derived from the values, if writing it fails it gets
+  // rebuilt on the next load
+  if (!zones_.has_value()) {
+    load_zones();
+    auto _ = zones_->store(zone_map_path(path), 0);
+  } else {
+    auto from = zones_->extend(values, size / Codec::value_size(layout));
+    auto _ = zones_->store(zone_map_path(path), from);
+  }
+
+  return {};
+}
+
+cpp::result<void, std::string> Writer::sync() const {
+  for (auto &file :
+       {heap_path(path), tail_path(path), nulls_path(path), path}) {
+    if (file != path && !FileManager::Path(file).exists())
+      continue;
+    auto synced = FileManager::append_bytes(file, nullptr, 0, true);
+    if (synced.has_error())
+      return synced;
+  }
+  return {};
+}
+
+void Writer::load_zones() {
+  auto mapping = FileManager::MappedFile::open(path);
+  if (mapping.has_error()) {
+    zones_ = ZoneMap{layout.type, PAGE_ROWS, {}};
+    return;
+  }
+
+  auto &file = *mapping.value();
+  if (header_.has_value() && header_->encoding == Encoding::Paged) {
+    auto decoded = read_paged(file.data(), file.size(), path, layout);
+    if (decoded.has_error()) {
+      zones_ = ZoneMap{layout.type, PAGE_ROWS, {}};
+      return;
+    }
+    zones_ = ZoneMap::load(zone_map_path(path), layout, decoded->data(),
+                           decoded->size() / sizeof(std::uint64_t));
+    return;
+  }
+
+  std::size_t offset =
+      Header::parse(file.data(), file.size()).has_value() ? HEADER_SIZE : 0;
+  std::uint64_t rows = file.size() < offset
+                           ? 0
+                           : (file.size() - offset) / Codec::value_size(layout);
+  zones_ = ZoneMap::load(zone_map_path(path), layout, file.data() + offset,
+                         rows);
+}
+
+cpp::result<void, std::string>
+Writer::append_varlen(const std::uint8_t *values, std::size_t size,
+                      bool sync) {
+  auto heap = heap_path(path);
+
+  // Bytes a crash left past the last offset are dropped
+  if (!heap_end_.has_value()) {
+    std::uint64_t rows = row_count(path, layout);
+    std::uint64_t end = 0;
+    if (rows > 0) {
+      std::uint8_t last[8];
+      std::ifstream file(path, std::ios::in | std::ios::binary);
+      file.seekg(static_cast<std::streamoff>(data_offset(path) +
+                                             (rows - 1) * sizeof(last)));
+      file.read(reinterpret_cast<char *>(last), sizeof(last));
+      if (file.gcount() != sizeof(last))
+        return cpp::fail(fmt::format("Failed to read the offsets of {}", path));
+      end = Codec::load<std::uint64_t>(last);
+    }
+
+    FileManager::Path heap_file(heap);
+    if (heap_file.exists() && heap_file.get_file_size() != end &&
+        !FileManager::resize_file(heap, end))
+      return cpp::fail(fmt::format("Failed to repair {}", heap));
+    heap_end_ = end;
+  }
+
+  // The heap gets only the bytes, lengths are implied by the offsets
+  std::vector<std::uint8_t> bytes;
+  std::vector<std::uint8_t> offsets;
+  bytes.reserve(size);
+  std::uint64_t end = *heap_end_;
+  for (std::size_t at = 0; at < size;) {
+    if (size - at < 4 ||
+        size - at - 4 < Codec::load<std::uint32_t>(values + at))
+      return cpp::fail(fmt::format("Torn value appended to {}", path));
+
+    std::uint32_t length = Codec::load<std::uint32_t>(values + at);
+    bytes.insert(bytes.end(), values + at + 4, values + at + 4 + length);
+    end += length;
+    Codec::push(offsets, end);
+    at += 4 + length;
+  }
+
+  // Whatever was partly written is cut on the next append
+  heap_end_.reset();
+
+  auto appended = FileManager::append_bytes(heap, bytes.data(), bytes.size(),
+                                            sync);
+  if (appended.has_error())
+    return appended;
+
+  appended = FileManager::append_bytes(path, offsets.data(), offsets.size(),
+                                       sync);
+  if (appended.has_error())
+    return appended;
+
+  heap_end_ = end;
+  return {};
+}
+
+cpp::result<void, std::string>
+Writer::append_bits(const std::uint8_t *values, std::size_t size, bool sync) {
+  std::uint64_t rows = header_->rows;
+  std::size_t first_word = rows / Bitmap::WORD_BITS;
+  std::size_t words = Bitmap::words_for(rows + size) - first_word;
+
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open {} for appending", path));
+
+  // The last word may be partly used, it is written again with its bits
+  std::vector<std::uint8_t> packed(words * sizeof(std::uint64_t), 0);
+  auto at = static_cast<long>(HEADER_SIZE + first_word * sizeof(std::uint64_t));
+  bool ok = std::fseek(file, at, SEEK_SET) == 0;
+  if (ok && rows % Bitmap::WORD_BITS != 0)
+    ok = std::fread(packed.data(), 1, sizeof(std::uint64_t), file) ==
+         sizeof(std::uint64_t);
+  Bitmap::pack(values, size, rows % Bitmap::WORD_BITS, packed.data());
+
+  // Words first, the new row count makes them part of the column
+  ok = ok && std::fseek(file, at, SEEK_SET) == 0 &&
+       std::fwrite(packed.data(), 1, packed.size(), file) == packed.size();
+  if (ok && sync)
+    ok = FileManager::sync_file(file);
+
+  Header updated = *header_;
+  updated.rows = rows + size;
+  auto encoded = updated.encode();
+  ok = ok && std::fseek(file, 0, SEEK_SET) == 0 &&
+       std::fwrite(encoded.data(), 1, encoded.size(), file) == encoded.size();
+  ok = ok && std::fflush(file) == 0;
+  if (ok && sync)
+    ok = FileManager::sync_file(file);
+  ok = std::fclose(file) == 0 && ok;
+
+  if (!ok) {
+    header_read_ = false;
+    return cpp::fail(fmt::format("Failed to append to {}", path));
+  }
+
+  header_ = updated;
+  return {};
+}
+
+cpp::result<void, std::string> Writer::write_header(std::FILE *file,
+                                                    bool sync) {
+  auto encoded = header_->encode();
+  bool ok = std::fseek(file, 0, SEEK_SET) == 0 &&
+            std::fwrite(encoded.data(), 1, encoded.size(), file) ==
+                encoded.size() &&
+            std::fflush(file) == 0;
+  if (ok && sync)
+    ok = FileManager::sync_file(file);
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to write the header of {}", path));
+  return {};
+}
+
+// Replaces the tail in one step so a crash leaves the old or the new one
+static cpp::result<void, std::string>
+write_tail(const std::string &path, std::uint64_t first,
+           const std::vector<std::uint64_t> &values) {
+  std::vector<std::uint8_t> contents;
+  contents.reserve((values.size() + 1) * sizeof(std::uint64_t));
+  Codec::push(contents, first);
+  for (auto value : values)
+    Codec::push(contents, value);
+
+  auto staging = path + ".tmp";
+  std::FILE *file = std::fopen(staging.c_str(), "wb");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open {}", staging));
+  bool ok = std::fwrite(contents.data(), 1, contents.size(), file) ==
+                contents.size() &&
+            FileManager::sync_file(file);
+  ok = std::fclose(file) == 0 && ok;
+
+  std::error_code error;
+  if (ok)
+    std::filesystem::rename(staging, path, error);
+  if (!ok || error)
+    return cpp::fail(fmt::format("Failed to write {}", path));
+  return {};
+}
+
+cpp::result<void, std::string> Writer::load_tail() {
+  // Pages a crash cut short past the ones the header counts
+  FileManager::Path column(path);
+  if (column.get_file_size() > HEADER_SIZE + header_->bytes &&
+      !FileManager::resize_file(path, HEADER_SIZE + header_->bytes))
+    return cpp::fail(fmt::format("Failed to repair {}", path));
+
+  auto tail = tail_path(path);
+  auto [first, values] = read_tail(tail, header_->rows);
+  if (first > header_->rows)
+    return cpp::fail(fmt::format("The tail of {} skips rows", path));
+
+  // Rows sealed before the crash let the tail be replaced
+  std::uint64_t skip = std::min<std::uint64_t>(header_->rows - first,
+                                               values.size());
+  values.erase(values.begin(), values.begin() + skip);
+  tail_first_ = header_->rows;
+  tail_ = std::move(values);
+
+  std::uint64_t expected = (tail_.size() + 1) * sizeof(std::uint64_t);
+  if (!FileManager::Path(tail).exists() || skip > 0 ||
+      FileManager::Path(tail).get_file_size() != expected)
+    return write_tail(tail, *tail_first_, tail_);
+  return {};
+}
+
+cpp::result<void, std::string>
+Writer::append_paged(const std::uint8_t *values, std::size_t size,
+                     bool sync) {
+  if (!tail_first_.has_value()) {
+    auto loaded = load_tail();
+    if (loaded.has_error())
+      return loaded;
+  }
+
+  std::size_t rows = size / sizeof(std::uint64_t);
+  std::size_t appended_from = tail_.size();
+  tail_.resize(tail_.size() + rows);
+  Codec::decode(values, rows, tail_.data() + appended_from);
+
+  if (tail_.size() < PAGE_ROWS) {
+    auto appended = FileManager::append_bytes(tail_path(path), values, size,
+                                              sync);
+    if (appended.has_error())
+      tail_first_.reset();
+    return appended;
+  }
+
+  // Seal every full page: pages first, then the header counting them, then
+  // a tail without their rows
+  std::FILE *file = std::fopen(path.c_str(), "r+b");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open {} for appending", path));
+
+  std::vector<std::uint8_t> pages;
+  std::vector<std::uint64_t> keys(PAGE_ROWS);
+  std::size_t sealed = 0;
+  while (tail_.size() - sealed >= PAGE_ROWS) {
+    for (std::size_t i = 0; i < PAGE_ROWS; i++)
+      keys[i] = order_key(layout.type, tail_[sealed + i]);
+
+    std::size_t at = pages.size();
+    pages.resize(at + PAGE_HEADER_SIZE, 0);
+    auto kind = PageCodec::encode(keys.data(), PAGE_ROWS, pages);
+    Codec::store<std::uint32_t>(PAGE_ROWS, pages.data() + at);
+    Codec::store<std::uint32_t>(
+        static_cast<std::uint32_t>(pages.size() - at - PAGE_HEADER_SIZE),
+        pages.data() + at + 4);
+    pages[at + 8] = static_cast<std::uint8_t>(kind);
+    sealed += PAGE_ROWS;
+  }
+
+  auto at = static_cast<long>(HEADER_SIZE + header_->bytes);
+  bool ok = std::fseek(file, at, SEEK_SET) == 0 &&
+            std::fwrite(pages.data(), 1, pages.size(), file) == pages.size() &&
+            std::fflush(file) == 0;
+  if (ok && sync)
+    ok = FileManager::sync_file(file);
+
+  cpp::result<void, std::string> result;
+  if (ok) {
+    header_->rows += sealed;
+    header_->bytes += pages.size();
+    result = write_header(file, sync);
+  } else {
+    result = cpp::fail(fmt::format("Failed to append to {}", path));
+  }
+  ok = std::fclose(file) == 0 && !result.has_error();
+
+  // The files tell what made it, read them again before the next append
+  if (!ok) {
+    header_read_ = false;
+    tail_first_.reset();
+    tail_.clear();
+    return result.has_error()
+               ? result
+               : cpp::fail(fmt::format("Failed to append to {}", path));
+  }
+
+  tail_.erase(tail_.begin(), tail_.begin() + sealed);
+  tail_first_ = header_->rows;
+  auto written = write_tail(tail_path(path), *tail_first_, tail_);
+  if (written.has_error())
+    tail_first_.reset();
+  return written;
+}
+
+} // namespace ColumnFile
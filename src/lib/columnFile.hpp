@@ -0,0 +1,332 @@
+#ifndef COLUMNFILE_HPP
+#define COLUMNFILE_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <result.hpp>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "analyzer/parser.hpp"
+#include "bitmap.hpp"
+#include "codec.hpp"
+#include "serializer.hpp"
+
+// On disk format of a column.
+//
+// `<col>.col` starts with a HEADER_SIZE bytes header followed by the values,
+// back to back and encoded as bincode does (see codec.hpp), so a mapping of
+// the file can still be read in place. Files written before the header
+// existed hold only the values and are still read and appended to.
+//
+// vstr columns keep the u64 end offset of every value in `<col>.col` and
+// the bytes of the values back to back in `<col>.heap`, so the row count
+// and the row of a value stay fixed width. Heap bytes past the last offset
+// belong to no row and are overwritten by the next append.
+//
+// u64 and i64 columns are Paged: every full page is compressed on its own
+// (see pageCodec.hpp) and appended to `<col>.col` as
+//   u32 rows, u32 payload bytes, u8 codec, 3 reserved bytes, payload
+// while the rows of the page being filled wait plain in `<col>.tail`
+// (u64 index of its first row, then the values). The header counts the
+// rows and bytes of the sealed pages; pages past them were cut short by a
+// crash and tail rows already sealed are skipped.
+//
+// Columns declared with NULL keep a zero value (an empty string for
+// strings) in the rows that hold none and mark them in `<col>.nulls`, see
+// NullMap. Rows and the log carry their values behind a u8 flag, 0 for a
+// null.
+//
+// Values are grouped in pages of `page_rows` rows. `<col>.zm` keeps the
+// row count, min and max of every page so scans can skip pages a predicate
+// cannot match. The zone map lives next to the column instead of in a
+// footer so inserts stay plain appends; it is derived data and every entry
+// is checksummed, entries missing or torn by a crash are rebuilt from the
+// values.
+namespace ColumnFile {
+
+constexpr std::size_t HEADER_SIZE = 64;
+constexpr std::uint16_t VERSION = 2;
+constexpr std::uint32_t PAGE_ROWS = 4096;
+
+enum class Encoding : std::uint8_t {
+  // Values stored as they are encoded by Codec
+  Plain = 0,
+  // Bools packed 64 to a word (see bitmap.hpp), the row count is kept in
+  // the header since the words do not tell it
+  Bits = 1,
+  // 64 bit integers in compressed pages, see below
+  Paged = 2,
+};
+
+struct Header {
+  std::uint16_t version = VERSION;
+  ColumnType type = ColumnType::u8;
+  Encoding encoding = Encoding::Plain;
+  std::uint32_t page_rows = PAGE_ROWS;
+  std::uint64_t stride = 0;
+  // Rows of a Bits column or of the sealed pages of a Paged one
+  std::uint64_t rows = 0;
+  // Bytes of the sealed pages of a Paged column
+  std::uint64_t bytes = 0;
+
+  static Header for_layout(const Layout &layout);
+
+  [[nodiscard]] std::array<std::uint8_t, HEADER_SIZE> encode() const;
+
+  // Nothing for files without a header
+  static std::optional<Header> parse(const std::uint8_t *data,
+                                     std::size_t size);
+};
+
+// Creates an empty column file with a header
+cpp::result<void, std::string> create(const std::string &path,
+                                      const Layout &layout);
+
+// Bytes in front of the first value
+std::size_t data_offset(const std::string &path);
+
+// Rows stored in the column file, a value torn by a crash does not count
+std::uint64_t row_count(const std::string &path, const Layout &layout);
+
+// Cuts a value torn by a crash off the end of the column and returns the
+// rows left
+cpp::result<std::uint64_t, std::string> repair(const std::string &path,
+                                               const Layout &layout);
+
+std::string zone_map_path(const std::string &column_path);
+
+std::string heap_path(const std::string &column_path);
+
+std::string tail_path(const std::string &column_path);
+
+std::string nulls_path(const std::string &column_path);
+
+// Whether new columns of `type` are stored in compressed pages
+bool is_paged(ColumnType type);
+
+// Values of a Paged column from row `from` on, decoded to native integers.
+// Pages wholly before `from` are skipped without decoding them. `data` and
+// `size` hold the whole column file at `path`.
+cpp::result<std::vector<std::uint8_t>, std::string>
+read_paged(const std::uint8_t *data, std::size_t size, const std::string &path,
+           const Layout &layout, std::uint64_t from = 0);
+
+// Min and max of a page, widened to 64 bits: u64 for unsigned and
+// dictionary codes, i64 for signed, f64 for doubles. Kept as raw bits.
+struct PageStats {
+  std::uint64_t rows = 0;
+  std::uint64_t min = 0;
+  std::uint64_t max = 0;
+};
+
+struct ZoneMap {
+  ColumnType type;
+  std::uint32_t page_rows = PAGE_ROWS;
+  std::vector<PageStats> pages;
+
+  // Only numbers and dictionary codes get a zone map, bool filters are
+  // word wide bit operations already
+  static bool supports(ColumnType type);
+
+  // Bytes per value of the types that get a zone map
+  static std::size_t value_size(ColumnType type);
+
+  [[nodiscard]] std::uint64_t rows() const;
+
+  // Folds `rows` encoded values appended after the rows already covered.
+  // Returns the first page that changed.
+  std::size_t extend(const std::uint8_t *values, std::uint64_t rows);
+
+  // Whether some value of `page` could satisfy `value <op> constant`
+  template <typename T>
+  [[nodiscard]] bool may_match(std::size_t page, Parser::OperatorE op,
+                               T constant) const;
+
+  // Reads `<col>.zm` and checks it against the `rows` values at `values`.
+  // Entries that are missing, torn or stale are computed again from them.
+  static ZoneMap load(const std::string &path, const Layout &layout,
+                      const std::uint8_t *values, std::uint64_t rows);
+
+  // Writes the entries from `from_page` on
+  cpp::result<void, std::string> store(const std::string &path,
+                                       std::size_t from_page) const;
+
+private:
+  [[nodiscard]] PageStats page_stats(const std::uint8_t *values,
+                                     std::uint64_t rows) const;
+};
+
+template <typename T> constexpr bool is_unsigned_key() {
+  return std::is_same_v<T, bool> || std::is_unsigned_v<T>;
+}
+
+template <typename T>
+bool ZoneMap::may_match(std::size_t page, Parser::OperatorE op,
+                        T constant) const {
+  if (page >= pages.size())
+    return true;
+
+  auto compare = [&](auto min, auto max, auto value) {
+    switch (op) {
+    case Parser::OperatorE::EQUAL:
+      return min <= value && value <= max;
+    case Parser::OperatorE::NOT_EQUAL:
+      return !(min == max && min == value);
+    case Parser::OperatorE::GREAT:
+      return max > value;
+    case Parser::OperatorE::GREAT_EQUAL:
+      return max >= value;
+    case Parser::OperatorE::LESS:
+      return min < value;
+    case Parser::OperatorE::LESS_EQUAL:
+      return min <= value;
+    default:
+      return true;
+    }
+  };
+
+  const PageStats &stats = pages[page];
+  if constexpr (std::is_floating_point_v<T>) {
+    return compare(std::bit_cast<double>(stats.min),
+                   std::bit_cast<double>(stats.max),
+                   static_cast<double>(constant));
+  } else if constexpr (is_unsigned_key<T>()) {
+    return compare(stats.min, stats.max,
+                   static_cast<std::uint64_t>(constant));
+  } else if constexpr (std::is_signed_v<T>) {
+    return compare(std::bit_cast<std::int64_t>(stats.min),
+                   std::bit_cast<std::int64_t>(stats.max),
+                   static_cast<std::int64_t>(constant));
+  } else {
+    return true;
+  }
+}
+
+// Null rows of an optional column. Only pages holding a null get an entry,
+// so columns and pages without nulls cost nothing to load or scan.
+//
+// `<col>.nulls` holds the entries in page order, each
+//   u64 page, then the page_rows bits of the page as u64 words
+// with the bit of every null row set. An entry is written again in place
+// while its page fills. Bits reach the file before the rows they mark, so
+// bits past the rows of the column belong to rows a crash cut: readers
+// ignore them and the next writer clears them.
+struct NullMap {
+  static constexpr std::size_t PAGE_WORDS = PAGE_ROWS / Bitmap::WORD_BITS;
+  static constexpr std::size_t ENTRY_SIZE =
+      sizeof(std::uint64_t) * (PAGE_WORDS + 1);
+
+  struct Page {
+    std::uint64_t page;
+    std::array<std::uint64_t, PAGE_WORDS> bits{};
+  };
+
+  std::vector<Page> pages;
+
+  // Entries of the first `rows` rows, torn entries and later bits left out
+  static NullMap load(const std::string &path, std::uint64_t rows);
+
+  [[nodiscard]] bool empty() const { return pages.empty(); }
+
+  // Null rows
+  [[nodiscard]] std::uint64_t count() const;
+
+  [[nodiscard]] bool contains(std::uint64_t row) const {
+    std::uint64_t page = row / PAGE_ROWS;
+    auto entry = std::lower_bound(
+        pages.begin(), pages.end(), page,
+        [](const Page &entry, std::uint64_t page) { return entry.page < page; });
+    if (entry == pages.end() || entry->page != page)
+      return false;
+    std::size_t bit = row % PAGE_ROWS;
+    return (entry->bits[bit / Bitmap::WORD_BITS] >> (bit % Bitmap::WORD_BITS)) &
+           1;
+  }
+
+  // Marks `row` as null, rows come in increasing order. Returns the index of
+  // the entry that changed.
+  std::size_t set(std::uint64_t row);
+
+  // Drops the null rows from `selected`, one bit per row. Only the words of
+  // pages with nulls are touched.
+  void clear(std::vector<std::uint64_t> &selected) const;
+
+  // Calls `f(row)` for every null row, in order
+  template <typename F> void for_each(F &&f) const {
+    for (auto &entry : pages) {
+      for (std::size_t w = 0; w < PAGE_WORDS; w++) {
+        for (std::uint64_t bits = entry.bits[w]; bits != 0; bits &= bits - 1)
+          f(entry.page * PAGE_ROWS + w * Bitmap::WORD_BITS +
+            std::countr_zero(bits));
+      }
+    }
+  }
+};
+
+// Keeps the zone map of one column up to date while values are appended
+struct Writer {
+  Writer(std::string path, Layout layout)
+      : path(std::move(path)), layout(layout) {}
+
+  // Appends encoded values, `sync` waits for them to be durable. vstr values
+  // come as rows carry them (see Codec::push_varlen); their bytes reach
+  // the heap before their offsets reach the column. Values of optional
+  // columns come behind their null flag.
+  cpp::result<void, std::string> append(const std::uint8_t *values,
+                                        std::size_t size, bool sync);
+
+  // Makes what was appended without `sync` durable, in every file
+  cpp::result<void, std::string> sync() const;
+
+  std::string path;
+  Layout layout;
+
+private:
+  void load_zones();
+
+  cpp::result<void, std::string> append_values(const std::uint8_t *values,
+                                               std::size_t size, bool sync);
+
+  cpp::result<void, std::string> append_optional(const std::uint8_t *values,
+                                                 std::size_t size, bool sync);
+
+  cpp::result<void, std::string> write_nulls(const std::vector<std::size_t> &entries,
+                                             bool sync);
+
+  cpp::result<void, std::string> append_varlen(const std::uint8_t *values,
+                                               std::size_t size, bool sync);
+
+  cpp::result<void, std::string> append_bits(const std::uint8_t *values,
+                                             std::size_t size, bool sync);
+
+  cpp::result<void, std::string> append_paged(const std::uint8_t *values,
+                                              std::size_t size, bool sync);
+
+  cpp::result<void, std::string> load_tail();
+
+  cpp::result<void, std::string> write_header(std::FILE *file, bool sync);
+
+  std::optional<ZoneMap> zones_;
+  // End of the heap bytes the column refers to
+  std::optional<std::uint64_t> heap_end_;
+  // Header of the file, read on the first append, none for legacy files
+  std::optional<Header> header_;
+  bool header_read_ = false;
+  // Rows of the page being filled of a Paged column
+  std::optional<std::uint64_t> tail_first_;
+  std::vector<std::uint64_t> tail_;
+  // Row the next value of an optional column lands in, and its nulls
+  std::optional<std::uint64_t> next_row_;
+  NullMap nulls_;
+};
+
+} // namespace ColumnFile
+
+#endif // COLUMNFILE_HPP
@@ -1,23 +1,506 @@
 #ifndef COLUMNINSTANCE_HPP
 #define COLUMNINSTANCE_HPP
 
+#include <bit>
+#include <memory>
+#include <span>
+#include <string_view>
+
 #include "analyzer.hpp"
+#include "bitmap.hpp"
+#include "codec.hpp"
+#include "columnFile.hpp"
+#include "dictionary.hpp"
+#include "filter.hpp"
+#include "group.hpp"
+#include "pool.hpp"
+#include "rangeIndex.hpp"
+#include "reduce.hpp"
+#include "uniqueSet.hpp"
 
 struct ColumnInstance {
+  // Bytes behind `data`: either a read-only mapping of the column file, so
+  // scans work straight over the mapped pages, or a buffer owned by the
+  // instance when the values could not be used as they are stored.
+  using Storage = std::variant<std::shared_ptr<FileManager::MappedFile>,
+                               std::shared_ptr<std::vector<std::uint8_t>>>;
+
   Parser::NameAndSub column;
-  void * data;
+  Storage storage;
+  const std::uint8_t *data;
   Layout layout;
   std::size_t size;
+  // Path of the .col file the values come from
+  std::string file;
+  // Page min/max of the column, read with the values so scans do not read
+  // the .zm file again. Decoded copies on big endian hosts are not in the
+  // little endian encoding the zone map is checked against, they get none
+  // and every page is scanned.
+  std::shared_ptr<const ColumnFile::ZoneMap> zones;
+  // Strings behind the codes of a dstr column
+  std::shared_ptr<const Dictionary> dictionary;
+  // Bytes a vstr column's offsets point into
+  std::shared_ptr<FileManager::MappedFile> heap;
+  // Rows of an optional column holding no value, empty when there are none
+  ColumnFile::NullMap nulls;
+
+  ColumnInstance(Parser::NameAndSub column, Storage storage,
+                 const std::uint8_t *data, Layout layout, std::size_t size,
+                 std::string file)
+      : column(std::move(column)), storage(std::move(storage)), data(data),
+        layout(layout), size(size), file(std::move(file)) {}
+
+  [[nodiscard]] bool is_mapped() const {
+    return std::holds_alternative<std::shared_ptr<FileManager::MappedFile>>(
+        storage);
+  }
+
+  // Number of bytes each value takes in the column file
+  [[nodiscard]] static std::size_t stride(const Layout &layout) {
+    return Codec::value_size(layout);
+  }
+
+  [[nodiscard]] std::size_t stride() const { return stride(layout); }
+
+  // Typed view over a fixed width column (numbers, codes and offsets), bools
+  // are packed and read through the bitmap helpers below
+  template <typename T> [[nodiscard]] std::span<const T> values() const {
+    return {reinterpret_cast<const T *>(data), size};
+  }
+
+  [[nodiscard]] std::string_view str_at(std::size_t i) const {
+    if (layout.type == ColumnType::dstr)
+      return dictionary->at(values<std::uint32_t>()[i]);
+    if (layout.type == ColumnType::vstr) {
+      auto ends = values<std::uint64_t>();
+      std::uint64_t begin = i == 0 ? 0 : ends[i - 1];
+      return {reinterpret_cast<const char *>(heap->data()) + begin,
+              ends[i] - begin};
+    }
+    return Codec::decode_str(data + i * stride(), layout.size);
+  }
+
+  [[nodiscard]] bool bool_at(std::size_t i) const {
+    return Bitmap::get(data, i);
+  }
+
+  // Rows of a bool column holding `value`, null rows hold neither
+  [[nodiscard]] std::size_t count_bools(bool value) const {
+    std::size_t set = Bitmap::count(data, size);
+    std::size_t null_set = 0;
+    for (auto &entry : nulls.pages) {
+      std::size_t first = entry.page * ColumnFile::NullMap::PAGE_WORDS;
+      std::size_t words = std::min(ColumnFile::NullMap::PAGE_WORDS,
+                                   Bitmap::words_for(size) - first);
+      for (std::size_t w = 0; w < words; w++)
+        null_set += std::popcount(Bitmap::word(data, first + w) & entry.bits[w]);
+    }
+    return value ? set - null_set
+                 : size - set - (nulls.count() - null_set);
+  }
+
+  // Rows holding a value
+  [[nodiscard]] std::size_t count_values() const {
+    return size - nulls.count();
+  }
+
+  // Bytes of the values, and of the strings a vstr column points into
+  [[nodiscard]] std::size_t bytes() const {
+    if (layout.type == ColumnType::rbool)
+      return Bitmap::words_for(size) * sizeof(std::uint64_t);
+    return size * Codec::value_size(layout) + (heap ? heap->size() : 0);
+  }
+
+  // Rows that are null, or that are not, one bit each
+  [[nodiscard]] std::vector<std::uint64_t> select_nulls(bool null) const {
+    std::vector<std::uint64_t> selected(Bitmap::words_for(size),
+                                        null ? 0 : ~std::uint64_t{0});
+    if (!selected.empty())
+      selected.back() &= Bitmap::tail_mask(size);
+    if (null)
+      nulls.for_each([&](std::uint64_t row) { Bitmap::set(selected, row); });
+    else
+      nulls.clear(selected);
+    return selected;
+  }
+
+  // Rows of a bool column where `value <op> constant` holds, one bit each.
+  // Each operator is reduced to the bools it accepts and applied to whole
+  // words at a time. Null rows never match.
+  [[nodiscard]] std::vector<std::uint64_t>
+  select_bools(Parser::OperatorE op, bool constant) const {
+    auto holds = [&](bool value) {
+      switch (op) {
+      case Parser::OperatorE::EQUAL:
+        return value == constant;
+      case Parser::OperatorE::NOT_EQUAL:
+        return value != constant;
+      case Parser::OperatorE::GREAT:
+        return value > constant;
+      case Parser::OperatorE::GREAT_EQUAL:
+        return value >= constant;
+      case Parser::OperatorE::LESS:
+        return value < constant;
+      case Parser::OperatorE::LESS_EQUAL:
+        return value <= constant;
+      default:
+        return false;
+      }
+    };
+    std::uint64_t if_set = holds(true) ? ~std::uint64_t{0} : 0;
+    std::uint64_t if_clear = holds(false) ? ~std::uint64_t{0} : 0;
+
+    std::vector<std::uint64_t> selected(Bitmap::words_for(size));
+    for (std::size_t w = 0; w < selected.size(); w++) {
+      std::uint64_t bits = Bitmap::word(data, w);
+      selected[w] = (bits & if_set) | (~bits & if_clear);
+    }
+    if (!selected.empty())
+      selected.back() &= Bitmap::tail_mask(size);
+    nulls.clear(selected);
+    return selected;
+  }
+
+  // Reads `zones` for the rows held
+  void load_zones() {
+    if (!ColumnFile::ZoneMap::supports(layout.type) ||
+        (!is_mapped() && std::endian::native != std::endian::little))
+      return;
+    zones = std::make_shared<ColumnFile::ZoneMap>(ColumnFile::ZoneMap::load(
+        ColumnFile::zone_map_path(file), layout, data, size));
+  }
+
+  // Code a dstr column stores for `value`, nothing if no row holds it
+  [[nodiscard]] std::optional<std::uint32_t>
+  code_of(std::string_view value) const {
+    return dictionary->find(value);
+  }
+
+  // Row ranges [from, to) a filter `value <op> constant` has to look at,
+  // leaving out the pages whose min and max rule the predicate out
+  [[nodiscard]] std::vector<std::pair<std::size_t, std::size_t>>
+  candidate_rows(Parser::OperatorE op,
+                 const std::variant<Parser::String, Parser::UInt, Parser::Int,
+                                    Parser::Double, Parser::Bool, Parser::Null> &constant) const {
+    std::vector<std::pair<std::size_t, std::size_t>> ranges;
+    if (!ColumnFile::ZoneMap::supports(layout.type) || !zones) {
+      ranges.emplace_back(0, size);
+      return ranges;
+    }
+
+    // A constant that does not fit is reported by the filter itself
+    auto resolved = resolve_value(constant, layout);
+    if (resolved.has_error()) {
+      ranges.emplace_back(0, size);
+      return ranges;
+    }
+
+    // Codes only tell equal strings apart, their order means nothing
+    std::optional<std::uint32_t> code;
+    if (layout.type == ColumnType::dstr) {
+      if (op != Parser::OperatorE::EQUAL && op != Parser::OperatorE::NOT_EQUAL) {
+        ranges.emplace_back(0, size);
+        return ranges;
+      }
+      code = code_of(std::get<std::string>(resolved.value()));
+      if (!code) {
+        if (op == Parser::OperatorE::NOT_EQUAL)
+          ranges.emplace_back(0, size);
+        return ranges;
+      }
+    }
+
+    for (std::size_t page = 0; page * zones->page_rows < size; page++) {
+      bool keep = std::visit(
+          [&](auto value) {
+            if constexpr (std::is_same_v<decltype(value), std::string>)
+              return !code || zones->may_match(page, op, *code);
+            else
+              return zones->may_match(page, op, value);
+          },
+          resolved.value());
+      if (!keep)
+        continue;
+
+      std::size_t from = page * zones->page_rows;
+      std::size_t to = std::min<std::size_t>(from + zones->page_rows, size);
+      if (!ranges.empty() && ranges.back().second == from)
+        ranges.back().second = to;
+      else
+        ranges.emplace_back(from, to);
+    }
+
+    return ranges;
+  }
+
+  // Rows where `value <op> constant` holds, one bit each. The constant is
+  // resolved once and the pages the zone map leaves go through the filter
+  // kernels. Null rows only match `== NULL`. With `within`, words of it with
+  // no bit set are not scanned and come out clear.
+  [[nodiscard]] cpp::result<std::vector<std::uint64_t>, std::string>
+  select(Parser::OperatorE op,
+         const std::variant<Parser::String, Parser::UInt, Parser::Int,
+                            Parser::Double, Parser::Bool, Parser::Null>
+             &constant,
+         const std::vector<std::uint64_t> *within = nullptr) const {
+    if (std::holds_alternative<Parser::Null>(constant)) {
+      if (op != Parser::OperatorE::EQUAL && op != Parser::OperatorE::NOT_EQUAL)
+        return cpp::fail("Only `==` and `!=` compare with NULL");
+      return select_nulls(op == Parser::OperatorE::EQUAL);
+    }
+
+    auto resolved = resolve_value(constant, layout);
+    if (resolved.has_error())
+      return cpp::fail(resolved.error());
+    if (layout.type == ColumnType::rbool)
+      return select_bools(op, std::get<bool>(resolved.value()));
+
+    std::vector<std::uint64_t> selected(Bitmap::words_for(size));
+    auto scan = [&](std::size_t from, std::size_t to) {
+      std::visit(
+          [&](const auto &value) {
+            using T = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<T, std::string>)
+              select_strings(op, value, from, to, selected);
+            else if constexpr (!std::is_same_v<T, bool>)
+              Filter::select(values<T>().data(), from, to, op, value,
+                             selected);
+          },
+          resolved.value());
+    };
+    // Morsels write words of their own, they are scanned in parallel
+    auto ranges = candidate_rows(op, constant);
+    Pool::for_each_morsel(size, [&](std::size_t, std::size_t begin,
+                                    std::size_t end) {
+      auto range = std::lower_bound(
+          ranges.begin(), ranges.end(), begin,
+          [](const auto &range, std::size_t row) { return range.second <= row; });
+      for (; range != ranges.end() && range->first < end; ++range) {
+        std::size_t from = std::max(range->first, begin);
+        std::size_t to = std::min(range->second, end);
+        if (within == nullptr)
+          scan(from, to);
+        else
+          Bitmap::for_each_run(
+              *within, from,
+              std::min(to, within->size() * Bitmap::WORD_BITS), scan);
+      }
+    });
+
+    // Null rows hold a stand-in value, whatever it matched goes
+    nulls.clear(selected);
+    return selected;
+  }
+
+  // `function` (COUNT, SUM, MIN, MAX or AVG) over the rows set in
+  // `selected`, as text. Null rows are left out and an aggregate of no
+  // values but COUNT is NULL.
+  [[nodiscard]] cpp::result<std::string, std::string>
+  aggregate(Parser::KeywordE function,
+            std::vector<std::uint64_t> selected) const {
+    selected = without_nulls(std::move(selected));
+
+    std::size_t count = 0;
+    for (auto word : selected)
+      count += std::popcount(word);
+    if (function == Parser::KeywordE::COUNT)
+      return fmt::format("{}", count);
+    if (auto checked = check_aggregate(function); checked.has_error())
+      return cpp::fail(checked.error());
+    if (count == 0)
+      return std::string("NULL");
+
+    bool lowest = function == Parser::KeywordE::MIN;
+    if (layout.type == ColumnType::rbool) {
+      // The lowest bool is false if any row holds it, the highest true
+      bool found = false;
+      for (std::size_t w = 0; w < selected.size() && !found; w++) {
+        std::uint64_t bits = Bitmap::word(data, w);
+        found = (selected[w] & (lowest ? ~bits : bits)) != 0;
+      }
+      return fmt::format("{}", lowest ? !found : found);
+    }
+    if (!is_number()) {
+      std::optional<std::string_view> best;
+      Bitmap::for_each_set(selected, [&](std::size_t i) {
+        auto value = str_at(i);
+        if (!best || (lowest ? value < *best : value > *best))
+          best = value;
+      });
+      return std::string(*best);
+    }
+
+    std::string shown;
+    visit_number([&](auto type) {
+      using T = decltype(type);
+      std::vector<Reduce::Summary<T>> partials(Pool::morsels(size));
+      Pool::for_each_morsel(size, [&](std::size_t morsel, std::size_t from,
+                                      std::size_t to) {
+        partials[morsel] =
+            Reduce::summarize(values<T>().data(), from, to, selected);
+      });
+      Reduce::Summary<T> summary;
+      for (auto &partial : partials)
+        Reduce::merge(summary, partial);
+      shown = show(function, summary);
+    });
+    return shown;
+  }
+
+  // `function` per group of `groups`, over the rows set in `selected`
+  [[nodiscard]] cpp::result<std::vector<std::string>, std::string>
+  aggregate(Parser::KeywordE function, const Group::Groups &groups,
+            std::vector<std::uint64_t> selected) const {
+    selected = without_nulls(std::move(selected));
+    std::vector<std::string> shown(groups.size(), "NULL");
+
+    if (function == Parser::KeywordE::COUNT) {
+      auto counts = Group::sizes(groups, selected);
+      for (std::size_t g = 0; g < counts.size(); g++)
+        shown[g] = fmt::format("{}", counts[g]);
+      return shown;
+    }
+    if (auto checked = check_aggregate(function); checked.has_error())
+      return cpp::fail(checked.error());
+
+    bool lowest = function == Parser::KeywordE::MIN;
+    std::size_t rows = std::min(size, groups.of.size());
+    if (layout.type == ColumnType::rbool) {
+      // Bit 0 is set when a row of the group holds false, bit 1 true
+      std::vector<std::uint8_t> held(groups.size());
+      Group::for_each_selected(selected, 0, rows, [&](std::size_t i) {
+        if (groups.of[i] != Group::NONE)
+          held[groups.of[i]] |= bool_at(i) ? 2 : 1;
+      });
+      for (std::size_t g = 0; g < held.size(); g++) {
+        if (held[g] != 0)
+          shown[g] = fmt::format("{}", lowest ? (held[g] & 1) == 0
+                                              : (held[g] & 2) != 0);
+      }
+      return shown;
+    }
+    if (!is_number()) {
+      std::vector<std::optional<std::string_view>> best(groups.size());
+      Group::for_each_selected(selected, 0, rows, [&](std::size_t i) {
+        if (groups.of[i] == Group::NONE)
+          return;
+        auto &current = best[groups.of[i]];
+        auto value = str_at(i);
+        if (!current || (lowest ? value < *current : value > *current))
+          current = value;
+      });
+      for (std::size_t g = 0; g < best.size(); g++) {
+        if (best[g])
+          shown[g] = std::string(*best[g]);
+      }
+      return shown;
+    }
+
+    visit_number([&](auto type) {
+      using T = decltype(type);
+      auto summaries = Group::summarize(values<T>().data(), groups, selected);
+      for (std::size_t g = 0; g < summaries.size(); g++)
+        shown[g] = show(function, summaries[g]);
+    });
+    return shown;
+  }
+
+  // Groups of the selected rows by the value they hold. Bools, dictionary
+  // codes and numbers spanning few values index an array, other values go
+  // through a hash table sized from how many rows and values there are.
+  // Null rows make one group after the others.
+  [[nodiscard]] cpp::result<Group::Groups, std::string>
+  group(std::vector<std::uint64_t> selected) const {
+    selected.resize(Bitmap::words_for(size), 0);
+    if (!selected.empty())
+      selected.back() &= Bitmap::tail_mask(size);
+    auto present = without_nulls(selected);
+
+    Group::Groups groups;
+    if (layout.type == ColumnType::rbool) {
+      groups = Group::direct(size, present, 2, [&](std::size_t i) {
+        return static_cast<std::size_t>(bool_at(i));
+      });
+    } else if (layout.type == ColumnType::dstr) {
+      auto codes = values<std::uint32_t>();
+      groups = Group::direct(size, present, dictionary->size(),
+                             [&](std::size_t i) { return codes[i]; });
+    } else if (layout.type == ColumnType::str ||
+               layout.type == ColumnType::vstr) {
+      groups = Group::hashed<std::string_view>(
+          size, present, 1024, [&](std::size_t i) { return str_at(i); });
+    } else if (layout.type == ColumnType::f64 || !is_number()) {
+      return cpp::fail(fmt::format("Cannot group by `{}.{}`, a {} column",
+                                   column.name, column.sub,
+                                   to_string(layout.type)));
+    } else {
+      visit_number([&](auto type) {
+        using T = decltype(type);
+        auto keys = values<T>();
+        auto summary = Reduce::summarize(keys.data(), size, present);
+        if (summary.count == 0) {
+          groups.of.assign(size, Group::NONE);
+          return;
+        }
+        // Differences wrap the same way for signed and unsigned values
+        auto low = static_cast<std::uint64_t>(summary.min);
+        std::uint64_t span = static_cast<std::uint64_t>(summary.max) - low;
+        if (span < Group::DIRECT_LIMIT) {
+          groups = Group::direct(size, present, span + 1, [&](std::size_t i) {
+            return static_cast<std::size_t>(
+                static_cast<std::uint64_t>(keys[i]) - low);
+          });
+          return;
+        }
+        std::size_t expected = std::min<std::uint64_t>(
+            summary.count / Group::chunks_for(size) + 1, span);
+        groups = Group::hashed<std::uint64_t>(
+            size, present, expected, [&](std::size_t i) {
+              return static_cast<std::uint64_t>(keys[i]);
+            });
+      });
+    }
 
-  ColumnInstance(Parser::NameAndSub column, void * data, Layout layout, std::size_t size) : column(column), data(data), layout(layout), size(size) {}
+    auto id = static_cast<std::uint32_t>(groups.size());
+    nulls.for_each([&](std::uint64_t row) {
+      if (row >= size || !Bitmap::test(selected, row))
+        return;
+      if (groups.size() == id)
+        groups.first.push_back(row);
+      groups.of[row] = id;
+    });
+    return groups;
+  }
+
+  // String compares of rows [from, to), equality on a dstr column compares
+  // codes and looks at no string
+  void select_strings(Parser::OperatorE op, const std::string &constant,
+                      std::size_t from, std::size_t to,
+                      std::vector<std::uint64_t> &selected) const {
+    if (layout.type == ColumnType::dstr &&
+        (op == Parser::OperatorE::EQUAL || op == Parser::OperatorE::NOT_EQUAL)) {
+      auto code = code_of(constant);
+      if (code)
+        Filter::select(values<std::uint32_t>().data(), from, to, op, *code,
+                       selected);
+      else if (op == Parser::OperatorE::NOT_EQUAL)
+        Filter::select_if(from, to, selected, [](std::size_t) { return true; });
+      return;
+    }
+    Filter::select_if(from, to, selected, [&](std::size_t i) {
+      return Filter::holds(op, str_at(i), constant);
+    });
+  }
 
   static cpp::result<std::variant<std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t,
       std::int8_t, std::int16_t, std::int32_t, std::int64_t,
       std::string, double, bool>, std::string> resolve_value(std::variant<Parser::String, Parser::UInt, Parser::Int,
-      Parser::Double, Parser::Bool> current_value, Layout current_layout) {
+      Parser::Double, Parser::Bool, Parser::Null> current_value, Layout current_layout) {
     // Here is where we do actually verify type matching
     if (std::holds_alternative<Parser::String>(current_value)) {
-      if (current_layout.type == ColumnType::str) {
+      if (current_layout.type == ColumnType::str ||
+          current_layout.type == ColumnType::dstr ||
+          current_layout.type == ColumnType::vstr) {
         std::string value = get<Parser::String>(current_value).value;
         if (value.length() > current_layout.size) {
           return cpp::fail(fmt::format(
@@ -282,16 +765,187 @@ struct ColumnInstance {
             fmt::format("Cannot cast bool to field which takes a {}",
                         current_layout.ly_to_string()));
       }
+    } else if (std::holds_alternative<Parser::Null>(current_value)) {
+      return cpp::fail(
+          fmt::format("Cannot compare a {} with NULL, only `==` and `!=` can",
+                      current_layout.ly_to_string()));
     } else
       return cpp::fail(fmt::format("Cannot cast to field"));
   }
 
-  std::vector<std::string> to_string_vec() {
+  std::vector<std::string> to_string_vec() const {
+    auto result = value_strings();
+    nulls.for_each([&](std::uint64_t row) { result[row] = "NULL"; });
+    return result;
+  }
+
+  // Order of rows `i` and `j` by value, negative when `i` goes first. Null
+  // rows, and rows past the end of the column, go before any value.
+  [[nodiscard]] int compare(std::size_t i, std::size_t j) const {
+    bool i_null = i >= size || nulls.contains(i);
+    bool j_null = j >= size || nulls.contains(j);
+    if (i_null || j_null)
+      return static_cast<int>(j_null) - static_cast<int>(i_null);
+
+    if (layout.type == ColumnType::rbool)
+      return static_cast<int>(bool_at(i)) - static_cast<int>(bool_at(j));
+    if (!is_number()) {
+      int order = str_at(i).compare(str_at(j));
+      return (order > 0) - (order < 0);
+    }
+    int order = 0;
+    visit_number([&](auto type) {
+      auto held = values<decltype(type)>();
+      order = (held[j] < held[i]) - (held[i] < held[j]);
+    });
+    return order;
+  }
+
+  // `selected` cut to the rows of the column, without the null ones
+  [[nodiscard]] std::vector<std::uint64_t>
+  without_nulls(std::vector<std::uint64_t> selected) const {
+    selected.resize(Bitmap::words_for(size), 0);
+    if (!selected.empty())
+      selected.back() &= Bitmap::tail_mask(size);
+    nulls.clear(selected);
+    return selected;
+  }
+
+  [[nodiscard]] bool is_number() const {
+    return layout.type != ColumnType::str && layout.type != ColumnType::dstr &&
+           layout.type != ColumnType::vstr && layout.type != ColumnType::rbool;
+  }
+
+  // Calls `f(T{})` with the type the values of a number column have
+  template <typename F> void visit_number(F &&f) const {
+    switch (layout.type) {
+    case ColumnType::u8:
+      return f(std::uint8_t{});
+    case ColumnType::u16:
+      return f(std::uint16_t{});
+    case ColumnType::u32:
+      return f(std::uint32_t{});
+    case ColumnType::u64:
+      return f(std::uint64_t{});
+    case ColumnType::i8:
+      return f(std::int8_t{});
+    case ColumnType::i16:
+      return f(std::int16_t{});
+    case ColumnType::i32:
+      return f(std::int32_t{});
+    case ColumnType::i64:
+      return f(std::int64_t{});
+    case ColumnType::f64:
+      return f(double{});
+    default:
+      return;
+    }
+  }
+
+  // SUM and AVG only add up numbers
+  [[nodiscard]] cpp::result<void, std::string>
+  check_aggregate(Parser::KeywordE function) const {
+    if ((function == Parser::KeywordE::SUM ||
+         function == Parser::KeywordE::AVG) &&
+        !is_number())
+      return cpp::fail(fmt::format("`{}` needs a numeric column but `{}.{}` "
+                                   "is not",
+                                   Parser::to_string(function), column.name,
+                                   column.sub));
+    return {};
+  }
+
+  template <typename T>
+  [[nodiscard]] static std::string show(Parser::KeywordE function,
+                                        const Reduce::Summary<T> &summary) {
+    if (summary.count == 0)
+      return "NULL";
+    switch (function) {
+    case Parser::KeywordE::SUM:
+      return fmt::format("{}", summary.sum);
+    case Parser::KeywordE::AVG:
+      return fmt::format("{}", static_cast<double>(summary.sum) /
+                                   static_cast<double>(summary.count));
+    case Parser::KeywordE::MIN:
+      return fmt::format("{}", +summary.min);
+    default:
+      return fmt::format("{}", +summary.max);
+    }
+  }
+
+  // Key of row `i` in a RangeIndex, nothing for a null
+  [[nodiscard]] std::optional<std::uint64_t> index_key(std::size_t i) const {
+    std::optional<std::uint64_t> key;
+    if (i < size && !nulls.contains(i))
+      visit_number([&](auto type) {
+        key = RangeIndex::key_of(values<decltype(type)>()[i]);
+      });
+    return key;
+  }
+
+  // Key of row `i` in a UniqueSet, nothing for a null
+  [[nodiscard]] std::optional<std::string> unique_key(std::size_t i) const {
+    if (i >= size || nulls.contains(i))
+      return std::nullopt;
+    switch (layout.type) {
+    case ColumnType::str:
+    case ColumnType::dstr:
+    case ColumnType::vstr:
+      return std::string(str_at(i));
+    case ColumnType::rbool:
+      return UniqueSet::key_of(bool_at(i));
+    default:
+      std::optional<std::string> key;
+      visit_number([&](auto type) {
+        key = UniqueSet::key_of(values<decltype(type)>()[i]);
+      });
+      return key;
+    }
+  }
+
+  // Value of row `i` as text, as to_string_vec shows it
+  [[nodiscard]] std::string value_string(std::size_t i) const {
+    if (nulls.contains(i))
+      return "NULL";
+
+    switch (layout.type) {
+    case ColumnType::u8:
+      return fmt::format("{}", +values<std::uint8_t>()[i]);
+    case ColumnType::u16:
+      return fmt::format("{}", values<std::uint16_t>()[i]);
+    case ColumnType::u32:
+      return fmt::format("{}", values<std::uint32_t>()[i]);
+    case ColumnType::u64:
+      return fmt::format("{}", values<std::uint64_t>()[i]);
+    case ColumnType::i8:
+      return fmt::format("{}", +values<std::int8_t>()[i]);
+    case ColumnType::i16:
+      return fmt::format("{}", values<std::int16_t>()[i]);
+    case ColumnType::i32:
+      return fmt::format("{}", values<std::int32_t>()[i]);
+    case ColumnType::i64:
+      return fmt::format("{}", values<std::int64_t>()[i]);
+    case ColumnType::f64:
+      return fmt::format("{}", values<double>()[i]);
+    case ColumnType::str:
+    case ColumnType::dstr:
+    case ColumnType::vstr:
+      return std::string(str_at(i));
+    case ColumnType::rbool:
+      return fmt::format("{}", bool_at(i));
+    default:
+      throw std::runtime_error("Cannot convert to string");
+    }
+  }
+
+  // Every value as text, null rows show what they store in its place
+  std::vector<std::string> value_strings() const {
+    std::vector<std::string> result;
+    result.reserve(size);
+
 #define PUSH(TYPE, CAST) if (layout.type == TYPE) {\
-      auto * data_cast = reinterpret_cast<std::vector<CAST> *>(data);\
-      std::vector<std::string> result;\
-      for (std::size_t i = 0; i < size; i++) {\
-        result.push_back(fmt::format("{}", +data_cast->at(i)));\
+      for (auto value : values<CAST>()) {\
+        result.push_back(fmt::format("{}", +value));\
       }                                            \
       return result;                               \
     }
@@ -305,31 +959,82 @@ struct ColumnInstance {
     else PUSH(ColumnType::i32, std::int32_t)
     else PUSH(ColumnType::i64, std::int64_t)
     else PUSH(ColumnType::f64, double)
-    else if (layout.type == ColumnType::str) {
-      auto *data_cast = reinterpret_cast<std::vector<std::string> *>(data);
-      std::vector<std::string> result;
+    else if (layout.type == ColumnType::str ||
+             layout.type == ColumnType::dstr ||
+             layout.type == ColumnType::vstr) {
       for (std::size_t i = 0; i < size; i++) {
-        result.push_back(fmt::format("{}", data_cast->at(i)));
+        result.emplace_back(str_at(i));
       }
       return result;
     }
     else if (layout.type == ColumnType::rbool) {
-      auto *data_cast = reinterpret_cast<std::vector<bool> *>(data);
-      std::vector<std::string> result;
       for (std::size_t i = 0; i < size; i++) {
-        result.push_back(fmt::format("{}", data_cast->at(i)));
+        result.push_back(fmt::format("{}", bool_at(i)));
       }
       return result;
     }
     else
       throw std::runtime_error("Cannot convert to string vec");
 
+#undef PUSH
+  }
+
+  // Bools are kept packed in memory. Packed files are used in place, files
+  // from before packing hold a byte per bool and are packed once here.
+  static cpp::result<ColumnInstance, std::string>
+  load_bools(Parser::NameAndSub column,
+             std::shared_ptr<FileManager::MappedFile> contents,
+             const std::optional<ColumnFile::Header> &header, Layout layout,
+             std::string file) {
+    std::size_t offset = header.has_value() ? ColumnFile::HEADER_SIZE : 0;
+    const std::uint8_t *values = contents->data() + offset;
+    std::size_t bytes = contents->size() - offset;
+
+    if (header.has_value() &&
+        header->encoding == ColumnFile::Encoding::Bits) {
+      // An append may have moved the row count past what got mapped
+      std::size_t size = std::min<std::size_t>(
+          header->rows, bytes / sizeof(std::uint64_t) * Bitmap::WORD_BITS);
+      if (size == 0)
+        return cpp::fail(fmt::format("The column {} is empty.", column.sub));
+      return ColumnInstance{std::move(column), contents, values, layout, size,
+                            std::move(file)};
+    }
+
+    if (bytes == 0)
+      return cpp::fail(fmt::format("The column {} is empty.", column.sub));
+
+    auto owned = std::make_shared<std::vector<std::uint8_t>>(
+        Bitmap::words_for(bytes) * sizeof(std::uint64_t), 0);
+    Bitmap::pack(values, bytes, 0, owned->data());
+    return ColumnInstance{std::move(column), owned, owned->data(), layout,
+                          bytes, std::move(file)};
   }
 
   static cpp::result<ColumnInstance, std::string>
   load_column(std::string database, std::string table, std::string column,
               DatabaseTable &descriptor) {
-    std::unique_lock<std::shared_mutex> lock(descriptor.mtx_);
+    auto loaded = load_values(std::move(database), std::move(table),
+                              std::move(column), descriptor);
+    if (loaded.has_error() || !loaded->layout.optional)
+      return loaded;
+
+    // Read after the values, the bits of every row mapped are there
+    loaded->nulls = ColumnFile::NullMap::load(
+        ColumnFile::nulls_path(loaded->file), loaded->size);
+    return loaded;
+  }
+
+  static cpp::result<ColumnInstance, std::string>
+  load_values(std::string database, std::string table, std::string column,
+              DatabaseTable &descriptor) {
+    auto flushed = descriptor.flush_appends();
+    if (flushed.has_error())
+      return cpp::fail(flushed.error());
+
+    std::shared_lock<std::shared_mutex> lock(descriptor.mtx_);
+    // Mapped while no batch is half written
+    auto reading = descriptor.lock_files();
 
     Node<KeyValue<std::string, Layout>> *node =
         descriptor.columns.for_each([&](const auto &keyvalue) {
@@ -356,74 +1061,122 @@ struct ColumnInstance {
           fmt::format("The column path {} is not a file.", column_file.path));
     }
 
-    void *data_array = nullptr;
-    std::size_t size = 0;
-
-#define DECODE(TYPE, CAST, DECODER) if (node->value.value.type == ColumnType::TYPE) {\
-    auto * result = new std::vector<CAST>();\
-    auto contents = FileManager::read_to_vec(column_file.path);                      \
-     if (contents.size() % node->value.value.size != 0) {\
-        return cpp::fail(fmt::format("The column {} is not a multiple of the size of the column type.", column));\
-    } else if (contents.empty()) {\
-        return cpp::fail(fmt::format("The column {} is empty.", column));\
-    }                                                                            \
-    for (size_t i = 0; i < contents.size(); i+=node->value.value.size) {\
-      result->push_back(Serialized::DECODER(&contents[i], node->value.value.size));\
-    }\
-    size = result->size();                                                              \
-    data_array = result;\
-  }
-
-    DECODE(u8, uint8_t, du8)
-    else DECODE(u16, uint16_t, du16)
-    else DECODE(u32, uint32_t, du32)
-    else DECODE(u64, uint64_t, du64)
-    else DECODE(i8, int8_t, di8)
-    else DECODE(i16, int16_t, di16)
-    else DECODE(i32, int32_t, di32)
-    else DECODE(i64, int64_t, di64)
-    else DECODE(f64, double, df64)
-    else if (node->value.value.type == ColumnType::rbool) {
-      auto * result = new std::vector<bool>();
-      auto contents = FileManager::read_to_vec(column_file.path);
-
-      if (contents.size() % node->value.value.size != 0) {
-        return cpp::fail(fmt::format("The column {} is not a multiple of the size of the column type.", column));
-      } else if (contents.empty()) {
-        return cpp::fail(fmt::format("The column {} is empty.", column));
-      }
+    Layout layout = node->value.value;
+    std::size_t value_size = stride(layout);
+
+    auto mapping = FileManager::MappedFile::open(column_file.path);
+    if (mapping.has_error())
+      return cpp::fail(mapping.error());
 
-      for (size_t i = 0; i < contents.size(); i+=node->value.value.size) {
-        result->push_back(Serialized::dbool(&contents[i], node->value.value.size));
+    auto contents = mapping.value();
+
+    // Files written before the column header existed start straight with
+    // the values
+    std::size_t offset = 0;
+    auto header = ColumnFile::Header::parse(contents->data(), contents->size());
+    if (header.has_value()) {
+      if (header->type != layout.type || header->stride != value_size) {
+        return cpp::fail(fmt::format("The column {} file does not match its layout {}", column, layout.ly_to_string()));
       }
-      size = result->size();
-      data_array = result;
-    } else if (node->value.value.type == ColumnType::str) {
-      auto * result = new std::vector<std::string>();
-      auto contents = FileManager::read_to_vec(column_file.path);
-
-      if (contents.size() % (node->value.value.size + 8) != 0) {
-        return cpp::fail(fmt::format("The column {} is not a multiple of the size of the column type.", column));
-      } else if (contents.empty()) {
+      offset = ColumnFile::HEADER_SIZE;
+    }
+
+    const std::uint8_t *values = contents->data() + offset;
+    std::size_t bytes = contents->size() - offset;
+
+    if (layout.type == ColumnType::rbool) {
+      return load_bools(Parser::NameAndSub{table, column}, contents, header,
+                        layout, column_file.path);
+    }
+
+    // Compressed pages are decoded in one go, most of the I/O they save is
+    // worth more than pointing into the file
+    if (header.has_value() && header->encoding == ColumnFile::Encoding::Paged) {
+      auto decoded = ColumnFile::read_paged(contents->data(), contents->size(),
+                                            column_file.path, layout);
+      if (decoded.has_error())
+        return cpp::fail(decoded.error());
+      if (decoded->empty())
         return cpp::fail(fmt::format("The column {} is empty.", column));
-      }
 
-      for (size_t i = 0; i < contents.size(); i += node->value.value.size + 8) {
-        result->push_back(
-            Serialized::dstr(&contents[i], node->value.value.size + 8)
-                .to_string());
-      }
-      size = result->size();
-      data_array = result;
+      auto owned = std::make_shared<std::vector<std::uint8_t>>(
+          std::move(decoded.value()));
+      std::size_t rows = owned->size() / value_size;
+      ColumnInstance instance{Parser::NameAndSub{table, column}, owned,
+                              owned->data(), layout, rows, column_file.path};
+      instance.load_zones();
+      return instance;
+    }
+
+    if (bytes == 0) {
+      return cpp::fail(fmt::format("The column {} is empty.", column));
+    } else if (bytes % value_size != 0) {
+      return cpp::fail(fmt::format("The column {} is not a multiple of the size of the column type.", column));
+    }
+
+    std::size_t size = bytes / value_size;
+
+    // Every code in the file was made durable in the dictionary first
+    std::shared_ptr<const Dictionary> dictionary;
+    if (layout.type == ColumnType::dstr)
+      dictionary = Dictionary::load(Dictionary::path_for(column_file.path));
+
+    // Offsets are written after the bytes they point past, but the heap is
+    // mapped second so it covers every offset mapped above
+    std::shared_ptr<FileManager::MappedFile> heap;
+    if (layout.type == ColumnType::vstr) {
+      auto heap_mapping =
+          FileManager::MappedFile::open(ColumnFile::heap_path(column_file.path));
+      if (heap_mapping.has_error())
+        return cpp::fail(heap_mapping.error());
+      heap = heap_mapping.value();
+
+      std::uint64_t last = Codec::load<std::uint64_t>(values + bytes - 8);
+      if (last > heap->size())
+        return cpp::fail(fmt::format("The column {} points past its heap", column));
     }
 
-    if (data_array == nullptr)
+    // bincode writes numbers as little endian with no padding, so on little
+    // endian hosts the file already is an array of values we can point into.
+    // Strings are byte oriented and never need decoding.
+    if (std::endian::native == std::endian::little ||
+        layout.type == ColumnType::str || value_size == 1) {
+      ColumnInstance instance{Parser::NameAndSub{table, column}, contents,
+                              values, layout, size, column_file.path};
+      instance.dictionary = std::move(dictionary);
+      instance.heap = std::move(heap);
+      instance.load_zones();
+      return instance;
+    }
+
+    auto owned = std::make_shared<std::vector<std::uint8_t>>(bytes);
+
+#define DECODE(TYPE, CAST) if (layout.type == ColumnType::TYPE) {\
+    Codec::decode(values, size,\
+                  reinterpret_cast<CAST *>(owned->data()));\
+  }
+
+    DECODE(u16, uint16_t)
+    else DECODE(u32, uint32_t)
+    else DECODE(dstr, uint32_t)
+    else DECODE(vstr, uint64_t)
+    else DECODE(u64, uint64_t)
+    else DECODE(i16, int16_t)
+    else DECODE(i32, int32_t)
+    else DECODE(i64, int64_t)
+    else DECODE(f64, double)
+    else
       return cpp::fail(
           fmt::format("Failed to load contents for column {} from {}.{}",
                       column, database, table));
-    else
-      return ColumnInstance{Parser::NameAndSub{table, column}, data_array,
-                            node->value.value, size};
+
+#undef DECODE
+
+    ColumnInstance instance{Parser::NameAndSub{table, column}, owned,
+                            owned->data(), layout, size, column_file.path};
+    instance.dictionary = std::move(dictionary);
+    instance.heap = std::move(heap);
+    return instance;
   }
 };
 
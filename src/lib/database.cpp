@@ -1,5 +1,9 @@
 #include "database.hpp"
 
+#include <map>
+
+#include "codec.hpp"
+#include "columnFile.hpp"
 #include "fm.hpp"
 
 bool DataBase::operator==(const DataBase &other) const {
@@ -41,4 +45,94 @@ cpp::result<void, std::string> DataBase::delete_table_dir(std::string database,
   }
 
   return {};
-}
\ No newline at end of file
+}
+cpp::result<std::size_t, std::string> DataBase::open_log() {
+  std::unique_lock<std::shared_mutex> lock(mutex);
+
+  auto path = WriteAheadLog::path_for(nombre);
+  std::map<std::string, ColumnFile::Writer> writers;
+  std::size_t replayed = 0;
+  std::string error;
+
+  for (auto &record : WriteAheadLog::read(path)) {
+    auto table = tables.get(record.table);
+    // The table was deleted without its drop reaching the log
+    if (table == nullptr)
+      continue;
+
+    DatabaseTable &descriptor = **table;
+    if (record.values.size() != descriptor.columns.len()) {
+      return cpp::fail(fmt::format(
+          "The log holds a row of {} values for {}.{} which has {} columns",
+          record.values.size(), nombre, record.table,
+          descriptor.columns.len()));
+    }
+
+    std::size_t i = 0;
+    descriptor.columns.for_each_c(
+        [&](const KeyValue<std::string, Layout> &keyval) {
+          auto column = FileManager::Path("data") / nombre / record.table /
+                        (keyval.key + ".col");
+          auto &value = record.values[i++];
+
+          // A value cut in half by the crash
+          auto repaired = ColumnFile::repair(column.path, keyval.value);
+          if (repaired.has_error()) {
+            error = repaired.error();
+            return true;
+          }
+          std::uint64_t rows = repaired.value();
+
+          if (rows > record.row)
+            return false;
+
+          if (rows < record.row) {
+            error = fmt::format("Column {} holds {} rows but the log continues "
+                                "at row {}",
+                                column.path, rows, record.row);
+            return true;
+          }
+
+          // Through a writer so the zone map covers the replayed values
+          auto writer = writers.try_emplace(column.path, column.path,
+                                            keyval.value).first;
+          auto appended =
+              writer->second.append(value.data(), value.size(), false);
+          if (appended.has_error()) {
+            error = appended.error();
+            return true;
+          }
+
+          replayed++;
+          return false;
+        });
+
+    if (!error.empty())
+      return cpp::fail(error);
+  }
+
+  // Replayed values must be durable before the log is emptied
+  for (auto &[column, writer] : writers) {
+    auto synced = writer.sync();
+    if (synced.has_error())
+      return cpp::fail(synced.error());
+  }
+
+  auto opened = WriteAheadLog::open(path);
+  if (opened.has_error())
+    return cpp::fail(opened.error());
+
+  log = opened.value();
+  auto truncated = log->truncate();
+  if (truncated.has_error())
+    return cpp::fail(truncated.error());
+
+  tables.for_each(
+      [&](const KeyValue<std::string, std::shared_ptr<DatabaseTable>> &keyval) {
+        std::unique_lock<std::shared_mutex> table_lock(keyval.value->mtx_);
+        keyval.value->log = log;
+        return false;
+      });
+
+  return replayed;
+}
@@ -10,11 +10,14 @@
 
 #include "fm.hpp"
 #include "table.hpp"
+#include "wal.hpp"
 
 struct DataBase {
   KeyValueList<std::string, std::shared_ptr<DatabaseTable>> tables;
   std::string nombre;
   std::shared_mutex mutex;
+  // Opened by open_log, shared with every table of the database
+  std::shared_ptr<WriteAheadLog> log;
 
   DataBase(std::string name)
       : tables(std::move(KeyValueList<std::string, std::shared_ptr<DatabaseTable>>())),
@@ -95,6 +98,7 @@ struct DataBase {
     std::unique_lock<std::shared_mutex> lock(rhs.mutex);
     tables = rhs.tables;
     nombre = rhs.nombre;
+    log = rhs.log;
   }
 
   // Move operator
@@ -105,11 +109,23 @@ struct DataBase {
       std::lock(lock_rhs, lock_this);
       tables = rhs.tables;
       nombre = rhs.nombre;
+      log = rhs.log;
     }
 
     return *this;
   }
 
+  // Replays the rows of wal.log missing from the column files, then opens
+  // the log for new inserts. Returns how many column values were replayed.
+  cpp::result<std::size_t, std::string> open_log();
+
+  // Registers a freshly created table
+  void add_table(const std::string &name, DatabaseTable &&table) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    table.log = log;
+    tables.insert(name, std::make_shared<DatabaseTable>(std::move(table)));
+  }
+
   cpp::result<void, std::string> delete_table_dir(std::string database,
                                                   std::string table);
   // delete table in memory
@@ -28,16 +28,26 @@ struct Databases {
 
     for (auto &entry : contents.value()) {
       if (entry.is_dir()) {
-        dbs.insert(entry.get_file_name(), make_shared<DataBase>(DataBase(entry.get_file_name())));
+        auto db = make_shared<DataBase>(DataBase(entry.get_file_name()));
+        auto replayed = db->open_log();
+        if (replayed.has_error())
+          return cpp::fail(fmt::format("Database {}: {}", entry.get_file_name(),
+                                       replayed.error()));
+        dbs.insert(entry.get_file_name(), db);
       }
     }
 
     return {};
   }
 
-  void add(const std::string &name) {
+  cpp::result<void, std::string> add(const std::string &name) {
     std::lock_guard<std::mutex> lock(mutex);
-    dbs.insert(name, make_shared<DataBase>(DataBase({})));
+    auto db = make_shared<DataBase>(DataBase(name));
+    auto opened = db->open_log();
+    if (opened.has_error())
+      return cpp::fail(opened.error());
+    dbs.insert(name, db);
+    return {};
   }
 
   void remove(const std::string &name) {
@@ -77,6 +87,7 @@ struct Databases {
       } else {
         {
           std::unique_lock<std::shared_mutex> lock(table_ptr->get()->mtx_);
+          table_ptr->get()->discard_appends();
           auto result = (*db)->delete_table_dir(name, table);
 
           if (result.has_error())
@@ -107,6 +118,7 @@ struct Databases {
         // Lock all tables in the database
         result->get()->tables.for_each([&](const KeyValue<std::string, shared_ptr<DatabaseTable>> &keyValue) {
           table_locks.emplace_back(std::unique_lock<std::shared_mutex>(keyValue.value->mtx_));
+          keyValue.value->discard_appends();
           return false;
         });
 
@@ -0,0 +1,81 @@
+#include "dictionary.hpp"
+
+#include <fmt/core.h>
+#include <limits>
+
+#include "codec.hpp"
+#include "fm.hpp"
+#include "indexFile.hpp"
+
+std::string Dictionary::path_for(const std::string &column_path) {
+  return IndexFile::path_for(column_path, "dict");
+}
+
+std::shared_ptr<Dictionary> Dictionary::load(const std::string &path) {
+  std::shared_ptr<Dictionary> dictionary(new Dictionary(path));
+
+  if (!FileManager::Path(path).exists())
+    return dictionary;
+
+  auto contents = FileManager::read_to_vec(path);
+  const std::uint8_t *data = contents.data();
+  std::size_t size = contents.size();
+  std::size_t at = 0;
+
+  while (at + 4 <= size) {
+    std::uint32_t length = Codec::load<std::uint32_t>(data + at);
+    if (length > size - at - 4)
+      break;
+
+    auto &value = dictionary->values_.emplace_back(
+        reinterpret_cast<const char *>(data + at + 4), length);
+    dictionary->codes_.emplace(value, dictionary->values_.size() - 1);
+    at += 4 + length;
+  }
+
+  dictionary->bytes_ = at;
+  return dictionary;
+}
+
+std::optional<std::uint32_t> Dictionary::find(std::string_view value) const {
+  auto it = codes_.find(value);
+  if (it == codes_.end())
+    return std::nullopt;
+  return it->second;
+}
+
+cpp::result<std::uint32_t, std::string>
+Dictionary::intern(std::string_view value) {
+  std::lock_guard<std::mutex> lock(mtx_);
+
+  if (auto code = find(value))
+    return *code;
+
+  if (values_.size() > std::numeric_limits<std::uint32_t>::max())
+    return cpp::fail(fmt::format("The dictionary {} is full", path_));
+
+  // Whatever a crash left after the last whole entry goes before appending
+  if (!trimmed_) {
+    if (FileManager::Path(path_).exists() &&
+        FileManager::Path(path_).get_file_size() != bytes_ &&
+        !FileManager::resize_file(path_, bytes_))
+      return cpp::fail(fmt::format("Failed to repair the dictionary {}", path_));
+    trimmed_ = true;
+  }
+
+  std::vector<std::uint8_t> entry;
+  entry.reserve(4 + value.size());
+  Codec::push(entry, static_cast<std::uint32_t>(value.size()));
+  entry.insert(entry.end(), value.begin(), value.end());
+
+  auto appended =
+      FileManager::append_bytes(path_, entry.data(), entry.size(), true);
+  if (appended.has_error())
+    return cpp::fail(appended.error());
+
+  auto code = static_cast<std::uint32_t>(values_.size());
+  auto &stored = values_.emplace_back(value);
+  codes_.emplace(stored, code);
+  bytes_ += entry.size();
+  return code;
+}
@@ -0,0 +1,57 @@
+#ifndef DICTIONARY_HPP
+#define DICTIONARY_HPP
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <result.hpp>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Distinct values of a dictionary encoded string column (dstr), kept at
+// `<col>.dict` next to the column. The column stores the u32 code of every
+// value; codes are handed out in insertion order and never change, so
+// equality filters compare codes and strings are only looked up for output.
+//
+// The file is a sequence of [u32 length][bytes] entries, little endian, the
+// code of an entry is its position. A torn last entry is ignored.
+struct Dictionary {
+  static std::string path_for(const std::string &column_path);
+
+  // Reads the entries of `path`, a missing file is an empty dictionary
+  static std::shared_ptr<Dictionary> load(const std::string &path);
+
+  Dictionary(const Dictionary &) = delete;
+  Dictionary &operator=(const Dictionary &) = delete;
+
+  [[nodiscard]] std::optional<std::uint32_t> find(std::string_view value) const;
+
+  [[nodiscard]] std::string_view at(std::uint32_t code) const {
+    return values_[code];
+  }
+
+  [[nodiscard]] std::size_t size() const { return values_.size(); }
+
+  // Code of `value`, new values are appended to the file and made durable
+  // before their code is returned so no column row can outlive its entry.
+  // Only the instance inserts go through may call it, readers load their
+  // own copy.
+  cpp::result<std::uint32_t, std::string> intern(std::string_view value);
+
+private:
+  explicit Dictionary(std::string path) : path_(std::move(path)) {}
+
+  std::string path_;
+  std::mutex mtx_;
+  // A deque keeps the strings in place, the map keys point into them
+  std::deque<std::string> values_;
+  std::unordered_map<std::string_view, std::uint32_t> codes_;
+  // Bytes of valid entries, a torn tail past it is cut before appending
+  std::uint64_t bytes_ = 0;
+  bool trimmed_ = false;
+};
+
+#endif // DICTIONARY_HPP
@@ -0,0 +1,289 @@
+#include "filter.hpp"
+
+#include <algorithm>
+#include <type_traits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FILTER_X86 1
+#include <immintrin.h>
+#endif
+
+namespace Filter {
+
+using Op = Parser::OperatorE;
+
+std::string to_string(Isa isa) {
+  switch (isa) {
+  case Isa::Portable:
+    return "portable";
+  case Isa::Sse:
+    return "sse4.2";
+  case Isa::Avx2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+static Isa detect() {
+#ifdef FILTER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2"))
+    return Isa::Avx2;
+  if (__builtin_cpu_supports("sse4.2"))
+    return Isa::Sse;
+#endif
+  return Isa::Portable;
+}
+
+Isa best_isa() {
+  static const Isa isa = detect();
+  return isa;
+}
+
+template <typename T> using Kernel = void (*)(const T *, std::size_t, T,
+                                              std::uint64_t *);
+
+// Plain loop over 64 rows per word, left for the compiler to vectorize
+template <typename T, Op OP>
+static void scan_portable(const T *values, std::size_t words, T constant,
+                          std::uint64_t *out) {
+  for (std::size_t w = 0; w < words; w++) {
+    const T *at = values + w * Bitmap::WORD_BITS;
+    std::uint64_t bits = 0;
+    for (std::size_t j = 0; j < Bitmap::WORD_BITS; j++)
+      bits |= static_cast<std::uint64_t>(holds(OP, at[j], constant)) << j;
+    out[w] = bits;
+  }
+}
+
+#ifdef FILTER_X86
+
+#define SSE42 __attribute__((target("sse4.2")))
+#define AVX2 __attribute__((target("avx2")))
+
+// Lanes of one vector for each type: load, splat, signed `eq`/`gt` and the
+// mask of a compare as one bit per lane. Unsigned values get their sign bit
+// flipped on the way in so signed compares order them.
+template <typename T> struct Sse;
+template <typename T> struct Avx;
+
+#define SSE_INT(TYPE, BITS, SET, BIAS, MASK)                                   \
+  template <> struct Sse<TYPE> {                                               \
+    using V = __m128i;                                                         \
+    static constexpr std::size_t LANES = 16 / sizeof(TYPE);                    \
+    SSE42 static V bias() { return _mm_set1_epi##SET(BIAS); }                  \
+    SSE42 static V splat(TYPE c) {                                             \
+      return _mm_xor_si128(_mm_set1_epi##SET(c), bias());                      \
+    }                                                                          \
+    SSE42 static V load(const TYPE *at) {                                      \
+      return _mm_xor_si128(                                                    \
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(at)), bias());     \
+    }                                                                          \
+    SSE42 static V eq(V a, V b) { return _mm_cmpeq_epi##BITS(a, b); }          \
+    SSE42 static V gt(V a, V b) { return _mm_cmpgt_epi##BITS(a, b); }          \
+    SSE42 static std::uint64_t mask(V m) { return MASK; }                      \
+  };
+
+#define AVX_INT(TYPE, BITS, SET, BIAS, MASK)                                   \
+  template <> struct Avx<TYPE> {                                               \
+    using V = __m256i;                                                         \
+    static constexpr std::size_t LANES = 32 / sizeof(TYPE);                    \
+    AVX2 static V bias() { return _mm256_set1_epi##SET(BIAS); }                \
+    AVX2 static V splat(TYPE c) {                                              \
+      return _mm256_xor_si256(_mm256_set1_epi##SET(c), bias());                \
+    }                                                                          \
+    AVX2 static V load(const TYPE *at) {                                       \
+      return _mm256_xor_si256(                                                 \
+          _mm256_loadu_si256(reinterpret_cast<const __m256i *>(at)), bias());  \
+    }                                                                          \
+    AVX2 static V eq(V a, V b) { return _mm256_cmpeq_epi##BITS(a, b); }        \
+    AVX2 static V gt(V a, V b) { return _mm256_cmpgt_epi##BITS(a, b); }        \
+    AVX2 static std::uint64_t mask(V m) { return MASK; }                       \
+  };
+
+#define SSE_MASK8 static_cast<std::uint32_t>(_mm_movemask_epi8(m))
+#define SSE_MASK16                                                             \
+  static_cast<std::uint32_t>(                                                  \
+      _mm_movemask_epi8(_mm_packs_epi16(m, _mm_setzero_si128())))
+#define SSE_MASK32                                                             \
+  static_cast<std::uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(m)))
+#define SSE_MASK64                                                             \
+  static_cast<std::uint32_t>(_mm_movemask_pd(_mm_castsi128_pd(m)))
+
+#define AVX_MASK8 static_cast<std::uint32_t>(_mm256_movemask_epi8(m))
+#define AVX_MASK16                                                             \
+  static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(                \
+      _mm256_castsi256_si128(m), _mm256_extracti128_si256(m, 1))))
+#define AVX_MASK32                                                             \
+  static_cast<std::uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(m)))
+#define AVX_MASK64                                                             \
+  static_cast<std::uint32_t>(_mm256_movemask_pd(_mm256_castsi256_pd(m)))
+
+SSE_INT(std::int8_t, 8, 8, 0, SSE_MASK8)
+SSE_INT(std::uint8_t, 8, 8, static_cast<char>(0x80), SSE_MASK8)
+SSE_INT(std::int16_t, 16, 16, 0, SSE_MASK16)
+SSE_INT(std::uint16_t, 16, 16, static_cast<short>(0x8000), SSE_MASK16)
+SSE_INT(std::int32_t, 32, 32, 0, SSE_MASK32)
+SSE_INT(std::uint32_t, 32, 32, static_cast<int>(0x80000000u), SSE_MASK32)
+SSE_INT(std::int64_t, 64, 64x, 0, SSE_MASK64)
+SSE_INT(std::uint64_t, 64, 64x, static_cast<long long>(1ull << 63), SSE_MASK64)
+
+AVX_INT(std::int8_t, 8, 8, 0, AVX_MASK8)
+AVX_INT(std::uint8_t, 8, 8, static_cast<char>(0x80), AVX_MASK8)
+AVX_INT(std::int16_t, 16, 16, 0, AVX_MASK16)
+AVX_INT(std::uint16_t, 16, 16, static_cast<short>(0x8000), AVX_MASK16)
+AVX_INT(std::int32_t, 32, 32, 0, AVX_MASK32)
+AVX_INT(std::uint32_t, 32, 32, static_cast<int>(0x80000000u), AVX_MASK32)
+AVX_INT(std::int64_t, 64, 64x, 0, AVX_MASK64)
+AVX_INT(std::uint64_t, 64, 64x, static_cast<long long>(1ull << 63), AVX_MASK64)
+
+#undef SSE_INT
+#undef AVX_INT
+
+template <> struct Sse<double> {
+  using V = __m128d;
+  static constexpr std::size_t LANES = 2;
+  SSE42 static V splat(double c) { return _mm_set1_pd(c); }
+  SSE42 static V load(const double *at) { return _mm_loadu_pd(at); }
+  SSE42 static V eq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+  SSE42 static V gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+  SSE42 static std::uint64_t mask(V m) {
+    return static_cast<std::uint32_t>(_mm_movemask_pd(m));
+  }
+};
+
+template <> struct Avx<double> {
+  using V = __m256d;
+  static constexpr std::size_t LANES = 4;
+  AVX2 static V splat(double c) { return _mm256_set1_pd(c); }
+  AVX2 static V load(const double *at) { return _mm256_loadu_pd(at); }
+  AVX2 static V eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  AVX2 static V gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  AVX2 static std::uint64_t mask(V m) {
+    return static_cast<std::uint32_t>(_mm256_movemask_pd(m));
+  }
+};
+
+// The same word loop for each instruction set, it has to be compiled for
+// the set of the lanes it calls. Negated compares are masked to the lanes,
+// doubles build `>=`/`<=` out of two compares so NaN never matches them.
+#define SCAN(NAME, LANES_OF, TARGET)                                           \
+  template <typename T, Op OP>                                                 \
+  TARGET static void NAME(const T *values, std::size_t words, T constant,      \
+                          std::uint64_t *out) {                                \
+    using L = LANES_OF<T>;                                                     \
+    constexpr std::uint64_t all = (std::uint64_t{1} << L::LANES) - 1;          \
+    auto c = L::splat(constant);                                               \
+    for (std::size_t w = 0; w < words; w++) {                                  \
+      const T *at = values + w * Bitmap::WORD_BITS;                            \
+      std::uint64_t bits = 0;                                                  \
+      for (std::size_t k = 0; k < Bitmap::WORD_BITS; k += L::LANES) {          \
+        auto v = L::load(at + k);                                              \
+        std::uint64_t m;                                                       \
+        if constexpr (OP == Op::EQUAL)                                         \
+          m = L::mask(L::eq(v, c));                                            \
+        else if constexpr (OP == Op::NOT_EQUAL)                                \
+          m = ~L::mask(L::eq(v, c)) & all;                                     \
+        else if constexpr (OP == Op::GREAT)                                    \
+          m = L::mask(L::gt(v, c));                                            \
+        else if constexpr (OP == Op::LESS)                                     \
+          m = L::mask(L::gt(c, v));                                            \
+        else if constexpr (std::is_floating_point_v<T>)                        \
+          m = L::mask(OP == Op::GREAT_EQUAL ? L::gt(v, c) : L::gt(c, v)) |     \
+              L::mask(L::eq(v, c));                                            \
+        else if constexpr (OP == Op::GREAT_EQUAL)                              \
+          m = ~L::mask(L::gt(c, v)) & all;                                     \
+        else                                                                   \
+          m = ~L::mask(L::gt(v, c)) & all;                                     \
+        bits |= m << k;                                                        \
+      }                                                                        \
+      out[w] = bits;                                                           \
+    }                                                                          \
+  }
+
+SCAN(scan_sse, Sse, SSE42)
+SCAN(scan_avx2, Avx, AVX2)
+
+#undef SCAN
+
+#endif // FILTER_X86
+
+template <typename T, Op OP> static Kernel<T> kernel_for(Isa isa) {
+  switch (isa) {
+#ifdef FILTER_X86
+  case Isa::Avx2:
+    return &scan_avx2<T, OP>;
+  case Isa::Sse:
+    return &scan_sse<T, OP>;
+#endif
+  default:
+    return &scan_portable<T, OP>;
+  }
+}
+
+template <typename T> static Kernel<T> kernel_for(Isa isa, Op op) {
+  switch (op) {
+  case Op::EQUAL:
+    return kernel_for<T, Op::EQUAL>(isa);
+  case Op::NOT_EQUAL:
+    return kernel_for<T, Op::NOT_EQUAL>(isa);
+  case Op::GREAT:
+    return kernel_for<T, Op::GREAT>(isa);
+  case Op::GREAT_EQUAL:
+    return kernel_for<T, Op::GREAT_EQUAL>(isa);
+  case Op::LESS:
+    return kernel_for<T, Op::LESS>(isa);
+  case Op::LESS_EQUAL:
+    return kernel_for<T, Op::LESS_EQUAL>(isa);
+  default:
+    return nullptr;
+  }
+}
+
+template <typename T>
+void select(const T *values, std::size_t from, std::size_t to, Op op,
+            T constant, std::vector<std::uint64_t> &selected, Isa isa) {
+  Kernel<T> kernel = kernel_for<T>(supported(isa) ? isa : best_isa(), op);
+  if (kernel == nullptr || from >= to)
+    return;
+
+  // Rows before the first and after the last whole word go one at a time
+  std::size_t first = (from + Bitmap::WORD_BITS - 1) / Bitmap::WORD_BITS;
+  std::size_t last = to / Bitmap::WORD_BITS;
+  auto one_by_one = [&](std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; i++) {
+      std::uint64_t bit = std::uint64_t{1} << (i % Bitmap::WORD_BITS);
+      if (holds(op, values[i], constant))
+        selected[i / Bitmap::WORD_BITS] |= bit;
+      else
+        selected[i / Bitmap::WORD_BITS] &= ~bit;
+    }
+  };
+
+  if (first >= last) {
+    one_by_one(from, to);
+    return;
+  }
+  one_by_one(from, first * Bitmap::WORD_BITS);
+  kernel(values + first * Bitmap::WORD_BITS, last - first, constant,
+         selected.data() + first);
+  one_by_one(last * Bitmap::WORD_BITS, to);
+}
+
+#define INSTANTIATE(TYPE)                                                      \
+  template void select<TYPE>(const TYPE *, std::size_t, std::size_t, Op,       \
+                             TYPE, std::vector<std::uint64_t> &, Isa);
+
+INSTANTIATE(std::uint8_t)
+INSTANTIATE(std::uint16_t)
+INSTANTIATE(std::uint32_t)
+INSTANTIATE(std::uint64_t)
+INSTANTIATE(std::int8_t)
+INSTANTIATE(std::int16_t)
+INSTANTIATE(std::int32_t)
+INSTANTIATE(std::int64_t)
+INSTANTIATE(double)
+
+#undef INSTANTIATE
+
+} // namespace Filter
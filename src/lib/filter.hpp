@@ -0,0 +1,71 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "analyzer/parser.hpp"
+#include "bitmap.hpp"
+
+// Kernels that compare a column against a constant and write one bit per
+// row into a selection bitmap. Whole words of 64 rows go through a kernel
+// specialised on the type and operator, the instruction set is picked at
+// runtime among the ones the CPU has.
+namespace Filter {
+
+enum class Isa : std::uint8_t {
+  Portable = 0,
+  Sse = 1,
+  Avx2 = 2,
+};
+
+std::string to_string(Isa isa);
+
+// Best instruction set of the running CPU, detected once
+Isa best_isa();
+
+inline bool supported(Isa isa) { return isa <= best_isa(); }
+
+template <typename A, typename B>
+bool holds(Parser::OperatorE op, const A &value, const B &constant) {
+  switch (op) {
+  case Parser::OperatorE::EQUAL:
+    return value == constant;
+  case Parser::OperatorE::NOT_EQUAL:
+    return value != constant;
+  case Parser::OperatorE::GREAT:
+    return value > constant;
+  case Parser::OperatorE::GREAT_EQUAL:
+    return value >= constant;
+  case Parser::OperatorE::LESS:
+    return value < constant;
+  case Parser::OperatorE::LESS_EQUAL:
+    return value <= constant;
+  default:
+    return false;
+  }
+}
+
+// Sets the bits of the rows in [from, to) where `holds(row)`, for what has
+// no kernel (strings). Other bits are kept.
+template <typename F>
+void select_if(std::size_t from, std::size_t to,
+               std::vector<std::uint64_t> &selected, F &&holds) {
+  for (std::size_t i = from; i < to; i++) {
+    if (holds(i))
+      Bitmap::set(selected, i);
+  }
+}
+
+// Sets the bits of the rows in [from, to) to `values[i] <op> constant`,
+// bits outside the range are kept.
+// Instantiated for every integer type and double.
+template <typename T>
+void select(const T *values, std::size_t from, std::size_t to,
+            Parser::OperatorE op, T constant,
+            std::vector<std::uint64_t> &selected, Isa isa = best_isa());
+
+} // namespace Filter
+
+#endif // FILTER_HPP
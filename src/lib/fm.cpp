@@ -1,26 +1,81 @@
 #include "fm.hpp"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <io.h>
+#endif
+
 std::vector<uint8_t> FileManager::read_to_vec(const std::string &path) {
   std::fstream file;
   file.open(path, std::ios::in | std::ios::binary);
-  file.unsetf(std::ios::skipws);
-
-  std::streampos fileSize;
 
   file.seekg(0, std::ios::end);
-  fileSize = file.tellg();
+  std::streampos fileSize = file.tellg();
   file.seekg(0, std::ios::beg);
 
-  std::vector<uint8_t> vec;
-  vec.reserve(fileSize);
+  if (fileSize <= 0)
+    return {};
 
-  vec.insert(vec.begin(), std::istream_iterator<uint8_t>(file),
-             std::istream_iterator<uint8_t>());
+  // One bulk read instead of going byte by byte through an istream_iterator
+  std::vector<uint8_t> vec(static_cast<size_t>(fileSize));
+  file.read(reinterpret_cast<char *>(vec.data()), fileSize);
+  vec.resize(static_cast<size_t>(file.gcount()));
 
   file.close();
   return vec;
 }
 
+cpp::result<std::shared_ptr<FileManager::MappedFile>, std::string>
+FileManager::MappedFile::open(const std::string &path) {
+  std::shared_ptr<MappedFile> file(new MappedFile());
+
+#ifndef _WIN32
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return cpp::fail(fmt::format("Failed to open {} for reading", path));
+
+  struct stat info {};
+  if (fstat(fd, &info) != 0) {
+    ::close(fd);
+    return cpp::fail(fmt::format("Failed to get the size of {}", path));
+  }
+
+  file->size_ = static_cast<size_t>(info.st_size);
+
+  // mmap rejects empty mappings, an empty file is just an empty view
+  if (file->size_ > 0) {
+    void *mapped =
+        mmap(nullptr, file->size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      ::close(fd);
+      return cpp::fail(fmt::format("Failed to map {} into memory", path));
+    }
+    madvise(mapped, file->size_, MADV_SEQUENTIAL);
+    file->data_ = static_cast<const uint8_t *>(mapped);
+  }
+
+  // The mapping stays valid after the descriptor is closed
+  ::close(fd);
+#else
+  file->fallback_ = read_to_vec(path);
+  file->data_ = file->fallback_.data();
+  file->size_ = file->fallback_.size();
+#endif
+
+  return file;
+}
+
+FileManager::MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (data_ != nullptr)
+    munmap(const_cast<uint8_t *>(data_), size_);
+#endif
+}
+
 void FileManager::write_to_file(const std::string &path,
                                 const std::vector<uint8_t> &contents) {
   std::ofstream file(path, std::ios::out | std::ios::binary);
@@ -52,3 +107,38 @@ void FileManager::append_to_file(const std::string &path, uint8_t *contents,
   file.write((const char *)contents, (std::streamsize)size);
   file.close();
 }
+
+cpp::result<void, std::string> FileManager::append_bytes(const std::string &path,
+                                                         const uint8_t *contents,
+                                                         size_t size, bool sync) {
+  std::FILE *file = std::fopen(path.c_str(), "ab");
+  if (file == nullptr)
+    return cpp::fail(fmt::format("Failed to open {} for appending", path));
+
+  bool ok = std::fwrite(contents, 1, size, file) == size;
+  ok = std::fflush(file) == 0 && ok;
+  if (sync)
+    ok = sync_file(file) && ok;
+  ok = std::fclose(file) == 0 && ok;
+
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to append to {}", path));
+
+  return {};
+}
+
+bool FileManager::sync_file(std::FILE *file) {
+  if (std::fflush(file) != 0)
+    return false;
+#ifndef _WIN32
+  return fsync(fileno(file)) == 0;
+#else
+  return _commit(_fileno(file)) == 0;
+#endif
+}
+
+bool FileManager::resize_file(const std::string &path, uint64_t size) {
+  std::error_code error;
+  std::filesystem::resize_file(path, size, error);
+  return !error;
+}
@@ -1,11 +1,13 @@
 #ifndef FM_HPP
 #define FM_HPP
 
+#include <cstdio>
 #include <filesystem>
 #include <fmt/format.h>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <result.hpp>
 #include <string>
@@ -55,6 +57,42 @@ void append_to_file(const std::string &path, uint8_t *contents, size_t size);
 
 void append_to_file(const std::string &path, Serialized contents);
 
+// Appends `size` bytes and, when `sync` is set, waits for them to reach
+// stable storage before returning
+cpp::result<void, std::string> append_bytes(const std::string &path,
+                                            const uint8_t *contents,
+                                            size_t size, bool sync);
+
+// Flushes an open file down to stable storage
+bool sync_file(std::FILE *file);
+
+// Cuts or extends the file to exactly `size` bytes
+bool resize_file(const std::string &path, uint64_t size);
+
+// Read-only view over the whole contents of a file. On unix the file is
+// mmap'ed so readers work straight over the page cache; elsewhere the
+// contents are read once into a buffer owned by the instance.
+struct MappedFile {
+  static cpp::result<std::shared_ptr<MappedFile>, std::string>
+  open(const std::string &path);
+
+  [[nodiscard]] const uint8_t *data() const { return data_; }
+
+  [[nodiscard]] size_t size() const { return size_; }
+
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile();
+
+private:
+  MappedFile() = default;
+
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+  std::vector<uint8_t> fallback_;
+};
+
 struct Path {
 private:
   static std::string get_string(char *rs_cstring) {
@@ -0,0 +1,299 @@
+#ifndef GROUP_HPP
+#define GROUP_HPP
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bitmap.hpp"
+#include "pool.hpp"
+#include "reduce.hpp"
+
+// GROUP BY: numbering the groups of the selected rows and reducing columns
+// per group. The rows are split in chunks of whole words, one per thread
+// of the query in the worker pool. Each chunk numbers its groups in a table
+// of its own and keeps partial aggregates per group. The partials are
+// merged at the end, in chunk order, so groups are numbered in the order of
+// their first row.
+namespace Group {
+
+using Bits = std::vector<std::uint64_t>;
+
+constexpr std::uint32_t NONE = std::numeric_limits<std::uint32_t>::max();
+
+// Key ranges up to this many values are numbered by indexing an array
+// instead of hashing
+constexpr std::size_t DIRECT_LIMIT = std::size_t{1} << 16;
+
+// Fewest rows worth a thread of their own
+constexpr std::size_t CHUNK_ROWS = std::size_t{1} << 16;
+
+struct Groups {
+  // Group of each row, NONE for the rows not selected
+  std::vector<std::uint32_t> of;
+  // First row of each group, the keys of the group are read from it
+  std::vector<std::size_t> first;
+
+  [[nodiscard]] std::size_t size() const { return first.size(); }
+};
+
+inline std::size_t chunks_for(std::size_t rows) {
+  return std::clamp<std::size_t>(rows / CHUNK_ROWS, 1, Pool::degree());
+}
+
+// Calls `f(chunk, from, to)` over `chunks` ranges of whole words covering
+// [0, rows), on as many threads of the pool when there is more than one
+template <typename F>
+void for_each_chunk(std::size_t rows, std::size_t chunks, F &&f) {
+  if (chunks <= 1) {
+    f(std::size_t{0}, std::size_t{0}, rows);
+    return;
+  }
+  std::size_t words = Bitmap::words_for(rows);
+  std::size_t per = (words + chunks - 1) / chunks * Bitmap::WORD_BITS;
+  Pool::run(chunks, chunks, [&](std::size_t chunk) {
+    std::size_t from = std::min(chunk * per, rows);
+    f(chunk, from, std::min(from + per, rows));
+  });
+}
+
+// Calls `f(i)` for the rows of [from, to) set in `selected`, `from` is the
+// start of a word
+template <typename F>
+void for_each_selected(const Bits &selected, std::size_t from, std::size_t to,
+                       F &&f) {
+  std::size_t end = std::min(Bitmap::words_for(to), selected.size());
+  for (std::size_t w = from / Bitmap::WORD_BITS; w < end; w++) {
+    std::uint64_t bits = selected[w];
+    if (w + 1 == Bitmap::words_for(to))
+      bits &= Bitmap::tail_mask(to);
+    for (; bits != 0; bits &= bits - 1)
+      f(w * Bitmap::WORD_BITS + std::countr_zero(bits));
+  }
+}
+
+inline std::uint64_t hash(std::uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return key;
+}
+
+inline std::uint64_t hash(std::string_view key) {
+  return hash(std::hash<std::string_view>{}(key));
+}
+
+// Open addressing with linear probing, each key next to its id so a probe
+// touches one cache line. It starts with room for `expected` keys at half
+// load and doubles when it gets fuller than that.
+template <typename Key> class HashTable {
+public:
+  explicit HashTable(std::size_t expected) {
+    slots_.resize(std::bit_ceil(std::max<std::size_t>(16, expected * 2)));
+  }
+
+  // Id of `key`, which is `id` if it was not there yet, and whether it was
+  // added
+  std::pair<std::uint32_t, bool> emplace(const Key &key, std::uint32_t id) {
+    if ((size_ + 1) * 2 > slots_.size())
+      grow();
+    std::size_t mask = slots_.size() - 1;
+    for (std::size_t at = hash(key) & mask;; at = (at + 1) & mask) {
+      Slot &slot = slots_[at];
+      if (slot.id == NONE) {
+        slot = {key, id};
+        size_++;
+        return {id, true};
+      }
+      if (slot.key == key)
+        return {slot.id, false};
+    }
+  }
+
+  // Id of `key`, NONE if it is not there
+  [[nodiscard]] std::uint32_t find(const Key &key) const {
+    std::size_t mask = slots_.size() - 1;
+    for (std::size_t at = hash(key) & mask;; at = (at + 1) & mask) {
+      const Slot &slot = slots_[at];
+      if (slot.id == NONE || slot.key == key)
+        return slot.id;
+    }
+  }
+
+private:
+  struct Slot {
+    Key key{};
+    std::uint32_t id = NONE;
+  };
+
+  void grow() {
+    std::vector<Slot> old(slots_.size() * 2);
+    std::swap(old, slots_);
+    std::size_t mask = slots_.size() - 1;
+    for (auto &slot : old) {
+      if (slot.id == NONE)
+        continue;
+      std::size_t at = hash(slot.key) & mask;
+      while (slots_[at].id != NONE)
+        at = (at + 1) & mask;
+      slots_[at] = slot;
+    }
+  }
+
+  std::vector<Slot> slots_;
+  std::size_t size_ = 0;
+};
+
+// Keys in [0, range) index the ids straight away
+class DirectTable {
+public:
+  explicit DirectTable(std::size_t range) : ids_(range, NONE) {}
+
+  std::pair<std::uint32_t, bool> emplace(std::size_t key, std::uint32_t id) {
+    if (ids_[key] != NONE)
+      return {ids_[key], false};
+    ids_[key] = id;
+    return {id, true};
+  }
+
+private:
+  std::vector<std::uint32_t> ids_;
+};
+
+// Numbers the groups of the selected rows, `make_table()` gives an empty
+// table and `key_at(i)` the key of row `i`
+template <typename MakeTable, typename KeyAt>
+Groups number(std::size_t rows, const Bits &selected, MakeTable &&make_table,
+              KeyAt &&key_at) {
+  Groups groups;
+  groups.of.assign(rows, NONE);
+  std::size_t chunks = chunks_for(rows);
+
+  std::vector<std::vector<std::size_t>> firsts(chunks);
+  for_each_chunk(rows, chunks, [&](std::size_t chunk, std::size_t from,
+                                   std::size_t to) {
+    auto table = make_table();
+    auto &first = firsts[chunk];
+    for_each_selected(selected, from, to, [&](std::size_t i) {
+      auto [id, added] =
+          table.emplace(key_at(i), static_cast<std::uint32_t>(first.size()));
+      if (added)
+        first.push_back(i);
+      groups.of[i] = id;
+    });
+  });
+  if (chunks == 1) {
+    groups.first = std::move(firsts.front());
+    return groups;
+  }
+
+  // The first row of a local group has its key, it finds the global id
+  std::vector<std::vector<std::uint32_t>> global(chunks);
+  auto table = make_table();
+  for (std::size_t chunk = 0; chunk < chunks; chunk++) {
+    for (std::size_t row : firsts[chunk]) {
+      auto [id, added] = table.emplace(
+          key_at(row), static_cast<std::uint32_t>(groups.first.size()));
+      if (added)
+        groups.first.push_back(row);
+      global[chunk].push_back(id);
+    }
+  }
+  for_each_chunk(rows, chunks, [&](std::size_t chunk, std::size_t from,
+                                   std::size_t to) {
+    for_each_selected(selected, from, to, [&](std::size_t i) {
+      groups.of[i] = global[chunk][groups.of[i]];
+    });
+  });
+  return groups;
+}
+
+// Groups of keys that hash, sized for `expected` distinct keys
+template <typename Key, typename KeyAt>
+Groups hashed(std::size_t rows, const Bits &selected, std::size_t expected,
+              KeyAt &&key_at) {
+  return number(
+      rows, selected, [&] { return HashTable<Key>(expected); }, key_at);
+}
+
+// Groups of keys already in [0, range)
+template <typename KeyAt>
+Groups direct(std::size_t rows, const Bits &selected, std::size_t range,
+              KeyAt &&key_at) {
+  return number(
+      rows, selected, [&] { return DirectTable(range); }, key_at);
+}
+
+// Rows equal on the keys of both `a` and `b`, rows in only one of them are
+// left out
+inline Groups combine(const Groups &a, const Groups &b, Bits selected) {
+  for_each_selected(selected, 0, a.of.size(), [&](std::size_t i) {
+    if (a.of[i] == NONE || i >= b.of.size() || b.of[i] == NONE)
+      selected[i / Bitmap::WORD_BITS] &=
+          ~(std::uint64_t{1} << (i % Bitmap::WORD_BITS));
+  });
+
+  auto key_at = [&](std::size_t i) {
+    return (static_cast<std::uint64_t>(a.of[i]) << 32) | b.of[i];
+  };
+  std::size_t range = a.size() * b.size();
+  if (range <= DIRECT_LIMIT)
+    return direct(a.of.size(), selected, range, [&](std::size_t i) {
+      return static_cast<std::size_t>(a.of[i]) * b.size() + b.of[i];
+    });
+  return hashed<std::uint64_t>(a.of.size(), selected,
+                               std::max(a.size(), b.size()), key_at);
+}
+
+// Selected rows of each group
+inline std::vector<std::size_t> sizes(const Groups &groups,
+                                      const Bits &selected) {
+  std::vector<std::size_t> counts(groups.size());
+  for_each_selected(selected, 0, groups.of.size(), [&](std::size_t i) {
+    if (groups.of[i] != NONE)
+      counts[groups.of[i]]++;
+  });
+  return counts;
+}
+
+// Summary of `values` per group over the rows set in `selected`. Each chunk
+// fills partial summaries of its own that are merged at the end.
+template <typename T>
+std::vector<Reduce::Summary<T>> summarize(const T *values,
+                                          const Groups &groups,
+                                          const Bits &selected) {
+  std::size_t rows = groups.of.size();
+  std::size_t chunks = chunks_for(rows);
+  std::vector<std::vector<Reduce::Summary<T>>> partials(
+      chunks, std::vector<Reduce::Summary<T>>(groups.size()));
+
+  for_each_chunk(rows, chunks, [&](std::size_t chunk, std::size_t from,
+                                   std::size_t to) {
+    auto &partial = partials[chunk];
+    for_each_selected(selected, from, to, [&](std::size_t i) {
+      if (groups.of[i] == NONE)
+        return;
+      auto &summary = partial[groups.of[i]];
+      summary.count++;
+      summary.sum += values[i];
+      summary.min = std::min(summary.min, values[i]);
+      summary.max = std::max(summary.max, values[i]);
+    });
+  });
+
+  auto &total = partials.front();
+  for (std::size_t chunk = 1; chunk < chunks; chunk++) {
+    for (std::size_t g = 0; g < total.size(); g++)
+      Reduce::merge(total[g], partials[chunk][g]);
+  }
+  return std::move(total);
+}
+
+} // namespace Group
+
+#endif // GROUP_HPP
@@ -0,0 +1,215 @@
+#include "hashIndex.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <fmt/core.h>
+
+#include "codec.hpp"
+#include "fm.hpp"
+#include "group.hpp"
+
+namespace {
+
+constexpr std::uint8_t MAGIC[4] = {'T', 'P', 'K', 'H'};
+
+} // namespace
+
+std::string HashIndex::path_for(const std::string &column_path) {
+  return IndexFile::path_for(column_path, "pkh");
+}
+
+bool HashIndex::supports(ColumnType type) { return RangeIndex::supports(type); }
+
+cpp::result<std::shared_ptr<HashIndex>, std::string>
+HashIndex::open(const std::string &path, ColumnType type) {
+  if (!supports(type))
+    return cpp::fail(fmt::format("Columns of type {} cannot be a primary key",
+                                 to_string(type)));
+
+  std::shared_ptr<HashIndex> index(new HashIndex(path, type));
+  std::vector<std::uint8_t> contents;
+  if (FileManager::Path(path).exists())
+    contents = FileManager::read_to_vec(path);
+
+  bool usable = contents.size() >= HEADER_SIZE &&
+                std::memcmp(contents.data(), MAGIC, sizeof(MAGIC)) == 0 &&
+                Codec::load<std::uint16_t>(contents.data() + 4) == VERSION &&
+                Codec::load<std::uint16_t>(contents.data() + 6) == type;
+  if (usable) {
+    const std::uint8_t *header = contents.data();
+    auto slots = Codec::load<std::uint64_t>(header + 8);
+    index->entries_ = Codec::load<std::uint64_t>(header + 16);
+    index->rows_.reset(Codec::load<std::uint64_t>(header + 24));
+    usable = slots >= MIN_SLOTS && std::has_single_bit(slots) &&
+             index->entries_ * 2 <= slots &&
+             contents.size() == HEADER_SIZE + slots * SLOT_SIZE;
+    if (usable) {
+      index->slots_.resize(slots);
+      std::uint64_t held = 0;
+      for (std::size_t i = 0; i < slots; i++) {
+        const std::uint8_t *at = contents.data() + HEADER_SIZE + i * SLOT_SIZE;
+        index->slots_[i] = {Codec::load<std::uint64_t>(at),
+                            Codec::load<std::uint64_t>(at + 8)};
+        held += index->slots_[i].row != 0;
+      }
+      usable = held == index->entries_;
+    }
+  }
+  if (!usable)
+    index->reset();
+
+  index->file_ = IndexFile::open(path, usable);
+  if (index->file_ == nullptr)
+    return cpp::fail(fmt::format("Failed to open the primary key {}", path));
+  if (!usable) {
+    auto written = index->write_all();
+    if (written.has_error())
+      return cpp::fail(written.error());
+  }
+  return index;
+}
+
+HashIndex::~HashIndex() {
+  if (file_ != nullptr)
+    std::fclose(file_);
+}
+
+void HashIndex::reset() {
+  slots_.assign(MIN_SLOTS, Slot{});
+  dirty_.clear();
+  grown_ = false;
+  entries_ = 0;
+  rows_.reset();
+}
+
+std::size_t HashIndex::probe(std::uint64_t key) const {
+  std::size_t mask = slots_.size() - 1;
+  std::size_t at = Group::hash(key) & mask;
+  while (slots_[at].row != 0 && slots_[at].key != key)
+    at = (at + 1) & mask;
+  return at;
+}
+
+std::optional<std::uint64_t> HashIndex::find(std::uint64_t key) const {
+  std::lock_guard lock(mtx_);
+  const Slot &slot = slots_[probe(key)];
+  if (slot.row == 0)
+    return std::nullopt;
+  return slot.row - 1;
+}
+
+bool HashIndex::claim(std::uint64_t key) {
+  std::lock_guard lock(mtx_);
+  if (slots_[probe(key)].row != 0)
+    return false;
+  return claimed_.insert(key).second;
+}
+
+cpp::result<void, std::string> HashIndex::commit(std::uint64_t key,
+                                                 std::uint64_t row) {
+  std::lock_guard lock(mtx_);
+  claimed_.erase(key);
+  put(key, row);
+  rows_.advance(row);
+  return write_dirty();
+}
+
+void HashIndex::release(std::uint64_t key) {
+  std::lock_guard lock(mtx_);
+  claimed_.erase(key);
+}
+
+cpp::result<void, std::string> HashIndex::extend(std::uint64_t rows,
+                                                 const KeyAt &key_at) {
+  std::lock_guard lock(mtx_);
+  for (std::uint64_t row = rows_.rows(); row < rows; row++) {
+    if (auto key = key_at(row))
+      put(*key, row);
+    rows_.advance(row);
+  }
+  return write_dirty();
+}
+
+std::uint64_t HashIndex::rows() const {
+  std::lock_guard lock(mtx_);
+  return rows_.rows();
+}
+
+std::uint64_t HashIndex::size() const {
+  std::lock_guard lock(mtx_);
+  return entries_;
+}
+
+void HashIndex::put(std::uint64_t key, std::uint64_t row) {
+  if ((entries_ + 1) * 2 > slots_.size())
+    grow();
+  std::size_t at = probe(key);
+  if (slots_[at].row != 0)
+    return;
+  slots_[at] = {key, row + 1};
+  entries_++;
+  dirty_.push_back(at);
+}
+
+void HashIndex::grow() {
+  std::vector<Slot> old(slots_.size() * 2);
+  std::swap(old, slots_);
+  for (auto &slot : old) {
+    if (slot.row != 0)
+      slots_[probe(slot.key)] = slot;
+  }
+  grown_ = true;
+}
+
+cpp::result<void, std::string> HashIndex::write_dirty() {
+  if (grown_)
+    return write_all();
+  if (file_ == nullptr)
+    return {};
+
+  bool ok = true;
+  for (std::size_t slot : dirty_) {
+    std::array<std::uint8_t, SLOT_SIZE> bytes{};
+    Codec::store(slots_[slot].key, bytes.data());
+    Codec::store(slots_[slot].row, bytes.data() + 8);
+    ok = ok &&
+         std::fseek(file_, static_cast<long>(HEADER_SIZE + slot * SLOT_SIZE),
+                    SEEK_SET) == 0 &&
+         std::fwrite(bytes.data(), 1, SLOT_SIZE, file_) == SLOT_SIZE;
+  }
+  dirty_.clear();
+
+  // Slots land before the header that counts them
+  std::array<std::uint8_t, HEADER_SIZE> header{};
+  std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+  Codec::store(VERSION, header.data() + 4);
+  Codec::store(static_cast<std::uint16_t>(type_), header.data() + 6);
+  Codec::store(static_cast<std::uint64_t>(slots_.size()), header.data() + 8);
+  Codec::store(entries_, header.data() + 16);
+  Codec::store(rows_.rows(), header.data() + 24);
+  ok = ok && std::fseek(file_, 0, SEEK_SET) == 0 &&
+       std::fwrite(header.data(), 1, HEADER_SIZE, file_) == HEADER_SIZE &&
+       std::fflush(file_) == 0;
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to write the primary key {}", path_));
+  return {};
+}
+
+cpp::result<void, std::string> HashIndex::write_all() {
+  dirty_.clear();
+  grown_ = false;
+  if (file_ == nullptr)
+    return {};
+
+  std::vector<std::uint8_t> bytes(slots_.size() * SLOT_SIZE);
+  for (std::size_t slot = 0; slot < slots_.size(); slot++) {
+    Codec::store(slots_[slot].key, bytes.data() + slot * SLOT_SIZE);
+    Codec::store(slots_[slot].row, bytes.data() + slot * SLOT_SIZE + 8);
+  }
+  if (std::fseek(file_, HEADER_SIZE, SEEK_SET) != 0 ||
+      std::fwrite(bytes.data(), 1, bytes.size(), file_) != bytes.size())
+    return cpp::fail(fmt::format("Failed to write the primary key {}", path_));
+  return write_dirty();
+}
@@ -0,0 +1,125 @@
+#ifndef HASHINDEX_HPP
+#define HASHINDEX_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <result.hpp>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "indexFile.hpp"
+#include "rangeIndex.hpp"
+#include "serializer.hpp"
+
+// Primary key of a table declared with `PK`, an open addressing hash table
+// from the key of every row to the row, kept at `<col>.pkh` next to the key
+// column. Keys are the values widened the way of RangeIndex::key_of, they
+// are compared whole and a probe never reads the column.
+//
+// The file is a HEADER_SIZE bytes header
+//   "TPKH", u16 version, u16 column type, u64 slots, u64 entries, u64 rows
+// followed by the (u64 key, u64 row + 1) slots, all of them little endian.
+// A slot holding row 0 is free. Keys are probed linearly from their hash,
+// there are at least twice as many slots as keys and the table doubles,
+// written again whole, when it would get fuller than that.
+//
+// `rows` is how many leading rows of the column the table holds. Inserts
+// write their slot and then the header without waiting for them, rows past
+// `rows` are added from the column before the table is used again (see
+// `extend`). A file that does not add up is started over, and so is one
+// holding more rows than its column (see DatabaseTable::primary_index).
+class HashIndex {
+public:
+  static constexpr std::size_t HEADER_SIZE = 64;
+  static constexpr std::uint16_t VERSION = 1;
+
+  using KeyAt = RangeIndex::KeyAt;
+
+  static std::string path_for(const std::string &column_path);
+
+  // Whether a column of `type` can be a primary key
+  static bool supports(ColumnType type);
+
+  // Reads the table at `path`, one missing or that does not add up comes
+  // back empty, to be filled again by `extend`
+  static cpp::result<std::shared_ptr<HashIndex>, std::string>
+  open(const std::string &path, ColumnType type);
+
+  HashIndex(const HashIndex &) = delete;
+  HashIndex &operator=(const HashIndex &) = delete;
+
+  ~HashIndex();
+
+  // Row holding `key`, nothing if none does
+  [[nodiscard]] std::optional<std::uint64_t> find(std::uint64_t key) const;
+
+  // Takes `key` for a row about to be inserted. False when a row holds it
+  // already or another insert took it first.
+  bool claim(std::uint64_t key);
+
+  // Gives a claimed key the row it was inserted as and writes it
+  cpp::result<void, std::string> commit(std::uint64_t key, std::uint64_t row);
+
+  // Lets go of a claimed key whose row was not inserted
+  void release(std::uint64_t key);
+
+  // Adds every row before `rows` the table does not hold yet. A key held
+  // already keeps its row.
+  cpp::result<void, std::string> extend(std::uint64_t rows,
+                                        const KeyAt &key_at);
+
+  // Leading rows of the column the table holds
+  [[nodiscard]] std::uint64_t rows() const;
+
+  // Keys held
+  [[nodiscard]] std::uint64_t size() const;
+
+private:
+  static constexpr std::size_t SLOT_SIZE = 16;
+  static constexpr std::size_t MIN_SLOTS = 16;
+
+  struct Slot {
+    std::uint64_t key = 0;
+    // Row + 1, 0 for a free slot
+    std::uint64_t row = 0;
+  };
+
+  HashIndex(std::string path, ColumnType type)
+      : path_(std::move(path)), type_(type) {}
+
+  void reset();
+
+  // Slot of `key`, or the free one it would go in
+  [[nodiscard]] std::size_t probe(std::uint64_t key) const;
+
+  // Adds `key` for `row` unless it is held, without writing it, `mtx_`
+  // held
+  void put(std::uint64_t key, std::uint64_t row);
+
+  void grow();
+
+  // Writes the slots changed since the last write, or every one after the
+  // table grew, and then the header
+  cpp::result<void, std::string> write_dirty();
+
+  cpp::result<void, std::string> write_all();
+
+  std::string path_;
+  ColumnType type_;
+  std::FILE *file_ = nullptr;
+
+  mutable std::mutex mtx_;
+  std::vector<Slot> slots_;
+  std::vector<std::size_t> dirty_;
+  bool grown_ = false;
+  std::uint64_t entries_ = 0;
+  IndexFile::Watermark rows_;
+  // Keys of the inserts between `claim` and `commit`
+  std::set<std::uint64_t> claimed_;
+};
+
+#endif // HASHINDEX_HPP
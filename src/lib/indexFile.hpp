@@ -0,0 +1,64 @@
+#ifndef INDEXFILE_HPP
+#define INDEXFILE_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <set>
+#include <string>
+
+// What the indexes kept next to a column share: where their file goes, how
+// it is opened and how many leading rows of the column they hold.
+namespace IndexFile {
+
+// `<col>.<extension>` next to the column at `column_path`
+inline std::string path_for(const std::string &column_path,
+                            const std::string &extension) {
+  auto dot = column_path.rfind(".col");
+  return (dot == std::string::npos ? column_path
+                                   : column_path.substr(0, dot)) +
+         "." + extension;
+}
+
+// Opens an index to be written over in place, emptied unless `keep`
+inline std::FILE *open(const std::string &path, bool keep) {
+  return std::fopen(path.c_str(), keep ? "r+b" : "w+b");
+}
+
+// Leading rows of a column an index holds. Rows may be added in any order,
+// those past the first one missing wait until it comes.
+class Watermark {
+public:
+  [[nodiscard]] std::uint64_t rows() const { return rows_; }
+
+  // Whether some row past `rows()` was added already
+  [[nodiscard]] bool ahead() const { return !ahead_.empty(); }
+
+  // Holds exactly the first `rows` rows
+  void reset(std::uint64_t rows = 0) {
+    rows_ = rows;
+    ahead_.clear();
+  }
+
+  void advance(std::uint64_t row) {
+    if (row < rows_)
+      return;
+    if (row > rows_) {
+      ahead_.insert(row);
+      return;
+    }
+    rows_++;
+    while (!ahead_.empty() && *ahead_.begin() <= rows_) {
+      if (*ahead_.begin() == rows_)
+        rows_++;
+      ahead_.erase(ahead_.begin());
+    }
+  }
+
+private:
+  std::uint64_t rows_ = 0;
+  std::set<std::uint64_t> ahead_;
+};
+
+} // namespace IndexFile
+
+#endif // INDEXFILE_HPP
@@ -0,0 +1,165 @@
+#include "join.hpp"
+
+#include <optional>
+#include <type_traits>
+
+#include "group.hpp"
+
+namespace Join {
+
+static std::size_t count(const Bits &bits) {
+  std::size_t total = 0;
+  for (auto word : bits)
+    total += std::popcount(word);
+  return total;
+}
+
+// Builds a table over the `build` rows and probes it with the `probe` rows.
+// `build_key(i)` and `probe_key(i)` give the key of a row, nothing for rows
+// that cannot match. The rows of each key sit together, in row order.
+template <typename Key, typename BuildKey, typename ProbeKey>
+static void join_on(const Bits &build, BuildKey &&build_key, const Bits &probe,
+                    ProbeKey &&probe_key, std::vector<std::size_t> &build_out,
+                    std::vector<std::size_t> &probe_out) {
+  Group::HashTable<Key> table(count(build));
+  std::vector<std::size_t> rows;
+  std::vector<std::uint32_t> ids;
+  std::vector<std::size_t> starts;
+  Bitmap::for_each_set(build, [&](std::size_t i) {
+    std::optional<Key> key = build_key(i);
+    if (!key)
+      return;
+    auto [id, added] =
+        table.emplace(*key, static_cast<std::uint32_t>(starts.size()));
+    if (added)
+      starts.push_back(0);
+    starts[id]++;
+    rows.push_back(i);
+    ids.push_back(id);
+  });
+
+  // Counts to offsets, then the rows of each key in place
+  std::size_t offset = 0;
+  for (auto &start : starts)
+    offset += std::exchange(start, offset);
+  starts.push_back(offset);
+  std::vector<std::size_t> sorted(rows.size());
+  std::vector<std::size_t> next(starts.begin(), starts.end() - 1);
+  for (std::size_t k = 0; k < rows.size(); k++)
+    sorted[next[ids[k]]++] = rows[k];
+
+  Bitmap::for_each_set(probe, [&](std::size_t i) {
+    std::optional<Key> key = probe_key(i);
+    if (!key)
+      return;
+    std::uint32_t id = table.find(*key);
+    if (id == Group::NONE)
+      return;
+    for (std::size_t k = starts[id]; k < starts[id + 1]; k++) {
+      build_out.push_back(sorted[k]);
+      probe_out.push_back(i);
+    }
+  });
+}
+
+static bool is_string(const ColumnInstance &column) {
+  return column.layout.type == ColumnType::str ||
+         column.layout.type == ColumnType::dstr ||
+         column.layout.type == ColumnType::vstr;
+}
+
+cpp::result<Pairs, std::string> hash_join(const ColumnInstance &left,
+                                          const Bits &left_rows,
+                                          const ColumnInstance &right,
+                                          const Bits &right_rows) {
+  Bits left_keyed = left.without_nulls(left_rows);
+  Bits right_keyed = right.without_nulls(right_rows);
+  bool build_left = count(left_keyed) <= count(right_keyed);
+
+  Pairs pairs;
+  auto run = [&](auto key_type, auto &&left_key, auto &&right_key) {
+    using Key = decltype(key_type);
+    if (build_left)
+      join_on<Key>(left_keyed, left_key, right_keyed, right_key, pairs.left,
+                   pairs.right);
+    else
+      join_on<Key>(right_keyed, right_key, left_keyed, left_key, pairs.right,
+                   pairs.left);
+  };
+
+  auto type = left.layout.type;
+  auto other = right.layout.type;
+  if (is_string(left) && is_string(right)) {
+    auto key_of = [](const ColumnInstance &column) {
+      return [&column](std::size_t i) {
+        return std::optional<std::string_view>(column.str_at(i));
+      };
+    };
+    run(std::string_view{}, key_of(left), key_of(right));
+  } else if (type == ColumnType::rbool && other == ColumnType::rbool) {
+    auto key_of = [](const ColumnInstance &column) {
+      return [&column](std::size_t i) {
+        return std::optional<std::uint64_t>(column.bool_at(i));
+      };
+    };
+    run(std::uint64_t{}, key_of(left), key_of(right));
+  } else if (type == ColumnType::f64 && other == ColumnType::f64) {
+    // By bits, with both zeros alike and NaN equal to nothing
+    auto key_of = [](const ColumnInstance &column) {
+      return [values = column.values<double>()](std::size_t i) {
+        double value = values[i];
+        if (value != value)
+          return std::optional<std::uint64_t>();
+        return std::optional<std::uint64_t>(
+            std::bit_cast<std::uint64_t>(value == 0 ? 0.0 : value));
+      };
+    };
+    run(std::uint64_t{}, key_of(left), key_of(right));
+  } else if (left.is_number() && right.is_number() && type != ColumnType::f64 &&
+             other != ColumnType::f64) {
+    // Equal integers have equal bits once widened. Next to an unsigned
+    // column negative values equal nothing, so they do not meet the high
+    // unsigned ones.
+    left.visit_number([&](auto left_type) {
+      right.visit_number([&](auto right_type) {
+        using L = decltype(left_type);
+        using R = decltype(right_type);
+        if constexpr (std::is_integral_v<L> && std::is_integral_v<R>) {
+          constexpr bool mixed = std::is_signed_v<L> != std::is_signed_v<R>;
+          auto key_of = [](auto values) {
+            return [values](std::size_t i) {
+              auto value = values[i];
+              if constexpr (mixed && std::is_signed_v<decltype(value)>) {
+                if (value < 0)
+                  return std::optional<std::uint64_t>();
+              }
+              return std::optional<std::uint64_t>(
+                  static_cast<std::uint64_t>(value));
+            };
+          };
+          run(std::uint64_t{}, key_of(left.values<L>()),
+              key_of(right.values<R>()));
+        }
+      });
+    });
+  } else {
+    return cpp::fail(fmt::format("Cannot join `{}.{}` ({}) with `{}.{}` ({})",
+                                 left.column.name, left.column.sub,
+                                 to_string(type), right.column.name,
+                                 right.column.sub, to_string(other)));
+  }
+  return pairs;
+}
+
+Bits gather(const Bits &bits, const std::vector<std::size_t> &rows,
+            const Bits &within) {
+  Bits out(within.size());
+  Bitmap::for_each_set(within, [&](std::size_t k) {
+    if (k < rows.size() && rows[k] / Bitmap::WORD_BITS < bits.size() &&
+        Bitmap::test(bits, rows[k]))
+      Bitmap::set(out, k);
+  });
+  return out;
+}
+
+} // namespace Join
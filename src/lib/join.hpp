@@ -0,0 +1,41 @@
+#ifndef JOIN_HPP
+#define JOIN_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "columnInstance.hpp"
+
+// Equi-joins of two tables. Only row ids go through the join, the columns a
+// query shows are read afterwards for the pairs that come out of it.
+namespace Join {
+
+using Bits = std::vector<std::uint64_t>;
+
+// Rows of the left and the right table that pair up, `left[k]` with
+// `right[k]`
+struct Pairs {
+  std::vector<std::size_t> left;
+  std::vector<std::size_t> right;
+
+  [[nodiscard]] std::size_t size() const { return left.size(); }
+};
+
+// Pairs of the rows set in `left_rows` and `right_rows` whose keys are
+// equal. A hash table is built over the side with fewer rows and the other
+// side probes it, pairs come in the order of the probing rows. Null keys
+// match nothing, signed and unsigned integers compare by value.
+cpp::result<Pairs, std::string> hash_join(const ColumnInstance &left,
+                                          const Bits &left_rows,
+                                          const ColumnInstance &right,
+                                          const Bits &right_rows);
+
+// Selection of pairs out of a selection of one table's rows: bit `k` of
+// `within` stays set if `rows[k]` is set in `bits`
+Bits gather(const Bits &bits, const std::vector<std::size_t> &rows,
+            const Bits &within);
+
+} // namespace Join
+
+#endif // JOIN_HPP
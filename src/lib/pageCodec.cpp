@@ -0,0 +1,267 @@
+#include "pageCodec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <limits>
+#include <utility>
+
+#include "codec.hpp"
+
+namespace PageCodec {
+
+std::string to_string(Kind kind) {
+  switch (kind) {
+  case Kind::Plain:
+    return "plain";
+  case Kind::FrameOfReference:
+    return "for";
+  case Kind::Delta:
+    return "delta";
+  case Kind::RunLength:
+    return "rle";
+  }
+  return "unknown";
+}
+
+// Small differences of either sign become small unsigned numbers
+static std::uint64_t zigzag(std::uint64_t delta) {
+  auto value = static_cast<std::int64_t>(delta);
+  return (delta << 1) ^ static_cast<std::uint64_t>(value >> 63);
+}
+
+static std::uint64_t unzigzag(std::uint64_t value) {
+  return (value >> 1) ^ (0 - (value & 1));
+}
+
+static std::size_t packed_bytes(std::size_t rows, unsigned width) {
+  return (rows * width + 63) / 64 * sizeof(std::uint64_t);
+}
+
+// Packs `values - base` in `width` bits each
+static void pack(const std::uint64_t *values, std::size_t rows,
+                 std::uint64_t base, unsigned width,
+                 std::vector<std::uint8_t> &out) {
+  std::size_t at = out.size();
+  out.resize(at + packed_bytes(rows, width), 0);
+  if (width == 0)
+    return;
+
+  std::uint8_t *words = out.data() + at;
+  std::uint64_t word = 0;
+  unsigned used = 0;
+  for (std::size_t i = 0; i < rows; i++) {
+    std::uint64_t value = values[i] - base;
+    word |= value << used;
+    if (used + width >= 64) {
+      Codec::store<std::uint64_t>(word, words);
+      words += sizeof(std::uint64_t);
+      word = used == 0 ? 0 : value >> (64 - used);
+      used = used + width - 64;
+    } else {
+      used += width;
+    }
+  }
+  if (used > 0)
+    Codec::store<std::uint64_t>(word, words);
+}
+
+// Value `I` of a block of 64 values packed in W bits, positions are known
+// at compile time so the shifts and masks are constants
+template <unsigned W, std::size_t I>
+static std::uint64_t extract(const std::uint64_t *words) {
+  constexpr std::size_t bit = I * W;
+  constexpr std::size_t word = bit / 64;
+  constexpr unsigned shift = bit % 64;
+  constexpr std::uint64_t mask =
+      W == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << W) - 1;
+
+  if constexpr (shift + W > 64)
+    return ((words[word] >> shift) | (words[word + 1] << (64 - shift))) &
+           mask;
+  else
+    return (words[word] >> shift) & mask;
+}
+
+template <unsigned W, std::size_t... I>
+static void unpack_block(const std::uint8_t *in, std::uint64_t base,
+                         std::uint64_t *out, std::index_sequence<I...>) {
+  // 64 values of W bits fill exactly W words
+  std::uint64_t words[W];
+  for (unsigned w = 0; w < W; w++)
+    words[w] = Codec::load<std::uint64_t>(in + w * sizeof(std::uint64_t));
+  ((out[I] = extract<W, I>(words) + base), ...);
+}
+
+template <unsigned W>
+static void unpack(const std::uint8_t *in, std::size_t rows,
+                   std::uint64_t base, std::uint64_t *out) {
+  if constexpr (W == 0) {
+    std::fill(out, out + rows, base);
+  } else {
+    std::size_t blocks = rows / 64;
+    for (std::size_t b = 0; b < blocks; b++)
+      unpack_block<W>(in + b * W * sizeof(std::uint64_t), base, out + b * 64,
+                      std::make_index_sequence<64>{});
+
+    constexpr std::uint64_t mask =
+        W == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << W) - 1;
+    for (std::size_t i = blocks * 64; i < rows; i++) {
+      std::size_t bit = i * W;
+      std::size_t word = bit / 64;
+      unsigned shift = bit % 64;
+      std::uint64_t value =
+          Codec::load<std::uint64_t>(in + word * sizeof(std::uint64_t)) >>
+          shift;
+      if (shift + W > 64)
+        value |= Codec::load<std::uint64_t>(in + (word + 1) *
+                                                     sizeof(std::uint64_t))
+                 << (64 - shift);
+      out[i] = (value & mask) + base;
+    }
+  }
+}
+
+using Unpacker = void (*)(const std::uint8_t *, std::size_t, std::uint64_t,
+                          std::uint64_t *);
+
+template <std::size_t... W>
+static constexpr std::array<Unpacker, sizeof...(W)>
+make_unpackers(std::index_sequence<W...>) {
+  return {&unpack<W>...};
+}
+
+static constexpr auto UNPACKERS = make_unpackers(std::make_index_sequence<65>{});
+
+Kind encode(const std::uint64_t *values, std::size_t rows,
+            std::vector<std::uint8_t> &out) {
+  std::uint64_t min = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t max = 0;
+  std::uint64_t delta_min = std::numeric_limits<std::uint64_t>::max();
+  std::uint64_t delta_max = 0;
+  std::size_t runs = rows == 0 ? 0 : 1;
+
+  for (std::size_t i = 0; i < rows; i++) {
+    min = std::min(min, values[i]);
+    max = std::max(max, values[i]);
+    if (i > 0) {
+      std::uint64_t delta = zigzag(values[i] - values[i - 1]);
+      delta_min = std::min(delta_min, delta);
+      delta_max = std::max(delta_max, delta);
+      runs += values[i] != values[i - 1];
+    }
+  }
+  if (rows < 2)
+    delta_min = delta_max = 0;
+
+  unsigned width = std::bit_width(max - min);
+  unsigned delta_width = std::bit_width(delta_max - delta_min);
+
+  // Bytes each codec takes, the first one strictly smaller than plain wins
+  std::array<std::pair<Kind, std::size_t>, 3> sizes{{
+      {Kind::FrameOfReference, 9 + packed_bytes(rows, width)},
+      {Kind::Delta, 17 + packed_bytes(rows == 0 ? 0 : rows - 1, delta_width)},
+      {Kind::RunLength, 4 + 12 * runs},
+  }};
+  Kind kind = Kind::Plain;
+  std::size_t best = rows * sizeof(std::uint64_t);
+  for (auto [candidate, size] : sizes) {
+    if (size < best) {
+      kind = candidate;
+      best = size;
+    }
+  }
+
+  out.reserve(out.size() + best);
+  switch (kind) {
+  case Kind::Plain:
+    for (std::size_t i = 0; i < rows; i++)
+      Codec::push(out, values[i]);
+    break;
+  case Kind::FrameOfReference:
+    Codec::push(out, min);
+    Codec::push(out, static_cast<std::uint8_t>(width));
+    pack(values, rows, min, width, out);
+    break;
+  case Kind::Delta: {
+    std::vector<std::uint64_t> deltas(rows - 1);
+    for (std::size_t i = 1; i < rows; i++)
+      deltas[i - 1] = zigzag(values[i] - values[i - 1]);
+    Codec::push(out, values[0]);
+    Codec::push(out, delta_min);
+    Codec::push(out, static_cast<std::uint8_t>(delta_width));
+    pack(deltas.data(), deltas.size(), delta_min, delta_width, out);
+  } break;
+  case Kind::RunLength: {
+    Codec::push(out, static_cast<std::uint32_t>(runs));
+    std::size_t start = 0;
+    for (std::size_t i = 1; i <= rows; i++) {
+      if (i == rows || values[i] != values[start]) {
+        Codec::push(out, values[start]);
+        Codec::push(out, static_cast<std::uint32_t>(i - start));
+        start = i;
+      }
+    }
+  } break;
+  }
+
+  return kind;
+}
+
+bool decode(Kind kind, const std::uint8_t *in, std::size_t size,
+            std::size_t rows, std::uint64_t *out) {
+  switch (kind) {
+  case Kind::Plain:
+    if (size != rows * sizeof(std::uint64_t))
+      return false;
+    Codec::decode(in, rows, out);
+    return true;
+  case Kind::FrameOfReference: {
+    if (size < 9)
+      return false;
+    std::uint64_t min = Codec::load<std::uint64_t>(in);
+    unsigned width = in[8];
+    if (width > 64 || size != 9 + packed_bytes(rows, width))
+      return false;
+    UNPACKERS[width](in + 9, rows, min, out);
+    return true;
+  }
+  case Kind::Delta: {
+    if (size < 17 || rows == 0)
+      return false;
+    std::uint64_t first = Codec::load<std::uint64_t>(in);
+    std::uint64_t min = Codec::load<std::uint64_t>(in + 8);
+    unsigned width = in[16];
+    if (width > 64 || size != 17 + packed_bytes(rows - 1, width))
+      return false;
+    UNPACKERS[width](in + 17, rows - 1, min, out + 1);
+    out[0] = first;
+    std::uint64_t value = first;
+    for (std::size_t i = 1; i < rows; i++) {
+      value += unzigzag(out[i]);
+      out[i] = value;
+    }
+    return true;
+  }
+  case Kind::RunLength: {
+    if (size < 4)
+      return false;
+    std::uint32_t runs = Codec::load<std::uint32_t>(in);
+    if (size != 4 + 12 * static_cast<std::size_t>(runs))
+      return false;
+    std::size_t at = 0;
+    for (std::uint32_t r = 0; r < runs; r++) {
+      std::uint64_t value = Codec::load<std::uint64_t>(in + 4 + r * 12);
+      std::uint32_t length = Codec::load<std::uint32_t>(in + 12 + r * 12);
+      if (length > rows - at)
+        return false;
+      std::fill(out + at, out + at + length, value);
+      at += length;
+    }
+    return at == rows;
+  }
+  }
+  return false;
+}
+
+} // namespace PageCodec
@@ -0,0 +1,41 @@
+#ifndef PAGECODEC_HPP
+#define PAGECODEC_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Lightweight compression of one page of 64 bit integers. Values come as
+// unsigned words in an order preserving form (signed values get their sign
+// bit flipped, see ColumnFile), so every codec works on plain u64s.
+//
+// Payloads, little endian:
+//   Plain:            rows x u64
+//   FrameOfReference: u64 min, u8 width, values - min packed in `width` bits
+//   Delta:            u64 first, u64 min, u8 width, then the zigzag encoded
+//                     differences between neighbours - min, packed
+//   RunLength:        u32 runs, runs x (u64 value, u32 length)
+// Packed values go LSB first into u64 words.
+namespace PageCodec {
+
+enum class Kind : std::uint8_t {
+  Plain = 0,
+  FrameOfReference = 1,
+  Delta = 2,
+  RunLength = 3,
+};
+
+std::string to_string(Kind kind);
+
+// Appends the smallest encoding of `values` to `out`, going by the page
+// min/max, run count and spread of the differences
+Kind encode(const std::uint64_t *values, std::size_t rows,
+            std::vector<std::uint8_t> &out);
+
+// Decodes `rows` values, false if the payload is not a valid `kind` page
+bool decode(Kind kind, const std::uint8_t *in, std::size_t size,
+            std::size_t rows, std::uint64_t *out);
+
+} // namespace PageCodec
+
+#endif // PAGECODEC_HPP
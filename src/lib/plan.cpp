@@ -0,0 +1,208 @@
+#include "plan.hpp"
+
+#include <algorithm>
+#include <fmt/core.h>
+
+namespace {
+
+// Per thread, so counting takes no shared cache line
+thread_local std::size_t allocated = 0;
+
+std::string column_name(const Parser::NameAndSub &column) {
+  return fmt::format("{}.{}", column.name, column.sub);
+}
+
+std::string symbol(Parser::OperatorE op) {
+  switch (op) {
+  case Parser::OperatorE::EQUAL:
+    return "==";
+  case Parser::OperatorE::NOT_EQUAL:
+    return "!=";
+  case Parser::OperatorE::GREAT:
+    return ">";
+  case Parser::OperatorE::GREAT_EQUAL:
+    return ">=";
+  case Parser::OperatorE::LESS:
+    return "<";
+  case Parser::OperatorE::LESS_EQUAL:
+    return "<=";
+  default:
+    return Parser::to_string(op);
+  }
+}
+
+} // namespace
+
+namespace Plan {
+
+std::string to_string(Kind kind) {
+  switch (kind) {
+  case Kind::Scan:
+    return "Scan";
+  case Kind::Filter:
+    return "Filter";
+  case Kind::Join:
+    return "Join";
+  case Kind::Aggregate:
+    return "Aggregate";
+  case Kind::Sort:
+    return "Sort";
+  case Kind::Project:
+    return "Project";
+  case Kind::Output:
+    return "Output";
+  }
+  return "Unknown";
+}
+
+Operator *Pipeline::find(Kind kind) {
+  for (auto &op : operators) {
+    if (op.kind == kind)
+      return &op;
+  }
+  return nullptr;
+}
+
+std::string to_string(const Automata::Predicate &node,
+                      const std::vector<Automata::Restriction> &restrictions) {
+  if (node.restriction) {
+    auto &[column, op, value] = restrictions[*node.restriction];
+    std::string constant = Automata::val_to_string(value);
+    if (std::holds_alternative<Parser::String>(value))
+      constant = fmt::format("\"{}\"", constant);
+    else if (std::holds_alternative<Parser::Double>(value))
+      constant = fmt::format("{}", std::get<Parser::Double>(value).value);
+    return fmt::format("{} {} {}", column_name(column), symbol(op), constant);
+  }
+
+  std::string written;
+  for (auto &child : node.children) {
+    if (!written.empty())
+      written += fmt::format(" {} ", Parser::to_string(node.op));
+    if (child.restriction)
+      written += to_string(child, restrictions);
+    else
+      written += fmt::format("({})", to_string(child, restrictions));
+  }
+  return written;
+}
+
+Pipeline build(const Automata::Show_Select &select) {
+  Pipeline pipeline;
+
+  // Tables in the order the query names them
+  std::vector<std::string> tables;
+  auto add_table = [&](const std::string &table) {
+    if (std::find(tables.begin(), tables.end(), table) == tables.end())
+      tables.push_back(table);
+  };
+  for (auto &column : select.tables)
+    add_table(column.name);
+  for (auto &aggregate : select.aggregates) {
+    if (aggregate.column)
+      add_table(aggregate.column->name);
+    else if (aggregate.table)
+      add_table(*aggregate.table);
+  }
+  for (auto &key : select.group_by)
+    add_table(key.name);
+  for (auto &restriction : select.restrictions)
+    add_table(std::get<0>(restriction).name);
+  if (select.join)
+    add_table(select.join->table);
+
+  std::string scanned;
+  for (auto &table : tables)
+    scanned += fmt::format("{}{}.{}", scanned.empty() ? "" : ", ",
+                           select.database, table);
+  pipeline.operators.push_back({Kind::Scan, scanned, {}});
+
+  if (select.where.restriction || !select.where.children.empty())
+    pipeline.operators.push_back(
+        {Kind::Filter, to_string(select.where, select.restrictions), {}});
+
+  if (select.join)
+    pipeline.operators.push_back(
+        {Kind::Join,
+         fmt::format("hash {} == {}", column_name(select.join->left),
+                     column_name(select.join->right)),
+         {}});
+
+  if (!select.aggregates.empty() || !select.group_by.empty()) {
+    std::string reduced;
+    for (auto &aggregate : select.aggregates)
+      reduced += fmt::format("{}{}", reduced.empty() ? "" : ", ",
+                             Automata::to_string(aggregate));
+    std::string keys;
+    for (auto &key : select.group_by)
+      keys += fmt::format("{}{}", keys.empty() ? "" : ", ", column_name(key));
+    if (!keys.empty())
+      reduced += fmt::format("{}BY {}", reduced.empty() ? "" : " ", keys);
+    pipeline.operators.push_back({Kind::Aggregate, reduced, {}});
+  }
+
+  if (!select.order_by.empty()) {
+    std::string keys;
+    for (auto &order : select.order_by)
+      keys += fmt::format("{}{}{}", keys.empty() ? "" : ", ",
+                          column_name(order.column),
+                          order.descending ? " DESC" : "");
+    if (select.limit)
+      keys += fmt::format(", top {}", *select.limit);
+    pipeline.operators.push_back({Kind::Sort, keys, {}});
+  }
+
+  std::string shown;
+  for (auto &column : select.tables)
+    shown += fmt::format("{}{}", shown.empty() ? "" : ", ", column_name(column));
+  for (auto &aggregate : select.aggregates)
+    shown += fmt::format("{}{}", shown.empty() ? "" : ", ",
+                         Automata::to_string(aggregate));
+  pipeline.operators.push_back({Kind::Project, shown, {}});
+
+  pipeline.operators.push_back(
+      {Kind::Output,
+       select.limit ? fmt::format("LIMIT {}", *select.limit) : "", {}});
+  return pipeline;
+}
+
+std::string to_string(const Pipeline &pipeline, bool analyzed) {
+  std::string written;
+  std::size_t depth = 0;
+  for (auto op = pipeline.operators.rbegin(); op != pipeline.operators.rend();
+       ++op, depth++) {
+    written += fmt::format("{}{}{}", std::string(depth * 2, ' '),
+                           depth == 0 ? "" : "-> ", to_string(op->kind));
+    if (!op->detail.empty())
+      written += " " + op->detail;
+    if (analyzed) {
+      auto &stats = op->stats;
+      written += fmt::format(
+          "  (time={:.3f} ms rows={} -> {} bytes={} allocs={})",
+          std::chrono::duration<double, std::milli>(stats.time).count(),
+          stats.rows_in, stats.rows_out, stats.bytes_read, stats.allocations);
+    }
+    written += "\n";
+  }
+  return written;
+}
+
+void count_allocation() { allocated++; }
+
+void count_allocations(std::size_t count) { allocated += count; }
+
+std::size_t allocations() { return allocated; }
+
+Step::Step(Pipeline &pipeline, Kind kind)
+    : op_(pipeline.find(kind)), start_(std::chrono::steady_clock::now()),
+      allocations_(allocations()) {}
+
+Step::~Step() {
+  if (op_ == nullptr)
+    return;
+  op_->stats.time += std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - start_);
+  op_->stats.allocations += allocations() - allocations_;
+}
+
+} // namespace Plan
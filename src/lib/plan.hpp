@@ -0,0 +1,95 @@
+#ifndef PLAN_HPP
+#define PLAN_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "analyzer/automata.hpp"
+
+// Physical plan of a SELECT: the operators its rows go through, from the
+// scan of the columns to the text sent back. EXPLAIN prints it and EXPLAIN
+// ANALYZE runs the query and prints what each operator took.
+namespace Plan {
+
+enum class Kind : std::uint8_t {
+  Scan,
+  Filter,
+  Join,
+  Aggregate,
+  Sort,
+  Project,
+  Output,
+};
+
+std::string to_string(Kind kind);
+
+// What an operator took, added up over every time it ran. Allocations are
+// those of the thread running the query and of the workers that took its
+// morsels.
+struct Stats {
+  std::chrono::nanoseconds time{0};
+  std::size_t rows_in = 0;
+  std::size_t rows_out = 0;
+  // Bytes of the columns it reads
+  std::size_t bytes_read = 0;
+  std::size_t allocations = 0;
+};
+
+struct Operator {
+  Kind kind;
+  // What it works on, as written in the query
+  std::string detail;
+  Stats stats;
+};
+
+// Operators in the order the rows go through them
+struct Pipeline {
+  std::vector<Operator> operators;
+
+  // Operator of `kind`, nullptr when the query needs none
+  Operator *find(Kind kind);
+};
+
+Pipeline build(const Automata::Show_Select &select);
+
+// Operators from the output down to the scan, one per line, with their
+// Stats when `analyzed`
+std::string to_string(const Pipeline &pipeline, bool analyzed);
+
+// `node` written back as a WHERE
+std::string to_string(const Automata::Predicate &node,
+                      const std::vector<Automata::Restriction> &restrictions);
+
+// Counts one allocation of the calling thread. Binaries call it from their
+// own operator new, toidb does; without it allocations stay at 0.
+void count_allocation();
+
+// Counts `count` allocations made for the calling thread by others, the
+// pool adds those of the workers once the morsels they took are done
+void count_allocations(std::size_t count);
+
+// Allocations the calling thread made so far
+std::size_t allocations();
+
+// Adds the wall time and the allocations of its thread from its
+// construction to its destruction to the operator of `kind`, if the
+// pipeline has it
+class Step {
+public:
+  Step(Pipeline &pipeline, Kind kind);
+  ~Step();
+
+  Step(const Step &) = delete;
+  Step &operator=(const Step &) = delete;
+
+private:
+  Operator *op_;
+  std::chrono::steady_clock::time_point start_;
+  std::size_t allocations_;
+};
+
+} // namespace Plan
+
+#endif // PLAN_HPP
@@ -0,0 +1,143 @@
+#include "pool.hpp"
+
+#include "plan.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Pool {
+
+namespace {
+
+class Workers {
+public:
+  explicit Workers(std::size_t count) {
+    for (std::size_t i = 0; i < count; i++)
+      threads_.emplace_back([this] { work(); });
+  }
+
+  ~Workers() {
+    {
+      std::lock_guard lock(mutex_);
+      stop_ = true;
+    }
+    ready_.notify_all();
+    for (auto &thread : threads_)
+      thread.join();
+  }
+
+  void submit(std::function<void()> job) {
+    {
+      std::lock_guard lock(mutex_);
+      jobs_.push_back(std::move(job));
+    }
+    ready_.notify_one();
+  }
+
+  [[nodiscard]] std::size_t size() const { return threads_.size(); }
+
+private:
+  void work() {
+    for (;;) {
+      std::function<void()> job;
+      {
+        std::unique_lock lock(mutex_);
+        ready_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty())
+          return;
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::function<void()>> jobs_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+std::size_t worker_count() {
+  std::size_t workers = Options::global().workers;
+  if (workers == 0)
+    workers = std::thread::hardware_concurrency();
+  return std::max<std::size_t>(workers, 1);
+}
+
+// Started on first use, with the options set by then
+Workers &workers() {
+  static Workers pool(worker_count());
+  return pool;
+}
+
+// Tasks of one `run`. Helpers that start once every task was taken only
+// look at `next`, so the state outlives the call but `f` does not need to.
+struct Batch {
+  std::atomic<std::size_t> next{0};
+  std::size_t tasks = 0;
+  const std::function<void(std::size_t)> *f = nullptr;
+
+  std::mutex mutex;
+  std::condition_variable finished;
+  std::size_t done = 0;
+  // Made by the workers, counted for the calling thread once all tasks ran
+  std::size_t allocations = 0;
+
+  void drain(bool helping) {
+    std::size_t before = Plan::allocations();
+    std::size_t ran = 0;
+    for (std::size_t task; (task = next.fetch_add(1)) < tasks; ran++)
+      (*f)(task);
+    if (ran == 0)
+      return;
+    std::size_t allocated = Plan::allocations() - before;
+    std::lock_guard lock(mutex);
+    done += ran;
+    if (helping)
+      allocations += allocated;
+    if (done == tasks)
+      finished.notify_all();
+  }
+};
+
+} // namespace
+
+Options &Options::global() {
+  static Options options;
+  return options;
+}
+
+std::size_t degree() {
+  std::size_t degree = Options::global().degree;
+  return degree == 0 ? worker_count() : degree;
+}
+
+void run(std::size_t tasks, std::size_t threads,
+         const std::function<void(std::size_t)> &f) {
+  threads = std::min(threads, tasks);
+  if (threads <= 1) {
+    for (std::size_t task = 0; task < tasks; task++)
+      f(task);
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  batch->tasks = tasks;
+  batch->f = &f;
+  for (std::size_t helper = 1; helper < threads; helper++)
+    workers().submit([batch] { batch->drain(true); });
+  batch->drain(false);
+
+  std::unique_lock lock(batch->mutex);
+  batch->finished.wait(lock, [&] { return batch->done == batch->tasks; });
+  Plan::count_allocations(batch->allocations);
+}
+
+} // namespace Pool
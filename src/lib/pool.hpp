@@ -0,0 +1,55 @@
+#ifndef POOL_HPP
+#define POOL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include "bitmap.hpp"
+
+// Worker threads shared by every query. A scan is cut in morsels of a fixed
+// number of rows and the threads of a query take the next morsel left until
+// there are none, so a slow morsel does not hold the others back. The thread
+// that runs the query takes morsels too, and each query uses at most
+// `Options::degree` threads so a heavy scan leaves room for inserts.
+namespace Pool {
+
+// Rows of a morsel, whole words so morsels never write the same word of a
+// selection bitmap
+constexpr std::size_t MORSEL_ROWS = std::size_t{1} << 16;
+
+struct Options {
+  // Worker threads, 0 for one per core
+  std::size_t workers = 0;
+  // Most threads a query scans with, its own included, 0 for as many as
+  // there are workers
+  std::size_t degree = 0;
+
+  // Options used by every query, set once at startup
+  static Options &global();
+};
+
+// Threads a query may use
+std::size_t degree();
+
+// Calls `f(task)` for every task in [0, tasks) on up to `threads` threads,
+// the calling one among them, and returns once all of them ran
+void run(std::size_t tasks, std::size_t threads,
+         const std::function<void(std::size_t)> &f);
+
+inline std::size_t morsels(std::size_t rows) {
+  return (rows + MORSEL_ROWS - 1) / MORSEL_ROWS;
+}
+
+// Calls `f(morsel, from, to)` for the morsels covering [0, rows), results
+// kept per morsel merge in order
+template <typename F> void for_each_morsel(std::size_t rows, F &&f) {
+  run(morsels(rows), degree(), [&](std::size_t morsel) {
+    std::size_t from = morsel * MORSEL_ROWS;
+    f(morsel, from, std::min(from + MORSEL_ROWS, rows));
+  });
+}
+
+} // namespace Pool
+
+#endif // POOL_HPP
@@ -0,0 +1,493 @@
+#include "rangeIndex.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fmt/core.h>
+#include <mutex>
+
+#include "codec.hpp"
+#include "fm.hpp"
+
+namespace {
+
+constexpr std::uint8_t MAGIC[4] = {'T', 'B', 'P', 'T'};
+
+constexpr std::size_t NODE_HEADER_SIZE = 8;
+constexpr std::size_t ENTRY_SIZE = 16;
+constexpr std::size_t LEAF_CAPACITY =
+    (RangeIndex::PAGE_SIZE - NODE_HEADER_SIZE) / ENTRY_SIZE;
+// Children of an inner node, one more than its separators
+constexpr std::size_t INNER_CAPACITY =
+    (RangeIndex::PAGE_SIZE - NODE_HEADER_SIZE + ENTRY_SIZE) /
+    (ENTRY_SIZE + sizeof(std::uint32_t));
+constexpr std::size_t CHILDREN_AT =
+    NODE_HEADER_SIZE + (INNER_CAPACITY - 1) * ENTRY_SIZE;
+
+// Accessors over the bytes of a node page
+bool is_leaf(const std::uint8_t *page) { return page[0] != 0; }
+
+std::size_t count(const std::uint8_t *page) {
+  return Codec::load<std::uint16_t>(page + 2);
+}
+
+void set_count(std::uint8_t *page, std::size_t count) {
+  Codec::store(static_cast<std::uint16_t>(count), page + 2);
+}
+
+std::uint32_t next_leaf(const std::uint8_t *page) {
+  return Codec::load<std::uint32_t>(page + 4);
+}
+
+void set_next_leaf(std::uint8_t *page, std::uint32_t next) {
+  Codec::store(next, page + 4);
+}
+
+template <typename Entry> Entry entry(const std::uint8_t *page, std::size_t i) {
+  const std::uint8_t *at = page + NODE_HEADER_SIZE + i * ENTRY_SIZE;
+  return {Codec::load<std::uint64_t>(at), Codec::load<std::uint64_t>(at + 8)};
+}
+
+template <typename Entry>
+void set_entry(std::uint8_t *page, std::size_t i, const Entry &entry) {
+  std::uint8_t *at = page + NODE_HEADER_SIZE + i * ENTRY_SIZE;
+  Codec::store(entry.key, at);
+  Codec::store(entry.row, at + 8);
+}
+
+std::uint32_t child(const std::uint8_t *page, std::size_t i) {
+  return Codec::load<std::uint32_t>(page + CHILDREN_AT + i * 4);
+}
+
+void set_child(std::uint8_t *page, std::size_t i, std::uint32_t child) {
+  Codec::store(child, page + CHILDREN_AT + i * 4);
+}
+
+// First of the `count` entries of a node not less than `target` (`upper`:
+// greater than it), by binary search over the page
+template <typename Entry>
+std::size_t search(const std::uint8_t *page, std::size_t count,
+                   const Entry &target, bool upper) {
+  std::size_t low = 0;
+  std::size_t high = count;
+  while (low < high) {
+    std::size_t middle = (low + high) / 2;
+    auto at = entry<Entry>(page, middle);
+    if (upper ? !(target < at) : at < target)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  return low;
+}
+
+} // namespace
+
+std::string RangeIndex::path_for(const std::string &column_path) {
+  return IndexFile::path_for(column_path, "bpt");
+}
+
+bool RangeIndex::supports(ColumnType type) {
+  switch (type) {
+  case ColumnType::u8:
+  case ColumnType::u16:
+  case ColumnType::u32:
+  case ColumnType::u64:
+  case ColumnType::i8:
+  case ColumnType::i16:
+  case ColumnType::i32:
+  case ColumnType::i64:
+  case ColumnType::f64:
+    return true;
+  default:
+    return false;
+  }
+}
+
+std::optional<std::pair<std::uint64_t, std::uint64_t>>
+RangeIndex::bounds(Parser::OperatorE op, std::uint64_t key) {
+  constexpr auto last = std::numeric_limits<std::uint64_t>::max();
+  std::pair<std::uint64_t, std::uint64_t> none{1, 0};
+  switch (op) {
+  case Parser::OperatorE::EQUAL:
+    return std::pair{key, key};
+  case Parser::OperatorE::GREAT:
+    return key == last ? none : std::pair{key + 1, last};
+  case Parser::OperatorE::GREAT_EQUAL:
+    return std::pair{key, last};
+  case Parser::OperatorE::LESS:
+    return key == 0 ? none : std::pair<std::uint64_t, std::uint64_t>{0, key - 1};
+  case Parser::OperatorE::LESS_EQUAL:
+    return std::pair<std::uint64_t, std::uint64_t>{0, key};
+  default:
+    return std::nullopt;
+  }
+}
+
+cpp::result<std::shared_ptr<RangeIndex>, std::string>
+RangeIndex::build(const std::string &path, ColumnType type, std::uint64_t rows,
+                  const KeyAt &key_at) {
+  if (!supports(type))
+    return cpp::fail(fmt::format("Columns of type {} cannot be indexed",
+                                 to_string(type)));
+
+  std::shared_ptr<RangeIndex> index(new RangeIndex(path, type));
+  index->reset();
+  auto written = index->write_all();
+  if (written.has_error())
+    return cpp::fail(written.error());
+  auto extended = index->extend(rows, key_at);
+  if (extended.has_error())
+    return cpp::fail(extended.error());
+  return index;
+}
+
+cpp::result<std::shared_ptr<RangeIndex>, std::string>
+RangeIndex::open(const std::string &path, ColumnType type) {
+  std::shared_ptr<RangeIndex> index(new RangeIndex(path, type));
+  auto contents = FileManager::read_to_vec(path);
+
+  bool usable = contents.size() >= 2 * PAGE_SIZE &&
+                contents.size() % PAGE_SIZE == 0 &&
+                std::memcmp(contents.data(), MAGIC, sizeof(MAGIC)) == 0 &&
+                Codec::load<std::uint16_t>(contents.data() + 4) == VERSION &&
+                Codec::load<std::uint16_t>(contents.data() + 6) == type;
+  if (usable) {
+    const std::uint8_t *header = contents.data();
+    index->root_ = Codec::load<std::uint32_t>(header + 8);
+    auto pages = Codec::load<std::uint32_t>(header + 12);
+    index->height_ = Codec::load<std::uint32_t>(header + 16);
+    index->rows_.reset(Codec::load<std::uint64_t>(header + 20));
+    index->entries_ = Codec::load<std::uint64_t>(header + 28);
+    usable = pages == contents.size() / PAGE_SIZE && index->root_ > 0 &&
+             index->root_ < pages && index->height_ > 0 && header[36] == 0;
+  }
+
+  if (usable) {
+    index->pages_.resize(contents.size() / PAGE_SIZE);
+    for (std::size_t page = 0; page < index->pages_.size(); page++)
+      std::memcpy(index->pages_[page].data(),
+                  contents.data() + page * PAGE_SIZE, PAGE_SIZE);
+  } else {
+    index->reset();
+  }
+
+  index->file_ = IndexFile::open(path, usable);
+  if (index->file_ == nullptr)
+    return cpp::fail(fmt::format("Failed to open the index {}", path));
+  if (!usable) {
+    auto written = index->write_all();
+    if (written.has_error())
+      return cpp::fail(written.error());
+  }
+  return index;
+}
+
+RangeIndex::~RangeIndex() {
+  if (file_ != nullptr)
+    std::fclose(file_);
+}
+
+void RangeIndex::reset() {
+  pages_.clear();
+  pages_.emplace_back();
+  dirty_.clear();
+  root_ = allocate(true);
+  height_ = 1;
+  rows_.reset();
+  entries_ = 0;
+}
+
+std::uint32_t RangeIndex::allocate(bool leaf) {
+  auto page = static_cast<std::uint32_t>(pages_.size());
+  pages_.emplace_back().fill(0);
+  pages_.back()[0] = leaf ? 1 : 0;
+  dirty_.push_back(page);
+  return page;
+}
+
+std::optional<std::pair<RangeIndex::Entry, std::uint32_t>>
+RangeIndex::insert(std::uint32_t page, const Entry &entry, bool &added) {
+  std::uint8_t *node = pages_[page].data();
+  std::size_t filled = count(node);
+
+  if (is_leaf(node)) {
+    std::size_t at = search(node, filled, entry, false);
+    if (at < filled && ::entry<Entry>(node, at) == entry) {
+      added = false;
+      return std::nullopt;
+    }
+    added = true;
+    dirty_.push_back(page);
+
+    if (filled < LEAF_CAPACITY) {
+      std::memmove(node + NODE_HEADER_SIZE + (at + 1) * ENTRY_SIZE,
+                   node + NODE_HEADER_SIZE + at * ENTRY_SIZE,
+                   (filled - at) * ENTRY_SIZE);
+      set_entry(node, at, entry);
+      set_count(node, filled + 1);
+      return std::nullopt;
+    }
+
+    std::vector<Entry> all;
+    all.reserve(filled + 1);
+    for (std::size_t i = 0; i < filled; i++)
+      all.push_back(::entry<Entry>(node, i));
+    all.insert(all.begin() + static_cast<std::ptrdiff_t>(at), entry);
+
+    // Appending past the last entry keeps the leaf full, rows inserted in
+    // key order then fill every leaf instead of half of them
+    std::size_t keep = at == filled ? filled : all.size() / 2;
+    std::uint32_t right = allocate(true);
+    node = pages_[page].data();
+    std::uint8_t *sibling = pages_[right].data();
+    for (std::size_t i = 0; i < keep; i++)
+      set_entry(node, i, all[i]);
+    for (std::size_t i = keep; i < all.size(); i++)
+      set_entry(sibling, i - keep, all[i]);
+    set_count(node, keep);
+    set_count(sibling, all.size() - keep);
+    set_next_leaf(sibling, next_leaf(node));
+    set_next_leaf(node, right);
+    return std::pair{all[keep], right};
+  }
+
+  std::size_t at = search(node, filled - 1, entry, true);
+  auto split = insert(child(node, at), entry, added);
+  if (!split)
+    return std::nullopt;
+
+  node = pages_[page].data();
+  dirty_.push_back(page);
+  std::vector<Entry> separators;
+  std::vector<std::uint32_t> children;
+  for (std::size_t i = 0; i + 1 < filled; i++)
+    separators.push_back(::entry<Entry>(node, i));
+  for (std::size_t i = 0; i < filled; i++)
+    children.push_back(child(node, i));
+  separators.insert(separators.begin() + static_cast<std::ptrdiff_t>(at),
+                    split->first);
+  children.insert(children.begin() + static_cast<std::ptrdiff_t>(at) + 1,
+                  split->second);
+
+  auto fill = [](std::uint8_t *node, const Entry *separators,
+                 const std::uint32_t *children, std::size_t count) {
+    for (std::size_t i = 0; i + 1 < count; i++)
+      set_entry(node, i, separators[i]);
+    for (std::size_t i = 0; i < count; i++)
+      set_child(node, i, children[i]);
+    set_count(node, count);
+  };
+  if (children.size() <= INNER_CAPACITY) {
+    fill(node, separators.data(), children.data(), children.size());
+    return std::nullopt;
+  }
+
+  // The separator between the halves moves up to the parent
+  std::size_t keep = children.size() / 2;
+  std::uint32_t right = allocate(false);
+  fill(pages_[page].data(), separators.data(), children.data(), keep);
+  fill(pages_[right].data(), separators.data() + keep, children.data() + keep,
+       children.size() - keep);
+  return std::pair{separators[keep - 1], right};
+}
+
+void RangeIndex::load_sorted(const std::vector<Entry> &entries) {
+  std::uint64_t rows = rows_.rows();
+  reset();
+  rows_.reset(rows);
+  entries_ = entries.size();
+
+  // Full leaves, chained in order
+  std::vector<std::pair<Entry, std::uint32_t>> level;
+  std::uint32_t leaf = root_;
+  for (std::size_t from = 0; from < entries.size(); from += LEAF_CAPACITY) {
+    if (from > 0) {
+      std::uint32_t next = allocate(true);
+      set_next_leaf(pages_[leaf].data(), next);
+      leaf = next;
+    }
+    std::size_t filled = std::min(LEAF_CAPACITY, entries.size() - from);
+    for (std::size_t i = 0; i < filled; i++)
+      set_entry(pages_[leaf].data(), i, entries[from + i]);
+    set_count(pages_[leaf].data(), filled);
+    level.emplace_back(entries[from], leaf);
+  }
+
+  // Then full inner nodes over each level until one node is left
+  while (level.size() > 1) {
+    std::vector<std::pair<Entry, std::uint32_t>> parents;
+    for (std::size_t from = 0; from < level.size(); from += INNER_CAPACITY) {
+      std::uint32_t parent = allocate(false);
+      std::uint8_t *node = pages_[parent].data();
+      std::size_t filled = std::min(INNER_CAPACITY, level.size() - from);
+      for (std::size_t i = 0; i < filled; i++) {
+        set_child(node, i, level[from + i].second);
+        if (i > 0)
+          set_entry(node, i - 1, level[from + i].first);
+      }
+      set_count(node, filled);
+      parents.emplace_back(level[from].first, parent);
+    }
+    level = std::move(parents);
+    height_++;
+  }
+  if (!level.empty())
+    root_ = level.front().second;
+}
+
+void RangeIndex::put(std::uint64_t row, std::optional<std::uint64_t> key) {
+  if (key) {
+    bool added = false;
+    auto split = insert(root_, Entry{*key, row}, added);
+    if (split) {
+      std::uint32_t old = root_;
+      root_ = allocate(false);
+      std::uint8_t *node = pages_[root_].data();
+      set_child(node, 0, old);
+      set_child(node, 1, split->second);
+      set_entry(node, 0, split->first);
+      set_count(node, 2);
+      height_++;
+    }
+    if (added)
+      entries_++;
+  }
+  rows_.advance(row);
+}
+
+cpp::result<void, std::string>
+RangeIndex::add(std::uint64_t row, std::optional<std::uint64_t> key) {
+  std::unique_lock lock(mtx_);
+  put(row, key);
+  return write_dirty();
+}
+
+cpp::result<void, std::string> RangeIndex::extend(std::uint64_t rows,
+                                                  const KeyAt &key_at) {
+  std::unique_lock lock(mtx_);
+  if (rows_.rows() >= rows)
+    return {};
+
+  // An empty index is filled bottom up in one go
+  if (entries_ == 0 && !rows_.ahead()) {
+    std::vector<Entry> entries;
+    entries.reserve(rows - rows_.rows());
+    for (std::uint64_t row = rows_.rows(); row < rows; row++) {
+      if (auto key = key_at(row))
+        entries.push_back({*key, row});
+    }
+    std::sort(entries.begin(), entries.end());
+    rows_.reset(rows);
+    load_sorted(entries);
+    return write_all();
+  }
+
+  for (std::uint64_t row = rows_.rows(); row < rows; row++)
+    put(row, key_at(row));
+  return write_dirty();
+}
+
+std::optional<std::vector<std::uint64_t>>
+RangeIndex::range(std::uint64_t low, std::uint64_t high,
+                  std::size_t limit) const {
+  std::vector<std::uint64_t> rows;
+  if (low > high)
+    return rows;
+
+  std::shared_lock lock(mtx_);
+  Entry first{low, 0};
+  std::uint32_t page = root_;
+  while (!is_leaf(pages_[page].data())) {
+    const std::uint8_t *node = pages_[page].data();
+    page = child(node, search(node, count(node) - 1, first, true));
+  }
+
+  std::size_t at = search(pages_[page].data(), count(pages_[page].data()),
+                          first, false);
+  while (page != 0) {
+    const std::uint8_t *leaf = pages_[page].data();
+    for (std::size_t filled = count(leaf); at < filled; at++) {
+      auto found = entry<Entry>(leaf, at);
+      if (found.key > high)
+        return rows;
+      if (rows.size() == limit)
+        return std::nullopt;
+      rows.push_back(found.row);
+    }
+    page = next_leaf(leaf);
+    at = 0;
+  }
+  return rows;
+}
+
+std::uint64_t RangeIndex::rows() const {
+  std::shared_lock lock(mtx_);
+  return rows_.rows();
+}
+
+std::uint64_t RangeIndex::size() const {
+  std::shared_lock lock(mtx_);
+  return entries_;
+}
+
+std::uint32_t RangeIndex::height() const {
+  std::shared_lock lock(mtx_);
+  return height_;
+}
+
+RangeIndex::Page RangeIndex::encode_header(bool unclean) const {
+  Page header{};
+  std::memcpy(header.data(), MAGIC, sizeof(MAGIC));
+  Codec::store(VERSION, header.data() + 4);
+  Codec::store(static_cast<std::uint16_t>(type_), header.data() + 6);
+  Codec::store(root_, header.data() + 8);
+  Codec::store(static_cast<std::uint32_t>(pages_.size()), header.data() + 12);
+  Codec::store(height_, header.data() + 16);
+  Codec::store(rows_.rows(), header.data() + 20);
+  Codec::store(entries_, header.data() + 28);
+  header[36] = unclean ? 1 : 0;
+  return header;
+}
+
+cpp::result<void, std::string> RangeIndex::write_dirty() {
+  if (file_ == nullptr)
+    return {};
+  std::sort(dirty_.begin(), dirty_.end());
+  dirty_.erase(std::unique(dirty_.begin(), dirty_.end()), dirty_.end());
+
+  auto write_header = [&](bool unclean) {
+    auto header = encode_header(unclean);
+    return std::fseek(file_, 0, SEEK_SET) == 0 &&
+           std::fwrite(header.data(), 1, PAGE_SIZE, file_) == PAGE_SIZE &&
+           std::fflush(file_) == 0;
+  };
+
+  // A node rewritten before the pages it now points to would be followed
+  // out of the file, the header says so until every page is written. New
+  // pages land before the header that counts them.
+  bool ok = dirty_.empty() || write_header(true);
+  for (std::uint32_t page : dirty_)
+    ok = ok &&
+         std::fseek(file_, static_cast<long>(page * PAGE_SIZE), SEEK_SET) == 0 &&
+         std::fwrite(pages_[page].data(), 1, PAGE_SIZE, file_) == PAGE_SIZE;
+  ok = ok && write_header(false);
+  // Pages that failed are written again along with the next ones
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to write the index {}", path_));
+  dirty_.clear();
+  return {};
+}
+
+cpp::result<void, std::string> RangeIndex::write_all() {
+  if (file_ == nullptr) {
+    file_ = std::fopen(path_.c_str(), "w+b");
+    if (file_ == nullptr)
+      return cpp::fail(fmt::format("Failed to create the index {}", path_));
+  }
+  dirty_.clear();
+  for (std::uint32_t page = 1; page < pages_.size(); page++)
+    dirty_.push_back(page);
+  if (!FileManager::resize_file(path_, pages_.size() * PAGE_SIZE))
+    return cpp::fail(fmt::format("Failed to write the index {}", path_));
+  return write_dirty();
+}
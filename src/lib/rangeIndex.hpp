@@ -0,0 +1,178 @@
+#ifndef RANGEINDEX_HPP
+#define RANGEINDEX_HPP
+
+#include <array>
+#include <bit>
+#include <compare>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <result.hpp>
+#include <shared_mutex>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "analyzer/parser.hpp"
+#include "indexFile.hpp"
+#include "serializer.hpp"
+
+// Secondary index of a numeric column made with `CREATE INDEX`, a B+tree
+// kept at `<col>.bpt` next to the column. Entries are (key, row) pairs in
+// key and then row order, so every entry is distinct and a range of keys
+// gives its rows in key order. Keys are the values widened to 64 bits in a
+// way that keeps their order: signed integers get their sign bit flipped
+// and doubles are mapped the way of the IEEE total order.
+//
+// The file is made of PAGE_SIZE pages, all of them little endian. Page 0
+// is the header
+//   "TBPT", u16 version, u16 column type, u32 root, u32 pages, u32 height,
+//   u64 rows, u64 entries, u8 unclean
+// and every other page a node
+//   u8 leaf, u8 unused, u16 count, u32 next leaf
+// followed by the (u64 key, u64 row) entries of a leaf, or by the
+// separators and then the u32 children of an inner node. The separator
+// before a child is the first entry under it.
+//
+// `rows` is how many leading rows of the column the index holds. Inserts
+// write their pages without waiting for them, the index can always be
+// caught up from its column: rows past `rows` are added before it answers
+// (see `extend`), and a file that does not add up or holds more rows than
+// its column (see DatabaseTable::index_for) is started over. Nodes are
+// written over in place, so `unclean` is set in the header while they are;
+// a file found with it set may hold half a split and starts over too.
+class RangeIndex {
+public:
+  static constexpr std::size_t PAGE_SIZE = 4096;
+  static constexpr std::uint16_t VERSION = 2;
+  // A range keeping more than one row in SELECTIVITY is cheaper to scan
+  // for, its rows are spread all over the column
+  static constexpr std::size_t SELECTIVITY = 8;
+
+  // Key of a row, nothing for a null
+  using KeyAt = std::function<std::optional<std::uint64_t>(std::uint64_t)>;
+
+  static std::string path_for(const std::string &column_path);
+
+  // Whether columns of `type` can be indexed
+  static bool supports(ColumnType type);
+
+  // Key of a value, nothing for a NaN since no range holds it
+  template <typename T> static std::optional<std::uint64_t> key_of(T value) {
+    if constexpr (std::is_floating_point_v<T>) {
+      if (value != value)
+        return std::nullopt;
+      // -0 and 0 are equal, they get the same key
+      auto bits = std::bit_cast<std::uint64_t>(static_cast<double>(value) + 0.0);
+      return (bits & SIGN) != 0 ? ~bits : bits | SIGN;
+    } else if constexpr (std::is_signed_v<T>) {
+      return static_cast<std::uint64_t>(static_cast<std::int64_t>(value)) ^
+             SIGN;
+    } else {
+      return static_cast<std::uint64_t>(value);
+    }
+  }
+
+  // Keys in [first, second] of the values `<op> key` accepts, first past
+  // second when none does. Nothing for `!=`, which is no range.
+  static std::optional<std::pair<std::uint64_t, std::uint64_t>>
+  bounds(Parser::OperatorE op, std::uint64_t key);
+
+  // Writes a new index of the first `rows` rows of a column of `type` at
+  // `path`, replacing whatever was there
+  static cpp::result<std::shared_ptr<RangeIndex>, std::string>
+  build(const std::string &path, ColumnType type, std::uint64_t rows,
+        const KeyAt &key_at);
+
+  // Reads the index at `path`. One whose pages do not add up comes back
+  // empty, to be built again by `extend`.
+  static cpp::result<std::shared_ptr<RangeIndex>, std::string>
+  open(const std::string &path, ColumnType type);
+
+  RangeIndex(const RangeIndex &) = delete;
+  RangeIndex &operator=(const RangeIndex &) = delete;
+
+  ~RangeIndex();
+
+  // Adds `row` under `key`, nothing adds a null. Rows may come in any
+  // order, and again: a row already there is left alone.
+  cpp::result<void, std::string> add(std::uint64_t row,
+                                     std::optional<std::uint64_t> key);
+
+  // Adds every row before `rows` the index does not hold yet
+  cpp::result<void, std::string> extend(std::uint64_t rows,
+                                        const KeyAt &key_at);
+
+  // Rows with a key in [low, high] in key order, rows of a key in row
+  // order. Nothing as soon as more than `limit` match.
+  [[nodiscard]] std::optional<std::vector<std::uint64_t>>
+  range(std::uint64_t low, std::uint64_t high,
+        std::size_t limit = std::numeric_limits<std::size_t>::max()) const;
+
+  // Leading rows of the column the index holds
+  [[nodiscard]] std::uint64_t rows() const;
+
+  // Entries, null rows have none
+  [[nodiscard]] std::uint64_t size() const;
+
+  // Levels of nodes from the root down to the leaves
+  [[nodiscard]] std::uint32_t height() const;
+
+private:
+  static constexpr std::uint64_t SIGN = std::uint64_t{1} << 63;
+
+  struct Entry {
+    std::uint64_t key;
+    std::uint64_t row;
+
+    auto operator<=>(const Entry &) const = default;
+  };
+
+  using Page = std::array<std::uint8_t, PAGE_SIZE>;
+
+  RangeIndex(std::string path, ColumnType type)
+      : path_(std::move(path)), type_(type) {}
+
+  // Empties the tree down to a single empty leaf
+  void reset();
+
+  std::uint32_t allocate(bool leaf);
+
+  // Adds `entry` under `page`. A node that split returns the first entry
+  // and the page of its new right half.
+  std::optional<std::pair<Entry, std::uint32_t>>
+  insert(std::uint32_t page, const Entry &entry, bool &added);
+
+  // Fills the tree bottom up from entries in order
+  void load_sorted(const std::vector<Entry> &entries);
+
+  // Adds an entry without writing it, `mtx_` held
+  void put(std::uint64_t row, std::optional<std::uint64_t> key);
+
+  // Writes the pages changed since the last write and then the header
+  cpp::result<void, std::string> write_dirty();
+
+  cpp::result<void, std::string> write_all();
+
+  [[nodiscard]] Page encode_header(bool unclean) const;
+
+  std::string path_;
+  ColumnType type_;
+  std::FILE *file_ = nullptr;
+
+  mutable std::shared_mutex mtx_;
+  // Pages stay in place as the tree grows, page 0 is the header
+  std::deque<Page> pages_;
+  std::vector<std::uint32_t> dirty_;
+  std::uint32_t root_ = 0;
+  std::uint32_t height_ = 0;
+  IndexFile::Watermark rows_;
+  std::uint64_t entries_ = 0;
+};
+
+#endif // RANGEINDEX_HPP
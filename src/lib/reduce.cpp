@@ -0,0 +1,96 @@
+#include "reduce.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#include "bitmap.hpp"
+
+namespace Reduce {
+
+// Sum of a block of 64 values. Narrow integers add up in 64 bits without
+// overflowing, 64 bit ones are split in their high and low 32 bits so each
+// half does too. Doubles keep four partial sums so the adds do not wait on
+// each other.
+template <typename T> static Total<T> block_sum(const T *at) {
+  if constexpr (std::is_floating_point_v<T>) {
+    double part[4] = {0, 0, 0, 0};
+    for (std::size_t j = 0; j < Bitmap::WORD_BITS; j += 4) {
+      for (std::size_t k = 0; k < 4; k++)
+        part[k] += at[j + k];
+    }
+    return (part[0] + part[1]) + (part[2] + part[3]);
+  } else if constexpr (sizeof(T) == 8) {
+    using High = std::conditional_t<std::is_signed_v<T>, std::int64_t,
+                                    std::uint64_t>;
+    High high = 0;
+    std::uint64_t low = 0;
+    for (std::size_t j = 0; j < Bitmap::WORD_BITS; j++) {
+      high += static_cast<High>(at[j] >> 32);
+      low += static_cast<std::uint32_t>(at[j]);
+    }
+    return static_cast<Total<T>>(high) * (Total<T>{1} << 32) + low;
+  } else {
+    using Wide = std::conditional_t<std::is_signed_v<T>, std::int64_t,
+                                    std::uint64_t>;
+    Wide sum = 0;
+    for (std::size_t j = 0; j < Bitmap::WORD_BITS; j++)
+      sum += at[j];
+    return sum;
+  }
+}
+
+template <typename T>
+Summary<T> summarize(const T *values, std::size_t from, std::size_t to,
+                     const std::vector<std::uint64_t> &selected) {
+  Summary<T> summary;
+  std::size_t words = std::min(selected.size(), Bitmap::words_for(to));
+  for (std::size_t w = from / Bitmap::WORD_BITS; w < words; w++) {
+    std::uint64_t bits = selected[w];
+    if (w + 1 == Bitmap::words_for(to))
+      bits &= Bitmap::tail_mask(to);
+    if (bits == 0)
+      continue;
+
+    const T *at = values + w * Bitmap::WORD_BITS;
+    if (bits == ~std::uint64_t{0}) {
+      T lo = at[0];
+      T hi = at[0];
+      for (std::size_t j = 1; j < Bitmap::WORD_BITS; j++) {
+        lo = std::min(lo, at[j]);
+        hi = std::max(hi, at[j]);
+      }
+      summary.count += Bitmap::WORD_BITS;
+      summary.sum += block_sum(at);
+      summary.min = std::min(summary.min, lo);
+      summary.max = std::max(summary.max, hi);
+      continue;
+    }
+
+    summary.count += std::popcount(bits);
+    for (; bits != 0; bits &= bits - 1) {
+      T value = at[std::countr_zero(bits)];
+      summary.sum += value;
+      summary.min = std::min(summary.min, value);
+      summary.max = std::max(summary.max, value);
+    }
+  }
+  return summary;
+}
+
+#define INSTANTIATE(T)                                                         \
+  template Summary<T> summarize<T>(const T *, std::size_t, std::size_t,        \
+                                   const std::vector<std::uint64_t> &);
+
+INSTANTIATE(std::uint8_t)
+INSTANTIATE(std::uint16_t)
+INSTANTIATE(std::uint32_t)
+INSTANTIATE(std::uint64_t)
+INSTANTIATE(std::int8_t)
+INSTANTIATE(std::int16_t)
+INSTANTIATE(std::int32_t)
+INSTANTIATE(std::int64_t)
+INSTANTIATE(double)
+
+#undef INSTANTIATE
+
+} // namespace Reduce
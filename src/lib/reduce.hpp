@@ -0,0 +1,53 @@
+#ifndef REDUCE_HPP
+#define REDUCE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// Count, sum, min and max of the selected rows of a typed column, in one
+// pass. Words of 64 selected rows are reduced as a block by loops the
+// compiler unrolls and vectorizes, other words go a set bit at a time and
+// empty ones are skipped.
+namespace Reduce {
+
+// Sums of integers are kept exact, 64 bit columns included
+template <typename T>
+using Total = std::conditional_t<
+    std::is_floating_point_v<T>, double,
+    std::conditional_t<std::is_signed_v<T>, __int128, unsigned __int128>>;
+
+template <typename T> struct Summary {
+  std::size_t count = 0;
+  Total<T> sum = 0;
+  T min = std::numeric_limits<T>::max();
+  T max = std::numeric_limits<T>::lowest();
+};
+
+// Summary of the rows in [from, to) whose bit is set in `selected`, `from`
+// is the start of a word.
+// Instantiated for every integer type and double.
+template <typename T>
+Summary<T> summarize(const T *values, std::size_t from, std::size_t to,
+                     const std::vector<std::uint64_t> &selected);
+
+// Summary of the rows below `rows` whose bit is set in `selected`
+template <typename T>
+Summary<T> summarize(const T *values, std::size_t rows,
+                     const std::vector<std::uint64_t> &selected) {
+  return summarize(values, 0, rows, selected);
+}
+
+// Adds the rows of `part` to `into`
+template <typename T> void merge(Summary<T> &into, const Summary<T> &part) {
+  into.count += part.count;
+  into.sum += part.sum;
+  into.min = std::min(into.min, part.min);
+  into.max = std::max(into.max, part.max);
+}
+
+} // namespace Reduce
+
+#endif // REDUCE_HPP
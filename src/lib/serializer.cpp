@@ -26,6 +26,10 @@ std::string to_string(ColumnType type) {
     return "str";
   case ColumnType::rbool:
     return "bool";
+  case ColumnType::dstr:
+    return "dstr";
+  case ColumnType::vstr:
+    return "vstr";
   }
 
   throw std::runtime_error("Invalid column type");
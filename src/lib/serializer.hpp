@@ -16,7 +16,12 @@ enum ColumnType {
   f32 = 7,
   f64 = 8,
   str = 9,
-  rbool = 12
+  rbool = 12,
+  // Strings stored as u32 codes into a per column dictionary
+  dstr = 13,
+  // Strings of any length up to the declared size: end offsets in the
+  // column file and the bytes in a heap file next to it
+  vstr = 14
 };
 
 std::string to_string(ColumnType type);
@@ -54,6 +59,10 @@ struct Layout {
       return Layout{.size = 8, .optional = false, .type = ColumnType::f64};
     case Parser::TypeE::STR:
       return Layout{.size = 0, .optional = false, .type = ColumnType::str};
+    case Parser::TypeE::DSTR:
+      return Layout{.size = 0, .optional = false, .type = ColumnType::dstr};
+    case Parser::TypeE::VSTR:
+      return Layout{.size = 0, .optional = false, .type = ColumnType::vstr};
     case Parser::TypeE::BOOL:
       return Layout{.size = 1, .optional = false, .type = ColumnType::rbool};
     default:
@@ -94,7 +103,7 @@ extern "C" DynArray su8(uint8_t);
 extern "C" uint8_t du8(uint8_t *, uint64_t);
 
 extern "C" DynArray si64(int64_t);
-extern "C" int32_t di64(uint8_t *, uint64_t);
+extern "C" int64_t di64(uint8_t *, uint64_t);
 extern "C" DynArray si32(int32_t);
 extern "C" int32_t di32(uint8_t *, uint64_t);
 extern "C" DynArray si16(int16_t);
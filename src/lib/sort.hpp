@@ -0,0 +1,44 @@
+#ifndef SORT_HPP
+#define SORT_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+// Ordering of row (or group) ids for ORDER BY and LIMIT
+namespace Sort {
+
+// The ids `each(f)` passes to `f`, in the order of `less`, at most `limit`
+// of them. With a limit only the best `limit` ids seen so far are kept, in
+// a heap whose top is the worst of them, so the rest is never sorted.
+// `less` has to be a strict total order, ties broken by id.
+template <typename Each, typename Less>
+std::vector<std::size_t> top(Each &&each, std::optional<std::uint64_t> limit,
+                             Less &&less) {
+  std::vector<std::size_t> kept;
+  if (!limit) {
+    each([&](std::size_t id) { kept.push_back(id); });
+    std::sort(kept.begin(), kept.end(), less);
+    return kept;
+  }
+  if (*limit == 0)
+    return kept;
+
+  each([&](std::size_t id) {
+    if (kept.size() < *limit) {
+      kept.push_back(id);
+      std::push_heap(kept.begin(), kept.end(), less);
+    } else if (less(id, kept.front())) {
+      std::pop_heap(kept.begin(), kept.end(), less);
+      kept.back() = id;
+      std::push_heap(kept.begin(), kept.end(), less);
+    }
+  });
+  std::sort_heap(kept.begin(), kept.end(), less);
+  return kept;
+}
+
+} // namespace Sort
+
+#endif // SORT_HPP
@@ -1,6 +1,9 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 
+#include "columnCache.hpp"
+#include "columnFile.hpp"
 #include "fm.hpp"
 #include "fmt/core.h"
 #include "linkedList.hpp"
@@ -32,6 +35,19 @@ std::vector<std::uint8_t> DatabaseTable::into_vec() {
   });
 
   resultado.push_back('\0');
+
+  // Constraints follow the columns as a kind byte and the column name, so
+  // readers that stop at the columns still read the table
+  if (primary_key) {
+    resultado.push_back('P');
+    resultado.insert(resultado.end(), primary_key->begin(), primary_key->end());
+    resultado.push_back('\0');
+  }
+  for (auto &column : unique_columns) {
+    resultado.push_back('U');
+    resultado.insert(resultado.end(), column.begin(), column.end());
+    resultado.push_back('\0');
+  }
   return resultado;
 }
 
@@ -62,11 +78,24 @@ DatabaseTable DatabaseTable::from_vec(const std::vector<std::uint8_t> &in,
     columns.insert(column_name, layout);
   }
 
-  return {name, columns};
+  DatabaseTable table(name, columns);
+  for (i += 1; i < in.size();) {
+    std::uint8_t kind = in[i++];
+    std::string column_name;
+    while (i < in.size() && in[i] != '\0')
+      column_name += static_cast<char>(in[i++]);
+    i++;
+    if (kind == 'P')
+      table.primary_key = column_name;
+    else if (kind == 'U')
+      table.unique_columns.push_back(column_name);
+  }
+  return table;
 }
 
 bool DatabaseTable::operator==(const DatabaseTable &other) const {
-  return columns == other.columns;
+  return columns == other.columns && primary_key == other.primary_key &&
+         unique_columns == other.unique_columns;
 }
 
 DatabaseTable DatabaseTable::from_file(std::string const &path, std::string const &name) {
@@ -88,9 +117,35 @@ bool Layout::operator==(const Layout &other) const {
 
 cpp::result<DatabaseTable, std::string>
 DatabaseTable::createTable(std::string database, std::string &table_name,
-                           KeyValueList<std::string, Layout> &layout) {
+                           KeyValueList<std::string, Layout> &layout,
+                           const std::optional<std::string> &primary_key,
+                           const std::vector<std::string> &unique) {
   DatabaseTable t(table_name, layout);
 
+  if (primary_key) {
+    Layout *key = t.columns.get(*primary_key);
+    if (key == nullptr)
+      return cpp::fail(fmt::format("The primary key {} is not a column of {}",
+                                   *primary_key, table_name));
+    if (key->optional || !HashIndex::supports(key->type))
+      return cpp::fail(fmt::format(
+          "The primary key {} must be a numeric column without NULL",
+          *primary_key));
+    t.primary_key = primary_key;
+  }
+  for (auto &column : unique) {
+    if (t.columns.get(column) == nullptr)
+      return cpp::fail(fmt::format("The unique column {} is not a column of {}",
+                                   column, table_name));
+    if (column == primary_key)
+      return cpp::fail(fmt::format(
+          "The primary key {} is unique already, it takes no `UN`", column));
+    if (std::count(unique.begin(), unique.end(), column) > 1)
+      return cpp::fail(
+          fmt::format("Column {} is declared unique twice", column));
+  }
+  t.unique_columns = unique;
+
   auto p = FileManager::Path("data") / database;
 
   if (!p.exists())
@@ -112,7 +167,7 @@ DatabaseTable::createTable(std::string database, std::string &table_name,
   auto node =
       t.columns.for_each([&](const KeyValue<std::string, Layout> &value) {
         auto column_file = table_folder / (value.key + ".col");
-        if (!column_file.create_as_file()) {
+        if (ColumnFile::create(column_file.path, value.value).has_error()) {
           return true;
         }
         return false;
@@ -124,5 +179,83 @@ DatabaseTable::createTable(std::string database, std::string &table_name,
                     (table_folder / (node->value.key + ".col")).path));
   }
 
+  if (t.primary_key) {
+    auto key_column = table_folder / (*t.primary_key + ".col");
+    auto opened = HashIndex::open(HashIndex::path_for(key_column.path),
+                                  t.columns.get(*t.primary_key)->type);
+    if (opened.has_error())
+      return cpp::fail(opened.error());
+    t.key_index = opened.value();
+  }
+
   return t;
 }
+
+cpp::result<std::shared_ptr<HashIndex>, std::string>
+DatabaseTable::primary_index(const std::string &database) {
+  std::lock_guard<std::mutex> opening(key_mtx_);
+  if (key_index)
+    return key_index;
+  if (!primary_key)
+    return cpp::fail(fmt::format("Table {} has no primary key", name));
+
+  auto key_column =
+      FileManager::Path("data") / database / name / (*primary_key + ".col");
+  auto path = HashIndex::path_for(key_column.path);
+  auto type = columns.get(*primary_key)->type;
+  auto opened = HashIndex::open(path, type);
+  if (opened.has_error())
+    return cpp::fail(opened.error());
+
+  // Keys of rows the column lost before they reached its file would stay
+  // taken. The table starts over and is filled from the column.
+  std::uint64_t rows = watermark(database);
+  if (opened.value()->rows() > rows) {
+    if (!FileManager::Path(path).remove())
+      return cpp::fail(fmt::format("Failed to remove the primary key {}", path));
+    opened = HashIndex::open(path, type);
+    if (opened.has_error())
+      return cpp::fail(opened.error());
+  }
+
+  // Rows whose keys did not reach the file before a crash, or replayed
+  // from the log, are read back from the column
+  if (opened.value()->rows() < rows) {
+    auto column = ColumnCache::load(database, name, *primary_key, *this);
+    if (column.has_error())
+      return cpp::fail(column.error());
+    auto extended = opened.value()->extend(rows, [&](std::uint64_t row) {
+      return column.value().index_key(row);
+    });
+    if (extended.has_error())
+      return cpp::fail(extended.error());
+  }
+
+  key_index = opened.value();
+  return key_index;
+}
+
+cpp::result<std::shared_ptr<UniqueSet>, std::string>
+DatabaseTable::unique_set(const std::string &database,
+                          const std::string &column) {
+  std::lock_guard<std::mutex> opening(key_mtx_);
+  auto found = unique_sets.find(column);
+  if (found != unique_sets.end())
+    return found->second;
+
+  // Every insert gets the sets before it takes its keys, so the column
+  // holds all the rows there are while it is read
+  auto set = std::make_shared<UniqueSet>();
+  std::uint64_t rows = watermark(database);
+  if (rows > 0) {
+    auto loaded = ColumnCache::load(database, name, column, *this);
+    if (loaded.has_error())
+      return cpp::fail(loaded.error());
+    for (std::uint64_t row = 0; row < rows; row++) {
+      if (auto key = loaded.value().unique_key(row))
+        set->insert(*key);
+    }
+  }
+  unique_sets[column] = set;
+  return set;
+}
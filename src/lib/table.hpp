@@ -1,8 +1,10 @@
 #ifndef TABLE_HPP
 #define TABLE_HPP
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <result.hpp>
@@ -13,14 +15,41 @@
 #include <thread>
 
 #include "analyzer/parser.hpp"
+#include "appender.hpp"
+#include "codec.hpp"
+#include "columnFile.hpp"
+#include "dictionary.hpp"
 #include "fm.hpp"
+#include "hashIndex.hpp"
 #include "linkedList.hpp"
+#include "rangeIndex.hpp"
 #include "serializer.hpp"
+#include "uniqueSet.hpp"
 
 struct DatabaseTable {
   KeyValueList<std::string, Layout> columns;
   std::shared_mutex mtx_;
   std::string name;
+  // Created on the first insert, rows wait here before reaching the files
+  std::shared_ptr<TableAppender> appender;
+  // Log of the database the table belongs to, if it has one
+  std::shared_ptr<WriteAheadLog> log;
+  // Dictionaries of the dstr columns, opened on the first insert
+  std::map<std::string, std::shared_ptr<Dictionary>> dictionaries;
+  // Rows in the column files before the appender is created
+  std::optional<std::uint64_t> counted_rows;
+  // Range indexes opened so far, nullptr for a column known to have none
+  std::map<std::string, std::shared_ptr<RangeIndex>> indexes;
+  // Column declared `PK`, kept in info.tbl after the columns
+  std::optional<std::string> primary_key;
+  // Hash index of the primary key, opened on the first insert or lookup
+  std::shared_ptr<HashIndex> key_index;
+  // Columns declared `UN`, kept in info.tbl after the columns
+  std::vector<std::string> unique_columns;
+  // Values of the `UN` columns, built on the first insert
+  std::map<std::string, std::shared_ptr<UniqueSet>> unique_sets;
+  // Held while the key index and the unique sets are read from the columns
+  std::mutex key_mtx_;
 
   friend std::ostream &operator<<(std::ostream &os, DatabaseTable &table) {
     std::shared_lock lock(table.mtx_);
@@ -41,6 +70,15 @@ struct DatabaseTable {
     std::unique_lock<std::shared_mutex> lock(rhs.mtx_);
     columns = std::move(rhs.columns);
     name = std::move(rhs.name);
+    appender = std::move(rhs.appender);
+    log = std::move(rhs.log);
+    dictionaries = std::move(rhs.dictionaries);
+    counted_rows = rhs.counted_rows;
+    indexes = std::move(rhs.indexes);
+    primary_key = std::move(rhs.primary_key);
+    key_index = std::move(rhs.key_index);
+    unique_columns = std::move(rhs.unique_columns);
+    unique_sets = std::move(rhs.unique_sets);
   }
 
   // Move operator
@@ -51,6 +89,15 @@ struct DatabaseTable {
       std::lock(lock_rhs, lock_this);
       columns = std::move(rhs.columns);
       name = std::move(rhs.name);
+      appender = std::move(rhs.appender);
+      log = std::move(rhs.log);
+      dictionaries = std::move(rhs.dictionaries);
+      counted_rows = rhs.counted_rows;
+      indexes = std::move(rhs.indexes);
+      primary_key = std::move(rhs.primary_key);
+      key_index = std::move(rhs.key_index);
+      unique_columns = std::move(rhs.unique_columns);
+      unique_sets = std::move(rhs.unique_sets);
     }
 
     return *this;
@@ -65,10 +112,151 @@ struct DatabaseTable {
 
   void to_file(const std::string &path);
 
+  std::shared_ptr<TableAppender> appender_for(const std::string &database) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    if (!appender) {
+      std::vector<std::pair<std::string, Layout>> layouts;
+      columns.for_each_c([&](const KeyValue<std::string, Layout> &keyval) {
+        layouts.emplace_back(keyval.key, keyval.value);
+        return false;
+      });
+      appender = std::make_shared<TableAppender>(database, name, layouts,
+                                                 row_count(database), log);
+    }
+    return appender;
+  }
+
+  std::shared_ptr<Dictionary> dictionary_for(const std::string &database,
+                                             const std::string &column) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto &dictionary = dictionaries[column];
+    if (!dictionary) {
+      auto path = FileManager::Path("data") / database / name /
+                  (column + ".col");
+      dictionary = Dictionary::load(Dictionary::path_for(path.path));
+    }
+    return dictionary;
+  }
+
+  // Range index of `column`, nullptr if it has none. A column is indexed
+  // when its .bpt file exists.
+  std::shared_ptr<RangeIndex> index_for(const std::string &database,
+                                        const std::string &column) {
+    // Taken first, it locks the table too
+    std::uint64_t rows = watermark(database);
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    auto found = indexes.find(column);
+    if (found != indexes.end())
+      return found->second;
+
+    auto &index = indexes[column];
+    Layout *layout = columns.get(column);
+    auto path = RangeIndex::path_for(
+        (FileManager::Path("data") / database / name / (column + ".col")).path);
+    if (layout && RangeIndex::supports(layout->type) &&
+        FileManager::Path(path).exists()) {
+      auto opened = RangeIndex::open(path, layout->type);
+      // Rows the column does not hold were inserted but lost before they
+      // reached its file. The index starts over and is caught up from it.
+      if (opened.has_value() && opened.value()->rows() > rows)
+        opened = RangeIndex::build(path, layout->type, 0, {});
+      if (opened.has_value())
+        index = opened.value();
+    }
+    return index;
+  }
+
+  // Writes the range index of `column` over its first `rows` rows
+  cpp::result<void, std::string>
+  create_index(const std::string &database, const std::string &column,
+               std::uint64_t rows, const RangeIndex::KeyAt &key_at) {
+    Layout *layout = columns.get(column);
+    if (layout == nullptr)
+      return cpp::fail(
+          fmt::format("Table `{}` has no column `{}`", name, column));
+    if (!RangeIndex::supports(layout->type))
+      return cpp::fail(fmt::format(
+          "Only numeric columns can be indexed but `{}.{}` is a {}", name,
+          column, layout->ly_to_string()));
+    if (index_for(database, column))
+      return cpp::fail(
+          fmt::format("Column `{}.{}` is already indexed", name, column));
+
+    auto path = RangeIndex::path_for(
+        (FileManager::Path("data") / database / name / (column + ".col")).path);
+    auto built = RangeIndex::build(path, layout->type, rows, key_at);
+    if (built.has_error())
+      return cpp::fail(built.error());
+
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    indexes[column] = built.value();
+    return {};
+  }
+
+  // Hash index of the primary key, holding every row of the table: rows
+  // that did not reach its file are added from the column when it is opened
+  cpp::result<std::shared_ptr<HashIndex>, std::string>
+  primary_index(const std::string &database);
+
+  // Values `column` holds, read from it the first time and then kept in
+  // step by the inserts
+  cpp::result<std::shared_ptr<UniqueSet>, std::string>
+  unique_set(const std::string &database, const std::string &column);
+
+  // Rows in the column files, going by the first column
+  std::uint64_t row_count(const std::string &database) {
+    auto first = columns.first();
+    if (first == nullptr)
+      return 0;
+
+    auto path = FileManager::Path("data") / database / name /
+                (first->value.key + ".col");
+    return ColumnFile::row_count(path.path, first->value.value);
+  }
+
+  // Row watermark: rows readers see once the queued ones are flushed. Only
+  // inserts add rows, so the files are counted once and the appender keeps
+  // the count from then on.
+  std::uint64_t watermark(const std::string &database) {
+    std::unique_lock<std::shared_mutex> lock(mtx_);
+    if (appender)
+      return appender->rows();
+    if (!counted_rows)
+      counted_rows = row_count(database);
+    return *counted_rows;
+  }
+
+  // Writes the rows still buffered so readers see every acknowledged insert
+  cpp::result<void, std::string> flush_appends() {
+    std::shared_ptr<TableAppender> pending;
+    {
+      std::shared_lock<std::shared_mutex> lock(mtx_);
+      pending = appender;
+    }
+    if (pending)
+      return pending->flush();
+    return {};
+  }
+
+  // Keeps the appender from writing the column files while they are read.
+  // Taken with `mtx_` held, so no appender is created meanwhile.
+  std::shared_lock<std::shared_mutex> lock_files() {
+    if (appender)
+      return appender->read_lock();
+    return {};
+  }
+
+  // Drops the buffered rows, called with the table lock held before the
+  // table directory is removed
+  void discard_appends() {
+    if (appender)
+      appender->discard();
+  }
+
   cpp::result<void, std::string>
   try_insert(std::string const &database,
              List<std::variant<Parser::String, Parser::UInt, Parser::Int,
-                               Parser::Double, Parser::Bool>> &&values) {
+                               Parser::Double, Parser::Bool, Parser::Null>> &&values) {
 
     // First we verify type casting safeness
     if (values.len() != columns.len()) {
@@ -82,26 +270,29 @@ struct DatabaseTable {
       return cpp::fail(error.str());
     }
 
+    // monostate stands for NULL
     using Value =
         std::variant<std::uint8_t, std::uint16_t, std::uint32_t, std::uint64_t,
                      std::int8_t, std::int16_t, std::int32_t, std::int64_t,
-                     std::string, double, bool>;
+                     std::string, double, bool, std::monostate>;
     std::vector<Value> to_insert;
 
     Node<std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double,
-                      Parser::Bool>> *current = values.first();
+                      Parser::Bool, Parser::Null>> *current = values.first();
     Node<KeyValue<std::string, Layout>> *current_column = columns.first();
     for (int i = 0; i < values.len(); i++) {
       using Variant = std::variant<Parser::String, Parser::UInt, Parser::Int,
-                                   Parser::Double, Parser::Bool>;
+                                   Parser::Double, Parser::Bool, Parser::Null>;
 
       Layout &current_layout = current_column->value.value;
       std::variant<Parser::String, Parser::UInt, Parser::Int, Parser::Double,
-                   Parser::Bool> &current_value = current->value;
+                   Parser::Bool, Parser::Null> &current_value = current->value;
 
       // Here is where we do actually verify type matching
       if (std::holds_alternative<Parser::String>(current_value)) {
-        if (current_layout.type == ColumnType::str) {
+        if (current_layout.type == ColumnType::str ||
+            current_layout.type == ColumnType::dstr ||
+            current_layout.type == ColumnType::vstr) {
           std::string value = get<Parser::String>(current_value).value;
           if (value.length() > current_layout.size) {
             return cpp::fail(fmt::format(
@@ -367,6 +558,14 @@ struct DatabaseTable {
               fmt::format("Cannot push bool to field {} which takes a {}", i,
                           current_layout.ly_to_string()));
         }
+      } else if (std::holds_alternative<Parser::Null>(current_value)) {
+        if (current_layout.optional) {
+          to_insert.emplace_back(std::monostate{});
+        } else {
+          return cpp::fail(fmt::format(
+              "Cannot push NULL to field {} which takes a {} without NULL", i,
+              current_layout.ly_to_string()));
+        }
       } else
         return cpp::fail(fmt::format("Cannot push to field {}", i));
 
@@ -374,39 +573,137 @@ struct DatabaseTable {
       current_column = current_column->next;
     }
 
+    // Values of the `UN` columns as their sets hold them, taken before the
+    // NULL strings below turn into empty ones
+    std::vector<std::pair<std::string, std::optional<std::string>>> unique_keys;
+    current_column = columns.first();
+    for (std::size_t i = 0; i < columns.len(); i++) {
+      const std::string &column = current_column->value.key;
+      if (std::find(unique_columns.begin(), unique_columns.end(), column) !=
+          unique_columns.end())
+        unique_keys.emplace_back(
+            column, std::visit(
+                        [](auto &value) { return UniqueSet::key_of(value); },
+                        to_insert[i]));
+      current_column = current_column->next;
+    }
+
+    // Keys of the row in the indexed columns, nothing for a NULL
+    std::vector<std::pair<std::shared_ptr<RangeIndex>, std::optional<std::uint64_t>>>
+        keyed;
+    current_column = columns.first();
+    for (std::size_t i = 0; i < columns.len(); i++) {
+      if (RangeIndex::supports(current_column->value.value.type)) {
+        if (auto index = index_for(database, current_column->value.key))
+          keyed.emplace_back(index, std::visit(
+                                        [](auto &value) {
+                                          return index_key_of(value);
+                                        },
+                                        to_insert[i]));
+      }
+      current_column = current_column->next;
+    }
+
+    std::vector<std::shared_ptr<UniqueSet>> sets;
+    for (auto &[column, key] : unique_keys) {
+      auto set = unique_set(database, column);
+      if (set.has_error())
+        return cpp::fail(set.error());
+      sets.push_back(set.value());
+    }
+
+    // Keys are taken before the row is queued, two inserts of the same key
+    // cannot both get in. A clash or a failed append lets go of them.
+    std::shared_ptr<HashIndex> claimed;
+    std::optional<std::uint64_t> claimed_key;
+    std::vector<std::pair<std::shared_ptr<UniqueSet>, std::string>> taken;
+    auto let_go = [&] {
+      if (claimed)
+        claimed->release(*claimed_key);
+      for (auto &[set, key] : taken)
+        set->erase(key);
+    };
+    if (primary_key) {
+      auto opened = primary_index(database);
+      if (opened.has_error())
+        return cpp::fail(opened.error());
+      std::size_t i = 0;
+      columns.for_each_c([&](const KeyValue<std::string, Layout> &keyval) {
+        if (keyval.key != *primary_key) {
+          i++;
+          return false;
+        }
+        claimed_key = std::visit(
+            [](auto &value) { return index_key_of(value); }, to_insert[i]);
+        return true;
+      });
+      if (!claimed_key)
+        return cpp::fail(fmt::format("Field {} cannot be a primary key", i));
+      if (!opened.value()->claim(*claimed_key))
+        return cpp::fail(fmt::format(
+            "Duplicate primary key: a row of {} already holds that `{}`", name,
+            *primary_key));
+      claimed = opened.value();
+    }
+    for (std::size_t i = 0; i < unique_keys.size(); i++) {
+      auto &[column, key] = unique_keys[i];
+      if (!key)
+        continue;
+      if (!sets[i]->insert(*key)) {
+        let_go();
+        return cpp::fail(fmt::format(
+            "Duplicate value: a row of {} already holds that `{}`", name,
+            column));
+      }
+      taken.emplace_back(sets[i], *key);
+    }
+
     // Up to this point to_insert is full of values that are the correct type
-    // We iterate once more each layout column
+    // We encode one buffer per column and hand the row to the appender. Only
+    // a row that passed its key checks gets here: its dstr values go into
+    // the dictionary for good.
 
-    std::unique_lock<std::shared_mutex> lock(mtx_);
+    TableAppender::Row row(columns.len());
 
     current_column = columns.first();
     for (std::size_t i = 0; i < columns.len(); i++) {
-      // Sleep 2000 miliseconds
-      FileManager::Path column_path = FileManager::Path("data") / database /
-                                      name /
-                                      (current_column->value.key + ".col");
-
-      if (!column_path.exists()) {
-        return cpp::fail(
-            fmt::format("Column {} does not exist", current_column->value.key));
-      }
+      std::vector<std::uint8_t> &encoded = row[i];
+      const Layout &layout = current_column->value.value;
 
     #define ENCODE(TYPE) if (std::holds_alternative<TYPE>(to_insert[i])) {\
-      TYPE value = std::get<TYPE>(to_insert[i]);\
-      FileManager::append_to_file(column_path.path,\
-                                  Serialized::serialize(value));\
+      Codec::push(encoded, std::get<TYPE>(to_insert[i]));\
     }
 
-      if (std::holds_alternative<std::string>(to_insert[i])) {
-        std::string value = std::get<std::string>(to_insert[i]);
-        auto result = columns.get_at(i);
-        if (result == nullptr) {
-          return cpp::fail(fmt::format(
-              "Cannot push string to field. Failed to get string size"));
+      // Optional columns flag every value. A null still takes a row in the
+      // column: zeros, or an empty string, which every reader can decode.
+      if (layout.optional) {
+        bool null = std::holds_alternative<std::monostate>(to_insert[i]);
+        encoded.push_back(null ? 0 : 1);
+        if (null) {
+          if (layout.type == ColumnType::str ||
+              layout.type == ColumnType::dstr ||
+              layout.type == ColumnType::vstr)
+            to_insert[i] = std::string();
+          else
+            encoded.resize(encoded.size() + Codec::value_size(layout), 0);
+        }
+      }
+
+      if (std::holds_alternative<std::monostate>(to_insert[i])) {
+        // Zeros pushed above
+      } else if (current_column->value.value.type == ColumnType::dstr) {
+        auto code = dictionary_for(database, current_column->value.key)
+                        ->intern(std::get<std::string>(to_insert[i]));
+        if (code.has_error()) {
+          let_go();
+          return cpp::fail(code.error());
         }
-        auto size = result->value.value.size;
-        FileManager::append_to_file(column_path.path,
-                                    Serialized::serialize(value, size));
+        Codec::push(encoded, code.value());
+      } else if (current_column->value.value.type == ColumnType::vstr) {
+        Codec::push_varlen(encoded, std::get<std::string>(to_insert[i]));
+      } else if (std::holds_alternative<std::string>(to_insert[i])) {
+        Codec::push(encoded, std::get<std::string>(to_insert[i]),
+                    current_column->value.value.size);
       } else {
         ENCODE(std::uint64_t)
         else ENCODE(std::int64_t)
@@ -418,15 +715,47 @@ struct DatabaseTable {
         else ENCODE(std::int8_t)
         else ENCODE(bool)
         else ENCODE(double)
-        else return cpp::fail(fmt::format("Cannot push to field {}", i));
+        else {
+          let_go();
+          return cpp::fail(fmt::format("Cannot push to field {}", i));
+        }
       }
 
+    #undef ENCODE
+
       current_column = current_column->next;
     }
 
+    std::shared_ptr<TableAppender> table_appender = appender_for(database);
+
+    // A shared lock is enough, the appender orders concurrent inserts. It
+    // keeps the table from being deleted while the row is queued.
+    std::shared_lock<std::shared_mutex> lock(mtx_);
+
+    auto appended = table_appender->append(row);
+    if (appended.has_error()) {
+      let_go();
+      return cpp::fail(appended.error());
+    }
+    // Indexes that miss the row catch up from its column before they
+    // answer, the row is in already
+    if (claimed)
+      auto _ = claimed->commit(*claimed_key, appended.value());
+    for (auto &[index, key] : keyed)
+      auto _ = index->add(appended.value(), key);
+
     return {};
   }
 
+  // Key of a value in a RangeIndex, nothing for NULL and non-numbers
+  template <typename T>
+  static std::optional<std::uint64_t> index_key_of(const T &value) {
+    if constexpr (std::is_arithmetic_v<T> && !std::is_same_v<T, bool>)
+      return RangeIndex::key_of(value);
+    else
+      return std::nullopt;
+  }
+
   bool operator==(DatabaseTable const &other) const;
 
   DatabaseTable(const std::string &name, KeyValueList<std::string, Layout> &layout)
@@ -434,6 +763,8 @@ struct DatabaseTable {
 
   static cpp::result<DatabaseTable, std::string>
   createTable(std::string database, std::string &table_name,
-              KeyValueList<std::string, Layout> &layout);
+              KeyValueList<std::string, Layout> &layout,
+              const std::optional<std::string> &primary_key = std::nullopt,
+              const std::vector<std::string> &unique = {});
 };
 #endif // TABLE_HPP
@@ -0,0 +1,96 @@
+#ifndef UNIQUESET_HPP
+#define UNIQUESET_HPP
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_set>
+#include <variant>
+
+#include "codec.hpp"
+#include "group.hpp"
+#include "rangeIndex.hpp"
+
+// Values of a column declared `UN`, held in memory so inserts are checked
+// without reading the column. The set is split in SHARDS shards by the
+// hash of the value, each behind a lock of its own, so inserts of
+// different values seldom wait on each other. Built from the column on
+// the first insert into the table (see DatabaseTable::unique_set) and
+// kept in step by every insert after it.
+class UniqueSet {
+public:
+  static constexpr std::size_t SHARDS = 64;
+
+  // Bytes a value is held as: numbers widened the way of
+  // RangeIndex::key_of, so equal values of a column give equal keys.
+  // Nothing for NULL, which never clashes with another row.
+  template <typename T>
+  static std::optional<std::string> key_of(const T &value) {
+    if constexpr (std::is_same_v<T, std::monostate>) {
+      return std::nullopt;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+      return value;
+    } else if constexpr (std::is_same_v<T, bool>) {
+      return std::string(1, value ? '\1' : '\0');
+    } else {
+      auto key = RangeIndex::key_of(value);
+      if (!key)
+        return std::nullopt;
+      std::string bytes(sizeof(std::uint64_t), '\0');
+      Codec::store(*key, reinterpret_cast<std::uint8_t *>(bytes.data()));
+      return bytes;
+    }
+  }
+
+  // Adds `key`, false when the set holds it already
+  bool insert(const std::string &key) {
+    Shard &shard = shard_of(key);
+    std::lock_guard lock(shard.mtx);
+    return shard.keys.insert(key).second;
+  }
+
+  // Takes `key` out again, for a row that did not make it in
+  void erase(const std::string &key) {
+    Shard &shard = shard_of(key);
+    std::lock_guard lock(shard.mtx);
+    shard.keys.erase(key);
+  }
+
+  [[nodiscard]] bool contains(const std::string &key) const {
+    const Shard &shard = shards_[shard_for(key)];
+    std::lock_guard lock(shard.mtx);
+    return shard.keys.contains(key);
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    std::size_t total = 0;
+    for (const Shard &shard : shards_) {
+      std::lock_guard lock(shard.mtx);
+      total += shard.keys.size();
+    }
+    return total;
+  }
+
+private:
+  struct Shard {
+    mutable std::mutex mtx;
+    std::unordered_set<std::string> keys;
+  };
+
+  // High bits of the mixed hash, the shard's own table uses the low ones
+  static std::size_t shard_for(const std::string &key) {
+    return Group::hash(std::string_view(key)) >> 58;
+  }
+
+  Shard &shard_of(const std::string &key) { return shards_[shard_for(key)]; }
+
+  static_assert(SHARDS == std::size_t{1} << (64 - 58));
+
+  std::array<Shard, SHARDS> shards_;
+};
+
+#endif // UNIQUESET_HPP
@@ -0,0 +1,299 @@
+#include "wal.hpp"
+
+#include <algorithm>
+#include <fmt/core.h>
+
+#include "codec.hpp"
+#include "fm.hpp"
+
+template <Codec::Fixed T>
+static void put(std::vector<std::uint8_t> &out, T value) {
+  Codec::push(out, value);
+}
+
+std::string WriteAheadLog::path_for(const std::string &database) {
+  return (FileManager::Path("data") / database / "wal.log").path;
+}
+
+cpp::result<std::shared_ptr<WriteAheadLog>, std::string>
+WriteAheadLog::open(const std::string &path) {
+  std::shared_ptr<WriteAheadLog> wal(new WriteAheadLog(path));
+
+  wal->file_ = std::fopen(path.c_str(), "ab");
+  if (wal->file_ == nullptr)
+    return cpp::fail(fmt::format("Failed to open the log {}", path));
+
+  wal->file_bytes_ = FileManager::Path(path).get_file_size();
+  wal->written_ = wal->file_bytes_;
+  return wal;
+}
+
+WriteAheadLog::~WriteAheadLog() {
+  auto _ = sync(logged_);
+  if (file_ != nullptr)
+    std::fclose(file_);
+}
+
+std::uint64_t WriteAheadLog::push(Kind kind, const std::string &table,
+                                  std::uint64_t row, const Row &values) {
+  std::size_t at = buffer_.size();
+
+  // Header goes first and is filled once the payload size is known
+  buffer_.resize(at + 8);
+  put<std::uint8_t>(buffer_, static_cast<std::uint8_t>(kind));
+  put<std::uint16_t>(buffer_, static_cast<std::uint16_t>(table.size()));
+  buffer_.insert(buffer_.end(), table.begin(), table.end());
+
+  if (kind == Kind::Insert) {
+    put<std::uint64_t>(buffer_, row);
+    put<std::uint16_t>(buffer_, static_cast<std::uint16_t>(values.size()));
+    for (auto &value : values) {
+      put<std::uint32_t>(buffer_, static_cast<std::uint32_t>(value.size()));
+      buffer_.insert(buffer_.end(), value.begin(), value.end());
+    }
+  }
+
+  std::size_t payload = buffer_.size() - at - 8;
+  Codec::store<std::uint32_t>(static_cast<std::uint32_t>(payload),
+                              buffer_.data() + at);
+  Codec::store<std::uint32_t>(Codec::crc32(buffer_.data() + at + 8, payload),
+                              buffer_.data() + at + 4);
+
+  // Drops have nothing to apply
+  written_ += buffer_.size() - at;
+  pending_.push_back({written_, kind == Kind::Drop});
+  return ++logged_;
+}
+
+std::uint64_t WriteAheadLog::log(const std::string &table, std::uint64_t row,
+                                 const Row &values) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  return push(Kind::Insert, table, row, values);
+}
+
+cpp::result<void, std::string>
+WriteAheadLog::log_drop(const std::string &table) {
+  std::uint64_t sequence;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    sequence = push(Kind::Drop, table, 0, {});
+  }
+  return sync(sequence);
+}
+
+cpp::result<void, std::string> WriteAheadLog::sync(std::uint64_t sequence) {
+  std::unique_lock<std::mutex> lock(mtx_);
+
+  while (synced_ < sequence && failure_.empty()) {
+    if (syncing_) {
+      synced_cv_.wait(lock);
+      continue;
+    }
+
+    // Lead this sync, writing every record queued so far in one go
+    syncing_ = true;
+    std::vector<std::uint8_t> batch;
+    batch.swap(buffer_);
+    std::uint64_t batch_to = logged_;
+
+    lock.unlock();
+    bool ok = std::fwrite(batch.data(), 1, batch.size(), file_) ==
+                  batch.size() &&
+              FileManager::sync_file(file_);
+    lock.lock();
+
+    // After a failed fsync nothing tells which records made it, so the
+    // log refuses to acknowledge anything else
+    if (!ok)
+      failure_ = fmt::format("Failed to write the log {}", path_);
+
+    file_bytes_ += batch.size();
+    synced_ = batch_to;
+    syncing_ = false;
+    synced_cv_.notify_all();
+  }
+
+  if (!failure_.empty())
+    return cpp::fail(failure_);
+
+  return {};
+}
+
+void WriteAheadLog::applied(const std::vector<std::uint64_t> &sequences) {
+  std::unique_lock<std::mutex> lock(mtx_);
+  for (auto sequence : sequences)
+    if (sequence >= first_ && sequence - first_ < pending_.size())
+      pending_[sequence - first_].applied = true;
+
+  while (!pending_.empty() && pending_.front().applied) {
+    cut_ = pending_.front().end;
+    pending_.pop_front();
+    first_++;
+  }
+
+  if (cut_ <= file_start_ || cut_ - file_start_ < checkpoint_bytes)
+    return;
+
+  lock.unlock();
+  auto _ = rotate();
+}
+
+cpp::result<void, std::string> WriteAheadLog::rotate() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  synced_cv_.wait(lock, [&] { return !syncing_; });
+  if (!failure_.empty())
+    return cpp::fail(failure_);
+
+  // Records past the end of the file are still buffered, they stay there
+  std::uint64_t file_end = file_start_ + file_bytes_;
+  std::uint64_t cut = std::min(cut_, file_end);
+  if (cut <= file_start_)
+    return {};
+
+  // Leading a sync keeps everyone else off the file meanwhile
+  syncing_ = true;
+  lock.unlock();
+
+  // Every remaining record goes to a new file that replaces the log in one
+  // step, so a crash leaves the old log or the new one
+  std::fflush(file_);
+  std::vector<std::uint8_t> kept(file_end - cut);
+  bool ok = false;
+  if (std::FILE *old = std::fopen(path_.c_str(), "rb")) {
+    ok = std::fseek(old, static_cast<long>(cut - file_start_), SEEK_SET) == 0 &&
+         std::fread(kept.data(), 1, kept.size(), old) == kept.size();
+    std::fclose(old);
+  }
+
+  auto staging = path_ + ".tmp";
+  if (ok) {
+    std::FILE *file = std::fopen(staging.c_str(), "wb");
+    ok = file != nullptr &&
+         std::fwrite(kept.data(), 1, kept.size(), file) == kept.size() &&
+         FileManager::sync_file(file);
+    if (file != nullptr)
+      ok = std::fclose(file) == 0 && ok;
+  }
+
+  std::error_code error;
+  if (ok)
+    std::filesystem::rename(staging, path_, error);
+  ok = ok && !error;
+
+  if (ok) {
+    std::fclose(file_);
+    file_ = std::fopen(path_.c_str(), "ab");
+  }
+
+  lock.lock();
+  if (ok && file_ == nullptr)
+    failure_ = fmt::format("Failed to reopen the log {}", path_);
+  if (ok) {
+    file_start_ = cut;
+    file_bytes_ = kept.size();
+  }
+  syncing_ = false;
+  synced_cv_.notify_all();
+
+  if (!failure_.empty())
+    return cpp::fail(failure_);
+  if (!ok)
+    return cpp::fail(fmt::format("Failed to rotate the log {}", path_));
+  return {};
+}
+
+cpp::result<void, std::string> WriteAheadLog::truncate() {
+  std::unique_lock<std::mutex> lock(mtx_);
+  synced_cv_.wait(lock, [&] { return !syncing_; });
+
+  // New rows may have been logged meanwhile, they still need the log
+  if (!std::all_of(pending_.begin(), pending_.end(),
+                   [](const Pending &record) { return record.applied; }))
+    return {};
+
+  // Records still buffered are drops only, the truncation makes them moot
+  buffer_.clear();
+  synced_ = logged_;
+  synced_cv_.notify_all();
+
+  std::fflush(file_);
+  if (!FileManager::resize_file(path_, 0))
+    return cpp::fail(fmt::format("Failed to truncate the log {}", path_));
+
+  first_ += pending_.size();
+  pending_.clear();
+  cut_ = written_;
+  file_start_ = written_;
+  file_bytes_ = 0;
+  return {};
+}
+
+std::vector<WriteAheadLog::Record>
+WriteAheadLog::read(const std::string &path) {
+  std::vector<Record> records;
+
+  if (!FileManager::Path(path).exists())
+    return records;
+
+  auto contents = FileManager::read_to_vec(path);
+  const std::uint8_t *data = contents.data();
+  std::size_t size = contents.size();
+  std::size_t at = 0;
+
+  while (at + 8 <= size) {
+    std::uint32_t payload = Codec::load<std::uint32_t>(data + at);
+    std::uint32_t crc = Codec::load<std::uint32_t>(data + at + 4);
+    if (at + 8 + payload > size || Codec::crc32(data + at + 8, payload) != crc)
+      break;
+
+    const std::uint8_t *in = data + at + 8;
+    const std::uint8_t *end = in + payload;
+    at += 8 + payload;
+
+    if (end - in < 3)
+      break;
+
+    Record record{static_cast<Kind>(in[0]), {}, 0, {}};
+    std::uint16_t name_size = Codec::load<std::uint16_t>(in + 1);
+    in += 3;
+    if (end - in < name_size)
+      break;
+    record.table.assign(reinterpret_cast<const char *>(in), name_size);
+    in += name_size;
+
+    if (record.kind == Kind::Drop) {
+      std::erase_if(records,
+                    [&](const Record &r) { return r.table == record.table; });
+      continue;
+    }
+
+    if (end - in < 10)
+      break;
+    record.row = Codec::load<std::uint64_t>(in);
+    std::uint16_t columns = Codec::load<std::uint16_t>(in + 8);
+    in += 10;
+
+    bool valid = true;
+    for (std::uint16_t i = 0; i < columns && valid; i++) {
+      if (end - in < 4) {
+        valid = false;
+        break;
+      }
+      std::uint32_t value_size = Codec::load<std::uint32_t>(in);
+      in += 4;
+      if (end - in < value_size) {
+        valid = false;
+        break;
+      }
+      record.values.emplace_back(in, in + value_size);
+      in += value_size;
+    }
+
+    if (!valid)
+      break;
+
+    records.push_back(std::move(record));
+  }
+
+  return records;
+}
@@ -0,0 +1,110 @@
+#ifndef WAL_HPP
+#define WAL_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <result.hpp>
+#include <string>
+#include <vector>
+
+// Redo log shared by every table of a database, kept at data/<db>/wal.log.
+// An insert is one sequential append here; the column files are written
+// later and the log is replayed on startup to finish whatever a crash cut.
+//
+// Each record is [u32 payload length][u32 crc32 of payload][payload], all
+// little endian. The payload is
+//   u8 kind, u16 table name length, table name, then for rows:
+//   u64 row index, u16 columns, and per column u32 length + encoded value.
+// A torn or corrupt record ends the log.
+struct WriteAheadLog {
+  using Row = std::vector<std::vector<std::uint8_t>>;
+
+  enum class Kind : std::uint8_t {
+    Insert = 0,
+    // Every earlier record of the table is void, it was deleted
+    Drop = 1,
+  };
+
+  struct Record {
+    Kind kind;
+    std::string table;
+    std::uint64_t row;
+    Row values;
+  };
+
+  static cpp::result<std::shared_ptr<WriteAheadLog>, std::string>
+  open(const std::string &path);
+
+  WriteAheadLog(const WriteAheadLog &) = delete;
+  WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+  ~WriteAheadLog();
+
+  // Queues a row for the next sync and returns its sequence number
+  std::uint64_t log(const std::string &table, std::uint64_t row,
+                    const Row &values);
+
+  // Logs that a table was deleted and waits for it to be durable
+  cpp::result<void, std::string> log_drop(const std::string &table);
+
+  // Returns once every record up to `sequence` is on stable storage.
+  // Concurrent callers share a single write + fsync.
+  cpp::result<void, std::string> sync(std::uint64_t sequence);
+
+  // Reports the rows logged under `sequences` as durable in their column
+  // files. Once the records every earlier row is applied for span more
+  // than `checkpoint_bytes`, the log is rewritten without them.
+  void applied(const std::vector<std::uint64_t> &sequences);
+
+  // Empties the log, every record must already be in the column files
+  cpp::result<void, std::string> truncate();
+
+  // Reads the valid prefix of a log, without the records of dropped tables
+  static std::vector<Record> read(const std::string &path);
+
+  static std::string path_for(const std::string &database);
+
+  std::uint64_t checkpoint_bytes = 4 << 20;
+
+private:
+  explicit WriteAheadLog(std::string path) : path_(std::move(path)) {}
+
+  std::uint64_t push(Kind kind, const std::string &table, std::uint64_t row,
+                     const Row &values);
+
+  // Drops the records before `cut_` from the file
+  cpp::result<void, std::string> rotate();
+
+  std::string path_;
+  std::FILE *file_ = nullptr;
+
+  std::mutex mtx_;
+  std::condition_variable synced_cv_;
+
+  std::vector<std::uint8_t> buffer_;
+  std::uint64_t logged_ = 0;
+  std::uint64_t synced_ = 0;
+  bool syncing_ = false;
+  std::string failure_;
+
+  // Offsets count every byte ever logged, the file starts at `file_start_`.
+  // `pending_` holds, from sequence `first_` on, where each record ends
+  // and whether it was applied. Applied records at its front are popped
+  // and `cut_` moves to their end.
+  struct Pending {
+    std::uint64_t end;
+    bool applied;
+  };
+  std::deque<Pending> pending_;
+  std::uint64_t first_ = 1;
+  std::uint64_t cut_ = 0;
+  std::uint64_t written_ = 0;
+  std::uint64_t file_start_ = 0;
+  std::uint64_t file_bytes_ = 0;
+};
+
+#endif // WAL_HPP
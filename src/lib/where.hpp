@@ -0,0 +1,137 @@
+#ifndef WHERE_HPP
+#define WHERE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "analyzer/automata.hpp"
+#include "bitmap.hpp"
+#include "codec.hpp"
+
+// Evaluation of a WHERE tree over selection bitmaps. Each node only looks
+// at the rows its parent has not decided yet: an AND passes on the rows its
+// earlier children kept, an OR the rows none of them matched. Children go
+// cheapest and most decisive first, and a node with no rows left to decide
+// stops.
+namespace Where {
+
+using Bits = std::vector<std::uint64_t>;
+
+// Guess of what a predicate costs per row and of the share of rows it keeps
+struct Estimate {
+  double work;
+  double pass;
+};
+
+// Bits and codes are cheap, wide values cost more and strings the most.
+// Equality keeps few rows and `!=` almost all of them.
+inline Estimate estimate(const Layout &layout, Parser::OperatorE op,
+                         bool null_constant) {
+  double work;
+  if (null_constant || layout.type == ColumnType::rbool)
+    work = 0.1;
+  else if (layout.type == ColumnType::str || layout.type == ColumnType::vstr ||
+           (layout.type == ColumnType::dstr &&
+            op != Parser::OperatorE::EQUAL &&
+            op != Parser::OperatorE::NOT_EQUAL))
+    work = 8;
+  else
+    work = 1 + Codec::value_size(layout) / 8.0;
+
+  double pass = 0.5;
+  if (op == Parser::OperatorE::EQUAL)
+    pass = 0.1;
+  else if (op == Parser::OperatorE::NOT_EQUAL)
+    pass = 0.9;
+  return {work, pass};
+}
+
+template <typename Leaf>
+Estimate estimate(const Automata::Predicate &node, Leaf &&leaf) {
+  if (node.restriction)
+    return leaf(*node.restriction);
+
+  Estimate total{0, node.op == Parser::OperatorE::OR ? 0.0 : 1.0};
+  for (auto &child : node.children) {
+    Estimate part = estimate(child, leaf);
+    total.work += part.work;
+    if (node.op == Parser::OperatorE::OR)
+      total.pass = 1 - (1 - total.pass) * (1 - part.pass);
+    else
+      total.pass *= part.pass;
+  }
+  return total;
+}
+
+// Table all the restrictions under `node` are on, `table_of(restriction)`
+// names it. Nothing when they are on more than one.
+template <typename TableOf>
+std::optional<std::string> single_table(const Automata::Predicate &node,
+                                        TableOf &&table_of) {
+  if (node.restriction)
+    return table_of(*node.restriction);
+
+  std::optional<std::string> table;
+  for (auto &child : node.children) {
+    auto inner = single_table(child, table_of);
+    if (!inner || (table && *table != *inner))
+      return std::nullopt;
+    table = std::move(inner);
+  }
+  return table;
+}
+
+// Rows of `candidates` where `node` holds. `select(restriction, within)`
+// gives the rows of one restriction, it may leave out rows not in `within`.
+// `cost(restriction)` is its Estimate.
+template <typename Select, typename Cost>
+Bits evaluate(const Automata::Predicate &node, Bits candidates,
+              Select &&select, Cost &&cost) {
+  if (!Bitmap::any(candidates))
+    return candidates;
+
+  if (node.restriction) {
+    Bits matched = select(*node.restriction, candidates);
+    matched.resize(candidates.size(), 0);
+    Bitmap::intersect(candidates, matched);
+    return candidates;
+  }
+
+  // An AND drops rows, so it wants the children that drop the most per
+  // unit of work first. An OR settles rows, it wants those that match most.
+  bool any_of = node.op == Parser::OperatorE::OR;
+  std::vector<std::pair<double, const Automata::Predicate *>> order;
+  for (auto &child : node.children) {
+    Estimate guess = estimate(child, cost);
+    double decided = any_of ? guess.pass : 1 - guess.pass;
+    order.emplace_back(guess.work / std::max(decided, 1e-6), &child);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [](auto &a, auto &b) { return a.first < b.first; });
+
+  if (!any_of) {
+    for (auto [rank, child] : order) {
+      candidates = evaluate(*child, std::move(candidates), select, cost);
+      if (!Bitmap::any(candidates))
+        break;
+    }
+    return candidates;
+  }
+
+  Bits matched(candidates.size(), 0);
+  for (auto [rank, child] : order) {
+    Bits part = evaluate(*child, candidates, select, cost);
+    Bitmap::unite(matched, part);
+    Bitmap::subtract(candidates, part);
+    if (!Bitmap::any(candidates))
+      break;
+  }
+  return matched;
+}
+
+} // namespace Where
+
+#endif // WHERE_HPP
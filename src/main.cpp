@@ -1,6 +1,10 @@
+#include <algorithm>
+#include <bit>
 #include <csignal>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <new>
 #include <optional>
 #include <sstream>
 #include <thread>
@@ -15,13 +19,32 @@
 #include "lib/linkedList.hpp"
 #include "lib/logger.hpp"
 #include "lib/server.hpp"
+#include "lib/columnCache.hpp"
 #include "lib/columnInstance.hpp"
 #include "lib/databases.hpp"
+#include "lib/group.hpp"
+#include "lib/join.hpp"
+#include "lib/plan.hpp"
+#include "lib/pool.hpp"
+#include "lib/sort.hpp"
+#include "lib/where.hpp"
 
 using namespace std;
 
 volatile sig_atomic_t st = 0;
 
+// Every allocation of the server is counted for EXPLAIN ANALYZE
+void *operator new(std::size_t size) {
+  Plan::count_allocation();
+  if (void *p = std::malloc(size == 0 ? 1 : size))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+
 #define LOG(...) log->log(fmt::format(__VA_ARGS__))
 #define WARN(...) log->warn(fmt::format(__VA_ARGS__))
 #define ERROR(...) log->error(fmt::format(__VA_ARGS__))
@@ -84,7 +107,9 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
         auto db_result = DataBase::create(arg.name);
         if (db_result.has_value()) {
           LSEND("Database {} created\n", arg.name);
-          dbs.add(arg.name);
+          auto added = dbs.add(arg.name);
+          if (added.has_error())
+            SEND_ERROR("{}\n", added.error());
           LSEND("Databases {}\n", dbs.to_string());
         } else {
           SEND_ERROR("{}\n", db_result.error());
@@ -95,6 +120,7 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
         if (result.has_error()) {
           SEND_ERROR("{}\n", result.error());
         } else {
+          ColumnCache::forget(arg.name);
           LSEND("Deleted database {}\n", arg.name);
         }
 
@@ -105,6 +131,7 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
         if (result.has_error()) {
           SEND_ERROR("{}\n", result.error());
         } else {
+          ColumnCache::forget(arg.database, arg.table);
           LSEND("Deleted table {}.{}\n", arg.database, arg.table);
         }
       } else if (holds_alternative<Automata::CreateTable>(args.value())) {
@@ -114,15 +141,54 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
         if (db == nullptr) {
           SEND_ERROR("Database {} does not exist\n", arg.name);
         } else {
-          auto result = DatabaseTable::createTable(arg.db, arg.name, arg.columns);
+          auto result = DatabaseTable::createTable(
+              arg.db, arg.name, arg.columns, arg.primary_key, arg.unique);
           if (result.has_error()) {
             SEND_ERROR("{}\n", result.error());
           } else {
-            (*db)->tables.insert(arg.name,
-                              std::make_shared<DatabaseTable>(std::move(*result)));
+            (*db)->add_table(arg.name, std::move(*result));
             LSEND("DatabaseTable {} created in database {}\n", arg.name, arg.db);
           }
         }
+      } else if (holds_alternative<Automata::CreateIndex>(args.value())) {
+        auto arg = get<Automata::CreateIndex>(args.value());
+        auto db = dbs.dbs.get(arg.database);
+        auto table = db == nullptr ? nullptr : (*db)->tables.get(arg.table);
+
+        if (db == nullptr) {
+          SEND_ERROR("Database {} does not exist\n", arg.database);
+        } else if (table == nullptr) {
+          SEND_ERROR("DatabaseTable {} does not exist in {}\n", arg.table,
+                     arg.database);
+        } else if (auto flushed = (*table)->flush_appends();
+                   flushed.has_error()) {
+          SEND_ERROR("{}\n", flushed.error());
+        } else {
+          // The rows already in the table are read once and loaded in bulk,
+          // inserts from now on add themselves
+          std::uint64_t rows = (*table)->watermark(arg.database);
+          std::optional<ColumnInstance> column;
+          cpp::result<void, std::string> result;
+          if (rows > 0) {
+            auto loaded = ColumnCache::load(arg.database, arg.table,
+                                            arg.column, *(*table));
+            if (loaded.has_error())
+              result = cpp::fail(loaded.error());
+            else
+              column = std::move(loaded.value());
+          }
+          if (!result.has_error())
+            result = (*table)->create_index(
+                arg.database, arg.column, rows, [&](std::uint64_t row) {
+                  return column->index_key(row);
+                });
+          if (result.has_error()) {
+            SEND_ERROR("{}\n", result.error());
+          } else {
+            LSEND("Index on {}.{}.{} created\n", arg.database, arg.table,
+                  arg.column);
+          }
+        }
       } else if (holds_alternative<Automata::ShowDatabase>(args.value())) {
         auto arg = get<Automata::ShowDatabase>(args.value());
 
@@ -164,11 +230,11 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
             std::shared_lock<std::shared_mutex> lock((*table)->mtx_);
 
             fort::char_table pp_table;
-            pp_table << fort::header << "Column" << "Size" << "Type" << fort::endr;
+            pp_table << fort::header << "Column" << "Size" << "Type" << "Null" << fort::endr;
             auto _ = (*table)->columns.for_each_c(
                 [&](const KeyValue<std::string, Layout> &column) {
                     pp_table << column.key << column.value.size << to_string(column.value.type)
-                             << fort::endr;
+                             << (column.value.optional ? "yes" : "no") << fort::endr;
                   return false;
                 });
 
@@ -225,7 +291,7 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
             SEND_ERROR("DatabaseTable {} does not exist in {}\n", arg.table,
                        arg.database);
           } else {
-            auto result = ColumnInstance::load_column(
+            auto result = ColumnCache::load(
                 arg.database, arg.table, arg.column, *(*table));
             if (result.has_error()) {
               SEND_ERROR("{}\n", result.error());
@@ -268,7 +334,7 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
             vector<string> column_names;
 
             (*table)->columns.for_each_c([&](const KeyValue<std::string, Layout> &column){
-              auto result = ColumnInstance::load_column(
+              auto result = ColumnCache::load(
                   arg.database, arg.table, column.key, *(*table));
               column_names.push_back(column.key);
               if (result.has_error()) {
@@ -303,385 +369,649 @@ void resolve(const shared_ptr<Connection> &s, TcpServer &tcp,
       } else if (std::holds_alternative<Automata::Show_Select>(args.value())) {
         auto arg = std::get<Automata::Show_Select>(args.value());
 
-        LSEND("Requested select in database {}\n", arg.database);
-        LSEND("With request for displaying columns:\n");
+        // Each stage runs under a Plan::Step of its operator. EXPLAIN only
+        // shows the operators, EXPLAIN ANALYZE answers what they took
+        // instead of the rows.
+        auto plan = Plan::build(arg);
+        if (arg.explain == Automata::Explain::Plan) {
+          send << Plan::to_string(plan, false);
+          break;
+        }
+        bool analyze = arg.explain == Automata::Explain::Analyze;
+        auto note = [&](Plan::Kind kind, size_t rows_in, size_t rows_out,
+                        size_t bytes = 0) {
+          if (auto *op = plan.find(kind)) {
+            op->stats.rows_in += rows_in;
+            op->stats.rows_out += rows_out;
+            op->stats.bytes_read += bytes;
+          }
+        };
+        auto count_of = [](const std::vector<std::uint64_t> &bits) {
+          size_t count = 0;
+          for (auto word : bits)
+            count += std::popcount(word);
+          return count;
+        };
+        auto bytes_of =
+            [](const std::vector<std::pair<std::string, ColumnInstance>> &columns) {
+              size_t bytes = 0;
+              for (auto &[key, column] : columns)
+                bytes += column.bytes();
+              return bytes;
+            };
+
+        if (!analyze) {
+          LSEND("Requested select in database {}\n", arg.database);
+          LSEND("With request for displaying columns:\n");
+        }
 
-        Cortina<std::string, std::string> display_columns;
-        Cortina<std::string, Node<std::string> *> display_columns_final;
+        // Display columns stay typed through the filtering, only the rows
+        // that survive it are turned into text
+        std::vector<std::pair<std::string, ColumnInstance>> display_columns;
+        // Columns the aggregates reduce and the groups are made of, read the
+        // same way
+        std::vector<std::pair<std::string, ColumnInstance>> aggregate_columns;
+        std::vector<std::pair<std::string, ColumnInstance>> group_columns;
 
-        for (auto &display_column : arg.tables) {
-          LSEND("Column {}\n", display_column.sub);
+        auto load_into = [&](std::vector<std::pair<std::string, ColumnInstance>> &columns,
+                             const Parser::NameAndSub &column) {
           auto db = dbs.dbs.get(arg.database);
 
           if (db == nullptr) {
             SEND_ERROR("Database {} does not exist\n", arg.database);
           } else {
 
-            auto table = (*db)->tables.get(display_column.name);
+            auto table = (*db)->tables.get(column.name);
 
             if (table == nullptr) {
               SEND_ERROR("DatabaseTable {} does not exist in {}\n",
-                         display_column.name, arg.database);
+                         column.name, arg.database);
             } else {
-
-              if (display_columns.g(fmt::format("{}.{}", display_column.name, display_column.sub)) == nullptr) {
-                auto result = ColumnInstance::load_column(
-                    arg.database, display_column.name, display_column.sub,
-                    *(*table));
+              auto key = fmt::format("{}.{}", column.name, column.sub);
+              bool loaded = std::any_of(
+                  columns.begin(), columns.end(),
+                  [&](const auto &loaded) { return loaded.first == key; });
+
+              if (!loaded) {
+                auto result = ColumnCache::load(
+                    arg.database, column.name, column.sub, *(*table));
                 if (result.has_error()) {
                   SEND_ERROR("{}\n", result.error());
                 } else {
-                  std::vector<std::string> string_data = result.value().to_string_vec();
-
-                  for (auto &i : string_data)
-                    display_columns.append(fmt::format("{}.{}", display_column.name, display_column.sub), i);
+                  columns.emplace_back(key, std::move(result.value()));
                 }
               }
             }
           }
-        }
+        };
 
-        ListFre<size_t> indexes;
-        for (size_t i = 0; i < display_columns.first()->value.value.len(); i++) {
-          indexes.push(i);
+        // A bit per row, each restriction ANDs its own selection in
+        size_t rows = 0;
+        std::optional<Plan::Step> scan_step(std::in_place, plan,
+                                            Plan::Kind::Scan);
+        for (auto &display_column : arg.tables) {
+          if (!analyze)
+            LSEND("Column {}\n", display_column.sub);
+          load_into(display_columns, display_column);
         }
-
-        // Load each of the columns that are used in the where clause
-        // and then filter the data
-        for (auto &where_column : arg.restrictions) {
-          auto operador = std::get<1>(where_column);
-          auto table_name = std::get<0>(where_column).name;
-          auto column_name = std::get<0>(where_column).sub;
-          auto value = std::get<2>(where_column);
-
-          // Load column values
+        for (auto &aggregate : arg.aggregates) {
+          if (!analyze)
+            LSEND("Aggregate {}\n", Automata::to_string(aggregate));
+          if (aggregate.column)
+            load_into(aggregate_columns, *aggregate.column);
+        }
+        for (auto &key : arg.group_by)
+          load_into(group_columns, key);
+
+        if (!display_columns.empty()) {
+          rows = display_columns.front().second.size;
+        } else if (!group_columns.empty()) {
+          rows = group_columns.front().second.size;
+        } else if (!aggregate_columns.empty()) {
+          rows = aggregate_columns.front().second.size;
+        } else if (!arg.aggregates.empty()) {
+          // Only counts, the rows of the named table or of the first one
+          // restricted are counted straight from its column headers
+          std::string name = arg.aggregates.front().table.value_or(
+              arg.restrictions.empty()
+                  ? std::string()
+                  : std::get<0>(arg.restrictions.front()).name);
           auto db = dbs.dbs.get(arg.database);
-          if (db == nullptr) {
+          auto table = db == nullptr || name.empty()
+                           ? nullptr
+                           : (*db)->tables.get(name);
+          if (name.empty()) {
+            SEND_ERROR("`COUNT(*)` needs a table, name it with `COUNT(table)` "
+                       "or restrict one of its columns\n");
+          } else if (db == nullptr) {
             SEND_ERROR("Database {} does not exist\n", arg.database);
+          } else if (table == nullptr) {
+            SEND_ERROR("DatabaseTable {} does not exist in {}\n", name,
+                       arg.database);
+          } else if (auto flushed = (*table)->flush_appends();
+                     flushed.has_error()) {
+            SEND_ERROR("{}\n", flushed.error());
           } else {
-
-            auto table = (*db)->tables.get(table_name);
-
-            if (table == nullptr) {
-              SEND_ERROR("DatabaseTable {} does not exist in {}\n", table_name,
-                         arg.database);
-            } else {
-              auto result = ColumnInstance::load_column(
-                  arg.database, table_name, column_name, *(*table));
-              if (result.has_error()) {
-                SEND_ERROR("{}\n", result.error());
-              } else {
-                for (int i = 0; i < result.value().size; i++) {
-                  switch (result.value().layout.type) {
-                    case u8: {
-                      std::vector<uint8_t> *vector = reinterpret_cast<std::vector<uint8_t> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<uint8_t>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<uint8_t>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case u16: {
-                      std::vector<uint16_t> *vector = reinterpret_cast<std::vector<uint16_t> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<uint16_t>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<uint16_t>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case u32: {
-                      std::vector<uint32_t> *vector = reinterpret_cast<std::vector<uint32_t> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<uint32_t>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<uint32_t>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case u64: {
-                      std::vector<uint64_t> *vector = reinterpret_cast<std::vector<uint64_t> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<uint64_t>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<uint64_t>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case f64: {
-                      std::vector<double> *vector = reinterpret_cast<std::vector<double> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<double>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<double>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case str: {
-                      std::vector<std::string> *vector = reinterpret_cast<std::vector<std::string> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<std::string>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<std::string>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    case rbool: {
-                      std::vector<bool> *vector = reinterpret_cast<std::vector<bool> *>(result.value().data);
-                      auto r = ColumnInstance::resolve_value(value, result.value().layout);
-                      if (r.has_error()) {
-                        SEND_ERROR("{}\n", r.error());
-                      } else if (!std::holds_alternative<bool>(r.value())) {
-                        SEND_ERROR("Value {} is not of type {}\n", Automata::val_to_string(value), to_string(result.value().layout.type));
-                      } else {
-                        auto v = std::get<bool>(r.value());
-                        if (operador == Parser::OperatorE::EQUAL) {
-                          if (vector->at(i) == v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT) {
-                          if (vector->at(i) > v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS) {
-                          if (vector->at(i) < v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::GREAT_EQUAL) {
-                          if (vector->at(i) >= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::LESS_EQUAL) {
-                          if (vector->at(i) <= v) {
-                            indexes.push(i);
-                          }
-                        } else if (operador == Parser::OperatorE::NOT_EQUAL) {
-                          if (vector->at(i) != v) {
-                            indexes.push(i);
-                          }
-                        }
-                      }
-                    }
-                    break;
-                    default:
-                      SEND_ERROR("Type {} not supported\n", to_string(result.value().layout.type));
-                      break;
-                  }
-                }
-              }
-            }
+            rows = (*table)->row_count(arg.database);
           }
         }
+        std::vector<std::uint64_t> selected(Bitmap::words_for(rows),
+                                            ~std::uint64_t{0});
+        if (!selected.empty())
+          selected.back() &= Bitmap::tail_mask(rows);
+        scan_step.reset();
+        note(Plan::Kind::Scan, rows, rows,
+             bytes_of(display_columns) + bytes_of(aggregate_columns) +
+                 bytes_of(group_columns));
+
+        // Tables of the restrictions, errors are sent once per lookup
+        auto table_of = [&](const Automata::Restriction &restriction)
+            -> std::shared_ptr<DatabaseTable> * {
+          auto db = dbs.dbs.get(arg.database);
+          if (db == nullptr)
+            return nullptr;
+          return (*db)->tables.get(std::get<0>(restriction).name);
+        };
+
+        // `key == v` on the primary key is a probe of its hash index, the
+        // one row it finds is the only one selected
+        auto select_by_key = [&](size_t index, DatabaseTable &table)
+            -> std::optional<Where::Bits> {
+          auto &[column, operador, value] = arg.restrictions[index];
+          if (operador != Parser::OperatorE::EQUAL || !table.primary_key ||
+              *table.primary_key != column.sub ||
+              std::holds_alternative<Parser::Null>(value))
+            return std::nullopt;
+          Layout *layout = table.columns.get(column.sub);
+          auto key_index = table.primary_index(arg.database);
+          if (layout == nullptr || key_index.has_error())
+            return std::nullopt;
+          auto resolved = ColumnInstance::resolve_value(value, *layout);
+          if (resolved.has_error())
+            return std::nullopt;
+          auto key = std::visit(
+              [](const auto &constant) {
+                return DatabaseTable::index_key_of(constant);
+              },
+              resolved.value());
+
+          std::uint64_t rows = table.watermark(arg.database);
+          Where::Bits matched(Bitmap::words_for(rows), 0);
+          auto row = key ? key_index.value()->find(*key) : std::nullopt;
+          if (row && *row < rows)
+            Bitmap::set(matched, *row);
+          note(Plan::Kind::Filter, 0, 0, 2 * sizeof(std::uint64_t));
+          return matched;
+        };
+
+        // Rows of a range restriction on an indexed column, read from the
+        // index in key order. Nothing when the column has no index or the
+        // restriction keeps too many rows for the index to beat a scan.
+        auto select_indexed = [&](size_t index, DatabaseTable &table)
+            -> std::optional<Where::Bits> {
+          auto &[column, operador, value] = arg.restrictions[index];
+          if (std::holds_alternative<Parser::Null>(value))
+            return std::nullopt;
+          auto range_index = table.index_for(arg.database, column.sub);
+          Layout *layout = table.columns.get(column.sub);
+          if (!range_index || layout == nullptr)
+            return std::nullopt;
+          auto resolved = ColumnInstance::resolve_value(value, *layout);
+          if (resolved.has_error())
+            return std::nullopt;
+          auto key = std::visit(
+              [](const auto &constant) {
+                return DatabaseTable::index_key_of(constant);
+              },
+              resolved.value());
+          auto bounds = key ? RangeIndex::bounds(operador, *key)
+                            : std::optional<std::pair<std::uint64_t,
+                                                      std::uint64_t>>{};
+          if (!bounds || table.flush_appends().has_error())
+            return std::nullopt;
+
+          // Rows inserted while the index could not take them are added
+          // from the column first
+          std::uint64_t rows = table.watermark(arg.database);
+          if (range_index->rows() < rows) {
+            auto loaded = ColumnCache::load(arg.database, column.name,
+                                            column.sub, table);
+            if (loaded.has_error() ||
+                range_index
+                    ->extend(rows,
+                             [&](std::uint64_t row) {
+                               return loaded.value().index_key(row);
+                             })
+                    .has_error())
+              return std::nullopt;
+          }
 
-        send << indexes << '\n';
+          auto found = range_index->range(bounds->first, bounds->second,
+                                          rows / RangeIndex::SELECTIVITY);
+          if (!found)
+            return std::nullopt;
+          Where::Bits matched(Bitmap::words_for(rows), 0);
+          for (auto row : *found) {
+            if (row < rows)
+              Bitmap::set(matched, row);
+          }
+          note(Plan::Kind::Filter, 0, 0,
+               found->size() * 2 * sizeof(std::uint64_t));
+          return matched;
+        };
+
+        // Each restriction only scans the rows still undecided, one that
+        // cannot be evaluated matches nothing
+        bool failed = false;
+        auto select_in_table = [&](size_t index,
+                                   const Where::Bits *within) -> Where::Bits {
+          auto &[column, operador, value] = arg.restrictions[index];
+          auto table = table_of(arg.restrictions[index]);
+          if (dbs.dbs.get(arg.database) == nullptr) {
+            failed = true;
+            SEND_ERROR("Database {} does not exist\n", arg.database);
+            return {};
+          } else if (table == nullptr) {
+            failed = true;
+            SEND_ERROR("DatabaseTable {} does not exist in {}\n",
+                       column.name, arg.database);
+            return {};
+          }
 
-        display_columns.for_each_node([&](Node<KeyValue<string, List<string>>> *columns) {
-          size_t i = 0;
-          columns->value.value.for_each_node([&](Node<string> *node) {
-            if (indexes.get(i)->value.fre - 1 == arg.restrictions.size()) {
-              auto a = columns->value.value.get(i);
-              display_columns_final.append(columns->value.key,a);
-            }
+          if (auto found = select_by_key(index, *(*table))) {
+            failed = false;
+            return std::move(*found);
+          }
+          if (auto found = select_indexed(index, *(*table))) {
+            failed = false;
+            return std::move(*found);
+          }
+
+          auto result = ColumnCache::load(
+              arg.database, column.name, column.sub, *(*table));
+          if (result.has_error()) {
+            failed = true;
+            SEND_ERROR("{}\n", result.error());
+            return {};
+          }
+          // Words with no row left to decide are not read
+          size_t bytes = result.value().bytes();
+          if (within != nullptr && !within->empty())
+            bytes = bytes * static_cast<size_t>(std::count_if(
+                                within->begin(), within->end(),
+                                [](std::uint64_t word) { return word != 0; })) /
+                    within->size();
+          note(Plan::Kind::Filter, 0, 0, bytes);
+          auto matched = result.value().select(operador, value, within);
+          if (matched.has_error()) {
+            failed = true;
+            SEND_ERROR("{}\n", matched.error());
+            return {};
+          }
+          return std::move(matched.value());
+        };
+        auto cost_of = [&](size_t index) {
+          auto &[column, operador, value] = arg.restrictions[index];
+          auto table = table_of(arg.restrictions[index]);
+          if (table == nullptr)
+            return Where::Estimate{1, 0.5};
+          std::shared_lock<std::shared_mutex> lock((*table)->mtx_);
+          Layout *layout = (*table)->columns.get(column.sub);
+          if (layout == nullptr)
+            return Where::Estimate{1, 0.5};
+          return Where::estimate(*layout, operador,
+                                 std::holds_alternative<Parser::Null>(value));
+        };
+
+        // With a JOIN the rows of the answer are pairs of rows, one of each
+        // table, and restrictions select pairs through the rows they hold
+        std::optional<Join::Pairs> pairs;
+        auto rows_of = [&](const std::string &table)
+            -> const std::vector<size_t> & {
+          return table == arg.join->left.name ? pairs->left : pairs->right;
+        };
+        auto select_restriction = [&](size_t index,
+                                      const Where::Bits &within) -> Where::Bits {
+          if (!pairs)
+            return select_in_table(index, &within);
+          auto &table = std::get<0>(arg.restrictions[index]).name;
+          return Join::gather(select_in_table(index, nullptr), rows_of(table),
+                              within);
+        };
+
+        Automata::Predicate where = arg.where;
+        if (arg.join) {
+          auto &join = *arg.join;
+          std::vector<std::pair<std::string, ColumnInstance>> key_columns;
+          load_into(key_columns, join.left);
+          load_into(key_columns, join.right);
+          if (key_columns.size() < 2)
+            break;
+          auto &left = key_columns[0].second;
+          auto &right = key_columns[1].second;
+
+          // Conjuncts of the WHERE on one table filter it before the join,
+          // the others are checked on the pairs
+          std::vector<Automata::Predicate> conjuncts{where};
+          if (!where.restriction && where.op == Parser::OperatorE::AND)
+            conjuncts = where.children;
+          Automata::Predicate on_left, on_right, residual;
+          for (auto &conjunct : conjuncts) {
+            auto table = Where::single_table(conjunct, [&](size_t index) {
+              return std::get<0>(arg.restrictions[index]).name;
+            });
+            if (table == join.left.name)
+              on_left.children.push_back(conjunct);
+            else if (table == join.right.name)
+              on_right.children.push_back(conjunct);
+            else
+              residual.children.push_back(conjunct);
+          }
 
-            i++;
-            return false;
-          });
-          return false;
-        });
+          auto all_rows = [](size_t count) {
+            Where::Bits bits(Bitmap::words_for(count), ~std::uint64_t{0});
+            if (!bits.empty())
+              bits.back() &= Bitmap::tail_mask(count);
+            return bits;
+          };
+          Where::Bits left_rows, right_rows;
+          {
+            Plan::Step step(plan, Plan::Kind::Filter);
+            left_rows = Where::evaluate(on_left, all_rows(left.size),
+                                        select_restriction, cost_of);
+            right_rows = Where::evaluate(on_right, all_rows(right.size),
+                                         select_restriction, cost_of);
+          }
+          note(Plan::Kind::Filter, left.size + right.size,
+               count_of(left_rows) + count_of(right_rows));
+          if (failed)
+            break;
+          std::optional<Plan::Step> join_step(std::in_place, plan,
+                                              Plan::Kind::Join);
+          auto joined = Join::hash_join(left, left_rows, right, right_rows);
+          join_step.reset();
+          if (joined.has_error()) {
+            SEND_ERROR("{}\n", joined.error());
+            break;
+          }
+          note(Plan::Kind::Join, count_of(left_rows) + count_of(right_rows),
+               joined.value().size(), left.bytes() + right.bytes());
+          pairs = std::move(joined.value());
+          rows = pairs->size();
+          selected = all_rows(rows);
+          where = std::move(residual);
+        }
 
-        send << display_columns << '\n';
-        send << display_columns_final << '\n';
+        size_t candidates_in = count_of(selected);
+        std::optional<Plan::Step> filter_step(std::in_place, plan,
+                                              Plan::Kind::Filter);
+        if (arg.limit && arg.order_by.empty() && arg.group_by.empty() &&
+            arg.aggregates.empty() && !pairs) {
+          // Any rows do without an order, the WHERE goes over windows of
+          // rows twice as big each time until enough of them match
+          Where::Bits found(selected.size());
+          size_t kept = 0;
+          size_t window = 64 * Bitmap::WORD_BITS;
+          for (size_t from = 0; from < rows && kept < *arg.limit && !failed;
+               from += window, window *= 2) {
+            size_t to = std::min(rows, from + window);
+            Where::Bits candidates(selected.size());
+            std::copy(selected.begin() + from / Bitmap::WORD_BITS,
+                      selected.begin() + Bitmap::words_for(to),
+                      candidates.begin() + from / Bitmap::WORD_BITS);
+            auto matched = Where::evaluate(where, std::move(candidates),
+                                           select_restriction, cost_of);
+            Bitmap::for_each_set(matched, [&](size_t i) {
+              if (kept < *arg.limit) {
+                Bitmap::set(found, i);
+                kept++;
+              }
+            });
+          }
+          selected = std::move(found);
+        } else {
+          selected = Where::evaluate(where, std::move(selected),
+                                     select_restriction, cost_of);
+        }
+        filter_step.reset();
+        if (failed)
+          break;
+        if (where.restriction || !where.children.empty())
+          note(Plan::Kind::Filter, candidates_in, count_of(selected));
+
+        // Sort keys, resolved once the columns are loaded. Ties keep the
+        // order of the rows.
+        std::vector<std::pair<std::string, ColumnInstance>> order_columns;
+        for (auto &order : arg.order_by)
+          load_into(order_columns, order.column);
+        note(Plan::Kind::Sort, 0, 0, bytes_of(order_columns));
+        std::vector<std::pair<const ColumnInstance *, bool>> sort_keys;
+        for (auto &order : arg.order_by) {
+          auto key = fmt::format("{}.{}", order.column.name, order.column.sub);
+          auto column = std::find_if(
+              order_columns.begin(), order_columns.end(),
+              [&](const auto &loaded) { return loaded.first == key; });
+          if (column != order_columns.end())
+            sort_keys.emplace_back(&column->second, order.descending);
+        }
+        if (sort_keys.size() < arg.order_by.size())
+          break;
+        // Row of `column` behind row `i` of the answer
+        auto row_in = [&](const ColumnInstance &column, size_t i) {
+          return pairs ? rows_of(column.column.name)[i] : i;
+        };
+        auto row_less = [&](size_t a, size_t b) {
+          for (auto [column, descending] : sort_keys) {
+            int order = column->compare(row_in(*column, a), row_in(*column, b));
+            if (order != 0)
+              return descending ? order > 0 : order < 0;
+          }
+          return a < b;
+        };
+
+        // The rows go out as a table, under EXPLAIN ANALYZE the plan with
+        // what each operator took goes instead
+        auto answer = [&](fort::char_table &table, size_t count) {
+          std::string text;
+          {
+            Plan::Step step(plan, Plan::Kind::Output);
+            if (count != 0)
+              text = table.to_string();
+          }
+          note(Plan::Kind::Output, count, count);
+          if (analyze) {
+            send << Plan::to_string(plan, true);
+          } else if (count == 0) {
+            LSEND("No results found");
+          } else {
+            send << text << '\n';
+          }
+        };
 
         fort::char_table pp_table;
-        display_columns_final.for_each_c([&](const auto &column) {
-          pp_table << fort::header << column.key;
-          return false;
-        });
-        pp_table << fort::endr;
+        if (!arg.group_by.empty()) {
+          // One row per group, the grouped columns show the values of the
+          // group's first row. Several keys group by the pairs of groups.
+          std::optional<Plan::Step> aggregate_step(std::in_place, plan,
+                                                   Plan::Kind::Aggregate);
+          std::optional<Group::Groups> groups;
+          for (auto &key : arg.group_by) {
+            auto name = fmt::format("{}.{}", key.name, key.sub);
+            auto column = std::find_if(
+                group_columns.begin(), group_columns.end(),
+                [&](const auto &loaded) { return loaded.first == name; });
+            if (column == group_columns.end()) {
+              groups = std::nullopt;
+              break;
+            }
+            auto grouped = column->second.group(selected);
+            if (grouped.has_error()) {
+              SEND_ERROR("{}\n", grouped.error());
+              groups = std::nullopt;
+              break;
+            }
+            groups = groups ? Group::combine(*groups, grouped.value(), selected)
+                            : std::move(grouped.value());
+          }
+          if (!groups)
+            break;
+
+          std::vector<std::vector<std::string>> results;
+          for (auto &aggregate : arg.aggregates) {
+            if (!aggregate.column) {
+              std::vector<std::string> counts;
+              for (auto count : Group::sizes(*groups, selected))
+                counts.push_back(fmt::format("{}", count));
+              results.push_back(std::move(counts));
+              continue;
+            }
+            auto key = fmt::format("{}.{}", aggregate.column->name,
+                                   aggregate.column->sub);
+            auto column = std::find_if(
+                aggregate_columns.begin(), aggregate_columns.end(),
+                [&](const auto &loaded) { return loaded.first == key; });
+            auto value =
+                column == aggregate_columns.end()
+                    ? cpp::result<std::vector<std::string>, std::string>(
+                          std::vector<std::string>(groups->size()))
+                    : column->second.aggregate(aggregate.function, *groups,
+                                               selected);
+            if (value.has_error()) {
+              SEND_ERROR("{}\n", value.error());
+              value = std::vector<std::string>(groups->size());
+            }
+            results.push_back(std::move(value.value()));
+          }
+          aggregate_step.reset();
+          note(Plan::Kind::Aggregate, count_of(selected), groups->size());
+
+          // Groups sort by the values of their first row
+          std::optional<Plan::Step> sort_step(std::in_place, plan,
+                                              Plan::Kind::Sort);
+          auto ranked = Sort::top(
+              [&](auto &&f) {
+                for (size_t g = 0; g < groups->size(); g++)
+                  f(g);
+              },
+              arg.order_by.empty() ? std::optional<std::uint64_t>() : arg.limit,
+              [&](size_t a, size_t b) {
+                return row_less(groups->first[a], groups->first[b]);
+              });
+          if (arg.order_by.empty() && arg.limit && ranked.size() > *arg.limit)
+            ranked.resize(*arg.limit);
+          sort_step.reset();
+          note(Plan::Kind::Sort, groups->size(), ranked.size());
+
+          {
+            Plan::Step step(plan, Plan::Kind::Project);
+            for (auto &[key, column] : display_columns)
+              pp_table << fort::header << key;
+            for (auto &aggregate : arg.aggregates)
+              pp_table << fort::header << Automata::to_string(aggregate);
+            pp_table << fort::endr;
 
+            for (size_t g : ranked) {
+              size_t first = groups->first[g];
+              for (auto &[key, column] : display_columns)
+                pp_table << (first < column.size ? column.value_string(first)
+                                                 : "");
+              for (auto &result : results)
+                pp_table << result[g];
+              pp_table << fort::endr;
+            }
+          }
+          note(Plan::Kind::Project, ranked.size(), ranked.size());
+          answer(pp_table, ranked.size());
+          break;
+        }
 
-        if (display_columns_final.len() <= 0) {
-          LSEND("No results found");
-        } else {
-          for (int j=0; j<display_columns_final.get_at(0)->value.value.len(); j++) {
-            for (int i=0; i<display_columns_final.len(); i++) {
-              pp_table << display_columns_final.get_at(i)->value.value.get(j)->value->value;
+        if (!arg.aggregates.empty()) {
+          // A single row, each aggregate reduces the selected rows of its
+          // column, counts of rows come from the selection alone
+          if (arg.limit == std::uint64_t{0}) {
+            answer(pp_table, 0);
+            break;
+          }
+          std::vector<std::string> values;
+          {
+            Plan::Step step(plan, Plan::Kind::Aggregate);
+            for (auto &aggregate : arg.aggregates) {
+              if (!aggregate.column) {
+                values.push_back(fmt::format("{}", count_of(selected)));
+                continue;
+              }
+              auto key = fmt::format("{}.{}", aggregate.column->name,
+                                     aggregate.column->sub);
+              auto column = std::find_if(
+                  aggregate_columns.begin(), aggregate_columns.end(),
+                  [&](const auto &loaded) { return loaded.first == key; });
+              if (column == aggregate_columns.end()) {
+                values.emplace_back();
+                continue;
+              }
+              auto value =
+                  column->second.aggregate(aggregate.function, selected);
+              if (value.has_error()) {
+                SEND_ERROR("{}\n", value.error());
+                values.emplace_back();
+              } else {
+                values.push_back(std::move(value.value()));
+              }
             }
+          }
+          note(Plan::Kind::Aggregate, count_of(selected), 1);
+
+          {
+            Plan::Step step(plan, Plan::Kind::Project);
+            for (auto &aggregate : arg.aggregates)
+              pp_table << fort::header << Automata::to_string(aggregate);
+            pp_table << fort::endr;
+            for (auto &value : values)
+              pp_table << value;
             pp_table << fort::endr;
           }
+          note(Plan::Kind::Project, 1, 1);
+          answer(pp_table, 1);
+          break;
         }
 
+        std::vector<size_t> ranked;
+        if (!sort_keys.empty()) {
+          Plan::Step step(plan, Plan::Kind::Sort);
+          auto each = [&](auto &&f) { Bitmap::for_each_set(selected, f); };
+          ranked = Sort::top(each, arg.limit, row_less);
+          note(Plan::Kind::Sort, count_of(selected), ranked.size());
+        }
 
-        send << pp_table.to_string() << '\n';
+        size_t shown = 0;
+        {
+          Plan::Step step(plan, Plan::Kind::Project);
+          for (auto &[key, column] : display_columns)
+            pp_table << fort::header << key;
+          pp_table << fort::endr;
+
+          auto show_row = [&](size_t i) {
+            for (auto &[key, column] : display_columns) {
+              size_t row = row_in(column, i);
+              pp_table << (row < column.size ? column.value_string(row) : "");
+            }
+            pp_table << fort::endr;
+            shown++;
+          };
+          if (!sort_keys.empty()) {
+            for (size_t i : ranked)
+              show_row(i);
+          } else {
+            Bitmap::for_each_set(selected, [&](size_t i) {
+              if (!arg.limit || shown < *arg.limit)
+                show_row(i);
+            });
+          }
+        }
+        note(Plan::Kind::Project, sort_keys.empty() ? count_of(selected)
+                                                    : ranked.size(),
+             shown);
+        answer(pp_table, shown);
       }
     } else {
       SEND_ERROR("{}\n", args.error());
@@ -700,7 +1030,19 @@ int main(int argc, char **argv) {
   cxxopts::Options options("toidb-server", "A simple database server");
   options.add_options()("h,help", "Print help")(
       "p,port", "Port to listen on", cxxopts::value<std::string>()->default_value("9999"))(
-      "i,ip", "IP to listen on", cxxopts::value<std::string>()->default_value("[::]"));
+      "i,ip", "IP to listen on", cxxopts::value<std::string>()->default_value("[::]"))(
+      "ack", "When inserts are acknowledged: buffered, logged or flushed",
+      cxxopts::value<std::string>()->default_value("logged"))(
+      "flush-bytes", "Buffered bytes per table that trigger a flush",
+      cxxopts::value<std::size_t>()->default_value("1048576"))(
+      "flush-ms", "Longest time a buffered row waits to be flushed",
+      cxxopts::value<std::size_t>()->default_value("50"))(
+      "workers", "Threads shared by the queries to scan, 0 for one per core",
+      cxxopts::value<std::size_t>()->default_value("0"))(
+      "query-threads", "Most threads one query scans with, 0 for all the workers",
+      cxxopts::value<std::size_t>()->default_value("0"))(
+      "cache-bytes", "Bytes of decoded columns kept between queries",
+      cxxopts::value<std::size_t>()->default_value("268435456"));
 
   auto args = options.parse(argc, argv);
 
@@ -777,6 +1119,29 @@ int main(int argc, char **argv) {
   LOG("App data path : {}", app_data.path);
   LOG("Logger path   : {}", log->path_.path);
 
+  auto ack = ack_mode_from_string(args["ack"].as<std::string>());
+  if (!ack.has_value()) {
+    ERROR("Invalid ack mode {}", args["ack"].as<std::string>());
+    return 1;
+  }
+  AppendOptions &append_options = AppendOptions::global();
+  append_options.ack = *ack;
+  append_options.flush_bytes = args["flush-bytes"].as<std::size_t>();
+  append_options.flush_interval =
+      std::chrono::milliseconds(args["flush-ms"].as<std::size_t>());
+
+  LOG("Insert ack    : {}", to_string(append_options.ack));
+
+  Pool::Options &pool_options = Pool::Options::global();
+  pool_options.workers = args["workers"].as<std::size_t>();
+  pool_options.degree = args["query-threads"].as<std::size_t>();
+
+  LOG("Query threads : {}", Pool::degree());
+
+  ColumnCache::Options::global().bytes = args["cache-bytes"].as<std::size_t>();
+
+  LOG("Column cache  : {} bytes", ColumnCache::Options::global().bytes);
+
   LOG("Setting working directory to {}", data_path.path);
 
   if (!FileManager::Path::set_working_dir(data_path)) {
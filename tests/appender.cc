@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../src/lib/appender.hpp"
+#include "../src/lib/fm.hpp"
+#include "helpers.hpp"
+
+static const Layout U8{.size = 1, .optional = false, .type = ColumnType::u8};
+static const Layout U32{.size = 4, .optional = false, .type = ColumnType::u32};
+
+static FileManager::Path make_table_dir(const std::string &table) {
+  auto path = fresh_dir("appender/" + table);
+  EXPECT_TRUE(path.create_as_dir());
+  return path;
+}
+
+static std::size_t file_size(const FileManager::Path &path) {
+  if (!path.exists())
+    return 0;
+  return FileManager::read_to_vec(path.path).size();
+}
+
+TEST(Appender, FlushedModeWritesBeforeReturning) {
+  auto table = make_table_dir("flushed");
+  AppendOptions options;
+  options.ack = AckMode::Flushed;
+  TableAppender appender("appender", "flushed", {{"a", U32}, {"b", U8}}, 0, nullptr, options);
+
+  TableAppender::Row row{{1, 2, 3, 4}, {5}};
+  ASSERT_FALSE(appender.append(row).has_error());
+
+  EXPECT_EQ(file_size(table / "a.col"), 4);
+  EXPECT_EQ(file_size(table / "b.col"), 1);
+}
+
+TEST(Appender, BufferedModeWaitsForFlush) {
+  auto table = make_table_dir("buffered");
+  AppendOptions options;
+  options.ack = AckMode::Buffered;
+  options.flush_bytes = 1 << 20;
+  options.flush_interval = std::chrono::hours(1);
+  TableAppender appender("appender", "buffered", {{"a", U8}}, 0, nullptr, options);
+
+  for (int i = 0; i < 10; i++) {
+    TableAppender::Row row{{static_cast<std::uint8_t>(i)}};
+    ASSERT_FALSE(appender.append(row).has_error());
+  }
+
+  EXPECT_EQ(file_size(table / "a.col"), 0);
+  ASSERT_FALSE(appender.flush().has_error());
+  EXPECT_EQ(file_size(table / "a.col"), 10);
+}
+
+TEST(Appender, ConcurrentInsertersKeepEveryRow) {
+  auto table = make_table_dir("concurrent");
+  AppendOptions options;
+  options.ack = AckMode::Flushed;
+  TableAppender appender("appender", "concurrent", {{"a", U32}, {"b", U8}}, 0, nullptr, options);
+
+  const int THREADS = 8;
+  const int ROWS = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; t++) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < ROWS; i++) {
+        TableAppender::Row row{{1, 2, 3, 4, 5, 6, 7, 8}, {1}};
+        EXPECT_FALSE(appender.append(row).has_error());
+      }
+    });
+  }
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(file_size(table / "a.col"), THREADS * ROWS * 8);
+  EXPECT_EQ(file_size(table / "b.col"), THREADS * ROWS);
+}
+
+TEST(Appender, DiscardDropsQueuedRows) {
+  auto table = make_table_dir("discard");
+  AppendOptions options;
+  options.ack = AckMode::Buffered;
+  options.flush_interval = std::chrono::hours(1);
+  {
+    TableAppender appender("appender", "discard", {{"a", U8}}, 0, nullptr, options);
+    TableAppender::Row row{{1}};
+    ASSERT_FALSE(appender.append(row).has_error());
+    appender.discard();
+    EXPECT_TRUE(appender.append(row).has_error());
+  }
+
+  EXPECT_EQ(file_size(table / "a.col"), 0);
+}
+
+TEST(Appender, LoggedModeWritesTheLogFirst) {
+  auto table = make_table_dir("logged");
+  auto log_path = (table / "wal.log").path;
+  auto log = WriteAheadLog::open(log_path).value();
+  log->checkpoint_bytes = 0;
+
+  AppendOptions options;
+  options.ack = AckMode::Logged;
+  options.flush_interval = std::chrono::hours(1);
+  TableAppender appender("appender", "logged", {{"a", U8}}, 0, log, options);
+
+  TableAppender::Row row{{7, 7}};
+  ASSERT_FALSE(appender.append(row).has_error());
+
+  // Acknowledged once logged, the column is written later
+  EXPECT_EQ(WriteAheadLog::read(log_path).size(), 1);
+  EXPECT_EQ(file_size(table / "a.col"), 0);
+
+  // Once applied nothing is left to replay
+  ASSERT_FALSE(appender.flush().has_error());
+  EXPECT_EQ(file_size(table / "a.col"), 2);
+  EXPECT_EQ(WriteAheadLog::read(log_path).size(), 0);
+}
+
+TEST(Appender, FailedWriteStopsLaterRows) {
+  auto table = make_table_dir("failed");
+  AppendOptions options;
+  options.ack = AckMode::Flushed;
+  TableAppender appender("appender", "failed", {{"a", U32}, {"b", U8}}, 0, nullptr, options);
+
+  // A directory where column b should be makes its write fail after
+  // column a already took the row
+  ASSERT_TRUE((table / "b.col").create_as_dir());
+
+  TableAppender::Row row{{1, 2, 3, 4}, {5}};
+  EXPECT_TRUE(appender.append(row).has_error());
+  EXPECT_EQ(file_size(table / "a.col"), 4);
+
+  // Later rows would be misaligned between a and b, they are refused
+  TableAppender::Row next{{6, 7, 8, 9}, {10}};
+  EXPECT_TRUE(appender.append(next).has_error());
+  EXPECT_TRUE(appender.flush().has_error());
+  EXPECT_EQ(file_size(table / "a.col"), 4);
+}
+
+TEST(Appender, WritesWaitForReaders) {
+  auto table = make_table_dir("reading");
+  AppendOptions options;
+  options.ack = AckMode::Flushed;
+  TableAppender appender("appender", "reading", {{"a", U8}}, 0, nullptr, options);
+
+  std::thread writer;
+  {
+    auto reading = appender.read_lock();
+    writer = std::thread([&] {
+      TableAppender::Row row{{1}};
+      EXPECT_FALSE(appender.append(row).has_error());
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(file_size(table / "a.col"), 0);
+  }
+  writer.join();
+  EXPECT_EQ(file_size(table / "a.col"), 1);
+}
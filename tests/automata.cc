@@ -25,3 +25,208 @@ TEST(Automata, DeleteDatabaseValid) {
 
   EXPECT_FALSE(result.has_error());
 }
+
+TEST(Automata, NullableColumnsAndNullValues) {
+  std::string create = "CREATE TABLE db.t (u32 a NULL, str10 b, bool c NULL);";
+  auto table(Automata::get_action_struct(Parser::parse(create), create));
+  ASSERT_FALSE(table.has_error());
+  auto &columns = std::get<Automata::CreateTable>(table.value()).columns;
+  EXPECT_TRUE(columns.get("a")->optional);
+  EXPECT_FALSE(columns.get("b")->optional);
+  EXPECT_TRUE(columns.get("c")->optional);
+
+  std::string insert = "INSERT INTO db.t (NULL, \"x\", NULL);";
+  auto row(Automata::get_action_struct(Parser::parse(insert), insert));
+  ASSERT_FALSE(row.has_error());
+  auto &values = std::get<Automata::Insert>(row.value()).values;
+  EXPECT_TRUE(std::holds_alternative<Parser::Null>(values.get(0)->value));
+  EXPECT_TRUE(std::holds_alternative<Parser::String>(values.get(1)->value));
+
+  std::string misplaced = "CREATE TABLE db.t (u32 NULL a);";
+  EXPECT_TRUE(Automata::get_action_struct(Parser::parse(misplaced), misplaced)
+                  .has_error());
+}
+
+TEST(Automata, WhereBuildsAPredicateTree) {
+  std::string query = "USING db SELECT t.a WHERE t.a == 1 OR ( t.b > 2 AND "
+                      "t.c < 3 ) AND t.d == 4 ;";
+  auto select(Automata::get_action_struct(Parser::parse(query), query));
+  ASSERT_FALSE(select.has_error()) << select.error();
+  auto &arg = std::get<Automata::Show_Select>(select.value());
+  ASSERT_EQ(arg.restrictions.size(), 4);
+
+  // a OR (b AND c AND d), the parenthesis joins the AND it is in
+  auto &root = arg.where;
+  EXPECT_EQ(root.op, Parser::OperatorE::OR);
+  ASSERT_EQ(root.children.size(), 2);
+  EXPECT_EQ(root.children[0].restriction, 0);
+  auto &all = root.children[1];
+  EXPECT_EQ(all.op, Parser::OperatorE::AND);
+  ASSERT_EQ(all.children.size(), 3);
+  EXPECT_EQ(all.children[0].restriction, 1);
+  EXPECT_EQ(all.children[1].restriction, 2);
+  EXPECT_EQ(all.children[2].restriction, 3);
+
+  for (std::string bad : {"USING db SELECT t.a WHERE ( t.a == 1 ;",
+                          "USING db SELECT t.a WHERE t.a == 1 ) ;",
+                          "USING db SELECT t.a WHERE t.a == 1 OR ;",
+                          "USING db SELECT t.a WHERE ( ) ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, SelectTakesAggregates) {
+  std::string query = "USING db SELECT COUNT ( * ) , SUM ( t.a ) , COUNT ( t ) "
+                      "WHERE t.b > 2 ;";
+  auto select(Automata::get_action_struct(Parser::parse(query), query));
+  ASSERT_FALSE(select.has_error()) << select.error();
+  auto &arg = std::get<Automata::Show_Select>(select.value());
+  EXPECT_TRUE(arg.tables.empty());
+  ASSERT_EQ(arg.aggregates.size(), 3);
+  EXPECT_EQ(Automata::to_string(arg.aggregates[0]), "COUNT(*)");
+  EXPECT_EQ(Automata::to_string(arg.aggregates[1]), "SUM(t.a)");
+  EXPECT_EQ(Automata::to_string(arg.aggregates[2]), "COUNT(t)");
+  EXPECT_EQ(arg.restrictions.size(), 1);
+
+  for (std::string bad : {"USING db SELECT SUM ( * ) ;",
+                          "USING db SELECT MAX ( t ) ;",
+                          "USING db SELECT t.a , COUNT ( * ) ;",
+                          "USING db SELECT COUNT ( t.a ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, GroupByTakesColumns) {
+  std::string query = "USING db SELECT t.a , COUNT ( * ) WHERE t.b > 2 "
+                      "GROUP BY t.a , t.c ;";
+  auto select(Automata::get_action_struct(Parser::parse(query), query));
+  ASSERT_FALSE(select.has_error()) << select.error();
+  auto &arg = std::get<Automata::Show_Select>(select.value());
+  ASSERT_EQ(arg.group_by.size(), 2);
+  EXPECT_EQ(arg.group_by[1].sub, "c");
+  EXPECT_EQ(arg.restrictions.size(), 1);
+
+  for (std::string bad : {"USING db SELECT t.b , COUNT ( * ) GROUP BY t.a ;",
+                          "USING db SELECT COUNT ( * ) GROUP t.a ;",
+                          "USING db SELECT COUNT ( * ) GROUP BY ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, OrderByAndLimit) {
+  std::string query = "USING db SELECT t.a , t.b WHERE t.a > 2 ORDER BY t.b "
+                      "DESC , t.a LIMIT 50 ;";
+  auto select(Automata::get_action_struct(Parser::parse(query), query));
+  ASSERT_FALSE(select.has_error()) << select.error();
+  auto &arg = std::get<Automata::Show_Select>(select.value());
+  ASSERT_EQ(arg.order_by.size(), 2);
+  EXPECT_EQ(arg.order_by[0].column.sub, "b");
+  EXPECT_TRUE(arg.order_by[0].descending);
+  EXPECT_FALSE(arg.order_by[1].descending);
+  EXPECT_EQ(arg.limit, 50u);
+
+  std::string limited = "USING db SELECT t.a LIMIT 3 ;";
+  auto only(Automata::get_action_struct(Parser::parse(limited), limited));
+  ASSERT_FALSE(only.has_error()) << only.error();
+  EXPECT_TRUE(std::get<Automata::Show_Select>(only.value()).order_by.empty());
+
+  for (std::string bad : {"USING db SELECT t.a ORDER BY t.a LIMIT ;",
+                          "USING db SELECT t.a LIMIT 3 ORDER BY t.a ;",
+                          "USING db SELECT t.a ORDER BY DESC ;",
+                          "USING db SELECT t.a ORDER BY t.a GROUP BY t.a ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, JoinTakesEqualColumns) {
+  std::string query = "USING db SELECT a.x , b.y JOIN b ON a.id == b.aid "
+                      "WHERE b.y > 2 ORDER BY a.x LIMIT 5 ;";
+  auto select(Automata::get_action_struct(Parser::parse(query), query));
+  ASSERT_FALSE(select.has_error()) << select.error();
+  auto &arg = std::get<Automata::Show_Select>(select.value());
+  ASSERT_TRUE(arg.join.has_value());
+  EXPECT_EQ(arg.join->table, "b");
+  EXPECT_EQ(arg.join->left.name, "a");
+  EXPECT_EQ(arg.join->left.sub, "id");
+  EXPECT_EQ(arg.join->right.sub, "aid");
+  EXPECT_EQ(arg.limit, 5u);
+
+  for (std::string bad : {"USING db SELECT a.x JOIN b ON a.id == a.y ;",
+                          "USING db SELECT a.x JOIN c ON a.id == b.y ;",
+                          "USING db SELECT a.x JOIN b ON a.id b.y ;",
+                          "USING db SELECT a.x , c.z JOIN b ON a.id == b.y ;",
+                          "USING db SELECT a.x , COUNT(*) JOIN b ON a.id == "
+                          "b.y ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, ExplainWrapsASelect) {
+  for (auto [query, explain] :
+       {std::pair{"EXPLAIN USING db SELECT t.a ;", Automata::Explain::Plan},
+        std::pair{"EXPLAIN ANALYZE USING db SELECT t.a WHERE t.a > 1 ;",
+                  Automata::Explain::Analyze},
+        std::pair{"USING db SELECT t.a ;", Automata::Explain::None}}) {
+    std::string text = query;
+    auto select(Automata::get_action_struct(Parser::parse(text), text));
+    ASSERT_FALSE(select.has_error()) << select.error();
+    EXPECT_EQ(std::get<Automata::Show_Select>(select.value()).explain, explain)
+        << text;
+  }
+
+  for (std::string bad : {"EXPLAIN CREATE DATABASE db ;",
+                          "USING db SELECT t.a EXPLAIN ;",
+                          "EXPLAIN EXPLAIN USING db SELECT t.a ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, CreateIndexNamesAColumn) {
+  std::string text = "CREATE INDEX ON db.t (a) ;";
+  auto create(Automata::get_action_struct(Parser::parse(text), text));
+  ASSERT_FALSE(create.has_error()) << create.error();
+  auto &index = std::get<Automata::CreateIndex>(create.value());
+  EXPECT_EQ(index.database, "db");
+  EXPECT_EQ(index.table, "t");
+  EXPECT_EQ(index.column, "a");
+
+  for (std::string bad : {"CREATE INDEX ON db.t ;", "CREATE INDEX db.t (a) ;",
+                          "CREATE INDEX ON t (a) ;",
+                          "CREATE INDEX ON db.t (a, b) ;",
+                          "CREATE INDEX ON db.t () ;",
+                          "USING db SELECT t.a INDEX ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, CreateTableTakesOnePrimaryKey) {
+  std::string text = "CREATE TABLE db.t (u64 id PK, i32 qty NULL) ;";
+  auto create(Automata::get_action_struct(Parser::parse(text), text));
+  ASSERT_FALSE(create.has_error()) << create.error();
+  auto &table = std::get<Automata::CreateTable>(create.value());
+  EXPECT_EQ(table.primary_key, std::optional<std::string>("id"));
+  EXPECT_FALSE(table.columns.get("id")->optional);
+
+  for (std::string bad : {"CREATE TABLE db.t (u64 id PK, u64 other PK) ;",
+                          "CREATE TABLE db.t (u64 id NULL PK) ;",
+                          "CREATE TABLE db.t (u64 PK id) ;",
+                          "USING db SELECT t.a PK ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
+
+TEST(Automata, CreateTableMarksUniqueColumns) {
+  std::string text =
+      "CREATE TABLE db.t (u64 id PK, vstr20 mail NULL UN, u32 code UN) ;";
+  auto create(Automata::get_action_struct(Parser::parse(text), text));
+  ASSERT_FALSE(create.has_error()) << create.error();
+  auto &table = std::get<Automata::CreateTable>(create.value());
+  EXPECT_EQ(table.unique, (std::vector<std::string>{"mail", "code"}));
+  EXPECT_TRUE(table.columns.get("mail")->optional);
+
+  for (std::string bad : {"CREATE TABLE db.t (u64 id UN NULL) ;",
+                          "CREATE TABLE db.t (u64 UN id) ;",
+                          "CREATE TABLE db.t (u64 id UN UN) ;"})
+    EXPECT_TRUE(Automata::get_action_struct(Parser::parse(bad), bad).has_error())
+        << bad;
+}
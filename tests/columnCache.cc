@@ -0,0 +1,103 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/columnCache.hpp"
+#include "helpers.hpp"
+
+static DatabaseTable make_table(const std::string &name,
+                                ColumnType type = ColumnType::u32,
+                                std::uint64_t size = 4) {
+  fresh_dir("cache/" + name);
+
+  KeyValueList<std::string, Layout> layout{
+      {"a", {.size = size, .optional = false, .type = type}}};
+  std::string table = name;
+  return DatabaseTable::createTable("cache", table, layout).value();
+}
+
+static void append(DatabaseTable &table, std::uint8_t value,
+                   std::size_t width = 4) {
+  TableAppender::Row row{std::vector<std::uint8_t>(width, 0)};
+  row[0][0] = value;
+  ASSERT_FALSE(table.appender_for("cache")->append(row).has_error());
+}
+
+// A column read again comes from the cache, rows inserted since are added
+// to the entry without loading it again
+TEST(ColumnCache, HitsAndExtendsWithInsertedRows) {
+  auto table = make_table("hits");
+  append(table, 7);
+
+  auto before = ColumnCache::stats();
+  auto first = ColumnCache::load("cache", "hits", "a", table);
+  ASSERT_FALSE(first.has_error()) << first.error();
+  auto again = ColumnCache::load("cache", "hits", "a", table);
+  ASSERT_FALSE(again.has_error()) << again.error();
+  EXPECT_EQ(again->data, first->data);
+  EXPECT_EQ(ColumnCache::stats().hits, before.hits + 1);
+
+  append(table, 8);
+  auto grown = ColumnCache::load("cache", "hits", "a", table);
+  ASSERT_FALSE(grown.has_error()) << grown.error();
+  EXPECT_EQ(grown->size, 2u);
+  EXPECT_EQ(grown->value_string(1), "8");
+  EXPECT_EQ(first->size, 1u);
+  EXPECT_EQ(ColumnCache::stats().misses, before.misses + 1);
+  EXPECT_EQ(ColumnCache::stats().extensions, before.extensions + 1);
+  ColumnCache::forget("cache", "hits");
+}
+
+// Compressed columns decode only the pages past the cached rows and their
+// zone map grows with them, a query still holding the old values keeps them
+TEST(ColumnCache, ExtendsPagedColumnsPastHeldValues) {
+  auto table = make_table("paged", ColumnType::u64, 8);
+  for (std::size_t i = 0; i < ColumnFile::PAGE_ROWS + 10; i++)
+    append(table, static_cast<std::uint8_t>(i), 8);
+
+  auto before = ColumnCache::stats();
+  auto held = ColumnCache::load("cache", "paged", "a", table);
+  ASSERT_FALSE(held.has_error()) << held.error();
+  ASSERT_FALSE(held->is_mapped());
+
+  append(table, 200, 8);
+  auto grown = ColumnCache::load("cache", "paged", "a", table);
+  ASSERT_FALSE(grown.has_error()) << grown.error();
+  EXPECT_EQ(grown->size, ColumnFile::PAGE_ROWS + 11);
+  EXPECT_EQ(grown->value_string(ColumnFile::PAGE_ROWS + 10), "200");
+  EXPECT_EQ(grown->value_string(ColumnFile::PAGE_ROWS + 1), "1");
+  EXPECT_EQ(held->size, ColumnFile::PAGE_ROWS + 10);
+  ASSERT_TRUE(grown->zones && held->zones);
+  EXPECT_EQ(grown->zones->rows(), ColumnFile::PAGE_ROWS + 11);
+  EXPECT_EQ(held->zones->rows(), ColumnFile::PAGE_ROWS + 10);
+  EXPECT_FALSE(grown->zones->may_match(1, Parser::OperatorE::GREAT,
+                                       std::uint64_t{200}));
+  EXPECT_TRUE(grown->zones->may_match(1, Parser::OperatorE::EQUAL,
+                                      std::uint64_t{200}));
+  EXPECT_EQ(ColumnCache::stats().extensions, before.extensions + 1);
+  ColumnCache::forget("cache", "paged");
+}
+
+// Over the budget unused entries go, those a query holds stay
+TEST(ColumnCache, EvictsOnlyUnpinnedEntries) {
+  auto budget = ColumnCache::Options::global().bytes;
+  ColumnCache::Options::global().bytes = 6;
+  auto one = make_table("one");
+  auto two = make_table("two");
+  append(one, 1);
+  append(two, 2);
+
+  auto before = ColumnCache::stats();
+  {
+    auto held = ColumnCache::load("cache", "one", "a", one);
+    ASSERT_FALSE(held.has_error()) << held.error();
+    ASSERT_FALSE(ColumnCache::load("cache", "two", "a", two).has_error());
+    EXPECT_EQ(ColumnCache::stats().evictions, before.evictions);
+  }
+  ASSERT_FALSE(ColumnCache::load("cache", "two", "a", two).has_error());
+  ASSERT_FALSE(ColumnCache::load("cache", "one", "a", one).has_error());
+  EXPECT_GT(ColumnCache::stats().evictions, before.evictions);
+  EXPECT_LE(ColumnCache::stats().bytes, 6u);
+
+  ColumnCache::forget("cache");
+  EXPECT_EQ(ColumnCache::stats().entries, 0u);
+  ColumnCache::Options::global().bytes = budget;
+}
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/bitmap.hpp"
+#include "../src/lib/columnFile.hpp"
+#include "../src/lib/fm.hpp"
+#include "helpers.hpp"
+
+static const Layout U64{.size = 8, .optional = false, .type = ColumnType::u64};
+
+static std::vector<std::uint8_t> encode_range(std::uint64_t from,
+                                              std::uint64_t to) {
+  std::vector<std::uint8_t> out;
+  for (std::uint64_t i = from; i < to; i++)
+    Codec::push(out, i);
+  return out;
+}
+
+TEST(ColumnFile, HeaderRoundTrip) {
+  auto header = ColumnFile::Header::for_layout(U64);
+  auto encoded = header.encode();
+
+  auto parsed = ColumnFile::Header::parse(encoded.data(), encoded.size());
+  ASSERT_TRUE(parsed.has_value());
+  EXPECT_EQ(parsed->version, ColumnFile::VERSION);
+  EXPECT_EQ(parsed->type, ColumnType::u64);
+  EXPECT_EQ(parsed->stride, 8);
+
+  std::vector<std::uint8_t> legacy(64, 0);
+  EXPECT_FALSE(ColumnFile::Header::parse(legacy.data(), legacy.size()));
+}
+
+TEST(ColumnFile, ZoneMapSkipsPagesOutOfRange) {
+  ColumnFile::ZoneMap zones{ColumnType::u64, 100, {}};
+  auto values = encode_range(0, 250);
+  zones.extend(values.data(), 250);
+
+  ASSERT_EQ(zones.pages.size(), 3);
+  EXPECT_EQ(zones.pages[2].rows, 50);
+
+  EXPECT_FALSE(zones.may_match(0, Parser::OperatorE::GREAT, 150ull));
+  EXPECT_TRUE(zones.may_match(1, Parser::OperatorE::GREAT, 150ull));
+  EXPECT_TRUE(zones.may_match(2, Parser::OperatorE::GREAT, 150ull));
+  EXPECT_FALSE(zones.may_match(1, Parser::OperatorE::EQUAL, 5ull));
+  EXPECT_TRUE(zones.may_match(0, Parser::OperatorE::LESS_EQUAL, 0ull));
+  EXPECT_FALSE(zones.may_match(1, Parser::OperatorE::LESS, 100ull));
+}
+
+TEST(ColumnFile, ZoneMapSignedAndDouble) {
+  ColumnFile::ZoneMap ints{ColumnType::i32, 4, {}};
+  std::vector<std::uint8_t> values;
+  for (std::int32_t v : {-5, -1, -3, -2})
+    Codec::push(values, v);
+  ints.extend(values.data(), 4);
+  EXPECT_FALSE(ints.may_match(0, Parser::OperatorE::GREAT, 0ll));
+  EXPECT_TRUE(ints.may_match(0, Parser::OperatorE::LESS, -4ll));
+
+  ColumnFile::ZoneMap doubles{ColumnType::f64, 4, {}};
+  values.clear();
+  for (double v : {1.5, 2.5})
+    Codec::push(values, v);
+  doubles.extend(values.data(), 2);
+  EXPECT_FALSE(doubles.may_match(0, Parser::OperatorE::LESS, 1.0));
+  EXPECT_TRUE(doubles.may_match(0, Parser::OperatorE::EQUAL, 2.0));
+}
+
+TEST(ColumnFile, WriterKeepsZoneMapAndLoadRepairsIt) {
+  auto path = fresh_file("zones", "col");
+  ASSERT_FALSE(ColumnFile::create(path, U64).has_error());
+  std::remove(ColumnFile::zone_map_path(path).c_str());
+
+  ColumnFile::Writer writer(path, U64);
+  auto first = encode_range(0, 5000);
+  auto second = encode_range(5000, 9000);
+  ASSERT_FALSE(writer.append(first.data(), first.size(), false).has_error());
+  ASSERT_FALSE(writer.append(second.data(), second.size(), false).has_error());
+
+  EXPECT_EQ(ColumnFile::row_count(path, U64), 9000);
+
+  auto values = encode_range(0, 9000);
+  auto zones = ColumnFile::ZoneMap::load(ColumnFile::zone_map_path(path), U64,
+                                         values.data(), 9000);
+  ASSERT_EQ(zones.pages.size(), 3);
+  EXPECT_EQ(zones.pages[1].min, 4096);
+  EXPECT_EQ(zones.pages[2].max, 8999);
+
+  // Corrupt the middle entry, it gets computed again from the values
+  auto stored = FileManager::read_to_vec(ColumnFile::zone_map_path(path));
+  stored[16 + 24 + 10] ^= 0xFF;
+  FileManager::write_to_file(ColumnFile::zone_map_path(path), stored);
+
+  zones = ColumnFile::ZoneMap::load(ColumnFile::zone_map_path(path), U64,
+                                    values.data(), 9000);
+  EXPECT_EQ(zones.pages[1].min, 4096);
+  EXPECT_EQ(zones.pages[1].max, 8191);
+}
+
+TEST(ColumnFile, VarlenWriterKeepsOffsetsAndHeap) {
+  static const Layout VSTR{.size = 64, .optional = false,
+                           .type = ColumnType::vstr};
+  auto path = fresh_file("varlen", "col");
+  ASSERT_FALSE(ColumnFile::create(path, VSTR).has_error());
+
+  std::vector<std::uint8_t> rows;
+  for (auto value : {"a", "", "hello"})
+    Codec::push_varlen(rows, value);
+
+  ColumnFile::Writer writer(path, VSTR);
+  ASSERT_FALSE(writer.append(rows.data(), rows.size(), false).has_error());
+  EXPECT_EQ(ColumnFile::row_count(path, VSTR), 3);
+
+  // Bytes of a value whose offset never made it are dropped
+  FileManager::append_to_file(ColumnFile::heap_path(path),
+                              std::vector<std::uint8_t>{'x', 'y'});
+  rows.clear();
+  Codec::push_varlen(rows, "end");
+  ColumnFile::Writer reopened(path, VSTR);
+  ASSERT_FALSE(reopened.append(rows.data(), rows.size(), false).has_error());
+
+  auto heap = FileManager::read_to_vec(ColumnFile::heap_path(path));
+  EXPECT_EQ(std::string(heap.begin(), heap.end()), "ahelloend");
+
+  auto offsets = FileManager::read_to_vec(path);
+  ASSERT_EQ(offsets.size(), ColumnFile::HEADER_SIZE + 4 * 8);
+  std::vector<std::uint64_t> ends;
+  for (std::size_t i = 0; i < 4; i++)
+    ends.push_back(Codec::load<std::uint64_t>(offsets.data() +
+                                              ColumnFile::HEADER_SIZE + i * 8));
+  EXPECT_EQ(ends, (std::vector<std::uint64_t>{1, 1, 6, 9}));
+}
+
+TEST(ColumnFile, BoolsArePackedAcrossAppends) {
+  static const Layout BOOL{.size = 1, .optional = false,
+                           .type = ColumnType::rbool};
+  auto path = fresh_file("flags", "col");
+  ASSERT_FALSE(ColumnFile::create(path, BOOL).has_error());
+
+  std::vector<std::uint8_t> flags;
+  for (std::size_t i = 0; i < 100; i++)
+    flags.push_back(i % 3 == 0);
+
+  ColumnFile::Writer writer(path, BOOL);
+  ASSERT_FALSE(writer.append(flags.data(), 60, false).has_error());
+  ASSERT_FALSE(writer.append(flags.data() + 60, 40, false).has_error());
+  EXPECT_EQ(ColumnFile::row_count(path, BOOL), 100);
+
+  auto stored = FileManager::read_to_vec(path);
+  ASSERT_EQ(stored.size(), ColumnFile::HEADER_SIZE + 2 * 8);
+  const std::uint8_t *bits = stored.data() + ColumnFile::HEADER_SIZE;
+  for (std::size_t i = 0; i < 100; i++)
+    EXPECT_EQ(Bitmap::get(bits, i), i % 3 == 0) << i;
+  EXPECT_EQ(Bitmap::count(bits, 100), 34);
+
+  // Words past the row count are not part of the column
+  EXPECT_EQ(ColumnFile::repair(path, BOOL).value(), 100);
+}
+
+TEST(ColumnFile, NullsOnlyKeepPagesThatHoldThem) {
+  static const Layout OPTIONAL{.size = 4, .optional = true,
+                               .type = ColumnType::u32};
+  auto path = fresh_file("maybe", "col");
+  auto nulls = ColumnFile::nulls_path(path);
+  ASSERT_FALSE(ColumnFile::create(path, OPTIONAL).has_error());
+
+  // Three pages, nulls in the first and the last one
+  auto flagged = [](std::uint32_t from, std::uint32_t to) {
+    std::vector<std::uint8_t> out;
+    for (std::uint32_t i = from; i < to; i++) {
+      bool null = i == 10 || i == 8200 || i == 8201;
+      out.push_back(null ? 0 : 1);
+      Codec::push(out, null ? 0 : i);
+    }
+    return out;
+  };
+  ColumnFile::Writer writer(path, OPTIONAL);
+  auto first = flagged(0, 5000);
+  auto second = flagged(5000, 9000);
+  ASSERT_FALSE(writer.append(first.data(), first.size(), false).has_error());
+  ASSERT_FALSE(writer.append(second.data(), second.size(), false).has_error());
+
+  EXPECT_EQ(ColumnFile::row_count(path, OPTIONAL), 9000);
+  EXPECT_EQ(FileManager::Path(nulls).get_file_size(),
+            2 * ColumnFile::NullMap::ENTRY_SIZE);
+
+  auto map = ColumnFile::NullMap::load(nulls, 9000);
+  ASSERT_EQ(map.pages.size(), 2);
+  EXPECT_EQ(map.count(), 3);
+  std::vector<std::uint64_t> rows;
+  map.for_each([&](std::uint64_t row) { rows.push_back(row); });
+  EXPECT_EQ(rows, (std::vector<std::uint64_t>{10, 8200, 8201}));
+  EXPECT_TRUE(map.contains(8201));
+  EXPECT_FALSE(map.contains(11));
+  EXPECT_FALSE(map.contains(5000));
+
+  std::vector<std::uint64_t> selected(Bitmap::words_for(9000), ~0ull);
+  map.clear(selected);
+  EXPECT_EQ(selected[0], ~(1ull << 10));
+  EXPECT_EQ(selected[64], ~0ull);
+  EXPECT_EQ(selected[8200 / 64], ~(3ull << (8200 % 64)));
+
+  // A null whose value never made it is not a null of the row taking its
+  // place
+  auto cut = flagged(8200, 8201);
+  ASSERT_FALSE(writer.append(cut.data(), cut.size(), false).has_error());
+  ASSERT_TRUE(FileManager::resize_file(path, ColumnFile::HEADER_SIZE + 9000 * 4));
+  EXPECT_EQ(ColumnFile::NullMap::load(nulls, 9000).count(), 3);
+
+  ColumnFile::Writer reopened(path, OPTIONAL);
+  auto value = flagged(9000, 9001);
+  ASSERT_FALSE(reopened.append(value.data(), value.size(), false).has_error());
+  EXPECT_EQ(ColumnFile::NullMap::load(nulls, 9001).count(), 3);
+}
@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/dictionary.hpp"
+#include "../src/lib/fm.hpp"
+#include "helpers.hpp"
+
+TEST(Dictionary, InternHandsOutStableCodes) {
+  auto path = fresh_file("interned", "dict");
+  auto dictionary = Dictionary::load(path);
+
+  EXPECT_EQ(dictionary->intern("red").value(), 0);
+  EXPECT_EQ(dictionary->intern("green").value(), 1);
+  EXPECT_EQ(dictionary->intern("red").value(), 0);
+  EXPECT_EQ(dictionary->intern("").value(), 2);
+  EXPECT_EQ(dictionary->size(), 3);
+
+  auto reloaded = Dictionary::load(path);
+  ASSERT_EQ(reloaded->size(), 3);
+  EXPECT_EQ(reloaded->at(1), "green");
+  EXPECT_EQ(reloaded->find("red"), 0);
+  EXPECT_EQ(reloaded->find(""), 2);
+  EXPECT_FALSE(reloaded->find("blue").has_value());
+}
+
+TEST(Dictionary, TornEntryIsDroppedAndOverwritten) {
+  auto path = fresh_file("torn", "dict");
+  ASSERT_FALSE(Dictionary::load(path)->intern("first").has_error());
+
+  // Length of an entry whose bytes never made it
+  std::vector<std::uint8_t> torn{10, 0, 0, 0, 'a', 'b'};
+  FileManager::append_to_file(path, torn);
+
+  auto dictionary = Dictionary::load(path);
+  EXPECT_EQ(dictionary->size(), 1);
+  EXPECT_EQ(dictionary->intern("second").value(), 1);
+
+  auto reloaded = Dictionary::load(path);
+  ASSERT_EQ(reloaded->size(), 2);
+  EXPECT_EQ(reloaded->at(1), "second");
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+
+#include "../src/lib/filter.hpp"
+
+static const Parser::OperatorE OPERATORS[] = {
+    Parser::OperatorE::EQUAL,       Parser::OperatorE::NOT_EQUAL,
+    Parser::OperatorE::GREAT,       Parser::OperatorE::GREAT_EQUAL,
+    Parser::OperatorE::LESS,        Parser::OperatorE::LESS_EQUAL,
+};
+
+// Every kernel the CPU runs has to agree with a row by row compare, on
+// ranges that start and end inside words and around the type limits
+template <typename T> static void matches_row_by_row() {
+  std::mt19937_64 random(11);
+  std::vector<T> values(1000);
+  for (auto &value : values) {
+    switch (random() % 4) {
+    case 0:
+      value = std::numeric_limits<T>::min();
+      break;
+    case 1:
+      value = std::numeric_limits<T>::max();
+      break;
+    default:
+      value = static_cast<T>(static_cast<std::int64_t>(random() % 7) - 3);
+    }
+  }
+
+  for (auto isa : {Filter::Isa::Portable, Filter::Isa::Sse, Filter::Isa::Avx2}) {
+    if (!Filter::supported(isa))
+      continue;
+    for (auto op : OPERATORS) {
+      for (T constant : {static_cast<T>(0), static_cast<T>(-1),
+                         std::numeric_limits<T>::min(),
+                         std::numeric_limits<T>::max()}) {
+        for (auto [from, to] : {std::pair<std::size_t, std::size_t>{0, 1000},
+                                {3, 61},
+                                {70, 900},
+                                {128, 192}}) {
+          std::vector<std::uint64_t> selected(Bitmap::words_for(values.size()));
+          Filter::select(values.data(), from, to, op, constant, selected, isa);
+
+          for (std::size_t i = 0; i < values.size(); i++) {
+            bool expected =
+                i >= from && i < to && Filter::holds(op, values[i], constant);
+            bool got = (selected[i / 64] >> (i % 64)) & 1;
+            ASSERT_EQ(got, expected)
+                << Filter::to_string(isa) << " " << Parser::to_string(op)
+                << " " << +constant << " row " << i;
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(Filter, KernelsMatchRowByRow) {
+  matches_row_by_row<std::uint8_t>();
+  matches_row_by_row<std::uint16_t>();
+  matches_row_by_row<std::uint32_t>();
+  matches_row_by_row<std::uint64_t>();
+  matches_row_by_row<std::int8_t>();
+  matches_row_by_row<std::int16_t>();
+  matches_row_by_row<std::int32_t>();
+  matches_row_by_row<std::int64_t>();
+  matches_row_by_row<double>();
+}
+
+TEST(Filter, KeepsBitsOutsideTheRange) {
+  std::vector<std::int32_t> values(256, 5);
+  std::vector<std::uint64_t> selected(4, ~std::uint64_t{0});
+  Filter::select(values.data(), 10, 200, Parser::OperatorE::LESS, 0, selected);
+
+  EXPECT_EQ(selected[0], (std::uint64_t{1} << 10) - 1);
+  EXPECT_EQ(selected[1], 0u);
+  EXPECT_EQ(selected[2], 0u);
+  EXPECT_EQ(selected[3], ~std::uint64_t{0} << 8);
+}
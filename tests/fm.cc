@@ -19,4 +19,16 @@ TEST(Fm, GetSetCurrent) {
   } else {
     EXPECT_EQ(true, success);
   }
-}
\ No newline at end of file
+}
+TEST(Fm, MappedFileMatchesContents) {
+  std::vector<uint8_t> contents{1, 2, 3, 4, 5, 6, 7, 8, 0, 255};
+  FileManager::write_to_file("./mapped_file", contents);
+
+  auto mapped = FileManager::MappedFile::open("./mapped_file");
+  ASSERT_TRUE(mapped.has_value());
+
+  std::vector<uint8_t> result(mapped.value()->data(),
+                              mapped.value()->data() + mapped.value()->size());
+  EXPECT_EQ(contents, result);
+  EXPECT_EQ(contents, FileManager::read_to_vec("./mapped_file"));
+}
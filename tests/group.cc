@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <random>
+
+#include "../src/lib/group.hpp"
+
+// Rows with the same key share a group, groups are numbered by their first
+// row, and enough rows to be split across threads give the same answer
+template <typename Number>
+static void check_groups(const std::vector<std::uint64_t> &keys,
+                         const Group::Bits &selected, Number &&number) {
+  Group::Groups groups = number();
+  ASSERT_EQ(groups.of.size(), keys.size());
+
+  std::map<std::uint64_t, std::uint32_t> seen;
+  for (std::size_t i = 0; i < keys.size(); i++) {
+    if (!Bitmap::test(selected, i)) {
+      EXPECT_EQ(groups.of[i], Group::NONE);
+      continue;
+    }
+    auto [at, added] =
+        seen.emplace(keys[i], static_cast<std::uint32_t>(seen.size()));
+    ASSERT_EQ(groups.of[i], at->second) << "row " << i;
+    if (added) {
+      EXPECT_EQ(groups.first[at->second], i);
+    }
+  }
+  EXPECT_EQ(groups.size(), seen.size());
+}
+
+TEST(Group, DirectAndHashedMatchAMap) {
+  std::mt19937_64 random(3);
+  std::size_t rows = 3 * Group::CHUNK_ROWS + 17;
+  Group::Bits selected(Bitmap::words_for(rows));
+  for (auto &word : selected)
+    word = random() % 3 == 0 ? 0 : random();
+  selected.back() &= Bitmap::tail_mask(rows);
+
+  std::vector<std::uint64_t> few(rows), many(rows);
+  for (std::size_t i = 0; i < rows; i++) {
+    few[i] = random() % 50;
+    many[i] = random() % 100000 * 0x100000001ULL;
+  }
+
+  check_groups(few, selected, [&] {
+    return Group::direct(rows, selected, 50,
+                         [&](std::size_t i) { return few[i]; });
+  });
+  check_groups(many, selected, [&] {
+    return Group::hashed<std::uint64_t>(rows, selected, 16,
+                                        [&](std::size_t i) { return many[i]; });
+  });
+
+  // Two keys group by their pairs
+  std::vector<std::uint64_t> pairs(rows);
+  for (std::size_t i = 0; i < rows; i++)
+    pairs[i] = few[i] * 1000000 + many[i] % 1000;
+  auto a = Group::direct(rows, selected, 50,
+                         [&](std::size_t i) { return few[i]; });
+  auto b = Group::hashed<std::uint64_t>(
+      rows, selected, 16, [&](std::size_t i) { return many[i] % 1000; });
+  check_groups(pairs, selected,
+               [&] { return Group::combine(a, b, selected); });
+}
+
+TEST(Group, PartialSummariesMerge) {
+  std::size_t rows = 2 * Group::CHUNK_ROWS + 5;
+  std::vector<std::int32_t> values(rows);
+  std::vector<std::uint64_t> keys(rows);
+  for (std::size_t i = 0; i < rows; i++) {
+    values[i] = static_cast<std::int32_t>(i % 1000) - 500;
+    keys[i] = i % 7;
+  }
+  Group::Bits selected(Bitmap::words_for(rows), ~std::uint64_t{0});
+  selected.back() &= Bitmap::tail_mask(rows);
+
+  auto groups = Group::direct(rows, selected, 7,
+                              [&](std::size_t i) { return keys[i]; });
+  auto summaries = Group::summarize(values.data(), groups, selected);
+  auto sizes = Group::sizes(groups, selected);
+  ASSERT_EQ(summaries.size(), 7u);
+
+  for (std::size_t g = 0; g < 7; g++) {
+    Reduce::Summary<std::int32_t> expected;
+    for (std::size_t i = g; i < rows; i += 7) {
+      expected.count++;
+      expected.sum += values[i];
+      expected.min = std::min(expected.min, values[i]);
+      expected.max = std::max(expected.max, values[i]);
+    }
+    EXPECT_EQ(summaries[g].count, expected.count);
+    EXPECT_EQ(sizes[g], expected.count);
+    EXPECT_TRUE(summaries[g].sum == expected.sum);
+    EXPECT_EQ(summaries[g].min, expected.min);
+    EXPECT_EQ(summaries[g].max, expected.max);
+  }
+}
@@ -0,0 +1,93 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/fm.hpp"
+#include "../src/lib/hashIndex.hpp"
+#include "../src/lib/table.hpp"
+#include "helpers.hpp"
+
+// Keys are claimed once, found after their commit and read back the same
+// from the file after the table grew
+TEST(HashIndex, ClaimsKeysOnceAndFindsTheirRows) {
+  auto path = fresh_file("claims", "pkh");
+  auto index = HashIndex::open(path, ColumnType::i64).value();
+  for (std::uint64_t row = 0; row < 1000; row++) {
+    auto key = *RangeIndex::key_of(static_cast<std::int64_t>(row * 3) - 500);
+    ASSERT_TRUE(index->claim(key));
+    EXPECT_FALSE(index->claim(key));
+    ASSERT_FALSE(index->commit(key, row).has_error());
+    EXPECT_FALSE(index->claim(key));
+  }
+  EXPECT_EQ(index->size(), 1000u);
+  EXPECT_EQ(index->rows(), 1000u);
+
+  auto released = *RangeIndex::key_of(std::int64_t{-1});
+  ASSERT_TRUE(index->claim(released));
+  index->release(released);
+  EXPECT_TRUE(index->claim(released));
+  index->release(released);
+
+  auto reopened = HashIndex::open(path, ColumnType::i64).value();
+  EXPECT_EQ(reopened->rows(), 1000u);
+  EXPECT_EQ(reopened->find(*RangeIndex::key_of(std::int64_t{-500})), 0u);
+  EXPECT_EQ(reopened->find(*RangeIndex::key_of(std::int64_t{2497})), 999u);
+  EXPECT_FALSE(reopened->find(*RangeIndex::key_of(std::int64_t{-499})));
+}
+
+// Rows committed out of order only count once those before them are in,
+// and the rows missing are added from the column
+TEST(HashIndex, ExtendsWithRowsItMissed) {
+  auto path = fresh_file("extend", "pkh");
+  auto index = HashIndex::open(path, ColumnType::u32).value();
+  ASSERT_TRUE(index->claim(70));
+  ASSERT_FALSE(index->commit(70, 7).has_error());
+  EXPECT_EQ(index->rows(), 0u);
+
+  ASSERT_FALSE(index
+                   ->extend(10, [](std::uint64_t row) {
+                     return std::optional<std::uint64_t>{row * 10};
+                   })
+                   .has_error());
+  EXPECT_EQ(index->rows(), 10u);
+  EXPECT_EQ(index->size(), 10u);
+  EXPECT_EQ(index->find(70), 7u);
+  EXPECT_EQ(index->find(90), 9u);
+}
+
+// A file that does not add up comes back empty and is filled again
+TEST(HashIndex, BrokenFileStartsOver) {
+  auto path = fresh_file("broken", "pkh");
+  std::vector<std::uint8_t> junk(HashIndex::HEADER_SIZE + 100, 0xab);
+  FileManager::write_to_file(path, junk);
+
+  auto index = HashIndex::open(path, ColumnType::u64).value();
+  EXPECT_EQ(index->rows(), 0u);
+  EXPECT_EQ(index->size(), 0u);
+  EXPECT_TRUE(index->claim(5));
+  EXPECT_FALSE(HashIndex::open(path, ColumnType::str).has_value());
+}
+
+// Keys of rows the column lost in a crash would stay taken, the table
+// starts over when it is opened for a column holding fewer rows
+TEST(HashIndex, AheadOfItsColumnStartsOver) {
+  ASSERT_TRUE(fresh_dir("pk_ahead").create_as_dir());
+  KeyValueList<std::string, Layout> layout{
+      {"id", {.size = 8, .optional = false, .type = ColumnType::u64}}};
+  std::string name = "t";
+  ASSERT_TRUE(
+      DatabaseTable::createTable("pk_ahead", name, layout, "id").has_value());
+
+  auto path = HashIndex::path_for("data/pk_ahead/t/id.col");
+  ASSERT_FALSE(HashIndex::open(path, ColumnType::u64)
+                   .value()
+                   ->extend(5, [](std::uint64_t row) {
+                     return std::optional<std::uint64_t>{row};
+                   })
+                   .has_error());
+
+  auto table = DatabaseTable::from_file("data/pk_ahead/t/info.tbl", "t");
+  auto index = table.primary_index("pk_ahead");
+  ASSERT_FALSE(index.has_error()) << index.error();
+  EXPECT_EQ(index.value()->rows(), 0u);
+  EXPECT_EQ(index.value()->size(), 0u);
+  EXPECT_TRUE(index.value()->claim(3));
+}
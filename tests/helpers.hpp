@@ -0,0 +1,31 @@
+#ifndef TESTS_HELPERS_HPP
+#define TESTS_HELPERS_HPP
+
+#include <gtest/gtest.h>
+#include <string>
+
+#include "../src/lib/fm.hpp"
+
+// `data/<path>`, removed so the test starts without it. Its parents are
+// made, the directory itself is left to the test.
+inline FileManager::Path fresh_dir(const std::string &path) {
+  auto dir = FileManager::Path("data") / path;
+  if (dir.exists()) {
+    EXPECT_TRUE(dir.remove());
+  }
+  EXPECT_TRUE(dir.get_parent().create_as_dir());
+  return dir;
+}
+
+// Path of `data/<name>.<extension>`, removed so the test starts without it
+inline std::string fresh_file(const std::string &name,
+                              const std::string &extension) {
+  EXPECT_TRUE(FileManager::Path("data").create_as_dir());
+  auto path = FileManager::Path("data") / (name + "." + extension);
+  if (path.exists()) {
+    EXPECT_TRUE(path.remove());
+  }
+  return path.path;
+}
+
+#endif // TESTS_HELPERS_HPP
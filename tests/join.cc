@@ -0,0 +1,25 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/join.hpp"
+
+// A pair stays selected when its row of the table is selected and it was
+// still a candidate
+TEST(Join, GatherMapsRowsToPairs) {
+  std::vector<std::size_t> rows(200);
+  for (std::size_t k = 0; k < rows.size(); k++)
+    rows[k] = (k * 7) % 90;
+
+  Join::Bits bits(Bitmap::words_for(90), 0);
+  for (std::size_t i = 0; i < 90; i += 3)
+    Bitmap::set(bits, i);
+  Join::Bits within(Bitmap::words_for(rows.size()), ~std::uint64_t{0});
+  within.back() &= Bitmap::tail_mask(rows.size());
+  within[1] = 0;
+
+  auto gathered = Join::gather(bits, rows, within);
+  ASSERT_EQ(gathered.size(), within.size());
+  for (std::size_t k = 0; k < rows.size(); k++)
+    EXPECT_EQ(Bitmap::test(gathered, k),
+              Bitmap::test(within, k) && rows[k] % 3 == 0)
+        << "pair " << k;
+}
@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../src/lib/columnFile.hpp"
+#include "../src/lib/columnInstance.hpp"
+#include "../src/lib/fm.hpp"
+#include "../src/lib/pageCodec.hpp"
+#include "helpers.hpp"
+
+static PageCodec::Kind round_trip(const std::vector<std::uint64_t> &values) {
+  std::vector<std::uint8_t> encoded;
+  auto kind = PageCodec::encode(values.data(), values.size(), encoded);
+
+  std::vector<std::uint64_t> decoded(values.size());
+  EXPECT_TRUE(PageCodec::decode(kind, encoded.data(), encoded.size(),
+                                values.size(), decoded.data()));
+  EXPECT_EQ(decoded, values);
+  return kind;
+}
+
+TEST(PageCodec, PicksTheCodecThatFitsThePage) {
+  std::mt19937_64 random(7);
+  std::vector<std::uint64_t> timestamps, small, runs, noise;
+  std::uint64_t now = 1700000000000;
+  for (std::size_t i = 0; i < 4096; i++) {
+    now += 1000 + random() % 16;
+    timestamps.push_back(now);
+    small.push_back(500000 + random() % 1000);
+    runs.push_back(i / 1000);
+    noise.push_back(random());
+  }
+
+  EXPECT_EQ(round_trip(timestamps), PageCodec::Kind::Delta);
+  EXPECT_EQ(round_trip(small), PageCodec::Kind::FrameOfReference);
+  EXPECT_EQ(round_trip(runs), PageCodec::Kind::RunLength);
+  EXPECT_EQ(round_trip(noise), PageCodec::Kind::Plain);
+}
+
+TEST(PageCodec, OddSizesAndWidths) {
+  for (std::size_t rows : {1, 2, 63, 64, 65, 130}) {
+    for (unsigned width : {0, 1, 7, 33, 63, 64}) {
+      std::vector<std::uint64_t> values;
+      for (std::size_t i = 0; i < rows; i++) {
+        std::uint64_t mask =
+            width == 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << width) - 1;
+        values.push_back((i * 0x9E3779B97F4A7C15ull) & mask);
+      }
+      round_trip(values);
+    }
+  }
+}
+
+TEST(PageCodec, PagedColumnSealsPagesAndKeepsTheTail) {
+  static const Layout I64{.size = 8, .optional = false,
+                          .type = ColumnType::i64};
+  auto path = fresh_file("paged", "col");
+  std::remove(ColumnFile::tail_path(path).c_str());
+  ASSERT_FALSE(ColumnFile::create(path, I64).has_error());
+
+  std::vector<std::uint8_t> encoded;
+  for (std::int64_t i = 0; i < 9000; i++)
+    Codec::push(encoded, -4500 + i * 3);
+
+  ColumnFile::Writer writer(path, I64);
+  for (std::size_t at = 0; at < encoded.size(); at += 8 * 1000) {
+    std::size_t size = std::min<std::size_t>(8 * 1000, encoded.size() - at);
+    ASSERT_FALSE(writer.append(encoded.data() + at, size, false).has_error());
+  }
+  EXPECT_EQ(ColumnFile::row_count(path, I64), 9000);
+  EXPECT_LT(FileManager::Path(path).get_file_size(), 8192u);
+
+  // A page torn by a crash is not part of the column and gets cut
+  FileManager::append_to_file(path, std::vector<std::uint8_t>{1, 2, 3});
+  auto contents = FileManager::read_to_vec(path);
+  auto decoded = ColumnFile::read_paged(contents.data(), contents.size(),
+                                        path, I64);
+  ASSERT_FALSE(decoded.has_error()) << decoded.error();
+  EXPECT_EQ(decoded.value(), encoded);
+
+  std::vector<std::uint8_t> more;
+  Codec::push(more, std::int64_t{-1});
+  ColumnFile::Writer reopened(path, I64);
+  ASSERT_FALSE(reopened.append(more.data(), more.size(), false).has_error());
+  EXPECT_EQ(ColumnFile::row_count(path, I64), 9001);
+}
+
+// Readers decode the column while inserts seal pages and move its tail,
+// they see a prefix of the rows and never a page or tail half written
+TEST(PageCodec, PagedColumnReadsWhileInsertsSealPages) {
+  auto database = fresh_dir("paged_reads");
+  ASSERT_TRUE(database.create_as_dir());
+  // Buffered rows reach the file a page or more at a time, most writes seal
+  auto options = AppendOptions::global();
+  AppendOptions::global().ack = AckMode::Buffered;
+  AppendOptions::global().flush_bytes = ColumnFile::PAGE_ROWS * 8;
+  KeyValueList<std::string, Layout> layout{
+      {"a", {.size = 8, .optional = false, .type = ColumnType::u64}}};
+  std::string name = "t";
+  auto table = DatabaseTable::createTable("paged_reads", name, layout).value();
+  auto appender = table.appender_for("paged_reads");
+  AppendOptions::global() = options;
+
+  auto insert = [&](std::uint64_t value) {
+    TableAppender::Row row(1);
+    Codec::push(row[0], value);
+    return appender->append(row);
+  };
+  ASSERT_FALSE(insert(0).has_error());
+
+  const std::uint64_t ROWS = 100 * ColumnFile::PAGE_ROWS + 100;
+  std::atomic<bool> done = false;
+  std::thread writer([&] {
+    for (std::uint64_t i = 1; i < ROWS; i++)
+      EXPECT_FALSE(insert(i).has_error());
+    done = true;
+  });
+
+  auto read = [&] {
+    std::size_t reads = 0;
+    while (!done || reads == 0) {
+      auto loaded = ColumnInstance::load_column("paged_reads", "t", "a", table);
+      if (loaded.has_error()) {
+        ADD_FAILURE() << loaded.error();
+        return;
+      }
+      auto values = loaded->values<std::uint64_t>();
+      std::size_t wrong = 0;
+      for (std::size_t i = 0; i < values.size(); i++)
+        wrong += values[i] != i;
+      EXPECT_EQ(wrong, 0u);
+      reads++;
+    }
+  };
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 3; i++)
+    readers.emplace_back(read);
+  for (auto &reader : readers)
+    reader.join();
+  writer.join();
+
+  auto loaded = ColumnInstance::load_column("paged_reads", "t", "a", table);
+  ASSERT_FALSE(loaded.has_error()) << loaded.error();
+  EXPECT_EQ(loaded->size, ROWS);
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../src/lib/analyzer/parser.hpp"
+#include "../src/lib/plan.hpp"
+#include "../src/lib/pool.hpp"
+
+static Automata::Show_Select select_of(const std::string &query) {
+  auto action = Automata::get_action_struct(Parser::parse(query), query);
+  EXPECT_FALSE(action.has_error()) << action.error();
+  return std::get<Automata::Show_Select>(action.value());
+}
+
+// Operators go in the order the rows flow, only those the query needs
+TEST(Plan, BuildsTheOperatorsOfASelect) {
+  auto plain = Plan::build(select_of("USING db SELECT t.a ;"));
+  ASSERT_EQ(plain.operators.size(), 3);
+  EXPECT_EQ(plain.operators[0].kind, Plan::Kind::Scan);
+  EXPECT_EQ(plain.operators[0].detail, "db.t");
+  EXPECT_EQ(plain.find(Plan::Kind::Filter), nullptr);
+
+  auto full = Plan::build(select_of(
+      "USING db SELECT t.k , COUNT(*) WHERE t.a > 2 AND ( t.b == \"x\" OR "
+      "t.c == NULL ) GROUP BY t.k ORDER BY t.k DESC LIMIT 3 ;"));
+  std::vector<Plan::Kind> kinds;
+  for (auto &op : full.operators)
+    kinds.push_back(op.kind);
+  EXPECT_EQ(kinds, (std::vector<Plan::Kind>{
+                       Plan::Kind::Scan, Plan::Kind::Filter,
+                       Plan::Kind::Aggregate, Plan::Kind::Sort,
+                       Plan::Kind::Project, Plan::Kind::Output}));
+  EXPECT_EQ(full.find(Plan::Kind::Filter)->detail,
+            "t.a > 2 AND (t.b == \"x\" OR t.c == NULL)");
+  EXPECT_EQ(full.find(Plan::Kind::Aggregate)->detail, "COUNT(*) BY t.k");
+  EXPECT_EQ(full.find(Plan::Kind::Sort)->detail, "t.k DESC, top 3");
+  EXPECT_EQ(full.find(Plan::Kind::Output)->detail, "LIMIT 3");
+}
+
+// The output comes first and each operator reads from the one under it
+TEST(Plan, PrintsFromTheOutputDown) {
+  auto plan = Plan::build(select_of("USING db SELECT t.a WHERE t.a < 4 ;"));
+  EXPECT_EQ(Plan::to_string(plan, false), "Output\n"
+                                          "  -> Project t.a\n"
+                                          "    -> Filter t.a < 4\n"
+                                          "      -> Scan db.t\n");
+
+  // Tests keep the default operator new, allocations are counted by hand.
+  // Those of other threads are not the query's.
+  {
+    Plan::Step step(plan, Plan::Kind::Filter);
+    Plan::count_allocation();
+    Plan::count_allocation();
+    std::thread other([] {
+      for (int i = 0; i < 10; i++)
+        Plan::count_allocation();
+    });
+    other.join();
+  }
+  EXPECT_EQ(plan.find(Plan::Kind::Filter)->stats.allocations, 2u);
+  EXPECT_NE(Plan::to_string(plan, true).find("allocs=2"), std::string::npos);
+}
+
+// Morsels the workers take count for the query that handed them out
+TEST(Plan, CountsTheAllocationsOfItsMorsels) {
+  auto plan = Plan::build(select_of("USING db SELECT t.a WHERE t.a < 4 ;"));
+  {
+    Plan::Step step(plan, Plan::Kind::Filter);
+    Pool::run(8, 4, [](std::size_t) { Plan::count_allocation(); });
+  }
+  EXPECT_EQ(plan.find(Plan::Kind::Filter)->stats.allocations, 8u);
+}
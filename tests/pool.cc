@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "../src/lib/pool.hpp"
+
+// Every task runs once, whatever thread takes it
+TEST(Pool, RunsEveryTaskOnce) {
+  std::vector<std::atomic<int>> runs(1000);
+  Pool::run(runs.size(), 4, [&](std::size_t task) { runs[task]++; });
+  for (std::size_t task = 0; task < runs.size(); task++)
+    EXPECT_EQ(runs[task], 1) << "task " << task;
+}
+
+// A task may scan in parallel too, its helpers queue behind it without
+// blocking it
+TEST(Pool, RunsNestedTasks) {
+  std::atomic<std::size_t> total = 0;
+  Pool::run(8, 8, [&](std::size_t) {
+    Pool::run(100, 4, [&](std::size_t task) { total += task; });
+  });
+  EXPECT_EQ(total, 8 * 4950u);
+}
+
+// Morsels are whole words and cover the rows once
+TEST(Pool, MorselsCoverTheRows) {
+  std::size_t rows = 3 * Pool::MORSEL_ROWS + 100;
+  std::vector<std::pair<std::size_t, std::size_t>> seen(Pool::morsels(rows));
+  Pool::for_each_morsel(rows, [&](std::size_t morsel, std::size_t from,
+                                  std::size_t to) {
+    seen[morsel] = {from, to};
+  });
+  std::size_t next = 0;
+  for (auto [from, to] : seen) {
+    EXPECT_EQ(from, next);
+    EXPECT_EQ(from % Bitmap::WORD_BITS, 0u);
+    next = to;
+  }
+  EXPECT_EQ(next, rows);
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <random>
+
+#include "../src/lib/fm.hpp"
+#include "../src/lib/rangeIndex.hpp"
+#include "../src/lib/table.hpp"
+#include "helpers.hpp"
+
+// Rows of `keys` with a key in [low, high], in key and then row order
+static std::vector<std::uint64_t> scan(const std::vector<std::int64_t> &keys,
+                                       std::int64_t low, std::int64_t high) {
+  std::vector<std::pair<std::int64_t, std::uint64_t>> found;
+  for (std::uint64_t row = 0; row < keys.size(); row++) {
+    if (keys[row] >= low && keys[row] <= high)
+      found.emplace_back(keys[row], row);
+  }
+  std::sort(found.begin(), found.end());
+  std::vector<std::uint64_t> rows;
+  for (auto &[key, row] : found)
+    rows.push_back(row);
+  return rows;
+}
+
+TEST(RangeIndex, KeysKeepTheOrderOfTheirValues) {
+  EXPECT_LT(RangeIndex::key_of(std::int32_t{-5}), RangeIndex::key_of(std::int32_t{3}));
+  EXPECT_LT(RangeIndex::key_of(std::int64_t{-1}), RangeIndex::key_of(std::int64_t{0}));
+  EXPECT_LT(RangeIndex::key_of(-2.5), RangeIndex::key_of(-1.0));
+  EXPECT_LT(RangeIndex::key_of(-1.0), RangeIndex::key_of(0.5));
+  EXPECT_EQ(RangeIndex::key_of(-0.0), RangeIndex::key_of(0.0));
+  EXPECT_FALSE(RangeIndex::key_of(std::nan("")).has_value());
+
+  auto key = *RangeIndex::key_of(std::uint8_t{7});
+  EXPECT_EQ(RangeIndex::bounds(Parser::OperatorE::GREAT, key)->first, 8u);
+  EXPECT_EQ(RangeIndex::bounds(Parser::OperatorE::LESS, key)->second, 6u);
+  auto none = *RangeIndex::bounds(Parser::OperatorE::LESS, 0);
+  EXPECT_GT(none.first, none.second);
+  EXPECT_FALSE(RangeIndex::bounds(Parser::OperatorE::NOT_EQUAL, key));
+}
+
+// Inserts in random order split leaves and inner nodes, ranges still come
+// back in key order and the tree reads back the same from its file
+TEST(RangeIndex, RangesMatchAScanAcrossSplitsAndReopens) {
+  auto path = fresh_file("ranges", "bpt");
+  std::mt19937_64 random(7);
+  std::vector<std::int64_t> keys(60000);
+  for (auto &key : keys)
+    key = static_cast<std::int64_t>(random() % 5000) - 2500;
+  auto key_at = [&](std::uint64_t row) { return RangeIndex::key_of(keys[row]); };
+
+  auto index = RangeIndex::build(path, ColumnType::i64, 0, key_at).value();
+  std::vector<std::uint64_t> order(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::shuffle(order.begin(), order.end(), random);
+  for (auto row : order)
+    ASSERT_FALSE(index->add(row, key_at(row)).has_error());
+  EXPECT_EQ(index->rows(), keys.size());
+  EXPECT_EQ(index->size(), keys.size());
+  EXPECT_GE(index->height(), 3u);
+
+  auto reopened = RangeIndex::open(path, ColumnType::i64).value();
+  EXPECT_EQ(reopened->rows(), keys.size());
+  for (auto [low, high] : {std::pair{-10, 10}, std::pair{-2500, -2490},
+                           std::pair{2400, 9000}, std::pair{3, 3}}) {
+    auto found = reopened->range(*RangeIndex::key_of(std::int64_t{low}),
+                                 *RangeIndex::key_of(std::int64_t{high}));
+    ASSERT_TRUE(found.has_value());
+    EXPECT_EQ(*found, scan(keys, low, high));
+  }
+  EXPECT_FALSE(reopened->range(0, ~std::uint64_t{0}, 100).has_value());
+}
+
+// An index behind its column catches up, rows it holds are not added twice
+// and nulls take no entry
+TEST(RangeIndex, ExtendsWithRowsItMissed) {
+  auto path = fresh_file("extend", "bpt");
+  std::vector<std::optional<std::uint64_t>> keys;
+  for (std::uint64_t row = 0; row < 1000; row++)
+    keys.push_back(row % 10 == 0 ? std::nullopt
+                                 : std::optional<std::uint64_t>{row / 2});
+  auto key_at = [&](std::uint64_t row) { return keys[row]; };
+
+  auto index = RangeIndex::build(path, ColumnType::u64, 600, key_at).value();
+  EXPECT_EQ(index->size(), 540u);
+  ASSERT_FALSE(index->add(700, key_at(700)).has_error());
+  EXPECT_EQ(index->rows(), 600u);
+
+  ASSERT_FALSE(index->extend(1000, key_at).has_error());
+  EXPECT_EQ(index->rows(), 1000u);
+  EXPECT_EQ(index->size(), 900u);
+  EXPECT_EQ(*index->range(350, 350), (std::vector<std::uint64_t>{701}));
+  EXPECT_EQ(*index->range(0, 0), (std::vector<std::uint64_t>{1}));
+}
+
+// A file that does not add up comes back empty and is built again
+TEST(RangeIndex, BrokenFileStartsOver) {
+  auto path = fresh_file("broken", "bpt");
+  std::vector<std::uint8_t> junk(RangeIndex::PAGE_SIZE + 10, 0xab);
+  FileManager::write_to_file(path, junk);
+
+  auto index = RangeIndex::open(path, ColumnType::u32).value();
+  EXPECT_EQ(index->rows(), 0u);
+  ASSERT_FALSE(index
+                   ->extend(3, [](std::uint64_t row) {
+                     return std::optional<std::uint64_t>{row * 10};
+                   })
+                   .has_error());
+  EXPECT_EQ(*index->range(5, 25), (std::vector<std::uint64_t>{1, 2}));
+  EXPECT_EQ(RangeIndex::open(path, ColumnType::u32).value()->size(), 3u);
+}
+
+// A crash while nodes were written over leaves the header marked, and the
+// index is built again rather than followed into pages never written
+TEST(RangeIndex, UncleanFileStartsOver) {
+  auto path = fresh_file("unclean", "bpt");
+  auto key_at = [](std::uint64_t row) {
+    return std::optional<std::uint64_t>{row};
+  };
+  RangeIndex::build(path, ColumnType::u64, 2000, key_at).value();
+  EXPECT_EQ(RangeIndex::open(path, ColumnType::u64).value()->rows(), 2000u);
+
+  auto contents = FileManager::read_to_vec(path);
+  contents[36] = 1;
+  FileManager::write_to_file(path, contents);
+
+  auto index = RangeIndex::open(path, ColumnType::u64).value();
+  EXPECT_EQ(index->rows(), 0u);
+  ASSERT_FALSE(index->extend(2000, key_at).has_error());
+  EXPECT_EQ(index->range(100, 199)->size(), 100u);
+}
+
+// An index holding rows its column lost in a crash starts over when the
+// table opens it, so it never answers with rows that are not there
+TEST(RangeIndex, AheadOfItsColumnStartsOver) {
+  ASSERT_TRUE(fresh_dir("ahead").create_as_dir());
+  KeyValueList<std::string, Layout> layout{
+      {"a", {.size = 8, .optional = false, .type = ColumnType::u64}}};
+  std::string name = "t";
+  auto table = DatabaseTable::createTable("ahead", name, layout).value();
+  for (std::uint64_t value = 0; value < 3; value++) {
+    TableAppender::Row row(1);
+    Codec::push(row[0], value);
+    ASSERT_FALSE(table.appender_for("ahead")->append(row).has_error());
+  }
+
+  auto key_at = [](std::uint64_t row) {
+    return std::optional<std::uint64_t>{row};
+  };
+  auto path = RangeIndex::path_for("data/ahead/t/a.col");
+  RangeIndex::build(path, ColumnType::u64, 5, key_at).value();
+
+  auto index = table.index_for("ahead", "a");
+  ASSERT_TRUE(index);
+  EXPECT_EQ(index->rows(), 0u);
+  EXPECT_EQ(index->size(), 0u);
+}
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+
+#include <limits>
+#include <random>
+
+#include "../src/lib/bitmap.hpp"
+#include "../src/lib/reduce.hpp"
+
+// Dense, sparse and empty words all have to agree with a row by row pass
+template <typename T> static void matches_row_by_row() {
+  std::mt19937_64 random(5);
+  std::size_t rows = 1000;
+  std::vector<T> values(rows);
+  for (auto &value : values) {
+    switch (random() % 4) {
+    case 0:
+      value = std::numeric_limits<T>::min();
+      break;
+    case 1:
+      value = std::numeric_limits<T>::max();
+      break;
+    default:
+      value = static_cast<T>(static_cast<std::int64_t>(random() % 7) - 3);
+    }
+  }
+
+  std::vector<std::uint64_t> selected(Bitmap::words_for(rows));
+  selected[0] = ~std::uint64_t{0};
+  selected[1] = 0;
+  selected[2] = random();
+  selected[3] = ~std::uint64_t{0};
+  for (std::size_t w = 4; w < selected.size(); w++)
+    selected[w] = random() % 2 == 0 ? ~std::uint64_t{0} : random();
+
+  Reduce::Summary<T> expected;
+  for (std::size_t i = 0; i < rows; i++) {
+    if (!Bitmap::test(selected, i))
+      continue;
+    expected.count++;
+    expected.sum += values[i];
+    expected.min = std::min(expected.min, values[i]);
+    expected.max = std::max(expected.max, values[i]);
+  }
+
+  auto got = Reduce::summarize(values.data(), rows, selected);
+  EXPECT_EQ(got.count, expected.count);
+  EXPECT_TRUE(got.sum == expected.sum);
+  EXPECT_EQ(got.min, expected.min);
+  EXPECT_EQ(got.max, expected.max);
+}
+
+TEST(Reduce, BlocksMatchRowByRow) {
+  matches_row_by_row<std::uint8_t>();
+  matches_row_by_row<std::uint16_t>();
+  matches_row_by_row<std::uint32_t>();
+  matches_row_by_row<std::uint64_t>();
+  matches_row_by_row<std::int8_t>();
+  matches_row_by_row<std::int16_t>();
+  matches_row_by_row<std::int32_t>();
+  matches_row_by_row<std::int64_t>();
+}
+
+TEST(Reduce, DoublesAndEmptySelections) {
+  std::vector<double> values(130);
+  for (std::size_t i = 0; i < values.size(); i++)
+    values[i] = static_cast<double>(i) / 2;
+
+  std::vector<std::uint64_t> selected(Bitmap::words_for(values.size()),
+                                      ~std::uint64_t{0});
+  auto all = Reduce::summarize(values.data(), values.size(), selected);
+  EXPECT_EQ(all.count, 130u);
+  EXPECT_DOUBLE_EQ(all.sum, 129.0 * 130 / 4);
+  EXPECT_EQ(all.min, 0);
+  EXPECT_EQ(all.max, 64.5);
+
+  std::fill(selected.begin(), selected.end(), 0);
+  auto none = Reduce::summarize(values.data(), values.size(), selected);
+  EXPECT_EQ(none.count, 0u);
+}
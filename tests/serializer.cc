@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include "../src/lib/codec.hpp"
 #include "../src/lib/serializer.hpp"
 #include "../src/lib/table.hpp"
 
@@ -34,4 +35,56 @@ TEST(BinSerde, uint8) {
   uint8_t cmp = result.du8();
   
   EXPECT_EQ(input, cmp);
-}
\ No newline at end of file
+}
+
+TEST(Codec, MatchesBincodeNumbers) {
+  std::vector<uint64_t> input{0, 1, 234233, std::numeric_limits<uint64_t>::max()};
+  std::vector<uint8_t> encoded(input.size() * sizeof(uint64_t));
+  Codec::encode(std::span<const uint64_t>(input), encoded.data());
+
+  for (size_t i = 0; i < input.size(); i++) {
+    Serialized expected = Serialized::serialize(input[i]);
+    ASSERT_EQ(expected.len(), sizeof(uint64_t));
+    EXPECT_EQ(0, std::memcmp(expected.data(), &encoded[i * sizeof(uint64_t)],
+                             sizeof(uint64_t)));
+  }
+
+  std::vector<uint64_t> decoded(input.size());
+  Codec::decode(encoded.data(), input.size(), decoded.data());
+  EXPECT_EQ(input, decoded);
+}
+
+TEST(Codec, MatchesBincodeSigned) {
+  std::vector<int32_t> input{-1, 0, 45, std::numeric_limits<int32_t>::min()};
+  std::vector<uint8_t> encoded;
+  for (auto value : input)
+    Codec::push(encoded, value);
+
+  for (size_t i = 0; i < input.size(); i++) {
+    EXPECT_EQ(input[i], Serialized::di32(&encoded[i * 4], 4));
+  }
+}
+
+TEST(Codec, MatchesBincodeBool) {
+  std::vector<uint8_t> encoded;
+  Codec::push(encoded, true);
+  Codec::push(encoded, false);
+
+  Serialized yes = Serialized::serialize(true);
+  EXPECT_EQ(yes[0], encoded[0]);
+  EXPECT_TRUE(Serialized::dbool(&encoded[0], 1));
+  EXPECT_FALSE(Serialized::dbool(&encoded[1], 1));
+}
+
+TEST(Codec, MatchesBincodeStr) {
+  std::string nombre = "Daniel";
+  Serialized expected = Serialized::serialize(nombre, 20);
+
+  std::vector<uint8_t> encoded;
+  Codec::push(encoded, nombre, 20);
+
+  ASSERT_EQ(expected.len(), encoded.size());
+  EXPECT_EQ(0, std::memcmp(expected.data(), encoded.data(), encoded.size()));
+  EXPECT_EQ(nombre, Codec::decode_str(encoded.data(), 20));
+  EXPECT_EQ(nombre, Serialized::dstr(encoded.data(), encoded.size()).to_string());
+}
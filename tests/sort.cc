@@ -0,0 +1,30 @@
+#include <gtest/gtest.h>
+
+#include <random>
+
+#include "../src/lib/sort.hpp"
+
+// The heap keeps the same rows, in the same order, as sorting everything
+TEST(Sort, TopKeepsTheFirstOfAFullSort) {
+  std::mt19937_64 random(7);
+  std::vector<int> values(5000);
+  for (auto &value : values)
+    value = static_cast<int>(random() % 100);
+
+  auto each = [&](auto &&f) {
+    for (std::size_t i = 0; i < values.size(); i++)
+      f(i);
+  };
+  auto less = [&](std::size_t a, std::size_t b) {
+    return values[a] != values[b] ? values[a] > values[b] : a < b;
+  };
+
+  auto all = Sort::top(each, std::nullopt, less);
+  ASSERT_EQ(all.size(), values.size());
+  for (std::uint64_t limit : {0, 1, 50, 4999, 5000, 8000}) {
+    auto top = Sort::top(each, limit, less);
+    ASSERT_EQ(top.size(), std::min<std::size_t>(limit, values.size()));
+    for (std::size_t i = 0; i < top.size(); i++)
+      EXPECT_EQ(top[i], all[i]) << "limit " << limit << " rank " << i;
+  }
+}
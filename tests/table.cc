@@ -2,6 +2,7 @@
 
 #include "../src/lib/fm.hpp"
 #include "../src/lib/table.hpp"
+#include "helpers.hpp"
 
 /*
 TEST(SerDe, StructToBytes) {
@@ -90,3 +91,61 @@ TEST(SerDe, SaveLoadFromFile) {
 
   EXPECT_EQ(expected, result) << "Bad save & load";
 }
+
+TEST(SerDe, PrimaryKeySurvivesSaveAndLoad) {
+  KeyValueList<std::string, Layout> map{
+      {"id", {.size = 8, .optional = false, .type = ColumnType::u64}},
+      {"qty", {.size = 4, .optional = true, .type = ColumnType::i32}}};
+
+  DatabaseTable expected("table2", map);
+  expected.primary_key = "id";
+  expected.to_file("./table2");
+
+  DatabaseTable result = DatabaseTable::from_file("./table2", "table2");
+  EXPECT_EQ(result.primary_key, std::optional<std::string>("id"));
+  EXPECT_EQ(expected, result) << "Bad save & load";
+}
+
+TEST(SerDe, UniqueColumnsSurviveSaveAndLoad) {
+  KeyValueList<std::string, Layout> map{
+      {"id", {.size = 8, .optional = false, .type = ColumnType::u64}},
+      {"mail", {.size = 20, .optional = true, .type = ColumnType::vstr}},
+      {"code", {.size = 4, .optional = false, .type = ColumnType::u32}}};
+
+  DatabaseTable expected("table3", map);
+  expected.primary_key = "id";
+  expected.unique_columns = {"mail", "code"};
+  expected.to_file("./table3");
+
+  DatabaseTable result = DatabaseTable::from_file("./table3", "table3");
+  EXPECT_EQ(result.unique_columns, expected.unique_columns);
+  EXPECT_EQ(expected, result) << "Bad save & load";
+}
+
+// A row turned down for its key leaves nothing behind, its strings do not
+// reach the dictionary of their column
+TEST(Table, DuplicateKeyInternsNothing) {
+  fresh_dir("keys/dup");
+
+  KeyValueList<std::string, Layout> layout{
+      {"id", {.size = 8, .optional = false, .type = ColumnType::u64}},
+      {"name", {.size = 16, .optional = false, .type = ColumnType::dstr}}};
+  std::string name = "dup";
+  auto table =
+      DatabaseTable::createTable("keys", name, layout, std::string("id")).value();
+
+  using Values = List<std::variant<Parser::String, Parser::UInt, Parser::Int,
+                                   Parser::Double, Parser::Bool, Parser::Null>>;
+  auto first = table.try_insert("keys", Values{Parser::UInt{1},
+                                              Parser::String{"first"}});
+  ASSERT_FALSE(first.has_error()) << first.error();
+  EXPECT_TRUE(table
+                  .try_insert("keys", Values{Parser::UInt{1},
+                                             Parser::String{"second"}})
+                  .has_error());
+
+  auto dictionary = Dictionary::load(
+      Dictionary::path_for("data/keys/dup/name.col"));
+  EXPECT_EQ(dictionary->size(), 1u);
+  EXPECT_FALSE(dictionary->find("second").has_value());
+}
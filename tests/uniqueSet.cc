@@ -0,0 +1,40 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "../src/lib/uniqueSet.hpp"
+
+TEST(UniqueSet, KeysTellValuesApart) {
+  EXPECT_EQ(UniqueSet::key_of(std::int32_t{-3}), UniqueSet::key_of(std::int32_t{-3}));
+  EXPECT_NE(UniqueSet::key_of(std::int32_t{-3}), UniqueSet::key_of(std::int32_t{3}));
+  EXPECT_EQ(UniqueSet::key_of(-0.0), UniqueSet::key_of(0.0));
+  EXPECT_NE(UniqueSet::key_of(true), UniqueSet::key_of(false));
+  EXPECT_EQ(UniqueSet::key_of(std::string("ab")), std::optional<std::string>("ab"));
+  EXPECT_FALSE(UniqueSet::key_of(std::monostate{}).has_value());
+}
+
+// Threads inserting overlapping values each get a value in only once
+TEST(UniqueSet, EachValueGoesInOnce) {
+  UniqueSet set;
+  std::atomic<std::size_t> added = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++)
+    threads.emplace_back([&] {
+      for (std::uint64_t value = 0; value < 5000; value++) {
+        if (set.insert(*UniqueSet::key_of(value)))
+          added++;
+      }
+    });
+  for (auto &thread : threads)
+    thread.join();
+
+  EXPECT_EQ(added.load(), 5000u);
+  EXPECT_EQ(set.size(), 5000u);
+  EXPECT_TRUE(set.contains(*UniqueSet::key_of(std::uint64_t{4999})));
+
+  set.erase(*UniqueSet::key_of(std::uint64_t{7}));
+  EXPECT_FALSE(set.contains(*UniqueSet::key_of(std::uint64_t{7})));
+  EXPECT_TRUE(set.insert(*UniqueSet::key_of(std::uint64_t{7})));
+}
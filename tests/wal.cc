@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/database.hpp"
+#include "../src/lib/wal.hpp"
+#include "helpers.hpp"
+
+TEST(Wal, RecordsRoundTrip) {
+  auto path = fresh_file("wal_roundtrip", "log");
+  {
+    auto wal = WriteAheadLog::open(path).value();
+    wal->log("t", 0, {{1, 2, 3}, {4}});
+    auto last = wal->log("t", 1, {{5, 6, 7}, {8}});
+    ASSERT_FALSE(wal->sync(last).has_error());
+  }
+
+  auto records = WriteAheadLog::read(path);
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].table, "t");
+  EXPECT_EQ(records[0].row, 0);
+  EXPECT_EQ(records[1].row, 1);
+  EXPECT_EQ(records[1].values, (WriteAheadLog::Row{{5, 6, 7}, {8}}));
+}
+
+TEST(Wal, TornTailIsIgnored) {
+  auto path = fresh_file("wal_torn", "log");
+  {
+    auto wal = WriteAheadLog::open(path).value();
+    wal->log("t", 0, {{1}});
+    ASSERT_FALSE(wal->sync(wal->log("t", 1, {{2}})).has_error());
+  }
+
+  auto size = FileManager::Path(path).get_file_size();
+  ASSERT_TRUE(FileManager::resize_file(path, size - 1));
+
+  auto records = WriteAheadLog::read(path);
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].values, (WriteAheadLog::Row{{1}}));
+}
+
+TEST(Wal, DropVoidsEarlierRecords) {
+  auto path = fresh_file("wal_drop", "log");
+  {
+    auto wal = WriteAheadLog::open(path).value();
+    wal->log("a", 0, {{1}});
+    wal->log("b", 0, {{2}});
+    ASSERT_FALSE(wal->log_drop("a").has_error());
+    ASSERT_FALSE(wal->sync(wal->log("a", 0, {{3}})).has_error());
+  }
+
+  auto records = WriteAheadLog::read(path);
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].table, "b");
+  EXPECT_EQ(records[1].table, "a");
+  EXPECT_EQ(records[1].values, (WriteAheadLog::Row{{3}}));
+}
+
+TEST(Wal, AppliedPrefixIsCutWhileRowsArePending) {
+  auto path = fresh_file("wal_rotate", "log");
+  auto wal = WriteAheadLog::open(path).value();
+  wal->checkpoint_bytes = 0;
+
+  auto first = wal->log("a", 0, {{1}});
+  auto second = wal->log("b", 0, {{2}});
+  auto third = wal->log("a", 1, {{3}});
+  ASSERT_FALSE(wal->sync(third).has_error());
+
+  // Only what comes before the oldest pending row can go
+  wal->applied({first, third});
+  auto records = WriteAheadLog::read(path);
+  ASSERT_EQ(records.size(), 2);
+  EXPECT_EQ(records[0].values, (WriteAheadLog::Row{{2}}));
+  EXPECT_EQ(records[1].values, (WriteAheadLog::Row{{3}}));
+
+  // Rows logged after the cut land behind the kept records
+  ASSERT_FALSE(wal->sync(wal->log("b", 1, {{4}})).has_error());
+  EXPECT_EQ(WriteAheadLog::read(path).size(), 3);
+
+  wal->applied({second});
+  records = WriteAheadLog::read(path);
+  ASSERT_EQ(records.size(), 1);
+  EXPECT_EQ(records[0].values, (WriteAheadLog::Row{{4}}));
+}
+
+TEST(Wal, ReplayCompletesColumns) {
+  auto db_path = fresh_dir("wal_replay");
+  ASSERT_TRUE(DataBase::create("wal_replay").has_value());
+
+  std::string table_name = "t";
+  KeyValueList<std::string, Layout> layout{
+      {"a", {.size = 4, .optional = false, .type = ColumnType::u32}},
+      {"b", {.size = 1, .optional = false, .type = ColumnType::u8}}};
+  ASSERT_TRUE(DatabaseTable::createTable("wal_replay", table_name, layout)
+                  .has_value());
+
+  // Two rows logged, the crash left row 0 only in column a and half of
+  // row 1 in it too
+  {
+    auto wal = WriteAheadLog::open(WriteAheadLog::path_for("wal_replay")).value();
+    wal->log("t", 0, {{1, 0, 0, 0}, {9}});
+    ASSERT_FALSE(wal->sync(wal->log("t", 1, {{2, 0, 0, 0}, {8}})).has_error());
+  }
+  auto a = db_path / "t" / "a.col";
+  auto b = db_path / "t" / "b.col";
+  FileManager::append_to_file(a.path, std::vector<std::uint8_t>{1, 0, 0, 0, 2, 0});
+
+  DataBase db("wal_replay");
+  auto replayed = db.open_log();
+  ASSERT_FALSE(replayed.has_error()) << replayed.error();
+  EXPECT_EQ(replayed.value(), 3);
+
+  auto values = [](const FileManager::Path &column) {
+    auto contents = FileManager::read_to_vec(column.path);
+    return std::vector<std::uint8_t>(
+        contents.begin() + ColumnFile::HEADER_SIZE, contents.end());
+  };
+  EXPECT_EQ(values(a), (std::vector<std::uint8_t>{1, 0, 0, 0, 2, 0, 0, 0}));
+  EXPECT_EQ(values(b), (std::vector<std::uint8_t>{9, 8}));
+  EXPECT_EQ(FileManager::Path(WriteAheadLog::path_for("wal_replay"))
+                .get_file_size(),
+            0);
+}
@@ -0,0 +1,80 @@
+#include <gtest/gtest.h>
+
+#include "../src/lib/where.hpp"
+
+static Automata::Predicate leaf(std::size_t restriction) {
+  return {Parser::OperatorE::AND, restriction, {}};
+}
+
+static Automata::Predicate node(Parser::OperatorE op,
+                                std::vector<Automata::Predicate> children) {
+  return {op, std::nullopt, std::move(children)};
+}
+
+// Restriction `r` keeps the rows that are multiples of `r + 2`, and says
+// how many rows it was asked about
+struct Multiples {
+  std::vector<std::size_t> asked;
+
+  Where::Bits operator()(std::size_t r, const Where::Bits &within) {
+    Where::Bits matched(within.size(), 0);
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < within.size() * 64; i++) {
+      if (!Bitmap::test(within, i))
+        continue;
+      count++;
+      if (i % (r + 2) == 0)
+        Bitmap::set(matched, i);
+    }
+    asked.push_back(count);
+    return matched;
+  }
+};
+
+static Where::Bits all_rows(std::size_t rows) {
+  Where::Bits bits(Bitmap::words_for(rows), ~std::uint64_t{0});
+  bits.back() &= Bitmap::tail_mask(rows);
+  return bits;
+}
+
+TEST(Where, AndOrTreesMatchRowByRow) {
+  // multiple of 2 AND (multiple of 3 OR multiple of 5)
+  auto tree = node(Parser::OperatorE::AND,
+                   {leaf(0), node(Parser::OperatorE::OR, {leaf(1), leaf(3)})});
+  Multiples multiples;
+  auto cost = [](std::size_t) { return Where::Estimate{1, 0.5}; };
+  auto selected = Where::evaluate(tree, all_rows(200), multiples, cost);
+
+  for (std::size_t i = 0; i < 200; i++)
+    EXPECT_EQ(Bitmap::test(selected, i), i % 2 == 0 && (i % 3 == 0 || i % 5 == 0))
+        << i;
+
+  // Each restriction only saw the rows left undecided before it
+  ASSERT_EQ(multiples.asked.size(), 3);
+  EXPECT_EQ(multiples.asked[0], 200);
+  EXPECT_EQ(multiples.asked[1], 100);
+  EXPECT_EQ(multiples.asked[2], 100 - 34);
+}
+
+TEST(Where, CheapAndSelectiveGoFirstAndEmptyStops) {
+  auto tree = node(Parser::OperatorE::AND, {leaf(0), leaf(1), leaf(2)});
+  std::vector<std::size_t> order;
+  auto select = [&](std::size_t r, const Where::Bits &within) {
+    order.push_back(r);
+    return Where::Bits(within.size(), r == 1 ? 0 : ~std::uint64_t{0});
+  };
+  auto cost = [](std::size_t r) {
+    return r == 1 ? Where::Estimate{1, 0.1} : Where::Estimate{8, 0.5};
+  };
+  auto selected = Where::evaluate(tree, all_rows(100), select, cost);
+
+  EXPECT_FALSE(Bitmap::any(selected));
+  EXPECT_EQ(order, std::vector<std::size_t>{1});
+}
+
+TEST(Where, NoRestrictionsKeepEveryRow) {
+  auto cost = [](std::size_t) { return Where::Estimate{1, 0.5}; };
+  auto select = [](std::size_t, const Where::Bits &) { return Where::Bits{}; };
+  EXPECT_EQ(Where::evaluate(Automata::Predicate{}, all_rows(70), select, cost),
+            all_rows(70));
+}